@@ -0,0 +1,84 @@
+#version 430 core
+
+// Deferred lighting, first pass (src/Deferred.h): one full-screen triangle
+// applies the directional light to every lit pixel and copies unlit ones.
+
+out vec4 FragColor;
+
+// Directional light
+struct DirectionalLight
+{
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// Per-frame camera, shared with every program (src/FrameUniforms.h)
+layout(std140, binding = 0) uniform CameraBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+};
+
+// G-buffer, written by gbuffer.frag; declared from src/DeferredUniforms.h
+#pragma uniforms
+
+vec3 DecodeNormal(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+// world position from the depth buffer: view space through the projection,
+// then back through the (rigid) view matrix
+vec3 WorldPosition(ivec2 pixel, float depth)
+{
+    vec2 ndc = (vec2(pixel) + 0.5) / vec2(textureSize(uDepthMap, 0)) * 2.0 - 1.0;
+    float viewZ = -uProjection[3][2] / (depth * 2.0 - 1.0 + uProjection[2][2]);
+    vec3 viewPos = vec3(ndc * -viewZ / vec2(uProjection[0][0], uProjection[1][1]), viewZ);
+    return transpose(mat3(uView)) * (viewPos - uView[3].xyz);
+}
+
+// Per-frame lights (src/FrameUniforms.h); the point and spot light come
+// through the light volumes instead
+layout(std140, binding = 1) uniform LightBlock
+{
+    DirectionalLight dirLight;
+};
+
+vec3 CalcDirectional(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 color)
+{
+    vec3 lightDir = normalize(-light.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    vec3 ambient  = light.ambient  * color;
+    vec3 diffuse  = light.diffuse  * diff * color;
+    vec3 specular = light.specular * spec;
+    return ambient + diffuse + specular;
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(uDepthMap, pixel, 0).r;
+    if (depth == 1.0)
+        discard;    // background: keeps the clear colour
+
+    vec4 albedo = texelFetch(uAlbedoMap, pixel, 0);
+    if (albedo.a < 0.5)
+    {
+        FragColor = vec4(albedo.rgb, 1.0);
+        return;
+    }
+
+    vec3 norm    = DecodeNormal(texelFetch(uNormalMap, pixel, 0).rg);
+    vec3 viewDir = normalize(uViewPos - WorldPosition(pixel, depth));
+    FragColor = vec4(CalcDirectional(dirLight, norm, viewDir, albedo.rgb), 1.0);
+}
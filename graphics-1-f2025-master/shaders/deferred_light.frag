@@ -0,0 +1,162 @@
+#version 430 core
+
+// Deferred lighting, one point or spot light (src/Deferred.h). Runs only on
+// the pixels the stencil pass marked inside the light's volume, with
+// phong.frag's CalcPoint / CalcSpot, added onto the directional pass.
+
+flat in uint vLightID;
+out vec4 FragColor;
+
+// Point light
+struct PointLight
+{
+    vec3 position;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// Spotlight
+struct SpotLight
+{
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// Per-frame camera, shared with every program (src/FrameUniforms.h)
+layout(std140, binding = 0) uniform CameraBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+};
+
+// G-buffer, written by gbuffer.frag; declared from src/DeferredUniforms.h
+#pragma uniforms
+
+vec3 DecodeNormal(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+// world position from the depth buffer: view space through the projection,
+// then back through the (rigid) view matrix
+vec3 WorldPosition(ivec2 pixel, float depth)
+{
+    vec2 ndc = (vec2(pixel) + 0.5) / vec2(textureSize(uDepthMap, 0)) * 2.0 - 1.0;
+    float viewZ = -uProjection[3][2] / (depth * 2.0 - 1.0 + uProjection[2][2]);
+    vec3 viewPos = vec3(ndc * -viewZ / vec2(uProjection[0][0], uProjection[1][1]), viewZ);
+    return transpose(mat3(uView)) * (viewPos - uView[3].xyz);
+}
+
+// src/ClusteredLighting.h
+struct ClusterLight
+{
+    vec4 positionRange;
+    vec4 directionType;         // w: 0 point, 1 spot
+    vec4 ambientCutOff;
+    vec4 diffuseOuterCutOff;
+    vec4 specular;
+    vec4 attenuation;           // constant, linear, quadratic
+    vec4 viewSphere;
+};
+
+layout(std430, binding = 8) readonly buffer DeferredLightBlock
+{
+    ClusterLight uLights[];
+};
+
+vec3 CalcPoint(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 color)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    float distance    = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant +
+                               light.linear * distance +
+                               light.quadratic * distance * distance);
+
+    vec3 ambient  = light.ambient  * color;
+    vec3 diffuse  = light.diffuse  * diff * color;
+    vec3 specular = light.specular * spec;
+
+    ambient  *= attenuation;
+    diffuse  *= attenuation;
+    specular *= attenuation;
+
+    return ambient + diffuse + specular;
+}
+
+vec3 CalcSpot(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 color)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    float distance    = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant +
+                               light.linear * distance +
+                               light.quadratic * distance * distance);
+
+    float theta   = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+    vec3 ambient  = light.ambient  * color;
+    vec3 diffuse  = light.diffuse  * diff * color;
+    vec3 specular = light.specular * spec;
+
+    ambient  *= attenuation * intensity;
+    diffuse  *= attenuation * intensity;
+    specular *= attenuation * intensity;
+
+    return ambient + diffuse + specular;
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 albedo = texelFetch(uAlbedoMap, pixel, 0);
+    if (albedo.a < 0.5)
+        discard;
+
+    vec3 fragPos = WorldPosition(pixel, texelFetch(uDepthMap, pixel, 0).r);
+    vec3 norm    = DecodeNormal(texelFetch(uNormalMap, pixel, 0).rg);
+    vec3 viewDir = normalize(uViewPos - fragPos);
+
+    ClusterLight l = uLights[vLightID];
+    if (l.directionType.w > 0.5)
+    {
+        SpotLight spot = SpotLight(l.positionRange.xyz, l.directionType.xyz,
+            l.ambientCutOff.w, l.diffuseOuterCutOff.w,
+            l.ambientCutOff.rgb, l.diffuseOuterCutOff.rgb, l.specular.rgb,
+            l.attenuation.x, l.attenuation.y, l.attenuation.z);
+        FragColor = vec4(CalcSpot(spot, norm, fragPos, viewDir, albedo.rgb), 1.0);
+    }
+    else
+    {
+        PointLight point = PointLight(l.positionRange.xyz,
+            l.ambientCutOff.rgb, l.diffuseOuterCutOff.rgb, l.specular.rgb,
+            l.attenuation.x, l.attenuation.y, l.attenuation.z);
+        FragColor = vec4(CalcPoint(point, norm, fragPos, viewDir, albedo.rgb), 1.0);
+    }
+}
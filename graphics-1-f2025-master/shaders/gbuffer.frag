@@ -0,0 +1,65 @@
+#version 430 core
+
+// phong.frag's counterpart for --deferred (src/Deferred.h): writes the
+// surface to the G-buffer, the lighting passes shade it later.
+
+in vec2 vTexCoord;
+in vec3 vNormal;
+in vec3 vFragPos;
+in vec3 vTint;
+
+layout(location = 0) out vec4 gAlbedo;  // rgb: base colour, a: 1 if lit
+layout(location = 1) out vec2 gNormal;  // octahedral, RG16_SNORM
+
+// Per-draw data, streamed through a ring buffer (src/FrameUniforms.h)
+layout(std140, binding = 2) uniform ObjectBlock
+{
+    mat4 uModel;
+    vec3 uBaseColor;
+    bool uUseTexture;
+    bool uUseLighting;
+    mat3 uNormalMatrix;     // inverse transpose of uModel, from the CPU
+};
+
+// uDiffuseMap: declared from src/PhongUniforms.h
+#pragma uniforms
+
+// Feature switches. ShaderVariants (src/ShaderVariants.h) builds a
+// program per combination with these defined as constants, so the dead
+// branches compile away; otherwise ObjectBlock decides per fragment.
+#ifndef HAS_TEXTURE
+#define HAS_TEXTURE uUseTexture
+#endif
+#ifndef HAS_LIGHTING
+#define HAS_LIGHTING uUseLighting
+#endif
+
+vec3 GetBaseColor()
+{
+    if (HAS_TEXTURE)
+    {
+        return texture(uDiffuseMap, vTexCoord).rgb;
+    }
+    else
+    {
+        return uBaseColor;
+    }
+}
+
+vec2 SignNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// unit vector -> square: the octahedron's faces folded flat
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * SignNotZero(n.xy);
+}
+
+void main()
+{
+    gAlbedo = vec4(GetBaseColor() * vTint, HAS_LIGHTING ? 1.0 : 0.0);
+    gNormal = EncodeNormal(normalize(vNormal));
+}
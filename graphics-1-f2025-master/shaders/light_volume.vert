@@ -0,0 +1,58 @@
+#version 430 core
+
+// A light's volume for the deferred passes (src/Deferred.h): the unit
+// sphere scaled to a point light's range, or the unit cone stretched over
+// a spot light's outer cone. aDrawID is the light's index.
+
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in uint aDrawID;
+
+flat out uint vLightID;
+
+// Per-frame camera, shared with every program (src/FrameUniforms.h)
+layout(std140, binding = 0) uniform CameraBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+};
+
+// src/ClusteredLighting.h
+struct ClusterLight
+{
+    vec4 positionRange;
+    vec4 directionType;         // w: 0 point, 1 spot
+    vec4 ambientCutOff;
+    vec4 diffuseOuterCutOff;
+    vec4 specular;
+    vec4 attenuation;           // constant, linear, quadratic
+    vec4 viewSphere;
+};
+
+layout(std430, binding = 8) readonly buffer DeferredLightBlock
+{
+    ClusterLight uLights[];
+};
+
+void main()
+{
+    ClusterLight l = uLights[aDrawID];
+    vec3 worldPos;
+    if (l.directionType.w > 0.5)
+    {
+        // cone along the spot direction: length = range, radius from the outer angle
+        vec3 axis = normalize(l.directionType.xyz);
+        vec3 side = normalize(cross(axis, abs(axis.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+        vec3 up = cross(side, axis);
+        float cosOuter = l.diffuseOuterCutOff.w;
+        float radius = l.positionRange.w * sqrt(max(1.0 - cosOuter * cosOuter, 0.0)) / max(cosOuter, 0.01);
+        worldPos = l.positionRange.xyz + (side * aPos.x + up * aPos.y) * radius + axis * (aPos.z * l.positionRange.w);
+    }
+    else
+    {
+        worldPos = l.positionRange.xyz + aPos * l.positionRange.w;
+    }
+
+    vLightID = aDrawID;
+    gl_Position = uProjection * uView * vec4(worldPos, 1.0);
+}
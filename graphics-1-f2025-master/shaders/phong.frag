@@ -0,0 +1,231 @@
+#version 430 core
+
+in vec2 vTexCoord;
+in vec3 vNormal;
+in vec3 vFragPos;
+in vec3 vTint;
+out vec4 FragColor;
+
+// Directional light
+struct DirectionalLight
+{
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// Point light
+struct PointLight
+{
+    vec3 position;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// Spotlight
+struct SpotLight
+{
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// Per-frame camera, shared with every program (src/FrameUniforms.h)
+layout(std140, binding = 0) uniform CameraBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+};
+
+// Per-frame lights (src/FrameUniforms.h)
+layout(std140, binding = 1) uniform LightBlock
+{
+    DirectionalLight dirLight;
+    PointLight       pointLight;
+    SpotLight        spotLight;
+};
+
+// Per-draw data, streamed through a ring buffer (src/FrameUniforms.h)
+layout(std140, binding = 2) uniform ObjectBlock
+{
+    mat4 uModel;
+    vec3 uBaseColor;
+    bool uUseTexture;
+    bool uUseLighting;
+    mat3 uNormalMatrix;     // inverse transpose of uModel, from the CPU
+};
+
+// uDiffuseMap, uDirShadowMap, uSpotShadowMap: declared from src/PhongUniforms.h
+#pragma uniforms
+
+// Feature switches. ShaderVariants (src/ShaderVariants.h) builds a
+// program per combination with these defined as constants, so the dead
+// branches compile away; otherwise ObjectBlock decides per fragment.
+#ifndef HAS_TEXTURE
+#define HAS_TEXTURE uUseTexture
+#endif
+#ifndef HAS_LIGHTING
+#define HAS_LIGHTING uUseLighting
+#endif
+
+// Lights that never move, folded into constants by the static-lights variants
+#ifdef STATIC_DIR_LIGHT
+const DirectionalLight kStaticDirLight = STATIC_DIR_LIGHT;
+#define dirLight kStaticDirLight
+#endif
+#ifdef STATIC_SPOT_LIGHT
+const SpotLight kStaticSpotLight = STATIC_SPOT_LIGHT;
+#define spotLight kStaticSpotLight
+#endif
+
+// Shadow maps of dirLight and spotLight (src/ShadowMaps.h): 1 lit, 0 in
+// shadow. The lookup point is pushed off the surface by about a texel.
+#ifdef HAS_SHADOWS
+layout(std140, binding = 4) uniform ShadowBlock
+{
+    mat4 uDirShadowMatrix;      // world to map texture coordinates and depth
+    mat4 uSpotShadowMatrix;
+    float uDirTexelSize;        // world units
+    float uSpotTexelSize;       // world units per unit of distance from the light
+};
+
+float Shadow(sampler2DShadow map, mat4 shadowMatrix, vec3 fragPos, vec3 normal, float offset)
+{
+    vec4 p = shadowMatrix * vec4(fragPos + normal * offset, 1.0);
+    p.xyz /= p.w;
+    if (p.z >= 1.0)
+        return 1.0;     // beyond the map's far plane
+    return texture(map, p.xyz);
+}
+
+float DirShadow(vec3 normal, vec3 fragPos)
+{
+    return Shadow(uDirShadowMap, uDirShadowMatrix, fragPos, normal, 1.5 * uDirTexelSize);
+}
+
+float SpotShadow(vec3 normal, vec3 fragPos)
+{
+    float offset = 1.5 * uSpotTexelSize * length(spotLight.position - fragPos);
+    return Shadow(uSpotShadowMap, uSpotShadowMatrix, fragPos, normal, offset);
+}
+#else
+float DirShadow(vec3 normal, vec3 fragPos) { return 1.0; }
+float SpotShadow(vec3 normal, vec3 fragPos) { return 1.0; }
+#endif
+
+vec3 GetBaseColor()
+{
+    if (HAS_TEXTURE)
+    {
+        return texture(uDiffuseMap, vTexCoord).rgb;
+    }
+    else
+    {
+        return uBaseColor;
+    }
+}
+
+vec3 CalcDirectional(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 color, float shadow)
+{
+    vec3 lightDir = normalize(-light.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    vec3 ambient  = light.ambient  * color;
+    vec3 diffuse  = light.diffuse  * diff * color;
+    vec3 specular = light.specular * spec;
+
+    diffuse  *= shadow;
+    specular *= shadow;
+    return ambient + diffuse + specular;
+}
+
+vec3 CalcPoint(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 color)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    float distance    = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant +
+                               light.linear * distance +
+                               light.quadratic * distance * distance);
+
+    vec3 ambient  = light.ambient  * color;
+    vec3 diffuse  = light.diffuse  * diff * color;
+    vec3 specular = light.specular * spec;
+
+    ambient  *= attenuation;
+    diffuse  *= attenuation;
+    specular *= attenuation;
+
+    return ambient + diffuse + specular;
+}
+
+vec3 CalcSpot(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 color, float shadow)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    float distance    = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant +
+                               light.linear * distance +
+                               light.quadratic * distance * distance);
+
+    float theta   = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+    vec3 ambient  = light.ambient  * color;
+    vec3 diffuse  = light.diffuse  * diff * color;
+    vec3 specular = light.specular * spec;
+
+    ambient  *= attenuation * intensity;
+    diffuse  *= attenuation * intensity * shadow;
+    specular *= attenuation * intensity * shadow;
+
+    return ambient + diffuse + specular;
+}
+
+void main()
+{
+    vec3 color = GetBaseColor() * vTint;
+
+    // Unlit option – used for ground plane
+    if (!HAS_LIGHTING)
+    {
+        FragColor = vec4(color, 1.0);
+        return;
+    }
+
+    vec3 norm    = normalize(vNormal);
+    vec3 viewDir = normalize(uViewPos - vFragPos);
+
+    vec3 result = vec3(0.0);
+
+    result += CalcDirectional(dirLight, norm, viewDir, color, DirShadow(norm, vFragPos));
+    result += CalcPoint(pointLight, norm, vFragPos, viewDir, color);
+    result += CalcSpot(spotLight, norm, vFragPos, viewDir, color, SpotShadow(norm, vFragPos));
+
+    FragColor = vec4(result, 1.0);
+}
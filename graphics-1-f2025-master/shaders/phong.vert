@@ -0,0 +1,45 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec3 aNormal;
+
+out vec2 vTexCoord;
+out vec3 vNormal;
+out vec3 vFragPos;
+out vec3 vTint;
+
+// Per-frame camera, shared with every program (src/FrameUniforms.h)
+layout(std140, binding = 0) uniform CameraBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+};
+
+// Per-draw data, streamed through a ring buffer (src/FrameUniforms.h)
+layout(std140, binding = 2) uniform ObjectBlock
+{
+    mat4 uModel;
+    vec3 uBaseColor;
+    bool uUseTexture;
+    bool uUseLighting;
+    mat3 uNormalMatrix;     // inverse transpose of uModel, from the CPU
+};
+
+void main()
+{
+    vec4 worldPos = uModel * vec4(aPos, 1.0);
+    vFragPos = worldPos.xyz;
+
+#ifdef NORMAL_MATRIX_FROM_MODEL
+    // the old per-vertex inverse, kept for --vertex-bench
+    vNormal = mat3(transpose(inverse(uModel))) * aNormal;
+#else
+    vNormal = uNormalMatrix * aNormal;
+#endif
+    vTexCoord = aTexCoord;
+    vTint = vec3(1.0);
+
+    gl_Position = uProjection * uView * worldPos;
+}
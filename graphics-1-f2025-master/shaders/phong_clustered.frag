@@ -0,0 +1,221 @@
+#version 430 core
+
+// phong.frag for --lights N: the directional light as before, then every
+// point and spot light in this fragment's cluster (src/ClusteredLighting.h)
+
+in vec2 vTexCoord;
+in vec3 vNormal;
+in vec3 vFragPos;
+in vec3 vTint;
+out vec4 FragColor;
+
+// Directional light
+struct DirectionalLight
+{
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// Point light
+struct PointLight
+{
+    vec3 position;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// Spotlight
+struct SpotLight
+{
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// Per-frame camera, shared with every program (src/FrameUniforms.h)
+layout(std140, binding = 0) uniform CameraBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+};
+
+// Per-frame lights (src/FrameUniforms.h). Only dirLight is read here: the
+// point and spot light are the first two entries of uLights.
+layout(std140, binding = 1) uniform LightBlock
+{
+    DirectionalLight dirLight;
+    PointLight       pointLight;
+    SpotLight        spotLight;
+};
+
+// Point and spot lights; range is where the attenuation has faded out
+struct ClusterLight
+{
+    vec4 positionRange;
+    vec4 directionType;         // w: 0 point, 1 spot
+    vec4 ambientCutOff;
+    vec4 diffuseOuterCutOff;
+    vec4 specular;
+    vec4 attenuation;           // constant, linear, quadratic
+    vec4 viewSphere;            // for the light assignment only
+};
+
+layout(std430, binding = 5) readonly buffer ClusterLightBlock
+{
+    uvec4 uClusterGrid;         // clusters in x, y, z; light count
+    vec4  uClusterDepth;        // near, far, slice scale, slice bias
+    vec4  uClusterProjection;   // projection x and y scale, tile size in pixels
+    vec4  uClusterViewport;
+    ClusterLight uLights[];
+};
+
+// offset and count into uClusterIndices, per cluster
+layout(std430, binding = 6) readonly buffer ClusterGridBlock
+{
+    uvec2 uClusterRanges[];
+};
+
+layout(std430, binding = 7) readonly buffer ClusterIndexBlock
+{
+    uint uClusterIndices[];
+};
+
+// Per-draw data, streamed through a ring buffer (src/FrameUniforms.h)
+layout(std140, binding = 2) uniform ObjectBlock
+{
+    mat4 uModel;
+    vec3 uBaseColor;
+    bool uUseTexture;
+    bool uUseLighting;
+    mat3 uNormalMatrix;     // inverse transpose of uModel, from the CPU
+};
+
+// uDiffuseMap: declared from src/PhongUniforms.h
+#pragma uniforms
+
+// Feature switches. ShaderVariants (src/ShaderVariants.h) builds a
+// program per combination with these defined as constants, so the dead
+// branches compile away; otherwise ObjectBlock decides per fragment.
+#ifndef HAS_TEXTURE
+#define HAS_TEXTURE uUseTexture
+#endif
+#ifndef HAS_LIGHTING
+#define HAS_LIGHTING uUseLighting
+#endif
+
+// Lights that never move, folded into constants by the static-lights variants
+#ifdef STATIC_DIR_LIGHT
+const DirectionalLight kStaticDirLight = STATIC_DIR_LIGHT;
+#define dirLight kStaticDirLight
+#endif
+
+vec3 GetBaseColor()
+{
+    if (HAS_TEXTURE)
+    {
+        return texture(uDiffuseMap, vTexCoord).rgb;
+    }
+    else
+    {
+        return uBaseColor;
+    }
+}
+
+vec3 CalcDirectional(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 color)
+{
+    vec3 lightDir = normalize(-light.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    vec3 ambient  = light.ambient  * color;
+    vec3 diffuse  = light.diffuse  * diff * color;
+    vec3 specular = light.specular * spec;
+    return ambient + diffuse + specular;
+}
+
+// CalcPoint / CalcSpot of phong.frag, in one
+vec3 CalcClusterLight(ClusterLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 color)
+{
+    float distance = length(light.positionRange.xyz - fragPos);
+    if (distance > light.positionRange.w)
+        return vec3(0.0);
+
+    vec3 lightDir = normalize(light.positionRange.xyz - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    float attenuation = 1.0 / (light.attenuation.x +
+                               light.attenuation.y * distance +
+                               light.attenuation.z * distance * distance);
+
+    float intensity = 1.0;
+    if (light.directionType.w > 0.5)
+    {
+        float theta   = dot(lightDir, normalize(-light.directionType.xyz));
+        float epsilon = light.ambientCutOff.w - light.diffuseOuterCutOff.w;
+        intensity = clamp((theta - light.diffuseOuterCutOff.w) / epsilon, 0.0, 1.0);
+    }
+
+    vec3 ambient  = light.ambientCutOff.rgb      * color;
+    vec3 diffuse  = light.diffuseOuterCutOff.rgb * diff * color;
+    vec3 specular = light.specular.rgb           * spec;
+
+    ambient  *= attenuation * intensity;
+    diffuse  *= attenuation * intensity;
+    specular *= attenuation * intensity;
+
+    return ambient + diffuse + specular;
+}
+
+uint ClusterIndex()
+{
+    float viewDepth = -(uView * vec4(vFragPos, 1.0)).z;
+    int slice = int(floor(log(viewDepth) * uClusterDepth.z - uClusterDepth.w));
+    uvec3 cluster = uvec3(
+        min(uvec2(gl_FragCoord.xy / uClusterProjection.zw), uClusterGrid.xy - 1u),
+        uint(clamp(slice, 0, int(uClusterGrid.z) - 1)));
+    return (cluster.z * uClusterGrid.y + cluster.y) * uClusterGrid.x + cluster.x;
+}
+
+void main()
+{
+    vec3 color = GetBaseColor() * vTint;
+
+    // Unlit option – used for ground plane
+    if (!HAS_LIGHTING)
+    {
+        FragColor = vec4(color, 1.0);
+        return;
+    }
+
+    vec3 norm    = normalize(vNormal);
+    vec3 viewDir = normalize(uViewPos - vFragPos);
+
+    vec3 result = vec3(0.0);
+
+    result += CalcDirectional(dirLight, norm, viewDir, color);
+
+    uvec2 range = uClusterRanges[ClusterIndex()];
+    for (uint i = 0u; i < range.y; ++i)
+        result += CalcClusterLight(uLights[uClusterIndices[range.x + i]], norm, vFragPos, viewDir, color);
+
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,47 @@
+#version 430 core
+
+// phong.vert for MeshScene: per-draw model matrix and tint come from an
+// SSBO indexed by aDrawID, which baseInstance selects (src/MeshBatch.h)
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec3 aNormal;
+layout (location = 3) in uint aDrawID;
+
+out vec2 vTexCoord;
+out vec3 vNormal;
+out vec3 vFragPos;
+out vec3 vTint;
+
+// Per-frame camera, shared with every program (src/FrameUniforms.h)
+layout(std140, binding = 0) uniform CameraBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+};
+
+struct MeshInstance
+{
+    mat4 model;
+    mat3 normalMatrix;
+    vec4 tint;
+};
+
+layout(std430, binding = 0) readonly buffer InstanceBlock
+{
+    MeshInstance instances[];
+};
+
+void main()
+{
+    MeshInstance inst = instances[aDrawID];
+    vec4 worldPos = inst.model * vec4(aPos, 1.0);
+    vFragPos = worldPos.xyz;
+
+    vNormal = inst.normalMatrix * aNormal;
+    vTexCoord = aTexCoord;
+    vTint = inst.tint.rgb;
+
+    gl_Position = uProjection * uView * worldPos;
+}
@@ -0,0 +1,46 @@
+#version 430 core
+
+// phong.vert for the flock: the model matrix and tint come per instance
+// from an SSBO instead of ObjectBlock (src/Flock.h)
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec3 aNormal;
+
+out vec2 vTexCoord;
+out vec3 vNormal;
+out vec3 vFragPos;
+out vec3 vTint;
+
+// Per-frame camera, shared with every program (src/FrameUniforms.h)
+layout(std140, binding = 0) uniform CameraBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+};
+
+struct BirdInstance
+{
+    mat4 model;
+    mat3 normalMatrix;
+    vec4 tint;
+};
+
+layout(std430, binding = 0) readonly buffer InstanceBlock
+{
+    BirdInstance instances[];
+};
+
+void main()
+{
+    BirdInstance inst = instances[gl_InstanceID];
+    vec4 worldPos = inst.model * vec4(aPos, 1.0);
+    vFragPos = worldPos.xyz;
+
+    vNormal = inst.normalMatrix * aNormal;
+    vTexCoord = aTexCoord;
+    vTint = inst.tint.rgb;
+
+    gl_Position = uProjection * uView * worldPos;
+}
@@ -0,0 +1,8 @@
+#version 430 core
+
+// Shadow map caster pass (src/ShadowMaps.h): the targets have no colour,
+// only the depth written by the rasterizer matters.
+
+void main()
+{
+}
@@ -0,0 +1,24 @@
+#version 430 core
+
+// Shadow map caster pass (src/ShadowMaps.h): depth only, the model matrix
+// from ObjectBlock and the light's view-projection from uLightMatrix
+
+layout (location = 0) in vec3 aPos;
+
+// Per-draw data, streamed through a ring buffer (src/FrameUniforms.h)
+layout(std140, binding = 2) uniform ObjectBlock
+{
+    mat4 uModel;
+    vec3 uBaseColor;
+    bool uUseTexture;
+    bool uUseLighting;
+    mat3 uNormalMatrix;
+};
+
+// uLightMatrix: declared from src/ShadowUniforms.h
+#pragma uniforms
+
+void main()
+{
+    gl_Position = uLightMatrix * uModel * vec4(aPos, 1.0);
+}
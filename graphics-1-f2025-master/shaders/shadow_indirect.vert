@@ -0,0 +1,27 @@
+#version 430 core
+
+// shadow.vert for MeshScene: the model matrix comes per draw from an SSBO
+// indexed by aDrawID, which baseInstance selects (src/MeshBatch.h)
+
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in uint aDrawID;
+
+struct MeshInstance
+{
+    mat4 model;
+    mat3 normalMatrix;
+    vec4 tint;
+};
+
+layout(std430, binding = 0) readonly buffer InstanceBlock
+{
+    MeshInstance instances[];
+};
+
+// uLightMatrix: declared from src/ShadowUniforms.h
+#pragma uniforms
+
+void main()
+{
+    gl_Position = uLightMatrix * instances[aDrawID].model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,26 @@
+#version 430 core
+
+// shadow.vert for the flock: the model matrix comes per instance from an
+// SSBO instead of ObjectBlock (src/Flock.h)
+
+layout (location = 0) in vec3 aPos;
+
+struct BirdInstance
+{
+    mat4 model;
+    mat3 normalMatrix;
+    vec4 tint;
+};
+
+layout(std430, binding = 0) readonly buffer InstanceBlock
+{
+    BirdInstance instances[];
+};
+
+// uLightMatrix: declared from src/ShadowUniforms.h
+#pragma uniforms
+
+void main()
+{
+    gl_Position = uLightMatrix * instances[gl_InstanceID].model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,50 @@
+#version 430 core
+
+// ID pass of --visibility (src/VisibilityBuffer.h): one 32-bit ID per
+// triangle of every instance, 0 where nothing was drawn.
+
+flat in uint vInstance;
+layout(location = 0) out uint VisibilityID;
+
+struct BirdInstance
+{
+    mat4 model;
+    mat3 normalMatrix;
+    vec4 tint;
+};
+
+// instances of every mesh, the flock's first (src/Flock.h)
+layout(std430, binding = 0) readonly buffer InstanceBlock
+{
+    BirdInstance instances[];
+};
+
+// src/VisibilityBuffer.h
+struct VisibilityMesh
+{
+    uint firstVertex;
+    uint triangleCount;
+    uint firstInstance;
+    uint firstID;
+    vec3 baseColor;
+    uint flags;                 // 1: textured, 2: lit
+};
+
+// every mesh's vertices: position, uv, normal (main.cpp's Vertex)
+layout(std430, binding = 9) readonly buffer VisibilityVertexBlock
+{
+    float uVertices[];
+};
+
+layout(std430, binding = 10) readonly buffer VisibilityMeshBlock
+{
+    VisibilityMesh uMeshes[];
+};
+
+#pragma uniforms
+
+void main()
+{
+    VisibilityMesh mesh = uMeshes[uMesh];
+    VisibilityID = mesh.firstID + vInstance * mesh.triangleCount + uint(gl_PrimitiveID) + 1u;
+}
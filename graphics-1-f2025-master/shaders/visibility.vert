@@ -0,0 +1,62 @@
+#version 430 core
+
+// ID pass of --visibility (src/VisibilityBuffer.h): only positions, fetched
+// from the storage buffer, so no vertex attributes are bound.
+
+flat out uint vInstance;
+
+// Per-frame camera, shared with every program (src/FrameUniforms.h)
+layout(std140, binding = 0) uniform CameraBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+};
+
+struct BirdInstance
+{
+    mat4 model;
+    mat3 normalMatrix;
+    vec4 tint;
+};
+
+// instances of every mesh, the flock's first (src/Flock.h)
+layout(std430, binding = 0) readonly buffer InstanceBlock
+{
+    BirdInstance instances[];
+};
+
+// src/VisibilityBuffer.h
+struct VisibilityMesh
+{
+    uint firstVertex;
+    uint triangleCount;
+    uint firstInstance;
+    uint firstID;
+    vec3 baseColor;
+    uint flags;                 // 1: textured, 2: lit
+};
+
+// every mesh's vertices: position, uv, normal (main.cpp's Vertex)
+layout(std430, binding = 9) readonly buffer VisibilityVertexBlock
+{
+    float uVertices[];
+};
+
+layout(std430, binding = 10) readonly buffer VisibilityMeshBlock
+{
+    VisibilityMesh uMeshes[];
+};
+
+// uMesh: declared from src/VisibilityUniforms.h
+#pragma uniforms
+
+void main()
+{
+    uint v = uint(gl_VertexID) * 8u;
+    vec3 pos = vec3(uVertices[v], uVertices[v + 1u], uVertices[v + 2u]);
+    mat4 model = instances[uMeshes[uMesh].firstInstance + uint(gl_InstanceID)].model;
+
+    vInstance = uint(gl_InstanceID);
+    gl_Position = uProjection * uView * (model * vec4(pos, 1.0));
+}
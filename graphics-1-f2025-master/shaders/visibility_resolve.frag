@@ -0,0 +1,262 @@
+#version 430 core
+
+// Shading pass of --visibility (src/VisibilityBuffer.h): one full-screen
+// triangle, one run per pixel. Rebuilds what phong.vert would have
+// interpolated for the triangle in the ID buffer and lights it like
+// phong.frag.
+
+out vec4 FragColor;
+
+// Directional light
+struct DirectionalLight
+{
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// Point light
+struct PointLight
+{
+    vec3 position;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// Spotlight
+struct SpotLight
+{
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// Per-frame camera, shared with every program (src/FrameUniforms.h)
+layout(std140, binding = 0) uniform CameraBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+};
+
+// Per-frame lights (src/FrameUniforms.h)
+layout(std140, binding = 1) uniform LightBlock
+{
+    DirectionalLight dirLight;
+    PointLight       pointLight;
+    SpotLight        spotLight;
+};
+
+struct BirdInstance
+{
+    mat4 model;
+    mat3 normalMatrix;
+    vec4 tint;
+};
+
+// instances of every mesh, the flock's first (src/Flock.h)
+layout(std430, binding = 0) readonly buffer InstanceBlock
+{
+    BirdInstance instances[];
+};
+
+// src/VisibilityBuffer.h
+struct VisibilityMesh
+{
+    uint firstVertex;
+    uint triangleCount;
+    uint firstInstance;
+    uint firstID;
+    vec3 baseColor;
+    uint flags;                 // 1: textured, 2: lit
+};
+
+// every mesh's vertices: position, uv, normal (main.cpp's Vertex)
+layout(std430, binding = 9) readonly buffer VisibilityVertexBlock
+{
+    float uVertices[];
+};
+
+layout(std430, binding = 10) readonly buffer VisibilityMeshBlock
+{
+    VisibilityMesh uMeshes[];
+};
+
+// uVisibilityMap, uDiffuseMap, uMeshCount: declared from src/VisibilityUniforms.h
+#pragma uniforms
+
+vec3 CalcDirectional(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 color)
+{
+    vec3 lightDir = normalize(-light.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    vec3 ambient  = light.ambient  * color;
+    vec3 diffuse  = light.diffuse  * diff * color;
+    vec3 specular = light.specular * spec;
+    return ambient + diffuse + specular;
+}
+
+vec3 CalcPoint(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 color)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    float distance    = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant +
+                               light.linear * distance +
+                               light.quadratic * distance * distance);
+
+    vec3 ambient  = light.ambient  * color;
+    vec3 diffuse  = light.diffuse  * diff * color;
+    vec3 specular = light.specular * spec;
+
+    ambient  *= attenuation;
+    diffuse  *= attenuation;
+    specular *= attenuation;
+
+    return ambient + diffuse + specular;
+}
+
+vec3 CalcSpot(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 color)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    float distance    = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant +
+                               light.linear * distance +
+                               light.quadratic * distance * distance);
+
+    float theta   = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+    vec3 ambient  = light.ambient  * color;
+    vec3 diffuse  = light.diffuse  * diff * color;
+    vec3 specular = light.specular * spec;
+
+    ambient  *= attenuation * intensity;
+    diffuse  *= attenuation * intensity;
+    specular *= attenuation * intensity;
+
+    return ambient + diffuse + specular;
+}
+
+struct Triangle
+{
+    vec3 p0, e1, e2;            // world space: corner and the two edges leaving it
+};
+
+// world-space view ray through a point of the window
+vec3 ViewRay(vec2 fragCoord)
+{
+    vec2 ndc = fragCoord / vec2(textureSize(uVisibilityMap, 0)) * 2.0 - 1.0;
+    vec3 viewDir = vec3(ndc / vec2(uProjection[0][0], uProjection[1][1]), -1.0);
+    return transpose(mat3(uView)) * viewDir;
+}
+
+// Barycentrics (of corners 1 and 2) where the ray from the eye hits the
+// triangle's plane; Moller-Trumbore without the inside tests
+vec2 Barycentrics(Triangle tri, vec3 dir)
+{
+    vec3 p = cross(dir, tri.e2);
+    float invDet = 1.0 / dot(tri.e1, p);
+    vec3 s = uViewPos - tri.p0;
+    vec3 q = cross(s, tri.e1);
+    return vec2(dot(s, p), dot(dir, q)) * invDet;
+}
+
+vec3 FetchVec3(uint v, uint offset)
+{
+    return vec3(uVertices[v + offset], uVertices[v + offset + 1u], uVertices[v + offset + 2u]);
+}
+
+vec2 FetchVec2(uint v, uint offset)
+{
+    return vec2(uVertices[v + offset], uVertices[v + offset + 1u]);
+}
+
+void main()
+{
+    uint id = texelFetch(uVisibilityMap, ivec2(gl_FragCoord.xy), 0).r;
+    if (id == 0u)
+        discard;    // background: keeps the clear colour
+    id -= 1u;
+
+    // ID ranges are in mesh order
+    int meshIndex = 0;
+    for (int i = 1; i < uMeshCount; ++i)
+        if (id >= uMeshes[i].firstID)
+            meshIndex = i;
+    VisibilityMesh mesh = uMeshes[meshIndex];
+    uint local    = id - mesh.firstID;
+    uint instance = local / mesh.triangleCount;
+    uint v0 = (mesh.firstVertex + (local - instance * mesh.triangleCount) * 3u) * 8u;
+    uint v1 = v0 + 8u;
+    uint v2 = v0 + 16u;
+
+    BirdInstance inst = instances[mesh.firstInstance + instance];
+    Triangle tri;
+    tri.p0 = (inst.model * vec4(FetchVec3(v0, 0u), 1.0)).xyz;
+    tri.e1 = (inst.model * vec4(FetchVec3(v1, 0u), 1.0)).xyz - tri.p0;
+    tri.e2 = (inst.model * vec4(FetchVec3(v2, 0u), 1.0)).xyz - tri.p0;
+
+    vec3 dir = ViewRay(gl_FragCoord.xy);
+    vec2 b = Barycentrics(tri, dir);
+    vec3 fragPos = tri.p0 + tri.e1 * b.x + tri.e2 * b.y;
+
+    vec3 color = mesh.baseColor;
+    if ((mesh.flags & 1u) != 0u)
+    {
+        // texture footprint from the barycentrics one pixel over
+        vec2 uv0 = FetchVec2(v0, 3u);
+        vec2 du = FetchVec2(v1, 3u) - uv0;
+        vec2 dv = FetchVec2(v2, 3u) - uv0;
+        vec2 bx = Barycentrics(tri, ViewRay(gl_FragCoord.xy + vec2(1.0, 0.0))) - b;
+        vec2 by = Barycentrics(tri, ViewRay(gl_FragCoord.xy + vec2(0.0, 1.0))) - b;
+        vec2 uv = uv0 + du * b.x + dv * b.y;
+        color = textureGrad(uDiffuseMap, uv, du * bx.x + dv * bx.y, du * by.x + dv * by.y).rgb;
+    }
+    color *= inst.tint.rgb;
+
+    // Unlit option – used for ground plane
+    if ((mesh.flags & 2u) == 0u)
+    {
+        FragColor = vec4(color, 1.0);
+        return;
+    }
+
+    vec3 n0 = FetchVec3(v0, 5u);
+    vec3 normal = n0 + (FetchVec3(v1, 5u) - n0) * b.x + (FetchVec3(v2, 5u) - n0) * b.y;
+    vec3 norm    = normalize(inst.normalMatrix * normal);
+    vec3 viewDir = normalize(uViewPos - fragPos);
+
+    vec3 result = vec3(0.0);
+
+    result += CalcDirectional(dirLight, norm, viewDir, color);
+    result += CalcPoint(pointLight, norm, fragPos, viewDir, color);
+    result += CalcSpot(spotLight, norm, fragPos, viewDir, color);
+
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,8 @@
+#version 430 core
+
+// Stencil pass of the deferred light volumes (src/Deferred.h): only the
+// depth test and stencil ops matter, colour writes are off.
+
+void main()
+{
+}
@@ -0,0 +1,325 @@
+#include "BatchTransform.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+namespace
+{
+    // The three arrays of a PointsSoA. Kernels read row r of the matrix's
+    // 3x4 part as m[r], m[4 + r], m[8 + r], m[12 + r].
+    struct Stream3
+    {
+        const float* x;
+        const float* y;
+        const float* z;
+    };
+
+    struct Out3
+    {
+        float* x;
+        float* y;
+        float* z;
+    };
+
+    // ------------------------------------------------------------
+    // Scalar tails, shared by every path
+    // ------------------------------------------------------------
+    void PointsScalar(const float* m, Stream3 in, Out3 out, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const float x = in.x[i], y = in.y[i], z = in.z[i];
+            out.x[i] = m[0] * x + m[4] * y + m[8] * z + m[12];
+            out.y[i] = m[1] * x + m[5] * y + m[9] * z + m[13];
+            out.z[i] = m[2] * x + m[6] * y + m[10] * z + m[14];
+        }
+    }
+
+    void BoxesScalar(const float* m, Stream3 lo, Stream3 hi, Out3 outLo, Out3 outHi, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const float c[3] = { (lo.x[i] + hi.x[i]) * 0.5f, (lo.y[i] + hi.y[i]) * 0.5f, (lo.z[i] + hi.z[i]) * 0.5f };
+            const float e[3] = { (hi.x[i] - lo.x[i]) * 0.5f, (hi.y[i] - lo.y[i]) * 0.5f, (hi.z[i] - lo.z[i]) * 0.5f };
+            float* outs[2][3] = { { outLo.x, outLo.y, outLo.z }, { outHi.x, outHi.y, outHi.z } };
+            for (int r = 0; r < 3; ++r)
+            {
+                const float center = m[r] * c[0] + m[4 + r] * c[1] + m[8 + r] * c[2] + m[12 + r];
+                const float extent = fabsf(m[r]) * e[0] + fabsf(m[4 + r]) * e[1] + fabsf(m[8 + r]) * e[2];
+                outs[0][r][i] = center - extent;
+                outs[1][r][i] = center + extent;
+            }
+        }
+    }
+
+    // ------------------------------------------------------------
+    // SSE: 4 items per step
+    // ------------------------------------------------------------
+    void PointsSSE(const float* m, Stream3 in, Out3 out, size_t count)
+    {
+        __m128 r[12];
+        for (int k = 0; k < 12; ++k)
+            r[k] = _mm_set1_ps(m[(k % 4) * 4 + k / 4]);    // row k / 4, column k % 4
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 x = _mm_loadu_ps(in.x + i), y = _mm_loadu_ps(in.y + i), z = _mm_loadu_ps(in.z + i);
+            float* dst[3] = { out.x + i, out.y + i, out.z + i };
+            for (int row = 0; row < 3; ++row)
+            {
+                const __m128* c = r + row * 4;
+                __m128 v = _mm_add_ps(_mm_mul_ps(c[0], x), _mm_mul_ps(c[1], y));
+                v = _mm_add_ps(v, _mm_mul_ps(c[2], z));
+                _mm_storeu_ps(dst[row], _mm_add_ps(v, c[3]));
+            }
+        }
+        PointsScalar(m, in, out, i, count);
+    }
+
+    void BoxesSSE(const float* m, Stream3 lo, Stream3 hi, Out3 outLo, Out3 outHi, size_t count)
+    {
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        const __m128 half = _mm_set1_ps(0.5f);
+        __m128 r[12], a[12];
+        for (int k = 0; k < 12; ++k)
+        {
+            r[k] = _mm_set1_ps(m[(k % 4) * 4 + k / 4]);
+            a[k] = _mm_and_ps(r[k], absMask);
+        }
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 lx = _mm_loadu_ps(lo.x + i), ly = _mm_loadu_ps(lo.y + i), lz = _mm_loadu_ps(lo.z + i);
+            const __m128 hx = _mm_loadu_ps(hi.x + i), hy = _mm_loadu_ps(hi.y + i), hz = _mm_loadu_ps(hi.z + i);
+            const __m128 cx = _mm_mul_ps(_mm_add_ps(lx, hx), half), ex = _mm_mul_ps(_mm_sub_ps(hx, lx), half);
+            const __m128 cy = _mm_mul_ps(_mm_add_ps(ly, hy), half), ey = _mm_mul_ps(_mm_sub_ps(hy, ly), half);
+            const __m128 cz = _mm_mul_ps(_mm_add_ps(lz, hz), half), ez = _mm_mul_ps(_mm_sub_ps(hz, lz), half);
+            float* dstLo[3] = { outLo.x + i, outLo.y + i, outLo.z + i };
+            float* dstHi[3] = { outHi.x + i, outHi.y + i, outHi.z + i };
+            for (int row = 0; row < 3; ++row)
+            {
+                const __m128* c = r + row * 4;
+                const __m128* ac = a + row * 4;
+                __m128 center = _mm_add_ps(_mm_mul_ps(c[0], cx), _mm_mul_ps(c[1], cy));
+                center = _mm_add_ps(_mm_add_ps(center, _mm_mul_ps(c[2], cz)), c[3]);
+                __m128 extent = _mm_add_ps(_mm_mul_ps(ac[0], ex), _mm_mul_ps(ac[1], ey));
+                extent = _mm_add_ps(extent, _mm_mul_ps(ac[2], ez));
+                _mm_storeu_ps(dstLo[row], _mm_sub_ps(center, extent));
+                _mm_storeu_ps(dstHi[row], _mm_add_ps(center, extent));
+            }
+        }
+        BoxesScalar(m, lo, hi, outLo, outHi, i, count);
+    }
+
+    // ------------------------------------------------------------
+    // AVX2 + FMA: 8 items per step
+    // ------------------------------------------------------------
+    CPU_TARGET_AVX2_FMA void PointsAVX2(const float* m, Stream3 in, Out3 out, size_t count)
+    {
+        __m256 r[12];
+        for (int k = 0; k < 12; ++k)
+            r[k] = _mm256_set1_ps(m[(k % 4) * 4 + k / 4]);
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 x = _mm256_loadu_ps(in.x + i), y = _mm256_loadu_ps(in.y + i), z = _mm256_loadu_ps(in.z + i);
+            float* dst[3] = { out.x + i, out.y + i, out.z + i };
+            for (int row = 0; row < 3; ++row)
+            {
+                const __m256* c = r + row * 4;
+                const __m256 v = _mm256_fmadd_ps(c[0], x, _mm256_fmadd_ps(c[1], y, _mm256_fmadd_ps(c[2], z, c[3])));
+                _mm256_storeu_ps(dst[row], v);
+            }
+        }
+        PointsScalar(m, in, out, i, count);
+    }
+
+    CPU_TARGET_AVX2_FMA void BoxesAVX2(const float* m, Stream3 lo, Stream3 hi, Out3 outLo, Out3 outHi, size_t count)
+    {
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+        const __m256 half = _mm256_set1_ps(0.5f);
+        __m256 r[12], a[12];
+        for (int k = 0; k < 12; ++k)
+        {
+            r[k] = _mm256_set1_ps(m[(k % 4) * 4 + k / 4]);
+            a[k] = _mm256_and_ps(r[k], absMask);
+        }
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 lx = _mm256_loadu_ps(lo.x + i), ly = _mm256_loadu_ps(lo.y + i), lz = _mm256_loadu_ps(lo.z + i);
+            const __m256 hx = _mm256_loadu_ps(hi.x + i), hy = _mm256_loadu_ps(hi.y + i), hz = _mm256_loadu_ps(hi.z + i);
+            const __m256 cx = _mm256_mul_ps(_mm256_add_ps(lx, hx), half), ex = _mm256_mul_ps(_mm256_sub_ps(hx, lx), half);
+            const __m256 cy = _mm256_mul_ps(_mm256_add_ps(ly, hy), half), ey = _mm256_mul_ps(_mm256_sub_ps(hy, ly), half);
+            const __m256 cz = _mm256_mul_ps(_mm256_add_ps(lz, hz), half), ez = _mm256_mul_ps(_mm256_sub_ps(hz, lz), half);
+            float* dstLo[3] = { outLo.x + i, outLo.y + i, outLo.z + i };
+            float* dstHi[3] = { outHi.x + i, outHi.y + i, outHi.z + i };
+            for (int row = 0; row < 3; ++row)
+            {
+                const __m256* c = r + row * 4;
+                const __m256* ac = a + row * 4;
+                const __m256 center = _mm256_fmadd_ps(c[0], cx, _mm256_fmadd_ps(c[1], cy, _mm256_fmadd_ps(c[2], cz, c[3])));
+                const __m256 extent = _mm256_fmadd_ps(ac[0], ex, _mm256_fmadd_ps(ac[1], ey, _mm256_mul_ps(ac[2], ez)));
+                _mm256_storeu_ps(dstLo[row], _mm256_sub_ps(center, extent));
+                _mm256_storeu_ps(dstHi[row], _mm256_add_ps(center, extent));
+            }
+        }
+        BoxesScalar(m, lo, hi, outLo, outHi, i, count);
+    }
+
+    // ------------------------------------------------------------
+    // AVX-512: 16 items per step, the tail through a lane mask
+    // ------------------------------------------------------------
+    CPU_TARGET_AVX512 void PointsAVX512(const float* m, Stream3 in, Out3 out, size_t count)
+    {
+        __m512 r[12];
+        for (int k = 0; k < 12; ++k)
+            r[k] = _mm512_set1_ps(m[(k % 4) * 4 + k / 4]);
+
+        for (size_t i = 0; i < count; i += 16)
+        {
+            const __mmask16 lanes = count - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (count - i)) - 1);
+            const __m512 x = _mm512_maskz_loadu_ps(lanes, in.x + i);
+            const __m512 y = _mm512_maskz_loadu_ps(lanes, in.y + i);
+            const __m512 z = _mm512_maskz_loadu_ps(lanes, in.z + i);
+            float* dst[3] = { out.x + i, out.y + i, out.z + i };
+            for (int row = 0; row < 3; ++row)
+            {
+                const __m512* c = r + row * 4;
+                const __m512 v = _mm512_fmadd_ps(c[0], x, _mm512_fmadd_ps(c[1], y, _mm512_fmadd_ps(c[2], z, c[3])));
+                _mm512_mask_storeu_ps(dst[row], lanes, v);
+            }
+        }
+    }
+
+    CPU_TARGET_AVX512 void BoxesAVX512(const float* m, Stream3 lo, Stream3 hi, Out3 outLo, Out3 outHi, size_t count)
+    {
+        const __m512 half = _mm512_set1_ps(0.5f);
+        __m512 r[12], a[12];
+        for (int k = 0; k < 12; ++k)
+        {
+            r[k] = _mm512_set1_ps(m[(k % 4) * 4 + k / 4]);
+            a[k] = _mm512_set1_ps(fabsf(m[(k % 4) * 4 + k / 4]));
+        }
+
+        for (size_t i = 0; i < count; i += 16)
+        {
+            const __mmask16 lanes = count - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (count - i)) - 1);
+            const __m512 lx = _mm512_maskz_loadu_ps(lanes, lo.x + i), hx = _mm512_maskz_loadu_ps(lanes, hi.x + i);
+            const __m512 ly = _mm512_maskz_loadu_ps(lanes, lo.y + i), hy = _mm512_maskz_loadu_ps(lanes, hi.y + i);
+            const __m512 lz = _mm512_maskz_loadu_ps(lanes, lo.z + i), hz = _mm512_maskz_loadu_ps(lanes, hi.z + i);
+            const __m512 cx = _mm512_mul_ps(_mm512_add_ps(lx, hx), half), ex = _mm512_mul_ps(_mm512_sub_ps(hx, lx), half);
+            const __m512 cy = _mm512_mul_ps(_mm512_add_ps(ly, hy), half), ey = _mm512_mul_ps(_mm512_sub_ps(hy, ly), half);
+            const __m512 cz = _mm512_mul_ps(_mm512_add_ps(lz, hz), half), ez = _mm512_mul_ps(_mm512_sub_ps(hz, lz), half);
+            float* dstLo[3] = { outLo.x + i, outLo.y + i, outLo.z + i };
+            float* dstHi[3] = { outHi.x + i, outHi.y + i, outHi.z + i };
+            for (int row = 0; row < 3; ++row)
+            {
+                const __m512* c = r + row * 4;
+                const __m512* ac = a + row * 4;
+                const __m512 center = _mm512_fmadd_ps(c[0], cx, _mm512_fmadd_ps(c[1], cy, _mm512_fmadd_ps(c[2], cz, c[3])));
+                const __m512 extent = _mm512_fmadd_ps(ac[0], ex, _mm512_fmadd_ps(ac[1], ey, _mm512_mul_ps(ac[2], ez)));
+                _mm512_mask_storeu_ps(dstLo[row], lanes, _mm512_sub_ps(center, extent));
+                _mm512_mask_storeu_ps(dstHi[row], lanes, _mm512_add_ps(center, extent));
+            }
+        }
+    }
+
+    // ------------------------------------------------------------
+    // Dispatch
+    // ------------------------------------------------------------
+    struct Kernels
+    {
+        BatchSimdPath path;
+        void (*points)(const float* m, Stream3 in, Out3 out, size_t count);
+        void (*boxes)(const float* m, Stream3 lo, Stream3 hi, Out3 outLo, Out3 outHi, size_t count);
+    };
+
+    const Kernels kKernels[] = {
+        { kBatchSSE, PointsSSE, BoxesSSE },
+        { kBatchAVX2, PointsAVX2, BoxesAVX2 },
+        { kBatchAVX512, PointsAVX512, BoxesAVX512 },
+    };
+
+    const Kernels* gKernels = nullptr;
+
+    const Kernels& Active()
+    {
+        if (!gKernels)
+            SetBatchSimdPath(kBatchAuto);
+        return *gKernels;
+    }
+
+    Stream3 In(const PointsSoA& p) { return { p.x.data(), p.y.data(), p.z.data() }; }
+    Out3 Out(PointsSoA& p) { return { p.x.data(), p.y.data(), p.z.data() }; }
+}
+
+BatchSimdPath SetBatchSimdPath(BatchSimdPath path)
+{
+    if (path == kBatchAuto)
+        path = kBatchAVX512;
+    if (path == kBatchAVX512 && !CpuHasAvx512())
+        path = kBatchAVX2;
+    if (path == kBatchAVX2 && !(CpuHasAvx2() && CpuHasFma()))
+        path = kBatchSSE;
+
+    for (const Kernels& k : kKernels)
+        if (k.path == path)
+            gKernels = &k;
+    return path;
+}
+
+BatchSimdPath GetBatchSimdPath()
+{
+    return Active().path;
+}
+
+const char* BatchSimdPathName(BatchSimdPath path)
+{
+    switch (path)
+    {
+    case kBatchSSE: return "SSE";
+    case kBatchAVX2: return "AVX2";
+    case kBatchAVX512: return "AVX-512";
+    default: return "auto";
+    }
+}
+
+void TransformPoints(const float m[16], const PointsSoA& in, PointsSoA& out)
+{
+    out.Resize(in.Size());
+    Active().points(m, In(in), Out(out), in.Size());
+}
+
+void TransformVectors(const float m[16], const PointsSoA& in, PointsSoA& out)
+{
+    float linear[16];
+    std::copy(m, m + 16, linear);
+    linear[12] = linear[13] = linear[14] = 0.0f;
+    TransformPoints(linear, in, out);
+}
+
+void TransformBoxes(const float m[16], const BoxesSoA& in, BoxesSoA& out)
+{
+    out.Resize(in.Size());
+    Active().boxes(m, In(in.min), In(in.max), Out(out.min), Out(out.max), in.Size());
+}
+
+void TransformSpheres(const float m[16], const SpheresSoA& in, SpheresSoA& out)
+{
+    TransformPoints(m, in.center, out.center);
+
+    // radii only scale, which the compiler vectorizes well enough by itself
+    float scale2 = 0.0f;
+    for (int c = 0; c < 3; ++c)
+        scale2 = std::max(scale2, m[c * 4] * m[c * 4] + m[c * 4 + 1] * m[c * 4 + 1] + m[c * 4 + 2] * m[c * 4 + 2]);
+    const float scale = sqrtf(scale2);
+    out.radius.resize(in.Size());
+    for (size_t i = 0; i < in.Size(); ++i)
+        out.radius[i] = in.radius[i] * scale;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// ------------------------------------------------------------
+// One Mat4 applied to many points, boxes or spheres at once. The data is
+// kept as structure-of-arrays (every x, then every y, ...) so a register
+// holds the same component of 4 (SSE), 8 (AVX2) or 16 (AVX-512) items and
+// the matrix never has to be shuffled.
+//
+// The kernels are picked at run time from what the CPU supports; the
+// bench forces each path with SetBatchSimdPath(). Matrices are the usual
+// column-major float[16]. Output may alias input.
+// ------------------------------------------------------------
+enum BatchSimdPath
+{
+    kBatchAuto,     // widest the CPU runs
+    kBatchSSE,
+    kBatchAVX2,
+    kBatchAVX512,
+};
+
+// Returns the path now in use: one the CPU lacks falls back to the next narrower
+BatchSimdPath SetBatchSimdPath(BatchSimdPath path);
+BatchSimdPath GetBatchSimdPath();
+const char* BatchSimdPathName(BatchSimdPath path);
+
+struct PointsSoA
+{
+    std::vector<float> x, y, z;
+
+    size_t Size() const { return x.size(); }
+    void Resize(size_t count)
+    {
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+    }
+};
+
+struct BoxesSoA
+{
+    PointsSoA min, max;
+
+    size_t Size() const { return min.Size(); }
+    void Resize(size_t count)
+    {
+        min.Resize(count);
+        max.Resize(count);
+    }
+};
+
+struct SpheresSoA
+{
+    PointsSoA center;
+    std::vector<float> radius;
+
+    size_t Size() const { return center.Size(); }
+    void Resize(size_t count)
+    {
+        center.Resize(count);
+        radius.resize(count);
+    }
+};
+
+// w = 1: rotated, scaled and translated
+void TransformPoints(const float m[16], const PointsSoA& in, PointsSoA& out);
+
+// w = 0: directions and offsets, no translation
+void TransformVectors(const float m[16], const PointsSoA& in, PointsSoA& out);
+
+// The tight axis-aligned box around each transformed box (center moves
+// with m, half extents go through |m|)
+void TransformBoxes(const float m[16], const BoxesSoA& in, BoxesSoA& out);
+
+// Centers as points, radii times m's largest axis scale
+void TransformSpheres(const float m[16], const SpheresSoA& in, SpheresSoA& out);
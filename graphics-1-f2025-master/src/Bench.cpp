@@ -0,0 +1,1017 @@
+#include "Bench.h"
+#include "JobSystem.h"
+#include "Flock.h"
+#include "SoftwareOcclusion.h"
+#include "SimdMath.h"
+#include "ConstexprMath.h"
+#include "FrustumCull.h"
+#include "ObjLoader.h"
+#include "Bvh.h"
+#include "MeshScene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>     // __rdtsc
+#else
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+    double NowSeconds()
+    {
+        using namespace std::chrono;
+        return duration<double>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    // best of N runs, in seconds
+    template <typename Fn>
+    double TimeBest(int runs, Fn fn)
+    {
+        double best = 1e30;
+        for (int r = 0; r < runs; ++r)
+        {
+            double t0 = NowSeconds();
+            fn();
+            best = min(best, NowSeconds() - t0);
+        }
+        return best;
+    }
+
+    // ------------------------------------------------------------
+    // Job system: per-task scheduling cost and parallel scaling
+    // ------------------------------------------------------------
+    void BenchJobs()
+    {
+        // at least one worker so the queues are exercised even on a single core
+        InitJobSystem(max(1, (int)thread::hardware_concurrency() - 1));
+        cout << "[jobs] workers: " << GetJobWorkerCount() << " (+ main thread)\n";
+
+        // empty tasks through ParallelFor, one index per task
+        const size_t taskCount = 200000;
+        double tFor = TimeBest(5, [&] {
+            ParallelFor(taskCount, 1, [](size_t, size_t) {});
+        });
+        cout << "[jobs] ParallelFor empty task:  " << (tFor / taskCount) * 1e9 << " ns/task\n";
+
+        // individually queued std::function jobs sharing one counter
+        const int jobCount = 100000;
+        double tRun = TimeBest(5, [&] {
+            JobCounter counter;
+            for (int i = 0; i < jobCount; ++i)
+                RunJob([] {}, &counter);
+            WaitForCounter(counter);
+        });
+        cout << "[jobs] RunJob empty task:       " << (tRun / jobCount) * 1e9 << " ns/task\n";
+
+        // dependency chain: each job released by the previous counter
+        const int chainLength = 10000;
+        double tChain = TimeBest(3, [&] {
+            vector<JobCounter> links(chainLength);
+            for (int i = 0; i < chainLength; ++i)
+            {
+                if (i == 0)
+                    RunJob([] {}, &links[0]);
+                else
+                    RunJobAfter(links[i - 1], [] {}, &links[i]);
+            }
+            WaitForCounter(links[chainLength - 1]);
+        });
+        cout << "[jobs] dependency chain:        " << (tChain / chainLength) * 1e9 << " ns/link\n";
+        ShutdownJobSystem();
+
+        // embarrassingly parallel loop at increasing thread counts
+        const size_t n = 1 << 22;
+        vector<float> data(n);
+        auto work = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+            {
+                float x = (float)i * 0.001f;
+                for (int k = 0; k < 16; ++k)
+                    x = sqrtf(x * x + 1.0f) * 0.5f;
+                data[i] = x;
+            }
+        };
+
+        int maxThreads = max(1, (int)thread::hardware_concurrency());
+        vector<int> threadCounts;
+        for (int t = 1; t < maxThreads; t *= 2)
+            threadCounts.push_back(t);
+        threadCounts.push_back(maxThreads);
+
+        double baseline = 0.0;
+        for (int threads : threadCounts)
+        {
+            InitJobSystem(threads - 1);
+            double t = TimeBest(3, [&] { ParallelFor(n, 16384, work); });
+            ShutdownJobSystem();
+
+            if (threads == 1)
+                baseline = t;
+            double speedup = baseline / t;
+            cout << "[jobs] scaling " << threads << " thread(s): " << t * 1e3 << " ms, speedup "
+                << speedup << "x, efficiency " << (speedup / threads) * 100.0 << "%\n";
+        }
+    }
+
+    // ------------------------------------------------------------
+    // Flock instance fill (the CPU side of --birds N)
+    // ------------------------------------------------------------
+    void BenchFlock()
+    {
+        const size_t count = 100000;
+        vector<BirdInstance> instances(count);
+        float time = 0.0f;
+
+        InitJobSystem(0);
+        double serial = TimeBest(10, [&] { FillFlockInstances(instances.data(), count, time += 0.016f); });
+        ShutdownJobSystem();
+
+        InitJobSystem(max(1, (int)thread::hardware_concurrency() - 1));
+        double parallel = TimeBest(10, [&] { FillFlockInstances(instances.data(), count, time += 0.016f); });
+        int threads = GetJobWorkerCount() + 1;
+        ShutdownJobSystem();
+
+        cout << "[flock] " << count << " instances, 1 thread:  " << serial * 1e3 << " ms ("
+            << (serial / count) * 1e9 << " ns/instance)\n";
+        cout << "[flock] " << count << " instances, " << threads << " threads: " << parallel * 1e3
+            << " ms, speedup " << serial / parallel << "x\n";
+        cout << "[flock] upload size " << count * sizeof(BirdInstance) / (1024.0 * 1024.0) << " MiB/frame\n";
+    }
+
+    // ------------------------------------------------------------
+    // CPU occlusion (--cpu-occlusion): raster and box test, SSE vs AVX2
+    // ------------------------------------------------------------
+    void BenchOcclusion()
+    {
+        // three staggered walls of 16x16 quads, 1536 triangles, filling most of the view
+        vector<float> wall;
+        for (int w = 0; w < 3; ++w)
+        {
+            const float z = -8.0f - 4.0f * w, x0 = -6.0f + 3.0f * w, size = 0.5f;
+            for (int j = 0; j < 16; ++j)
+            {
+                for (int i = 0; i < 16; ++i)
+                {
+                    const float ax = x0 + i * size, ay = -4.0f + j * size;
+                    const float quad[6][3] = {
+                        { ax, ay, z }, { ax + size, ay, z }, { ax + size, ay + size, z },
+                        { ax, ay, z }, { ax + size, ay + size, z }, { ax, ay + size, z } };
+                    for (int k = 0; k < 6; ++k)
+                        wall.insert(wall.end(), quad[k], quad[k] + 3);
+                }
+            }
+        }
+
+        // boxes scattered in front of, among and behind the walls
+        const int boxCount = 10000;
+        vector<float> boxes(boxCount * 6);
+        unsigned seed = 12345u;
+        auto random = [&seed] { seed = seed * 1664525u + 1013904223u; return (seed >> 8) * (1.0f / 16777216.0f); };
+        for (int i = 0; i < boxCount; ++i)
+        {
+            const float c[3] = { random() * 16.0f - 8.0f, random() * 8.0f - 4.0f, -4.0f - random() * 30.0f };
+            const float h = 0.1f + random() * 0.4f;
+            for (int k = 0; k < 3; ++k)
+            {
+                boxes[i * 6 + k] = c[k] - h;
+                boxes[i * 6 + 3 + k] = c[k] + h;
+            }
+        }
+
+        // camera at the origin looking down -z, 60 degree vertical fov, near 0.1, far 100
+        const float f = 1.0f / tanf(30.0f * 3.14159265f / 180.0f), n = 0.1f, fa = 100.0f;
+        const float view[16] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+        const float projection[16] = { f,0,0,0, 0,f,0,0, 0,0,(fa + n) / (n - fa),-1, 0,0,2 * fa * n / (n - fa),0 };
+
+        InitJobSystem(0);
+        const SoftwareOcclusion::SimdPath paths[2] = { SoftwareOcclusion::kSimdSSE, SoftwareOcclusion::kSimdAVX2 };
+        for (SoftwareOcclusion::SimdPath path : paths)
+        {
+            SoftwareOcclusion occlusion;
+            occlusion.Create(256, 256, path);
+            if (occlusion.GetSimdPath() != path)
+            {
+                cout << "[occlusion] AVX2 not supported on this CPU\n";
+                continue;
+            }
+            occlusion.AddOccluder(wall.data(), 3 * sizeof(float), wall.size() / 3, view);
+
+            double raster = TimeBest(20, [&] { occlusion.Render(view, projection); });
+            int culled = 0;
+            double test = TimeBest(20, [&] {
+                culled = 0;
+                for (int i = 0; i < boxCount; ++i)
+                    culled += occlusion.IsVisible(&boxes[i * 6], &boxes[i * 6 + 3]) ? 0 : 1;
+            });
+
+            const char* name = path == SoftwareOcclusion::kSimdAVX2 ? "AVX2" : "SSE ";
+            cout << "[occlusion] " << name << " raster " << occlusion.GetOccluderTriangleCount() << " triangles at "
+                << occlusion.GetWidth() << "x" << occlusion.GetHeight() << ": " << raster * 1e3 << " ms, test "
+                << boxCount << " boxes: " << test * 1e3 << " ms (" << (test / boxCount) * 1e9 << " ns/box), "
+                << culled << " culled\n";
+        }
+        ShutdownJobSystem();
+    }
+
+    // ------------------------------------------------------------
+    // SIMD math (src/SimdMath.h) against plain scalar code: first checked
+    // on random inputs, then timed
+    // ------------------------------------------------------------
+    bool gMathFailed = false;
+
+    unsigned gMathSeed = 2024u;
+    float MathRandom(float lo, float hi)
+    {
+        gMathSeed = gMathSeed * 1664525u + 1013904223u;
+        return lo + (hi - lo) * ((gMathSeed >> 8) * (1.0f / 16777216.0f));
+    }
+
+    // the scalar code the library replaced, column-major throughout
+    void RefMul(const float a[16], const float b[16], float out[16])
+    {
+        for (int c = 0; c < 4; ++c)
+            for (int r = 0; r < 4; ++r)
+                out[c * 4 + r] = a[0 * 4 + r] * b[c * 4 + 0] + a[1 * 4 + r] * b[c * 4 + 1] +
+                    a[2 * 4 + r] * b[c * 4 + 2] + a[3 * 4 + r] * b[c * 4 + 3];
+    }
+
+    void RefCross(const float a[3], const float b[3], float out[3])
+    {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    void RefNormalize(const float v[3], float out[3])
+    {
+        float len2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+        float invLen = len2 > 0.0f ? 1.0f / sqrtf(len2) : 0.0f;
+        for (int k = 0; k < 3; ++k)
+            out[k] = v[k] * invLen;
+    }
+
+    void RefLookAt(const float eye[3], const float center[3], const float up[3], float m[16])
+    {
+        float d[3] = { center[0] - eye[0], center[1] - eye[1], center[2] - eye[2] };
+        float f[3], s[3], u[3], t[3];
+        RefNormalize(d, f);
+        RefCross(f, up, t);
+        RefNormalize(t, s);
+        RefCross(s, f, u);
+        m[0] = s[0]; m[1] = u[0]; m[2] = -f[0]; m[3] = 0.0f;
+        m[4] = s[1]; m[5] = u[1]; m[6] = -f[1]; m[7] = 0.0f;
+        m[8] = s[2]; m[9] = u[2]; m[10] = -f[2]; m[11] = 0.0f;
+        m[12] = -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]);
+        m[13] = -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]);
+        m[14] = f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2];
+        m[15] = 1.0f;
+    }
+
+    // cofactor expansion (the MESA gluInvertMatrix layout)
+    bool RefInverse(const float m[16], float out[16])
+    {
+        float inv[16];
+        inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+        inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+        inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+        inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+        inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+        inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+        inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+        inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+        inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+        inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+        inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+        inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+        inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+        inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+        inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+        inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+        float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+        if (det == 0.0f)
+            return false;
+        for (int i = 0; i < 16; ++i)
+            out[i] = inv[i] / det;
+        return true;
+    }
+
+    // rotation about a random axis, scale in [0.5, 2] per axis (or one for
+    // all), translation in [-10, 10]
+    void RandomAffine(float m[16], bool uniformScale, bool rigid)
+    {
+        const simd::Vec3 axis = simd::Normalize(simd::Vec3(MathRandom(-1, 1), MathRandom(-1, 1), MathRandom(-1, 1)));
+        const simd::Quat q = simd::AxisAngle(axis, MathRandom(-3.14159f, 3.14159f));
+        const float s0 = rigid ? 1.0f : MathRandom(0.5f, 2.0f);
+        const simd::Vec3 s = uniformScale || rigid ? simd::Vec3(s0, s0, s0) :
+            simd::Vec3(s0, MathRandom(0.5f, 2.0f), MathRandom(0.5f, 2.0f));
+        const simd::Vec3 t(MathRandom(-10, 10), MathRandom(-10, 10), MathRandom(-10, 10));
+        (simd::Translation(t) * simd::ToMat4(q) * simd::Scale(s)).Store(m);
+    }
+
+    // diagonally dominant, so comfortably invertible
+    void RandomGeneral(float m[16])
+    {
+        for (int i = 0; i < 16; ++i)
+            m[i] = MathRandom(-1.0f, 1.0f);
+        for (int i = 0; i < 4; ++i)
+            m[i * 5] += (m[i * 5] < 0.0f ? -4.0f : 4.0f);
+    }
+
+    // largest |a - b| relative to max(1, |b|, terms), terms being the size
+    // of what was summed: a result that cancels keeps the rounding error of
+    // its terms, and where the compiler fuses multiply-adds (FMA builds) the
+    // reference and the SIMD code round differently
+    float MaxError(const float* a, const float* b, int n, float terms = 1.0f)
+    {
+        float worst = 0.0f;
+        for (int i = 0; i < n; ++i)
+            worst = max(worst, fabsf(a[i] - b[i]) / max(max(1.0f, terms), fabsf(b[i])));
+        return worst;
+    }
+
+    float Length3(const float v[3])
+    {
+        return sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    }
+
+    void CheckMath(const char* what, float error, float tolerance)
+    {
+        const bool ok = error <= tolerance;
+        cout << "[math] check " << what << ": max error " << error << (ok ? "" : "  FAILED") << "\n";
+        gMathFailed = gMathFailed || !ok;
+    }
+
+    void CheckMathLibrary()
+    {
+        const int n = 20000;
+        float errVec = 0.0f, errMul = 0.0f, errInv = 0.0f, errAffine = 0.0f, errRigid = 0.0f;
+        float errMulAffine = 0.0f, errPoint = 0.0f, errLookAt = 0.0f, errQuat = 0.0f, errSlerp = 0.0f;
+
+        for (int i = 0; i < n; ++i)
+        {
+            // Vec3 ops against the scalar code
+            float a[3], b[3], ref[3], got[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                a[k] = MathRandom(-100, 100);
+                b[k] = MathRandom(-100, 100);
+            }
+            const simd::Vec3 va = simd::Vec3::Load(a), vb = simd::Vec3::Load(b);
+            const float products = Length3(a) * Length3(b);
+            RefCross(a, b, ref);
+            simd::Cross(va, vb).Store(got);
+            errVec = max(errVec, MaxError(got, ref, 3, products));
+            RefNormalize(a, ref);
+            simd::Normalize(va).Store(got);
+            errVec = max(errVec, MaxError(got, ref, 3));
+            const float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+            const float gotDot = simd::Dot(va, vb);
+            errVec = max(errVec, MaxError(&gotDot, &dot, 1, products));
+
+            // products
+            float m0[16], m1[16], refM[16], gotM[16];
+            RandomGeneral(m0);
+            RandomGeneral(m1);
+            RefMul(m0, m1, refM);
+            (simd::Mat4::Load(m0) * simd::Mat4::Load(m1)).Store(gotM);
+            errMul = max(errMul, MaxError(gotM, refM, 16));
+
+            // general inverse
+            RefInverse(m0, refM);
+            simd::Inverse(simd::Mat4::Load(m0)).Store(gotM);
+            errInv = max(errInv, MaxError(gotM, refM, 16));
+
+            // affine fast paths
+            float affine[16], rigid[16];
+            RandomAffine(affine, (i & 1) != 0, false);
+            RandomAffine(rigid, true, true);
+            RefInverse(affine, refM);
+            simd::InverseAffine(simd::Mat4::Load(affine)).Store(gotM);
+            errAffine = max(errAffine, MaxError(gotM, refM, 16));
+            RefInverse(rigid, refM);
+            simd::InverseRigid(simd::Mat4::Load(rigid)).Store(gotM);
+            errRigid = max(errRigid, MaxError(gotM, refM, 16));
+            RefMul(affine, rigid, refM);
+            simd::MulAffine(simd::Mat4::Load(affine), simd::Mat4::Load(rigid)).Store(gotM);
+            errMulAffine = max(errMulAffine, MaxError(gotM, refM, 16));
+
+            const float p[4] = { a[0], a[1], a[2], 1.0f };
+            for (int r = 0; r < 3; ++r)
+                ref[r] = affine[r] * p[0] + affine[4 + r] * p[1] + affine[8 + r] * p[2] + affine[12 + r];
+            simd::TransformPoint(simd::Mat4::Load(affine), va).Store(got);
+            errPoint = max(errPoint, MaxError(got, ref, 3));
+
+            // camera matrices
+            float up[3] = { 0.0f, 1.0f, 0.0f };
+            RefLookAt(a, b, up, refM);
+            simd::LookAt(va, vb, simd::Vec3::Load(up)).Store(gotM);
+            errLookAt = max(errLookAt, MaxError(gotM, refM, 16, Length3(a)));
+
+            // quaternions: rotating a vector, through a matrix, and composed
+            const simd::Vec3 axis = simd::Normalize(vb);
+            const float angle = MathRandom(-3.14159f, 3.14159f);
+            const simd::Quat q = simd::AxisAngle(axis, angle);
+            const simd::Quat q2 = simd::AxisAngle(simd::Normalize(va), MathRandom(-3.14159f, 3.14159f));
+            const simd::Vec3 unit = simd::Normalize(va);
+            // Rodrigues: v cos + (k x v) sin + k (k . v)(1 - cos)
+            const simd::Vec3 rodrigues = unit * cosf(angle) + simd::Cross(axis, unit) * sinf(angle) +
+                axis * (simd::Dot(axis, unit) * (1.0f - cosf(angle)));
+            rodrigues.Store(ref);
+            simd::Rotate(q, unit).Store(got);
+            errQuat = max(errQuat, MaxError(got, ref, 3));
+            simd::TransformVector(simd::ToMat4(q), unit).Store(got);
+            errQuat = max(errQuat, MaxError(got, ref, 3));
+            simd::Rotate(q2, simd::Rotate(q, unit)).Store(ref);
+            simd::Rotate(q2 * q, unit).Store(got);
+            errQuat = max(errQuat, MaxError(got, ref, 3));
+
+            // slerp halfway = rotation by half the angle
+            simd::Rotate(simd::AxisAngle(axis, angle * 0.5f), unit).Store(ref);
+            simd::Rotate(simd::Slerp(simd::Quat(), q, 0.5f), unit).Store(got);
+            errSlerp = max(errSlerp, MaxError(got, ref, 3));
+        }
+
+        // what the renderer builds every frame must not move at all
+        const float fov = 45.0f * 3.14159265f / 180.0f, f = 1.0f / tanf(fov * 0.5f);
+        const float refP[16] = { f, 0, 0, 0, 0, f, 0, 0, 0, 0, (100.0f + 0.1f) / (0.1f - 100.0f), -1,
+            0, 0, (2.0f * 100.0f * 0.1f) / (0.1f - 100.0f), 0 };
+        float gotP[16];
+        simd::Perspective(fov, 1.0f, 0.1f, 100.0f).Store(gotP);
+
+        cout << "[math] backend " << simd::BackendName() << ", " << n << " random cases per check\n";
+        CheckMath("Vec3 dot/cross/normalize", errVec, 1e-6f);
+        CheckMath("Mat4 multiply", errMul, 1e-6f);
+        CheckMath("Mat4 inverse", errInv, 1e-5f);
+        CheckMath("inverse affine", errAffine, 1e-5f);
+        CheckMath("inverse rigid", errRigid, 1e-5f);
+        CheckMath("multiply affine", errMulAffine, 1e-6f);
+        CheckMath("transform point", errPoint, 1e-6f);
+        CheckMath("look-at", errLookAt, 1e-6f);
+        CheckMath("perspective", MaxError(gotP, refP, 16), 0.0f);
+        CheckMath("quat rotate/matrix/compose", errQuat, 1e-5f);
+        CheckMath("slerp", errSlerp, 1e-5f);
+    }
+
+    void BenchMath()
+    {
+        CheckMathLibrary();
+
+        const int count = 4096;
+        vector<float> a(count * 16), b(count * 16), out(count * 16);
+        vector<simd::Mat4> ma(count), mb(count), mout(count);
+        for (int i = 0; i < count; ++i)
+        {
+            RandomAffine(&a[i * 16], false, false);
+            RandomAffine(&b[i * 16], true, true);
+            ma[i] = simd::Mat4::Load(&a[i * 16]);
+            mb[i] = simd::Mat4::Load(&b[i * 16]);
+        }
+
+        auto report = [&](const char* what, double scalar, double simdTime)
+        {
+            cout << "[math] " << what << ": scalar " << scalar / count * 1e9 << " ns, SIMD "
+                << simdTime / count * 1e9 << " ns, " << scalar / simdTime << "x\n";
+        };
+
+        report("Mat4 multiply", TimeBest(50, [&] {
+            for (int i = 0; i < count; ++i) RefMul(&a[i * 16], &b[i * 16], &out[i * 16]); }),
+            TimeBest(50, [&] { for (int i = 0; i < count; ++i) mout[i] = ma[i] * mb[i]; }));
+        report("Mat4 inverse", TimeBest(50, [&] {
+            for (int i = 0; i < count; ++i) RefInverse(&a[i * 16], &out[i * 16]); }),
+            TimeBest(50, [&] { for (int i = 0; i < count; ++i) mout[i] = simd::Inverse(ma[i]); }));
+        report("inverse affine (vs scalar general)", TimeBest(50, [&] {
+            for (int i = 0; i < count; ++i) RefInverse(&a[i * 16], &out[i * 16]); }),
+            TimeBest(50, [&] { for (int i = 0; i < count; ++i) mout[i] = simd::InverseAffine(ma[i]); }));
+        report("inverse rigid (vs scalar general)", TimeBest(50, [&] {
+            for (int i = 0; i < count; ++i) RefInverse(&b[i * 16], &out[i * 16]); }),
+            TimeBest(50, [&] { for (int i = 0; i < count; ++i) mout[i] = simd::InverseRigid(mb[i]); }));
+        report("multiply affine (vs scalar general)", TimeBest(50, [&] {
+            for (int i = 0; i < count; ++i) RefMul(&a[i * 16], &b[i * 16], &out[i * 16]); }),
+            TimeBest(50, [&] { for (int i = 0; i < count; ++i) mout[i] = simd::MulAffine(ma[i], mb[i]); }));
+
+        vector<simd::Quat> qa(count), qb(count), qout(count);
+        for (int i = 0; i < count; ++i)
+        {
+            qa[i] = simd::AxisAngle(simd::Vec3(0.0f, 1.0f, 0.0f), MathRandom(-3.0f, 3.0f));
+            qb[i] = simd::AxisAngle(simd::Vec3(1.0f, 0.0f, 0.0f), MathRandom(-3.0f, 3.0f));
+        }
+        const double quatMul = TimeBest(50, [&] { for (int i = 0; i < count; ++i) qout[i] = qa[i] * qb[i]; });
+        cout << "[math] Quat multiply: " << quatMul / count * 1e9 << " ns\n";
+        if (gMathFailed)
+            cout << "[math] SELF-CHECK FAILED\n";
+    }
+
+    // ------------------------------------------------------------
+    // Frustum culling (src/FrustumCull.h): a million spheres and boxes on
+    // every SIMD path, one thread and all of them, checked against the
+    // scalar tests
+    // ------------------------------------------------------------
+    bool gCullFailed = false;
+
+    void BenchCull()
+    {
+        // scattered over a 400 x 400 field, 0-20 high; the camera sees about 1 in 20
+        const size_t count = 1 << 20;
+        SpheresSoA spheres;
+        BoxesSoA boxes;
+        spheres.Resize(count);
+        boxes.Resize(count);
+        unsigned seed = 777u;
+        auto random = [&seed] { seed = seed * 1664525u + 1013904223u; return (seed >> 8) * (1.0f / 16777216.0f); };
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float x = random() * 400.0f - 200.0f, y = random() * 20.0f, z = random() * 400.0f - 200.0f;
+            const float h = 0.2f + random() * 1.5f;
+            spheres.center.x[i] = x;
+            spheres.center.y[i] = y;
+            spheres.center.z[i] = z;
+            spheres.radius[i] = h * 1.7320508f;
+            boxes.min.x[i] = x - h; boxes.min.y[i] = y - h; boxes.min.z[i] = z - h;
+            boxes.max.x[i] = x + h; boxes.max.y[i] = y + h; boxes.max.z[i] = z + h;
+        }
+
+        // the render loop's camera and projection
+        constexpr cx::Mat4 kView = cx::LookAt({ 0.0f, 2.0f, 8.0f }, { 0.3f, 1.8f, 7.0f }, { 0.0f, 1.0f, 0.0f });
+        constexpr cx::Mat4 kProjection = cx::Perspective(cx::DegToRad(60.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+        const Frustum frustum = ExtractFrustum(kView.m, kProjection.m);
+
+        vector<uint32_t> refSpheres, refBoxes, visible;
+        const double scalarSpheres = TimeBest(5, [&] {
+            refSpheres.clear();
+            for (size_t i = 0; i < count; ++i)
+                if (SphereInFrustum(frustum, spheres.center.x[i], spheres.center.y[i], spheres.center.z[i], spheres.radius[i]))
+                    refSpheres.push_back((uint32_t)i);
+        });
+        const double scalarBoxes = TimeBest(5, [&] {
+            refBoxes.clear();
+            for (size_t i = 0; i < count; ++i)
+            {
+                const float lo[3] = { boxes.min.x[i], boxes.min.y[i], boxes.min.z[i] };
+                const float hi[3] = { boxes.max.x[i], boxes.max.y[i], boxes.max.z[i] };
+                if (BoxInFrustum(frustum, lo, hi))
+                    refBoxes.push_back((uint32_t)i);
+            }
+        });
+        cout << "[cull] " << count << " objects, " << refSpheres.size() << " spheres and " << refBoxes.size()
+            << " boxes visible\n";
+        cout << "[cull] scalar, 1 thread: spheres " << scalarSpheres * 1e3 << " ms, boxes " << scalarBoxes * 1e3 << " ms\n";
+
+        // at least one worker so the parallel split is exercised even on a single core
+        const int threads = max(2, (int)thread::hardware_concurrency());
+        const BatchSimdPath paths[] = { kBatchSSE, kBatchAVX2, kBatchAVX512 };
+        for (BatchSimdPath path : paths)
+        {
+            if (SetBatchSimdPath(path) != path)
+            {
+                cout << "[cull] " << BatchSimdPathName(path) << " not supported on this CPU\n";
+                continue;
+            }
+            for (int t : { 1, threads })
+            {
+                InitJobSystem(t - 1);
+                const double sphereTime = TimeBest(10, [&] { CullSpheres(frustum, spheres, visible); });
+                const bool spheresMatch = visible == refSpheres;
+                const double boxTime = TimeBest(10, [&] { CullBoxes(frustum, boxes, visible); });
+                const bool boxesMatch = visible == refBoxes;
+                ShutdownJobSystem();
+
+                cout << "[cull] " << BatchSimdPathName(path) << ", " << t << " thread(s): spheres " << sphereTime * 1e3
+                    << " ms (" << count / sphereTime * 1e-6 << " M/s), boxes " << boxTime * 1e3 << " ms ("
+                    << count / boxTime * 1e-6 << " M/s)" << (spheresMatch && boxesMatch ? "" : "  MISMATCH vs scalar") << "\n";
+                gCullFailed = gCullFailed || !spheresMatch || !boxesMatch;
+            }
+        }
+        SetBatchSimdPath(kBatchAuto);
+    }
+
+    // ------------------------------------------------------------
+    // Batch transforms (src/BatchTransform.h) on the bird: every kernel on
+    // every path the CPU has, over its positions and face bounds tiled out
+    // to about a million items. Cycles are TSC ticks, so turbo shows up as
+    // more than one core clock.
+    // ------------------------------------------------------------
+
+    // obj.positions (or any packed Vec3 array) as structure-of-arrays
+    PointsSoA ToSoA(const vector<cx::Vec3>& points)
+    {
+        PointsSoA soa;
+        soa.Resize(points.size());
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            soa.x[i] = points[i].x;
+            soa.y[i] = points[i].y;
+            soa.z[i] = points[i].z;
+        }
+        return soa;
+    }
+
+    // Box and sphere around every face, taken from the SoA positions
+    void FaceBounds(const ObjData& obj, const PointsSoA& positions, BoxesSoA& boxes, SpheresSoA& spheres)
+    {
+        boxes.Resize(0);
+        spheres.Resize(0);
+        const float* axes[3] = { positions.x.data(), positions.y.data(), positions.z.data() };
+        vector<float>* lo[3] = { &boxes.min.x, &boxes.min.y, &boxes.min.z };
+        vector<float>* hi[3] = { &boxes.max.x, &boxes.max.y, &boxes.max.z };
+        vector<float>* center[3] = { &spheres.center.x, &spheres.center.y, &spheres.center.z };
+        for (const Face& f : obj.faces)
+        {
+            if (f.v[0] < 1 || f.v[1] < 1 || f.v[2] < 1 || max(f.v[0], max(f.v[1], f.v[2])) > (int)positions.Size())
+                continue;
+
+            float radius2 = 0.0f;
+            for (int k = 0; k < 3; ++k)
+            {
+                const float a = axes[k][f.v[0] - 1], b = axes[k][f.v[1] - 1], c = axes[k][f.v[2] - 1];
+                const float l = min(a, min(b, c)), h = max(a, max(b, c));
+                lo[k]->push_back(l);
+                hi[k]->push_back(h);
+                center[k]->push_back((l + h) * 0.5f);
+                radius2 += (h - l) * (h - l) * 0.25f;
+            }
+            spheres.radius.push_back(sqrtf(radius2));
+        }
+    }
+
+    void BenchTransform()
+    {
+        ObjData obj;
+        if (!LoadOBJ("Bird.obj", obj))
+            return;
+
+        const PointsSoA model = ToSoA(obj.positions);
+        BoxesSoA modelBoxes;
+        SpheresSoA modelSpheres;
+        FaceBounds(obj, model, modelBoxes, modelSpheres);
+        if (model.Size() == 0 || modelBoxes.Size() == 0)
+            return;
+
+        // copies of the model side by side
+        const size_t target = 1 << 20;
+        PointsSoA points;
+        BoxesSoA boxes;
+        SpheresSoA spheres;
+        const size_t pointCopies = (target + model.Size() - 1) / model.Size();
+        const size_t faceCopies = (target + modelBoxes.Size() - 1) / modelBoxes.Size();
+        for (size_t c = 0; c < max(pointCopies, faceCopies); ++c)
+        {
+            const float dx = (float)c * 4.0f;
+            auto append = [dx](PointsSoA& to, const PointsSoA& from)
+            {
+                for (size_t i = 0; i < from.Size(); ++i)
+                    to.x.push_back(from.x[i] + dx);
+                to.y.insert(to.y.end(), from.y.begin(), from.y.end());
+                to.z.insert(to.z.end(), from.z.begin(), from.z.end());
+            };
+            if (c < pointCopies)
+                append(points, model);
+            if (c < faceCopies)
+            {
+                append(boxes.min, modelBoxes.min);
+                append(boxes.max, modelBoxes.max);
+                append(spheres.center, modelSpheres.center);
+                spheres.radius.insert(spheres.radius.end(), modelSpheres.radius.begin(), modelSpheres.radius.end());
+            }
+        }
+
+        // rotation, non-uniform scale and a move
+        float m[16];
+        (simd::Translation(simd::Vec3(1.0f, 2.0f, 3.0f)) *
+            simd::ToMat4(simd::AxisAngle(simd::Normalize(simd::Vec3(1.0f, 2.0f, 0.5f)), 0.7f)) *
+            simd::Scale(simd::Vec3(1.5f, 0.5f, 2.0f))).Store(m);
+
+        // best of a few runs, in TSC ticks
+        auto ticks = [](const std::function<void()>& fn)
+        {
+            unsigned long long best = ~0ull;
+            for (int r = 0; r < 7; ++r)
+            {
+                const unsigned long long t0 = __rdtsc();
+                fn();
+                best = min(best, (unsigned long long)(__rdtsc() - t0));
+            }
+            return (double)best;
+        };
+
+        PointsSoA ssePoints, outPoints, hotIn, hotOut;
+        BoxesSoA sseBoxes, outBoxes;
+        SpheresSoA outSpheres;
+        // in and out of the small set fit in L1 together
+        hotIn.x.assign(points.x.begin(), points.x.begin() + 1024);
+        hotIn.y.assign(points.y.begin(), points.y.begin() + 1024);
+        hotIn.z.assign(points.z.begin(), points.z.begin() + 1024);
+
+        cout << "[transform] " << points.Size() << " points, " << boxes.Size() << " boxes and spheres from "
+            << obj.positions.size() << " positions / " << modelBoxes.Size() << " faces; items per TSC cycle\n";
+        printf("  %-8s %12s %12s %12s %12s %12s\n", "path", "points (L1)", "points", "vectors", "boxes", "spheres");
+        const BatchSimdPath paths[] = { kBatchSSE, kBatchAVX2, kBatchAVX512 };
+        for (BatchSimdPath path : paths)
+        {
+            if (SetBatchSimdPath(path) != path)
+            {
+                printf("  %-8s not supported on this CPU\n", BatchSimdPathName(path));
+                continue;
+            }
+            const double hot = ticks([&] { for (int r = 0; r < 64; ++r) TransformPoints(m, hotIn, hotOut); }) / 64.0;
+            const double pointTicks = ticks([&] { TransformPoints(m, points, outPoints); });
+            const double vectorTicks = ticks([&] { TransformVectors(m, points, outPoints); });
+            const double boxTicks = ticks([&] { TransformBoxes(m, boxes, outBoxes); });
+            const double sphereTicks = ticks([&] { TransformSpheres(m, spheres, outSpheres); });
+            TransformPoints(m, points, outPoints);
+
+            // every path against SSE, relative to the coordinates' size
+            float error = 0.0f;
+            if (path == kBatchSSE)
+            {
+                ssePoints = outPoints;
+                sseBoxes = outBoxes;
+            }
+            for (size_t i = 0; i < points.Size(); ++i)
+                error = max(error, fabsf(outPoints.x[i] - ssePoints.x[i]) / max(1.0f, fabsf(ssePoints.x[i])));
+            for (size_t i = 0; i < boxes.Size(); ++i)
+                error = max(error, fabsf(outBoxes.max.y[i] - sseBoxes.max.y[i]) / max(1.0f, fabsf(sseBoxes.max.y[i])));
+
+            printf("  %-8s %12.2f %12.2f %12.2f %12.2f %12.2f   max diff vs SSE %g\n", BatchSimdPathName(path),
+                hotIn.Size() / hot, points.Size() / pointTicks, points.Size() / vectorTicks, boxes.Size() / boxTicks,
+                spheres.Size() / sphereTicks, error);
+        }
+        SetBatchSimdPath(kBatchAuto);
+    }
+
+    // Primary rays over a width x height image, row by row, and the same rays
+    // as packets of 4 x 2 pixels
+    void MakeViewRays(const simd::Vec3& eye, const simd::Vec3& target, int width, int height,
+        vector<BvhRay>& rays, vector<BvhRayPacket>& packets)
+    {
+        const simd::Vec3 forward = simd::Normalize(target - eye);
+        const simd::Vec3 right = simd::Normalize(simd::Cross(forward, simd::Vec3(0.0f, 1.0f, 0.0f)));
+        const simd::Vec3 up = simd::Cross(right, forward);
+        constexpr float tanHalf = cx::Tan(cx::DegToRad(30.0f));
+
+        rays.resize((size_t)width * height);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const float sx = (2.0f * (x + 0.5f) / width - 1.0f) * tanHalf;
+                const float sy = (1.0f - 2.0f * (y + 0.5f) / height) * tanHalf;
+                const simd::Vec3 d = forward + right * sx + up * sy;
+                rays[(size_t)y * width + x] = { { eye.X(), eye.Y(), eye.Z() }, { d.X(), d.Y(), d.Z() }, 1e30f };
+            }
+        }
+
+        packets.clear();
+        for (int y = 0; y + 2 <= height; y += 2)
+        {
+            for (int x = 0; x + 4 <= width; x += 4)
+            {
+                BvhRayPacket p;
+                for (int i = 0; i < kBvhPacketSize; ++i)
+                {
+                    const BvhRay& r = rays[(size_t)(y + i / 4) * width + x + i % 4];
+                    p.ox[i] = r.origin[0]; p.oy[i] = r.origin[1]; p.oz[i] = r.origin[2];
+                    p.dx[i] = r.dir[0]; p.dy[i] = r.dir[1]; p.dz[i] = r.dir[2];
+                    p.tMax[i] = r.tMax;
+                }
+                packets.push_back(p);
+            }
+        }
+    }
+
+    // Every triangle against one ray, as the BVH tests them; the reference for the bvh bench
+    float BruteForceHit(const vector<Vertex>& vertices, const BvhRay& ray)
+    {
+        float best = ray.tMax;
+        const float* o = ray.origin;
+        const float* d = ray.dir;
+        for (size_t i = 0; i + 3 <= vertices.size(); i += 3)
+        {
+            const cx::Vec3 v0 = vertices[i].position;
+            const cx::Vec3 e1 = vertices[i + 1].position - v0, e2 = vertices[i + 2].position - v0;
+            const float px = d[1] * e2.z - d[2] * e2.y, py = d[2] * e2.x - d[0] * e2.z, pz = d[0] * e2.y - d[1] * e2.x;
+            const float det = e1.x * px + e1.y * py + e1.z * pz;
+            if (det == 0.0f)
+                continue;
+            const float invDet = 1.0f / det;
+            const float sx = o[0] - v0.x, sy = o[1] - v0.y, sz = o[2] - v0.z;
+            const float u = (sx * px + sy * py + sz * pz) * invDet;
+            const float qx = sy * e1.z - sz * e1.y, qy = sz * e1.x - sx * e1.z, qz = sx * e1.y - sy * e1.x;
+            const float v = (d[0] * qx + d[1] * qy + d[2] * qz) * invDet;
+            const float t = (e2.x * qx + e2.y * qy + e2.z * qz) * invDet;
+            if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < best)
+                best = t;
+        }
+        return best;
+    }
+
+    // ------------------------------------------------------------
+    // BVH: build times with one thread and with the workers, then millions
+    // of rays per second for closest and any hit, one ray at a time and in
+    // packets, on the bird, a finely tessellated superellipsoid and the bird
+    // plus a flock of 2000 instances
+    // ------------------------------------------------------------
+    void BenchBvh()
+    {
+        ObjData obj;
+        if (!LoadOBJ("Bird.obj", obj))
+            return;
+        const vector<Vertex> vertices = BuildVerticesFromObj(obj);
+        if (vertices.empty())
+            return;
+
+        vector<MeshVertex> blobVertices;
+        vector<GLuint> blobIndices;
+        BuildSuperellipsoid(256, 512, 0.6f, 0.6f, blobVertices, blobIndices);
+        static_assert(sizeof(GLuint) == sizeof(uint32_t), "index type");
+
+        struct Mesh
+        {
+            const char* name;
+            const void* positions;
+            size_t stride;
+            const uint32_t* indices;
+            size_t triangles;
+            MeshBvh bvh;
+        };
+        Mesh meshes[2] = {
+            { "bird", &vertices[0].position, sizeof(Vertex), nullptr, vertices.size() / 3, MeshBvh() },
+            { "superellipsoid", blobVertices[0].position, sizeof(MeshVertex), blobIndices.data(), blobIndices.size() / 3, MeshBvh() },
+        };
+
+        cout << "[bvh] build (binned SAH, 4-wide nodes), packets " << (BvhPacketsUseAvx2() ? "AVX2" : "one ray at a time") << ":\n";
+        const int threads = max(2, (int)thread::hardware_concurrency());
+        for (Mesh& m : meshes)
+        {
+            double serial = 1e30, parallel = 1e30;
+            InitJobSystem(0);
+            for (int r = 0; r < 3; ++r)
+            {
+                const double t0 = NowSeconds();
+                m.bvh.Build(m.positions, m.stride, m.indices, m.triangles);
+                serial = min(serial, NowSeconds() - t0);
+            }
+            ShutdownJobSystem();
+            InitJobSystem(threads - 1);
+            for (int r = 0; r < 3; ++r)
+            {
+                const double t0 = NowSeconds();
+                m.bvh.Build(m.positions, m.stride, m.indices, m.triangles);
+                parallel = min(parallel, NowSeconds() - t0);
+            }
+            ShutdownJobSystem();
+            printf("  %-15s %8zu triangles, %7zu nodes: %8.3f ms on 1 thread, %8.3f ms on %d\n", m.name,
+                m.bvh.GetTriangleCount(), m.bvh.GetNodeCount(), serial * 1e3, parallel * 1e3, threads);
+        }
+
+        InitJobSystem(threads - 1);
+        SceneBvh flock;
+        const double flockStart = NowSeconds();
+        BuildFlockScene(meshes[0].bvh, 2000, 0.0f, flock);
+        printf("  %-15s %8zu instances: %8.3f ms\n", "bird + flock", flock.GetInstanceCount(), (NowSeconds() - flockStart) * 1e3);
+
+        // 512 x 512 primary rays at each scene, then all four queries
+        auto run = [&](const char* name, const simd::Vec3& eye, const simd::Vec3& target, auto intersect, auto occluded,
+            auto intersectPacket, auto occludedPacket, const Mesh* brute)
+        {
+            vector<BvhRay> rays;
+            vector<BvhRayPacket> packets;
+            MakeViewRays(eye, target, 512, 512, rays, packets);
+            vector<float> t(rays.size());
+            int hits = 0, blocked = 0, packetMismatches = 0;
+            double best[4] = { 1e30, 1e30, 1e30, 1e30 };
+            for (int r = 0; r < 3; ++r)
+            {
+                double t0 = NowSeconds();
+                hits = 0;
+                for (size_t i = 0; i < rays.size(); ++i)
+                {
+                    BvhHit hit;
+                    hits += intersect(rays[i], hit) ? 1 : 0;
+                    t[i] = hit.triangle == kBvhNoHit ? rays[i].tMax : hit.t;
+                }
+                double t1 = NowSeconds();
+                blocked = 0;
+                for (const BvhRay& ray : rays)
+                    blocked += occluded(ray) ? 1 : 0;
+                double t2 = NowSeconds();
+                packetMismatches = 0;
+                for (size_t p = 0; p < packets.size(); ++p)
+                {
+                    BvhPacketHit ph;
+                    intersectPacket(packets[p], ph);
+                    const size_t row = (p / 128) * 2, column = (p % 128) * 4;
+                    for (int i = 0; i < kBvhPacketSize; ++i)
+                        packetMismatches += ph.t[i] != t[(row + i / 4) * 512 + column + i % 4] ? 1 : 0;
+                }
+                double t3 = NowSeconds();
+                int packetBlocked = 0;
+                for (const BvhRayPacket& p : packets)
+                {
+                    const int mask = occludedPacket(p);
+                    for (int i = 0; i < kBvhPacketSize; ++i)
+                        packetBlocked += (mask >> i) & 1;
+                }
+                double t4 = NowSeconds();
+                packetMismatches += abs(packetBlocked - blocked);
+
+                best[0] = min(best[0], t1 - t0);
+                best[1] = min(best[1], t2 - t1);
+                best[2] = min(best[2], t3 - t2);
+                best[3] = min(best[3], t4 - t3);
+            }
+
+            const double n = (double)rays.size() * 1e-6;
+            printf("  %-15s %6.2f%% hit | Mrays/s closest %7.2f, any %7.2f, packet closest %7.2f, packet any %7.2f",
+                name, 100.0 * hits / rays.size(), n / best[0], n / best[1], n / best[2], n / best[3]);
+            printf(" | %d packet lanes differ\n", packetMismatches);
+
+            // every 61st ray against all triangles
+            if (brute)
+            {
+                const vector<Vertex>& v = vertices;
+                int wrong = 0, tested = 0;
+                const double t0 = NowSeconds();
+                for (size_t i = 0; i < rays.size(); i += 61, ++tested)
+                    wrong += BruteForceHit(v, rays[i]) != t[i] ? 1 : 0;
+                const double bruteTime = NowSeconds() - t0;
+                printf("  %-15s brute force %.3f Mrays/s, %d of %d rays differ from the BVH\n", "",
+                    tested * 1e-6 / bruteTime, wrong, tested);
+            }
+        };
+
+        cout << "[bvh] ray queries, 512x512 primary rays, 1 thread:\n";
+        for (Mesh& m : meshes)
+        {
+            float lo[3], hi[3];
+            m.bvh.GetBounds(lo, hi);
+            const simd::Vec3 lower = simd::Vec3::Load(lo), upper = simd::Vec3::Load(hi);
+            const simd::Vec3 center = (lower + upper) * 0.5f;
+            const float radius = 0.5f * simd::Length(upper - lower);
+            const MeshBvh& bvh = m.bvh;
+            run(m.name, center + simd::Vec3(0.3f, 0.4f, 2.0f) * radius, center,
+                [&](const BvhRay& r, BvhHit& h) { return bvh.Intersect(r, h); },
+                [&](const BvhRay& r) { return bvh.Occluded(r); },
+                [&](const BvhRayPacket& p, BvhPacketHit& h) { bvh.IntersectPacket(p, h); },
+                [&](const BvhRayPacket& p) { return bvh.OccludedPacket(p); },
+                &m == &meshes[0] ? &m : nullptr);
+        }
+        run("bird + flock", simd::Vec3(0.0f, 2.0f, 8.0f), simd::Vec3(0.0f, 2.0f, 0.0f),
+            [&](const BvhRay& r, BvhHit& h) { return flock.Intersect(r, h); },
+            [&](const BvhRay& r) { return flock.Occluded(r); },
+            [&](const BvhRayPacket& p, BvhPacketHit& h) { flock.IntersectPacket(p, h); },
+            [&](const BvhRayPacket& p) { return flock.OccludedPacket(p); },
+            nullptr);
+
+        ShutdownJobSystem();
+    }
+
+    struct BenchEntry
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    const BenchEntry gBenches[] = {
+        { "jobs", BenchJobs },
+        { "flock", BenchFlock },
+        { "occlusion", BenchOcclusion },
+        { "math", BenchMath },
+        { "cull", BenchCull },
+        { "transform", BenchTransform },
+        { "bvh", BenchBvh },
+    };
+}
+
+int RunBenchmarks(const string& name)
+{
+    bool ran = false;
+    for (const BenchEntry& b : gBenches)
+    {
+        if (name == "all" || name == b.name)
+        {
+            b.run();
+            ran = true;
+        }
+    }
+
+    if (!ran)
+    {
+        cerr << "Unknown benchmark '" << name << "'. Available: all";
+        for (const BenchEntry& b : gBenches)
+            cerr << ", " << b.name;
+        cerr << "\n";
+        return 1;
+    }
+    return gMathFailed || gCullFailed ? 1 : 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <string>
+
+// Microbenchmarks, run with "--bench [name]" instead of opening the window.
+// Returns the process exit code.
+int RunBenchmarks(const std::string& name);
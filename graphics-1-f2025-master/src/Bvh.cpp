@@ -0,0 +1,1015 @@
+#include "Bvh.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+#include "SimdMath.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+
+namespace
+{
+    const int kBins = 16;
+    const uint32_t kLeafSize = 4;
+    const uint32_t kParallelBuildMin = 4096;   // subtrees above this go to another job
+    const uint32_t kParallelBinMin = 1 << 16;  // ranges above this are measured with ParallelFor
+    const int kStackSize = 256;
+
+    // no FMA (CPU_TARGET_AVX2), so a packet finds exactly the hits single rays do
+    const bool gPacketAvx2 = CpuHasAvx2();
+
+    // ------------------------------------------------------------
+    // Build: binary tree with a binned SAH
+    // ------------------------------------------------------------
+    struct Box
+    {
+        float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+        void Grow(const Box& b)
+        {
+            for (int a = 0; a < 3; ++a)
+            {
+                min[a] = std::min(min[a], b.min[a]);
+                max[a] = std::max(max[a], b.max[a]);
+            }
+        }
+
+        void Grow(const float p[3])
+        {
+            for (int a = 0; a < 3; ++a)
+            {
+                min[a] = std::min(min[a], p[a]);
+                max[a] = std::max(max[a], p[a]);
+            }
+        }
+
+        // half the surface area, 0 when empty
+        float Area() const
+        {
+            const float x = max[0] - min[0], y = max[1] - min[1], z = max[2] - min[2];
+            return x < 0.0f ? 0.0f : x * y + y * z + z * x;
+        }
+    };
+
+    struct BuildNode
+    {
+        Box box;
+        uint32_t left = 0;      // children at left and left + 1
+        uint32_t first = 0;     // leaf: order[first, first + count)
+        uint32_t count = 0;
+    };
+
+    struct Bin
+    {
+        Box box;
+        uint32_t count = 0;
+    };
+
+    // Bounds and centroid bounds of a range of primitives
+    struct Extent
+    {
+        Box box;
+        Box centroids;
+
+        void Grow(const Extent& e)
+        {
+            box.Grow(e.box);
+            centroids.Grow(e.centroids);
+        }
+    };
+
+    class Builder
+    {
+    public:
+        // Fills nodes (root first) and, four per leaf, the primitives of each leaf
+        void Build(const std::vector<Box>& primBoxes, std::vector<BvhNode4>& out, std::vector<uint32_t>& leafPrims)
+        {
+            out.clear();
+            leafPrims.clear();
+            const uint32_t count = (uint32_t)primBoxes.size();
+            if (count == 0)
+                return;
+
+            prims = primBoxes.data();
+            centers.resize(count * 3);
+            order.resize(count);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                for (int a = 0; a < 3; ++a)
+                    centers[i * 3 + a] = (prims[i].min[a] + prims[i].max[a]) * 0.5f;
+                order[i] = i;
+            }
+
+            nodes.assign(count * 2, BuildNode());
+            nodeCount = 1;
+            Subdivide(0, 0, count);
+            WaitForCounter(counter);
+
+            Collapse(out, leafPrims);
+        }
+
+    private:
+        const Box* prims = nullptr;
+        std::vector<float> centers;
+        std::vector<uint32_t> order;
+        std::vector<BuildNode> nodes;
+        std::atomic<uint32_t> nodeCount{ 0 };
+        JobCounter counter;
+
+        Extent MeasureRange(uint32_t begin, uint32_t end) const
+        {
+            Extent e;
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                e.box.Grow(prims[order[i]]);
+                e.centroids.Grow(&centers[order[i] * 3]);
+            }
+            return e;
+        }
+
+        Extent Measure(uint32_t first, uint32_t count) const
+        {
+            if (count < kParallelBinMin)
+                return MeasureRange(first, first + count);
+
+            const uint32_t grain = kParallelBinMin / 4;
+            std::vector<Extent> parts((count + grain - 1) / grain);
+            ParallelFor(count, grain, [&](size_t begin, size_t end)
+            {
+                parts[begin / grain] = MeasureRange(first + (uint32_t)begin, first + (uint32_t)end);
+            });
+            Extent e;
+            for (const Extent& p : parts)
+                e.Grow(p);
+            return e;
+        }
+
+        void BinRange(uint32_t begin, uint32_t end, const Box& centroids, Bin (*bins)[kBins]) const
+        {
+            for (int a = 0; a < 3; ++a)
+            {
+                const float extent = centroids.max[a] - centroids.min[a];
+                if (extent <= 0.0f)
+                    continue;
+                const float scale = kBins / extent;
+                for (uint32_t i = begin; i < end; ++i)
+                {
+                    const uint32_t p = order[i];
+                    const int b = std::min(kBins - 1, (int)((centers[p * 3 + a] - centroids.min[a]) * scale));
+                    bins[a][b].box.Grow(prims[p]);
+                    bins[a][b].count++;
+                }
+            }
+        }
+
+        // Best split plane over all three axes: returns false when every
+        // centroid is in the same spot
+        bool FindSplit(uint32_t first, uint32_t count, const Box& centroids, int& bestAxis, int& bestBin)
+        {
+            Bin bins[3][kBins];
+            if (count < kParallelBinMin)
+                BinRange(first, first + count, centroids, bins);
+            else
+            {
+                const uint32_t grain = kParallelBinMin / 4;
+                std::vector<Bin> parts(((count + grain - 1) / grain) * 3 * kBins);
+                ParallelFor(count, grain, [&](size_t begin, size_t end)
+                {
+                    Bin (*part)[kBins] = (Bin (*)[kBins])&parts[(begin / grain) * 3 * kBins];
+                    BinRange(first + (uint32_t)begin, first + (uint32_t)end, centroids, part);
+                });
+                for (size_t p = 0; p < parts.size(); ++p)
+                {
+                    Bin& b = bins[(p / kBins) % 3][p % kBins];
+                    b.box.Grow(parts[p].box);
+                    b.count += parts[p].count;
+                }
+            }
+
+            float bestCost = FLT_MAX;
+            bestAxis = -1;
+            for (int a = 0; a < 3; ++a)
+            {
+                if (centroids.max[a] <= centroids.min[a])
+                    continue;
+
+                // left side swept forward, right side backward
+                float leftArea[kBins];
+                uint32_t leftCount[kBins];
+                Box box;
+                uint32_t n = 0;
+                for (int b = 0; b < kBins; ++b)
+                {
+                    box.Grow(bins[a][b].box);
+                    n += bins[a][b].count;
+                    leftArea[b] = box.Area();
+                    leftCount[b] = n;
+                }
+                box = Box();
+                n = 0;
+                for (int b = kBins - 1; b > 0; --b)
+                {
+                    box.Grow(bins[a][b].box);
+                    n += bins[a][b].count;
+                    const float cost = leftArea[b - 1] * leftCount[b - 1] + box.Area() * n;
+                    if (leftCount[b - 1] > 0 && n > 0 && cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = a;
+                        bestBin = b;
+                    }
+                }
+            }
+            return bestAxis >= 0;
+        }
+
+        void Subdivide(uint32_t node, uint32_t first, uint32_t count)
+        {
+            const Extent extent = Measure(first, count);
+            BuildNode& n = nodes[node];
+            n.box = extent.box;
+            if (count <= kLeafSize)
+            {
+                n.first = first;
+                n.count = count;
+                return;
+            }
+
+            uint32_t* begin = order.data() + first;
+            uint32_t* mid = begin + count / 2;
+            int axis = 0, bin = 0;
+            if (FindSplit(first, count, extent.centroids, axis, bin))
+            {
+                const float lo = extent.centroids.min[axis];
+                const float scale = kBins / (extent.centroids.max[axis] - lo);
+                mid = std::partition(begin, begin + count, [&](uint32_t p)
+                {
+                    return std::min(kBins - 1, (int)((centers[p * 3 + axis] - lo) * scale)) < bin;
+                });
+            }
+            // identical centroids: any half will do
+            if (mid == begin || mid == begin + count)
+                mid = begin + count / 2;
+
+            const uint32_t leftCount = (uint32_t)(mid - begin);
+            const uint32_t left = nodeCount.fetch_add(2);
+            n.left = left;
+            if (count > kParallelBuildMin)
+            {
+                RunJob([=] { Subdivide(left, first, leftCount); }, &counter);
+                Subdivide(left + 1, first + leftCount, count - leftCount);
+            }
+            else
+            {
+                Subdivide(left, first, leftCount);
+                Subdivide(left + 1, first + leftCount, count - leftCount);
+            }
+        }
+
+        // ------------------------------------------------------------
+        // Binary tree to 4-wide nodes: each node takes its two children and
+        // keeps opening the biggest inner one until it has four
+        // ------------------------------------------------------------
+        uint32_t EmitChild(uint32_t index, std::vector<BvhNode4>& out, std::vector<uint32_t>& leafPrims) const
+        {
+            const BuildNode& n = nodes[index];
+            if (n.count == 0)
+                return EmitNode(index, out, leafPrims);
+
+            const uint32_t leaf = (uint32_t)(leafPrims.size() / 4);
+            for (uint32_t k = 0; k < 4; ++k)
+                leafPrims.push_back(k < n.count ? order[n.first + k] : kBvhNoHit);
+            return kBvhLeafBit | leaf;
+        }
+
+        uint32_t EmitNode(uint32_t index, std::vector<BvhNode4>& out, std::vector<uint32_t>& leafPrims) const
+        {
+            uint32_t kids[4];
+            int kidCount = 0;
+            if (nodes[index].count > 0)
+                kids[kidCount++] = index;   // a root small enough to be one leaf
+            else
+            {
+                kids[kidCount++] = nodes[index].left;
+                kids[kidCount++] = nodes[index].left + 1;
+            }
+            while (kidCount < 4)
+            {
+                int open = -1;
+                float area = -1.0f;
+                for (int k = 0; k < kidCount; ++k)
+                {
+                    if (nodes[kids[k]].count == 0 && nodes[kids[k]].box.Area() > area)
+                    {
+                        open = k;
+                        area = nodes[kids[k]].box.Area();
+                    }
+                }
+                if (open < 0)
+                    break;
+                const uint32_t left = nodes[kids[open]].left;
+                kids[open] = left;
+                kids[kidCount++] = left + 1;
+            }
+
+            const uint32_t self = (uint32_t)out.size();
+            out.emplace_back();
+            for (int k = 0; k < 4; ++k)
+            {
+                const Box box = k < kidCount ? nodes[kids[k]].box : Box();
+                const uint32_t child = k < kidCount ? EmitChild(kids[k], out, leafPrims) : kBvhNoHit;
+                BvhNode4& node = out[self];
+                for (int a = 0; a < 3; ++a)
+                {
+                    node.bounds[0][a][k] = box.min[a];
+                    node.bounds[1][a][k] = box.max[a];
+                }
+                node.child[k] = child;
+            }
+            return self;
+        }
+
+        void Collapse(std::vector<BvhNode4>& out, std::vector<uint32_t>& leafPrims) const
+        {
+            out.reserve(nodeCount / 2 + 1);
+            leafPrims.reserve(order.size() * 2);
+            EmitNode(0, out, leafPrims);
+        }
+    };
+
+    // ------------------------------------------------------------
+    // Single rays: SSE over the four children of a node, or the four
+    // triangles of a leaf
+    // ------------------------------------------------------------
+
+    // 1 / d without infinities, so a box face in line with the origin gives 0, not NaN
+    inline float SafeInverse(float d)
+    {
+        return 1.0f / (fabsf(d) < 1e-30f ? (std::signbit(d) ? -1e-30f : 1e-30f) : d);
+    }
+
+    struct RaySse
+    {
+        __m128 o[3], d[3], inv[3];
+        int neg[3];
+    };
+
+    RaySse SetupRay(const float origin[3], const float dir[3])
+    {
+        RaySse r;
+        for (int a = 0; a < 3; ++a)
+        {
+            const float inv = SafeInverse(dir[a]);
+            r.o[a] = _mm_set1_ps(origin[a]);
+            r.d[a] = _mm_set1_ps(dir[a]);
+            r.inv[a] = _mm_set1_ps(inv);
+            r.neg[a] = inv < 0.0f ? 1 : 0;
+        }
+        return r;
+    }
+
+    // Children entered before tMax as a bit mask, their entry distances in tNear.
+    // The near face of each slab comes from the ray's direction, so the
+    // inverted boxes of unused slots never pass.
+    inline int TestNode(const BvhNode4& n, const RaySse& r, float tMax, float tNear[4])
+    {
+        __m128 near = _mm_setzero_ps(), far = _mm_set1_ps(tMax);
+        for (int a = 0; a < 3; ++a)
+        {
+            const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(n.bounds[r.neg[a]][a]), r.o[a]), r.inv[a]);
+            const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(n.bounds[1 - r.neg[a]][a]), r.o[a]), r.inv[a]);
+            near = _mm_max_ps(near, t0);
+            far = _mm_min_ps(far, t1);
+        }
+        _mm_storeu_ps(tNear, near);
+        return _mm_movemask_ps(_mm_cmple_ps(near, far));
+    }
+
+    // Moller-Trumbore on four triangles: the lane of the closest hit in
+    // (0, tMax), or -1
+    inline int IntersectTri4(const BvhTri4& tri, const RaySse& r, float tMax, float& t, float& u, float& v)
+    {
+        const __m128 e1x = _mm_load_ps(tri.e1[0]), e1y = _mm_load_ps(tri.e1[1]), e1z = _mm_load_ps(tri.e1[2]);
+        const __m128 e2x = _mm_load_ps(tri.e2[0]), e2y = _mm_load_ps(tri.e2[1]), e2z = _mm_load_ps(tri.e2[2]);
+
+        // p = d x e2, det = e1 . p
+        const __m128 px = _mm_sub_ps(_mm_mul_ps(r.d[1], e2z), _mm_mul_ps(r.d[2], e2y));
+        const __m128 py = _mm_sub_ps(_mm_mul_ps(r.d[2], e2x), _mm_mul_ps(r.d[0], e2z));
+        const __m128 pz = _mm_sub_ps(_mm_mul_ps(r.d[0], e2y), _mm_mul_ps(r.d[1], e2x));
+        const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+        // s = o - v0, q = s x e1
+        const __m128 sx = _mm_sub_ps(r.o[0], _mm_load_ps(tri.v0[0]));
+        const __m128 sy = _mm_sub_ps(r.o[1], _mm_load_ps(tri.v0[1]));
+        const __m128 sz = _mm_sub_ps(r.o[2], _mm_load_ps(tri.v0[2]));
+        const __m128 uu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        const __m128 vv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r.d[0], qx), _mm_mul_ps(r.d[1], qy)), _mm_mul_ps(r.d[2], qz)), invDet);
+        const __m128 tt = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+        // unused lanes have zero edges: det = 0 and every test fails
+        const __m128 zero = _mm_setzero_ps();
+        __m128 hit = _mm_cmpneq_ps(det, zero);
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(uu, zero), _mm_cmpge_ps(vv, zero)));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(uu, vv), _mm_set1_ps(1.0f)));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpgt_ps(tt, zero), _mm_cmplt_ps(tt, _mm_set1_ps(tMax))));
+        int mask = _mm_movemask_ps(hit);
+        if (!mask)
+            return -1;
+
+        float ts[4], us[4], vs[4];
+        _mm_storeu_ps(ts, tt);
+        _mm_storeu_ps(us, uu);
+        _mm_storeu_ps(vs, vv);
+        int best = -1;
+        for (int k = 0; k < 4; ++k)
+        {
+            if ((mask & (1 << k)) && (best < 0 || ts[k] < ts[best]))
+                best = k;
+        }
+        t = ts[best];
+        u = us[best];
+        v = vs[best];
+        return best;
+    }
+
+    // Children in mask, sorted far to near onto the stack
+    inline void PushSorted(const BvhNode4& n, int mask, const float tNear[4], uint32_t* stack, int& top)
+    {
+        int kids[4], count = 0;
+        for (int k = 0; k < 4; ++k)
+        {
+            if (!(mask & (1 << k)))
+                continue;
+            int at = count++;
+            while (at > 0 && tNear[kids[at - 1]] < tNear[k])
+            {
+                kids[at] = kids[at - 1];
+                --at;
+            }
+            kids[at] = k;
+        }
+        for (int k = 0; k < count && top < kStackSize; ++k)
+            stack[top++] = n.child[kids[k]];
+    }
+
+    // Visits the leaves the ray reaches, nearest subtree first. leaf(index)
+    // may lower tMax and returns true to stop.
+    template <typename LeafFn>
+    void Traverse(const std::vector<BvhNode4>& nodes, const RaySse& r, const float& tMax, const LeafFn& leaf)
+    {
+        if (nodes.empty())
+            return;
+        uint32_t stack[kStackSize];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const uint32_t code = stack[--top];
+            if (code & kBvhLeafBit)
+            {
+                if (leaf(code & ~kBvhLeafBit))
+                    return;
+                continue;
+            }
+            const BvhNode4& n = nodes[code];
+            float tNear[4];
+            const int mask = TestNode(n, r, tMax, tNear);
+            if (mask)
+                PushSorted(n, mask, tNear, stack, top);
+        }
+    }
+
+    // ------------------------------------------------------------
+    // Packets: 8 rays per AVX2 register, through the same 4-wide nodes
+    // ------------------------------------------------------------
+    struct alignas(32) PacketRays
+    {
+        float o[3][kBvhPacketSize];
+        float d[3][kBvhPacketSize];
+        float inv[3][kBvhPacketSize];
+    };
+
+    PacketRays SetupPacket(const BvhRayPacket& rays)
+    {
+        PacketRays p;
+        const float* o[3] = { rays.ox, rays.oy, rays.oz };
+        const float* d[3] = { rays.dx, rays.dy, rays.dz };
+        for (int a = 0; a < 3; ++a)
+        {
+            for (int i = 0; i < kBvhPacketSize; ++i)
+            {
+                p.o[a][i] = o[a][i];
+                p.d[a][i] = d[a][i];
+                p.inv[a][i] = SafeInverse(d[a][i]);
+            }
+        }
+        return p;
+    }
+
+    inline int LowestBit(int mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, (unsigned long)mask);
+        return (int)index;
+#else
+        return __builtin_ctz((unsigned)mask);
+#endif
+    }
+
+    // Lanes in mask as all-ones
+    CPU_TARGET_AVX2 inline __m256 LaneMask(int mask)
+    {
+        const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(mask), bits), bits));
+    }
+
+    // The leaf's triangles against the active rays, in the same operation
+    // order as IntersectTri4. Updates t/u/v/triangle of the lanes that got
+    // closer; returns those lanes.
+    CPU_TARGET_AVX2 int IntersectTri4Packet(const BvhTri4& tri, const PacketRays& p, int active,
+        float* tMax, float* uOut, float* vOut, uint32_t* triOut)
+    {
+        const __m256 ox = _mm256_load_ps(p.o[0]), oy = _mm256_load_ps(p.o[1]), oz = _mm256_load_ps(p.o[2]);
+        const __m256 dx = _mm256_load_ps(p.d[0]), dy = _mm256_load_ps(p.d[1]), dz = _mm256_load_ps(p.d[2]);
+        const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+        __m256 tBest = _mm256_loadu_ps(tMax), uBest = _mm256_loadu_ps(uOut), vBest = _mm256_loadu_ps(vOut);
+        __m256i idBest = _mm256_loadu_si256((const __m256i*)triOut);
+        const __m256 live = LaneMask(active);
+        int hits = 0;
+
+        for (int k = 0; k < 4 && tri.id[k] != kBvhNoHit; ++k)
+        {
+            const __m256 e1x = _mm256_set1_ps(tri.e1[0][k]), e1y = _mm256_set1_ps(tri.e1[1][k]), e1z = _mm256_set1_ps(tri.e1[2][k]);
+            const __m256 e2x = _mm256_set1_ps(tri.e2[0][k]), e2y = _mm256_set1_ps(tri.e2[1][k]), e2z = _mm256_set1_ps(tri.e2[2][k]);
+
+            const __m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+            const __m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+            const __m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+            const __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+            const __m256 invDet = _mm256_div_ps(one, det);
+
+            const __m256 sx = _mm256_sub_ps(ox, _mm256_set1_ps(tri.v0[0][k]));
+            const __m256 sy = _mm256_sub_ps(oy, _mm256_set1_ps(tri.v0[1][k]));
+            const __m256 sz = _mm256_sub_ps(oz, _mm256_set1_ps(tri.v0[2][k]));
+            const __m256 uu = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)), invDet);
+            const __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+            const __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+            const __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+            const __m256 vv = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), invDet);
+            const __m256 tt = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), invDet);
+
+            __m256 hit = _mm256_and_ps(live, _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ));
+            hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(uu, zero, _CMP_GE_OQ), _mm256_cmp_ps(vv, zero, _CMP_GE_OQ)));
+            hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_add_ps(uu, vv), one, _CMP_LE_OQ));
+            hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(tt, zero, _CMP_GT_OQ), _mm256_cmp_ps(tt, tBest, _CMP_LT_OQ)));
+            const int mask = _mm256_movemask_ps(hit);
+            if (!mask)
+                continue;
+
+            tBest = _mm256_blendv_ps(tBest, tt, hit);
+            uBest = _mm256_blendv_ps(uBest, uu, hit);
+            vBest = _mm256_blendv_ps(vBest, vv, hit);
+            idBest = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(idBest),
+                _mm256_castsi256_ps(_mm256_set1_epi32((int)tri.id[k])), hit));
+            hits |= mask;
+        }
+
+        _mm256_storeu_ps(tMax, tBest);
+        _mm256_storeu_ps(uOut, uBest);
+        _mm256_storeu_ps(vOut, vBest);
+        _mm256_storeu_si256((__m256i*)triOut, idBest);
+        return hits;
+    }
+
+    // Visits the leaves any active ray reaches, ordered by the first active
+    // ray's distance. leaf(index, active) may lower tMax[] and returns the
+    // rays still active; the walk ends when none are.
+    template <typename LeafFn>
+    CPU_TARGET_AVX2 void TraversePacket(const std::vector<BvhNode4>& nodes, const PacketRays& p, const float* tMax,
+        int active, const LeafFn& leaf)
+    {
+        if (nodes.empty() || !active)
+            return;
+        const __m256 o[3] = { _mm256_load_ps(p.o[0]), _mm256_load_ps(p.o[1]), _mm256_load_ps(p.o[2]) };
+        const __m256 inv[3] = { _mm256_load_ps(p.inv[0]), _mm256_load_ps(p.inv[1]), _mm256_load_ps(p.inv[2]) };
+        __m256 live = LaneMask(active);
+        __m256 far0 = _mm256_loadu_ps(tMax);
+
+        uint32_t stack[kStackSize];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const uint32_t code = stack[--top];
+            if (code & kBvhLeafBit)
+            {
+                active = leaf(code & ~kBvhLeafBit, active);
+                if (!active)
+                    return;
+                live = LaneMask(active);
+                far0 = _mm256_loadu_ps(tMax);
+                continue;
+            }
+
+            // rays mix directions, so each slab takes min/max; unused slots are skipped by code
+            const BvhNode4& n = nodes[code];
+            const int first = LowestBit(active);
+            float tNear[4];
+            int mask = 0;
+            for (int k = 0; k < 4; ++k)
+            {
+                if (n.child[k] == kBvhNoHit)
+                    continue;
+                __m256 near = _mm256_setzero_ps(), far = far0;
+                for (int a = 0; a < 3; ++a)
+                {
+                    const __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(n.bounds[0][a][k]), o[a]), inv[a]);
+                    const __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(n.bounds[1][a][k]), o[a]), inv[a]);
+                    near = _mm256_max_ps(near, _mm256_min_ps(t0, t1));
+                    far = _mm256_min_ps(far, _mm256_max_ps(t0, t1));
+                }
+                if (_mm256_movemask_ps(_mm256_and_ps(live, _mm256_cmp_ps(near, far, _CMP_LE_OQ))))
+                {
+                    alignas(32) float lanes[kBvhPacketSize];
+                    _mm256_store_ps(lanes, near);
+                    tNear[k] = lanes[first];
+                    mask |= 1 << k;
+                }
+            }
+            if (mask)
+                PushSorted(n, mask, tNear, stack, top);
+        }
+    }
+
+    // worldToLocal applied to lane i of a packet, as point and as direction
+    void TransformPacket(const float* m, const BvhRayPacket& in, BvhRayPacket& out)
+    {
+        for (int i = 0; i < kBvhPacketSize; ++i)
+        {
+            const float x = in.ox[i], y = in.oy[i], z = in.oz[i];
+            out.ox[i] = m[0] * x + m[4] * y + m[8] * z + m[12];
+            out.oy[i] = m[1] * x + m[5] * y + m[9] * z + m[13];
+            out.oz[i] = m[2] * x + m[6] * y + m[10] * z + m[14];
+            const float dx = in.dx[i], dy = in.dy[i], dz = in.dz[i];
+            out.dx[i] = m[0] * dx + m[4] * dy + m[8] * dz;
+            out.dy[i] = m[1] * dx + m[5] * dy + m[9] * dz;
+            out.dz[i] = m[2] * dx + m[6] * dy + m[10] * dz;
+            out.tMax[i] = in.tMax[i];
+        }
+    }
+
+    BvhRay TransformRay(const float* m, const BvhRay& in, float tMax)
+    {
+        BvhRay out;
+        const float* o = in.origin;
+        const float* d = in.dir;
+        for (int r = 0; r < 3; ++r)
+        {
+            out.origin[r] = m[r] * o[0] + m[4 + r] * o[1] + m[8 + r] * o[2] + m[12 + r];
+            out.dir[r] = m[r] * d[0] + m[4 + r] * d[1] + m[8 + r] * d[2];
+        }
+        out.tMax = tMax;
+        return out;
+    }
+
+    BvhRay PacketLane(const BvhRayPacket& p, int i)
+    {
+        BvhRay r = { { p.ox[i], p.oy[i], p.oz[i] }, { p.dx[i], p.dy[i], p.dz[i] }, p.tMax[i] };
+        return r;
+    }
+
+    int LiveLanes(const BvhRayPacket& p)
+    {
+        int mask = 0;
+        for (int i = 0; i < kBvhPacketSize; ++i)
+            mask |= p.tMax[i] > 0.0f ? 1 << i : 0;
+        return mask;
+    }
+
+    void ClearHits(const BvhRayPacket& rays, BvhPacketHit& hits)
+    {
+        for (int i = 0; i < kBvhPacketSize; ++i)
+        {
+            hits.t[i] = rays.tMax[i];
+            hits.u[i] = hits.v[i] = 0.0f;
+            hits.triangle[i] = hits.instance[i] = kBvhNoHit;
+        }
+    }
+}
+
+bool BvhPacketsUseAvx2()
+{
+    return gPacketAvx2;
+}
+
+// ------------------------------------------------------------
+// MeshBvh
+// ------------------------------------------------------------
+void MeshBvh::Build(const void* positions, size_t stride, const uint32_t* indices, size_t count)
+{
+    std::vector<float> corners(count * 9);
+    std::vector<Box> boxes(count);
+    for (size_t t = 0; t < count; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const size_t vertex = indices ? indices[t * 3 + k] : t * 3 + k;
+            const float* p = (const float*)((const char*)positions + vertex * stride);
+            memcpy(&corners[t * 9 + k * 3], p, 3 * sizeof(float));
+            boxes[t].Grow(p);
+        }
+    }
+
+    std::vector<uint32_t> leafPrims;
+    Builder builder;
+    builder.Build(boxes, nodes, leafPrims);
+    triangleCount = count;
+
+    leaves.assign(leafPrims.size() / 4, BvhTri4());
+    for (size_t leaf = 0; leaf < leaves.size(); ++leaf)
+    {
+        BvhTri4& tri = leaves[leaf];
+        for (int k = 0; k < 4; ++k)
+        {
+            const uint32_t id = leafPrims[leaf * 4 + k];
+            tri.id[k] = id;
+            for (int a = 0; a < 3; ++a)
+            {
+                const float* c = id == kBvhNoHit ? nullptr : &corners[id * 9];
+                tri.v0[a][k] = c ? c[a] : 0.0f;
+                tri.e1[a][k] = c ? c[3 + a] - c[a] : 0.0f;
+                tri.e2[a][k] = c ? c[6 + a] - c[a] : 0.0f;
+            }
+        }
+    }
+}
+
+void MeshBvh::GetBounds(float min[3], float max[3]) const
+{
+    for (int a = 0; a < 3; ++a)
+    {
+        min[a] = FLT_MAX;
+        max[a] = -FLT_MAX;
+    }
+    if (nodes.empty())
+        return;
+    for (int k = 0; k < 4; ++k)
+    {
+        if (nodes[0].child[k] == kBvhNoHit)
+            continue;
+        for (int a = 0; a < 3; ++a)
+        {
+            min[a] = std::min(min[a], nodes[0].bounds[0][a][k]);
+            max[a] = std::max(max[a], nodes[0].bounds[1][a][k]);
+        }
+    }
+}
+
+bool MeshBvh::Intersect(const BvhRay& ray, BvhHit& hit) const
+{
+    const RaySse r = SetupRay(ray.origin, ray.dir);
+    float tMax = ray.tMax;
+    bool found = false;
+    Traverse(nodes, r, tMax, [&](uint32_t leaf)
+    {
+        float t, u, v;
+        const int lane = IntersectTri4(leaves[leaf], r, tMax, t, u, v);
+        if (lane >= 0)
+        {
+            tMax = hit.t = t;
+            hit.u = u;
+            hit.v = v;
+            hit.triangle = leaves[leaf].id[lane];
+            hit.instance = kBvhNoHit;
+            found = true;
+        }
+        return false;
+    });
+    return found;
+}
+
+bool MeshBvh::Occluded(const BvhRay& ray) const
+{
+    const RaySse r = SetupRay(ray.origin, ray.dir);
+    const float tMax = ray.tMax;
+    bool found = false;
+    Traverse(nodes, r, tMax, [&](uint32_t leaf)
+    {
+        float t, u, v;
+        found = IntersectTri4(leaves[leaf], r, tMax, t, u, v) >= 0;
+        return found;
+    });
+    return found;
+}
+
+void MeshBvh::IntersectPacket(const BvhRayPacket& rays, BvhPacketHit& hits) const
+{
+    ClearHits(rays, hits);
+    if (!gPacketAvx2)
+    {
+        for (int i = 0; i < kBvhPacketSize; ++i)
+        {
+            BvhHit hit;
+            if (rays.tMax[i] > 0.0f && Intersect(PacketLane(rays, i), hit))
+            {
+                hits.t[i] = hit.t;
+                hits.u[i] = hit.u;
+                hits.v[i] = hit.v;
+                hits.triangle[i] = hit.triangle;
+            }
+        }
+        return;
+    }
+
+    const PacketRays p = SetupPacket(rays);
+    TraversePacket(nodes, p, hits.t, LiveLanes(rays), [&](uint32_t leaf, int active)
+    {
+        IntersectTri4Packet(leaves[leaf], p, active, hits.t, hits.u, hits.v, hits.triangle);
+        return active;
+    });
+}
+
+int MeshBvh::OccludedPacket(const BvhRayPacket& rays) const
+{
+    int occluded = 0;
+    if (!gPacketAvx2)
+    {
+        for (int i = 0; i < kBvhPacketSize; ++i)
+            occluded |= rays.tMax[i] > 0.0f && Occluded(PacketLane(rays, i)) ? 1 << i : 0;
+        return occluded;
+    }
+
+    // any hit will do, so each ray leaves once it has one
+    const PacketRays p = SetupPacket(rays);
+    BvhPacketHit scratch;
+    ClearHits(rays, scratch);
+    TraversePacket(nodes, p, scratch.t, LiveLanes(rays), [&](uint32_t leaf, int active)
+    {
+        const int hits = IntersectTri4Packet(leaves[leaf], p, active, scratch.t, scratch.u, scratch.v, scratch.triangle);
+        occluded |= hits;
+        return active & ~hits;
+    });
+    return occluded;
+}
+
+// ------------------------------------------------------------
+// SceneBvh
+// ------------------------------------------------------------
+void SceneBvh::Build(const BvhInstance* source, size_t count)
+{
+    instances.resize(count);
+    std::vector<Box> boxes(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        instances[i].mesh = source[i].mesh;
+        simd::Inverse(simd::Mat4::Load(source[i].model)).Store(instances[i].worldToLocal);
+
+        // world box around the mesh's box: center through m, half extents through |m|
+        float lo[3], hi[3];
+        source[i].mesh->GetBounds(lo, hi);
+        if (lo[0] > hi[0])
+            continue;
+        const float* m = source[i].model;
+        for (int r = 0; r < 3; ++r)
+        {
+            float center = m[12 + r], extent = 0.0f;
+            for (int c = 0; c < 3; ++c)
+            {
+                center += m[c * 4 + r] * (lo[c] + hi[c]) * 0.5f;
+                extent += fabsf(m[c * 4 + r]) * (hi[c] - lo[c]) * 0.5f;
+            }
+            boxes[i].min[r] = center - extent;
+            boxes[i].max[r] = center + extent;
+        }
+    }
+
+    Builder builder;
+    builder.Build(boxes, nodes, leaves);
+}
+
+bool SceneBvh::Intersect(const BvhRay& ray, BvhHit& hit) const
+{
+    const RaySse r = SetupRay(ray.origin, ray.dir);
+    float tMax = ray.tMax;
+    bool found = false;
+    Traverse(nodes, r, tMax, [&](uint32_t leaf)
+    {
+        for (int k = 0; k < 4 && leaves[leaf * 4 + k] != kBvhNoHit; ++k)
+        {
+            const uint32_t id = leaves[leaf * 4 + k];
+            const Instance& inst = instances[id];
+            if (inst.mesh->Intersect(TransformRay(inst.worldToLocal, ray, tMax), hit))
+            {
+                tMax = hit.t;
+                hit.instance = id;
+                found = true;
+            }
+        }
+        return false;
+    });
+    return found;
+}
+
+bool SceneBvh::Occluded(const BvhRay& ray) const
+{
+    const RaySse r = SetupRay(ray.origin, ray.dir);
+    const float tMax = ray.tMax;
+    bool found = false;
+    Traverse(nodes, r, tMax, [&](uint32_t leaf)
+    {
+        for (int k = 0; k < 4 && leaves[leaf * 4 + k] != kBvhNoHit && !found; ++k)
+        {
+            const Instance& inst = instances[leaves[leaf * 4 + k]];
+            found = inst.mesh->Occluded(TransformRay(inst.worldToLocal, ray, tMax));
+        }
+        return found;
+    });
+    return found;
+}
+
+void SceneBvh::IntersectPacket(const BvhRayPacket& rays, BvhPacketHit& hits) const
+{
+    ClearHits(rays, hits);
+    if (!gPacketAvx2)
+    {
+        for (int i = 0; i < kBvhPacketSize; ++i)
+        {
+            BvhHit hit;
+            if (rays.tMax[i] > 0.0f && Intersect(PacketLane(rays, i), hit))
+            {
+                hits.t[i] = hit.t;
+                hits.u[i] = hit.u;
+                hits.v[i] = hit.v;
+                hits.triangle[i] = hit.triangle;
+                hits.instance[i] = hit.instance;
+            }
+        }
+        return;
+    }
+
+    const PacketRays p = SetupPacket(rays);
+    BvhRayPacket local;
+    TraversePacket(nodes, p, hits.t, LiveLanes(rays), [&](uint32_t leaf, int active)
+    {
+        for (int k = 0; k < 4 && leaves[leaf * 4 + k] != kBvhNoHit; ++k)
+        {
+            const uint32_t id = leaves[leaf * 4 + k];
+            const Instance& inst = instances[id];
+            TransformPacket(inst.worldToLocal, rays, local);
+            const PacketRays lp = SetupPacket(local);
+            int hitLanes = 0;
+            TraversePacket(inst.mesh->nodes, lp, hits.t, active, [&](uint32_t meshLeaf, int meshActive)
+            {
+                hitLanes |= IntersectTri4Packet(inst.mesh->leaves[meshLeaf], lp, meshActive,
+                    hits.t, hits.u, hits.v, hits.triangle);
+                return meshActive;
+            });
+            for (int i = 0; i < kBvhPacketSize; ++i)
+                hits.instance[i] = (hitLanes & (1 << i)) ? id : hits.instance[i];
+        }
+        return active;
+    });
+}
+
+int SceneBvh::OccludedPacket(const BvhRayPacket& rays) const
+{
+    int occluded = 0;
+    if (!gPacketAvx2)
+    {
+        for (int i = 0; i < kBvhPacketSize; ++i)
+            occluded |= rays.tMax[i] > 0.0f && Occluded(PacketLane(rays, i)) ? 1 << i : 0;
+        return occluded;
+    }
+
+    const PacketRays p = SetupPacket(rays);
+    BvhPacketHit scratch;
+    ClearHits(rays, scratch);
+    BvhRayPacket local;
+    TraversePacket(nodes, p, scratch.t, LiveLanes(rays), [&](uint32_t leaf, int active)
+    {
+        for (int k = 0; k < 4 && leaves[leaf * 4 + k] != kBvhNoHit && active; ++k)
+        {
+            const Instance& inst = instances[leaves[leaf * 4 + k]];
+            TransformPacket(inst.worldToLocal, rays, local);
+            const PacketRays lp = SetupPacket(local);
+            TraversePacket(inst.mesh->nodes, lp, scratch.t, active, [&](uint32_t meshLeaf, int meshActive)
+            {
+                const int hits = IntersectTri4Packet(inst.mesh->leaves[meshLeaf], lp, meshActive,
+                    scratch.t, scratch.u, scratch.v, scratch.triangle);
+                occluded |= hits;
+                return meshActive & ~hits;
+            });
+            active &= ~occluded;
+        }
+        return active;
+    });
+    return occluded;
+}
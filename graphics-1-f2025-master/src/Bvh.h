@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ------------------------------------------------------------
+// Bounding volume hierarchies for ray queries on the CPU (picking, line
+// of sight). MeshBvh holds one mesh's triangles; SceneBvh is a top-level
+// tree over instances of meshes, each with its own transform.
+//
+// Built with a binned SAH, subtrees in parallel on the job system, then
+// collapsed to 4-wide nodes: one SSE test covers the four children of a
+// node and a leaf holds up to four triangles tested together. Packets of
+// 8 rays go through the same tree with AVX2 when the CPU has it, one ray
+// at a time otherwise.
+//
+// A ray covers origin + t * dir for 0 < t < tMax. dir needs no
+// normalizing, and t keeps the caller's units through instance transforms.
+// ------------------------------------------------------------
+const uint32_t kBvhNoHit = 0xFFFFFFFFu;
+const int kBvhPacketSize = 8;
+
+struct BvhRay
+{
+    float origin[3];
+    float dir[3];
+    float tMax;
+};
+
+struct BvhHit
+{
+    float t = 0.0f;
+    float u = 0.0f, v = 0.0f;           // barycentrics of the triangle's 2nd and 3rd vertex
+    uint32_t triangle = kBvhNoHit;      // in the order the mesh was built from
+    uint32_t instance = kBvhNoHit;      // SceneBvh only
+};
+
+// One component per array, lane i is ray i. Lanes not in use get tMax = 0.
+struct BvhRayPacket
+{
+    float ox[kBvhPacketSize], oy[kBvhPacketSize], oz[kBvhPacketSize];
+    float dx[kBvhPacketSize], dy[kBvhPacketSize], dz[kBvhPacketSize];
+    float tMax[kBvhPacketSize];
+};
+
+struct BvhPacketHit
+{
+    float t[kBvhPacketSize], u[kBvhPacketSize], v[kBvhPacketSize];
+    uint32_t triangle[kBvhPacketSize], instance[kBvhPacketSize];
+};
+
+// Children as bounds[min/max][axis][child]; child[] holds a node index, or
+// kBvhLeafBit | leaf index. Unused slots have an empty (inverted) box.
+const uint32_t kBvhLeafBit = 0x80000000u;
+
+struct alignas(16) BvhNode4
+{
+    float bounds[2][3][4];
+    uint32_t child[4];
+};
+
+// Up to four triangles as v0 and the edges v1 - v0, v2 - v0, one per lane
+struct alignas(16) BvhTri4
+{
+    float v0[3][4];
+    float e1[3][4];
+    float e2[3][4];
+    uint32_t id[4];     // kBvhNoHit in unused lanes
+};
+
+class MeshBvh
+{
+public:
+    // triangleCount triangles: vertex k's position is the first three floats
+    // at positions + k * stride bytes, taken three at a time, or through
+    // indices when given.
+    void Build(const void* positions, size_t stride, const uint32_t* indices, size_t triangleCount);
+
+    bool Intersect(const BvhRay& ray, BvhHit& hit) const;   // closest hit
+    bool Occluded(const BvhRay& ray) const;                 // any hit
+
+    // Per lane like Intersect()/Occluded(); the mask has bit i set for each occluded ray
+    void IntersectPacket(const BvhRayPacket& rays, BvhPacketHit& hits) const;
+    int OccludedPacket(const BvhRayPacket& rays) const;
+
+    // Box around every triangle; min > max when empty
+    void GetBounds(float min[3], float max[3]) const;
+
+    size_t GetTriangleCount() const { return triangleCount; }
+    size_t GetNodeCount() const { return nodes.size(); }
+
+private:
+    friend class SceneBvh;
+
+    std::vector<BvhNode4> nodes;
+    std::vector<BvhTri4> leaves;
+    size_t triangleCount = 0;
+};
+
+struct BvhInstance
+{
+    const MeshBvh* mesh;
+    float model[16];    // column-major, affine
+};
+
+class SceneBvh
+{
+public:
+    // Rebuild whenever an instance moves; the meshes must outlive the tree
+    void Build(const BvhInstance* instances, size_t count);
+
+    bool Intersect(const BvhRay& ray, BvhHit& hit) const;
+    bool Occluded(const BvhRay& ray) const;
+    void IntersectPacket(const BvhRayPacket& rays, BvhPacketHit& hits) const;
+    int OccludedPacket(const BvhRayPacket& rays) const;
+
+    size_t GetInstanceCount() const { return instances.size(); }
+
+private:
+    struct Instance
+    {
+        const MeshBvh* mesh;
+        float worldToLocal[16];
+    };
+
+    std::vector<BvhNode4> nodes;
+    std::vector<uint32_t> leaves;   // four instance indices per leaf, kBvhNoHit padded
+    std::vector<Instance> instances;
+};
+
+// Whether IntersectPacket()/OccludedPacket() trace 8 lanes at once
+bool BvhPacketsUseAvx2();
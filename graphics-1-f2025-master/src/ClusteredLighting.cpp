@@ -0,0 +1,348 @@
+#include "ClusteredLighting.h"
+#include "Shader.h"
+#include "GLState.h"
+#include "GLStats.h"
+#include "JobSystem.h"
+#include "Profile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+
+namespace
+{
+    const int kX = ClusteredLighting::kClustersX;
+    const int kY = ClusteredLighting::kClustersY;
+    const int kZ = ClusteredLighting::kClustersZ;
+    const int kMaxPerCluster = ClusteredLighting::kMaxLightsPerCluster;
+
+    inline int Clamp(int v, int lo, int hi)
+    {
+        return std::min(std::max(v, lo), hi);
+    }
+}
+
+void ClusteredLighting::Create(int maxLights_, int viewportWidth_, int viewportHeight_)
+{
+    maxLights = maxLights_;
+    viewportWidth = viewportWidth_;
+    viewportHeight = viewportHeight_;
+
+    // header + lights, the packed grid and the index lists at their fullest,
+    // plus the alignment between the three ranges
+    const size_t lightBytes = sizeof(ClusterHeader) + maxLights * sizeof(ClusterLight);
+    const size_t gridBytes = kClusterCount * 2 * sizeof(GLuint);
+    const size_t indexBytes = (size_t)kClusterCount * kMaxLightsPerCluster * sizeof(GLuint);
+    ring.Create(GL_SHADER_STORAGE_BUFFER, lightBytes + gridBytes + indexBytes + 3 * 256);
+
+    // the compute path writes its lists here and never reads them back
+    glGenBuffers(1, &gridBuffer);
+    gGLState.BindBuffer(GL_SHADER_STORAGE_BUFFER, gridBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, gridBytes, nullptr, GL_DYNAMIC_COPY);
+    glGenBuffers(1, &indexBuffer);
+    gGLState.BindBuffer(GL_SHADER_STORAGE_BUFFER, indexBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, indexBytes, nullptr, GL_DYNAMIC_COPY);
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        boxMin[axis].assign(kClusterCount, 0.0f);
+        boxMax[axis].assign(kClusterCount, 0.0f);
+    }
+    counts.assign(kClusterCount, 0);
+    slots.assign((size_t)kClusterCount * kMaxLightsPerCluster, 0);
+    sliceOverflow.assign(kClustersZ, 0);
+}
+
+void ClusteredLighting::Destroy()
+{
+    ring.Destroy();
+    GLuint buffers[2] = { gridBuffer, indexBuffer };
+    glDeleteBuffers(2, buffers);
+    gGLState.Invalidate();
+    gridBuffer = indexBuffer = 0;
+}
+
+float ClusteredLighting::LightRange(float constant, float linear, float quadratic, float brightest)
+{
+    // solve constant + linear * d + quadratic * d^2 = 256 * brightest
+    const float target = 256.0f * brightest;
+    if (constant >= target)
+        return 0.0f;
+    if (quadratic > 0.0f)
+        return (-linear + sqrtf(linear * linear - 4.0f * quadratic * (constant - target))) / (2.0f * quadratic);
+    if (linear > 0.0f)
+        return (target - constant) / linear;
+    return 1e6f; // never fades
+}
+
+void ClusteredLighting::BuildClusterBoxes(float zNear, float zFar, float scaleX, float scaleY)
+{
+    boxNear = zNear;
+    boxFar = zFar;
+    boxScaleX = scaleX;
+    boxScaleY = scaleY;
+
+    // tiles are whole pixels, as gl_FragCoord / tile size picks them
+    const int tileW = (viewportWidth + kX - 1) / kX;
+    const int tileH = (viewportHeight + kY - 1) / kY;
+    for (int z = 0; z < kZ; ++z)
+    {
+        const float d0 = zNear * powf(zFar / zNear, (float)z / kZ);
+        const float d1 = zNear * powf(zFar / zNear, (float)(z + 1) / kZ);
+        for (int y = 0; y < kY; ++y)
+        {
+            const float ny0 = 2.0f * (y * tileH) / viewportHeight - 1.0f;
+            const float ny1 = 2.0f * std::min(viewportHeight, (y + 1) * tileH) / viewportHeight - 1.0f;
+            for (int x = 0; x < kX; ++x)
+            {
+                const float nx0 = 2.0f * (x * tileW) / viewportWidth - 1.0f;
+                const float nx1 = 2.0f * std::min(viewportWidth, (x + 1) * tileW) / viewportWidth - 1.0f;
+
+                // the tile's frustum slab is widest at one of the two slice depths
+                const int c = (z * kY + y) * kX + x;
+                boxMin[0][c] = std::min(nx0 * d0, nx0 * d1) / scaleX;
+                boxMax[0][c] = std::max(nx1 * d0, nx1 * d1) / scaleX;
+                boxMin[1][c] = std::min(ny0 * d0, ny0 * d1) / scaleY;
+                boxMax[1][c] = std::max(ny1 * d0, ny1 * d1) / scaleY;
+                boxMin[2][c] = -d1;
+                boxMax[2][c] = -d0;
+            }
+        }
+    }
+}
+
+void ClusteredLighting::BinLights(std::vector<ClusterLight>& lights, const float view[16])
+{
+    const float sliceScale = kZ / logf(boxFar / boxNear);
+    const float sliceBias = logf(boxNear) * sliceScale;
+    const int tileW = (viewportWidth + kX - 1) / kX;
+    const int tileH = (viewportHeight + kY - 1) / kY;
+
+    bins.resize(lights.size());
+    for (size_t i = 0; i < lights.size(); ++i)
+    {
+        ClusterLight& light = lights[i];
+        LightBin& bin = bins[i];
+
+        // culling sphere: the range around a point light, or around a spot's cone
+        float center[3] = { light.position[0], light.position[1], light.position[2] };
+        float radius = light.range;
+        if (light.type == kClusterSpotLight)
+        {
+            const float cosAngle = light.outerCutOff;
+            const float sinAngle = sqrtf(std::max(0.0f, 1.0f - cosAngle * cosAngle));
+            const float along = cosAngle < 0.70710678f ? light.range * cosAngle : light.range / (2.0f * cosAngle);
+            radius = cosAngle < 0.70710678f ? light.range * sinAngle : along;
+            for (int k = 0; k < 3; ++k)
+                center[k] += light.direction[k] * along;
+        }
+
+        float* s = light.viewSphere;
+        for (int r = 0; r < 3; ++r)
+            s[r] = view[r] * center[0] + view[4 + r] * center[1] + view[8 + r] * center[2] + view[12 + r];
+        s[3] = radius;
+
+        const float dMin = -s[2] - radius;
+        const float dMax = -s[2] + radius;
+        if (dMax < boxNear || dMin > boxFar)
+        {
+            s[3] = -1.0f; // nowhere in the frustum; clusters.comp skips it too
+            bin.slice0 = 1;
+            bin.slice1 = 0;
+            continue;
+        }
+        memcpy(bin.sphere, s, sizeof(bin.sphere));
+        bin.slice0 = Clamp((int)floorf(logf(std::max(dMin, boxNear)) * sliceScale - sliceBias), 0, kZ - 1);
+        bin.slice1 = Clamp((int)floorf(logf(std::min(dMax, boxFar)) * sliceScale - sliceBias), 0, kZ - 1);
+
+        // screen rectangle of the sphere's box: its extremes are at the corners
+        bin.tileX0 = bin.tileY0 = 0;
+        bin.tileX1 = kX - 1;
+        bin.tileY1 = kY - 1;
+        if (dMin > boxNear)
+        {
+            float lo[2] = { 1e30f, 1e30f }, hi[2] = { -1e30f, -1e30f };
+            const float scale[2] = { boxScaleX, boxScaleY };
+            for (int axis = 0; axis < 2; ++axis)
+            {
+                for (int k = 0; k < 4; ++k)
+                {
+                    const float v = (s[axis] + ((k & 1) ? radius : -radius)) * scale[axis] / ((k & 2) ? dMax : dMin);
+                    lo[axis] = std::min(lo[axis], v);
+                    hi[axis] = std::max(hi[axis], v);
+                }
+            }
+            bin.tileX0 = Clamp((int)floorf((lo[0] * 0.5f + 0.5f) * viewportWidth / tileW), 0, kX - 1);
+            bin.tileX1 = Clamp((int)floorf((hi[0] * 0.5f + 0.5f) * viewportWidth / tileW), 0, kX - 1);
+            bin.tileY0 = Clamp((int)floorf((lo[1] * 0.5f + 0.5f) * viewportHeight / tileH), 0, kY - 1);
+            bin.tileY1 = Clamp((int)floorf((hi[1] * 0.5f + 0.5f) * viewportHeight / tileH), 0, kY - 1);
+        }
+    }
+}
+
+void ClusteredLighting::AssignSlice(int slice)
+{
+    GLuint* sliceCounts = &counts[slice * kX * kY];
+    std::fill(sliceCounts, sliceCounts + kX * kY, 0u);
+    sliceOverflow[slice] = 0;
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    for (size_t i = 0; i < bins.size(); ++i)
+    {
+        const LightBin& bin = bins[i];
+        if (slice < bin.slice0 || slice > bin.slice1)
+            continue;
+
+        const __m128 cx = _mm_set1_ps(bin.sphere[0]);
+        const __m128 cy = _mm_set1_ps(bin.sphere[1]);
+        const __m128 cz = _mm_set1_ps(bin.sphere[2]);
+        const __m128 r2 = _mm_set1_ps(bin.sphere[3] * bin.sphere[3]);
+        const __m128 first = _mm_set1_ps((float)bin.tileX0);
+        const __m128 last = _mm_set1_ps((float)bin.tileX1);
+
+        for (int y = bin.tileY0; y <= bin.tileY1; ++y)
+        {
+            const int row = (slice * kY + y) * kX;
+            for (int x = bin.tileX0 & ~3; x <= bin.tileX1; x += 4)
+            {
+                // squared distance from the sphere's center to 4 cluster boxes
+                const int c = row + x;
+                __m128 dx = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boxMin[0][c]), cx), _mm_sub_ps(cx, _mm_loadu_ps(&boxMax[0][c])));
+                __m128 dy = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boxMin[1][c]), cy), _mm_sub_ps(cy, _mm_loadu_ps(&boxMax[1][c])));
+                __m128 dz = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boxMin[2][c]), cz), _mm_sub_ps(cz, _mm_loadu_ps(&boxMax[2][c])));
+                dx = _mm_max_ps(dx, zero);
+                dy = _mm_max_ps(dy, zero);
+                dz = _mm_max_ps(dz, zero);
+                const __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+                const __m128 tile = _mm_add_ps(_mm_set1_ps((float)x), lane);
+                const __m128 inRect = _mm_and_ps(_mm_cmpge_ps(tile, first), _mm_cmple_ps(tile, last));
+                const int hits = _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(d2, r2), inRect));
+                if (!hits)
+                    continue;
+                for (int k = 0; k < 4; ++k)
+                {
+                    if (!(hits & (1 << k)))
+                        continue;
+                    GLuint& n = counts[c + k];
+                    if (n < (GLuint)kMaxPerCluster)
+                        slots[(size_t)(c + k) * kMaxPerCluster + n++] = (GLuint)i;
+                    else
+                        sliceOverflow[slice]++;
+                }
+            }
+        }
+    }
+}
+
+void ClusteredLighting::Update(std::vector<ClusterLight>& lights, const float view[16], const float projection[16],
+    Shader* computeShader)
+{
+    double start = ProfileNow();
+    if (lights.size() > (size_t)maxLights)
+        lights.resize(maxLights);
+
+    // near and far back out of the projection matrix MakePerspective builds
+    const float zNear = projection[14] / (projection[10] - 1.0f);
+    const float zFar = projection[14] / (projection[10] + 1.0f);
+    if (zNear != boxNear || zFar != boxFar || projection[0] != boxScaleX || projection[5] != boxScaleY)
+        BuildClusterBoxes(zNear, zFar, projection[0], projection[5]);
+    BinLights(lights, view);
+
+    ClusterHeader header;
+    header.grid[0] = kX;
+    header.grid[1] = kY;
+    header.grid[2] = kZ;
+    header.grid[3] = (GLuint)lights.size();
+    header.depth[0] = zNear;
+    header.depth[1] = zFar;
+    header.depth[2] = kZ / logf(zFar / zNear);
+    header.depth[3] = logf(zNear) * header.depth[2];
+    header.projection[0] = projection[0];
+    header.projection[1] = projection[5];
+    header.projection[2] = (float)((viewportWidth + kX - 1) / kX);
+    header.projection[3] = (float)((viewportHeight + kY - 1) / kY);
+    header.viewport[0] = (float)viewportWidth;
+    header.viewport[1] = (float)viewportHeight;
+    header.viewport[2] = header.viewport[3] = 0.0f;
+
+    ring.BeginFrame();
+    RingBuffer::Allocation lightData = ring.Alloc(sizeof(header) + lights.size() * sizeof(ClusterLight));
+    if (!lightData.ptr)
+    {
+        ring.Commit();
+        return;
+    }
+    memcpy(lightData.ptr, &header, sizeof(header));
+    if (!lights.empty())
+        memcpy((unsigned char*)lightData.ptr + sizeof(header), lights.data(), lights.size() * sizeof(ClusterLight));
+
+    if (computeShader)
+    {
+        ring.Commit();
+        ring.BindRange(kClusterLightBinding, lightData);
+        gGLState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kClusterGridBinding, gridBuffer);
+        gGLState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kClusterIndexBinding, indexBuffer);
+
+        computeShader->Use();
+        glDispatchCompute((kClusterCount + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        gFrameStats.clusterAssignMs += (ProfileNow() - start) * 1e3;
+        gFrameStats.clusterLights += (long long)lights.size();
+        return;
+    }
+
+    // clusters of different slices never share memory: one job per slice
+    ParallelFor(kZ, 1, [this](size_t begin, size_t end)
+    {
+        for (size_t z = begin; z < end; ++z)
+            AssignSlice((int)z);
+    });
+
+    // pack the fixed-size slots into one list
+    GLuint total = 0, most = 0;
+    for (int c = 0; c < kClusterCount; ++c)
+    {
+        total += counts[c];
+        most = std::max(most, counts[c]);
+    }
+    RingBuffer::Allocation gridData = ring.Alloc(kClusterCount * 2 * sizeof(GLuint));
+    RingBuffer::Allocation indexData = ring.Alloc(std::max<GLuint>(total, 1) * sizeof(GLuint));
+    if (!gridData.ptr || !indexData.ptr)
+    {
+        ring.Commit();
+        return;
+    }
+
+    GLuint* grid = (GLuint*)gridData.ptr;
+    GLuint* indices = (GLuint*)indexData.ptr;
+    GLuint offset = 0;
+    for (int c = 0; c < kClusterCount; ++c)
+    {
+        grid[c * 2 + 0] = offset;
+        grid[c * 2 + 1] = counts[c];
+        memcpy(indices + offset, &slots[(size_t)c * kMaxLightsPerCluster], counts[c] * sizeof(GLuint));
+        offset += counts[c];
+    }
+    ring.Commit();
+
+    ring.BindRange(kClusterLightBinding, lightData);
+    ring.BindRange(kClusterGridBinding, gridData);
+    ring.BindRange(kClusterIndexBinding, indexData);
+
+    long long overflow = 0;
+    for (int z = 0; z < kZ; ++z)
+        overflow += sliceOverflow[z];
+    gFrameStats.clusterAssignMs += (ProfileNow() - start) * 1e3;
+    gFrameStats.clusterLights += (long long)lights.size();
+    gFrameStats.clusterRefs += total;
+    gFrameStats.clusterMostRefs += most;
+    gFrameStats.clusterOverflow += overflow;
+}
+
+void ClusteredLighting::EndFrame()
+{
+    ring.EndFrame();
+}
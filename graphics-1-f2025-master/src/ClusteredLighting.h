@@ -0,0 +1,109 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+#include "RingBuffer.h"
+
+class Shader;
+
+// std430 element of the light array in shaders/phong_clustered.frag and
+// shaders/clusters.comp
+struct ClusterLight
+{
+    float position[3];  float range;        // range: see LightRange()
+    float direction[3]; float type;         // kClusterPointLight / kClusterSpotLight
+    float ambient[3];   float cutOff;       // spot cone cosines
+    float diffuse[3];   float outerCutOff;
+    float specular[3];  float pad0;
+    float constant, linear, quadratic, pad1;
+    float viewSphere[4];                    // culling sphere in view space, written by Update()
+};
+
+// std430 header in front of the light array
+struct ClusterHeader
+{
+    GLuint grid[4];     // clusters in x, y, z; light count
+    float depth[4];     // near, far, slice scale, slice bias
+    float projection[4];// x and y scale of the projection, tile size in pixels
+    float viewport[4];  // width, height in pixels
+};
+
+static_assert(offsetof(ClusterLight, constant) == 80, "std430 ClusterLight");
+static_assert(sizeof(ClusterLight) == 112, "std430 ClusterLight");
+static_assert(sizeof(ClusterHeader) == 64, "std430 ClusterHeader");
+
+const float kClusterPointLight = 0.0f;
+const float kClusterSpotLight = 1.0f;
+
+const unsigned int kClusterLightBinding = 5;   // shader storage: header + lights
+const unsigned int kClusterGridBinding = 6;    // shader storage: offset, count per cluster
+const unsigned int kClusterIndexBinding = 7;   // shader storage: light indices
+
+// ------------------------------------------------------------
+// Clustered forward lighting (--lights N). The view frustum is cut into
+// 16x16 screen tiles by 24 slices spaced exponentially in depth, and
+// every frame each cluster gets the list of lights whose range reaches
+// its box. phong_clustered.frag then loops over its own cluster's list
+// only, so the cost per fragment follows the lights nearby, not the
+// number in the scene.
+//
+// The lists are built on the CPU by default: lights are bounded by a
+// sphere, binned to the slices and tiles it touches, then tested against
+// the cluster boxes 4 at a time with SSE, one slice per job. The result
+// is packed and streamed through a ring buffer. With a compute shader
+// (--cluster-compute) clusters.comp builds fixed-size lists on the GPU
+// instead, from the same light array.
+// ------------------------------------------------------------
+class ClusteredLighting
+{
+public:
+    static const int kClustersX = 16;
+    static const int kClustersY = 16;
+    static const int kClustersZ = 24;
+    static const int kClusterCount = kClustersX * kClustersY * kClustersZ;
+    static const int kMaxLightsPerCluster = 64;
+
+    ClusteredLighting() : viewportWidth(0), viewportHeight(0), maxLights(0), gridBuffer(0), indexBuffer(0),
+        boxNear(0.0f), boxFar(0.0f), boxScaleX(0.0f), boxScaleY(0.0f) {}
+
+    void Create(int maxLights, int viewportWidth, int viewportHeight);
+    void Destroy();
+
+    // Assigns this frame's world-space lights to the clusters and binds
+    // everything the fragment shader reads. view and projection as the
+    // render loop builds them; computeShader == nullptr for the CPU path.
+    void Update(std::vector<ClusterLight>& lights, const float view[16], const float projection[16],
+        Shader* computeShader);
+
+    // Call after the frame's last draw that reads the lights.
+    void EndFrame();
+
+    // Distance at which constant + linear * d + quadratic * d^2 has cut the
+    // brightest channel below 1/256: the light can be ignored beyond it.
+    static float LightRange(float constant, float linear, float quadratic, float brightest);
+
+private:
+    // where one light's sphere lands in the grid
+    struct LightBin
+    {
+        float sphere[4];
+        int slice0, slice1, tileX0, tileX1, tileY0, tileY1;
+    };
+
+    int viewportWidth, viewportHeight, maxLights;
+    RingBuffer ring;
+    GLuint gridBuffer, indexBuffer;     // compute path only
+
+    // view-space box of every cluster, SoA, rebuilt when the projection changes
+    float boxNear, boxFar, boxScaleX, boxScaleY;
+    std::vector<float> boxMin[3], boxMax[3];
+
+    std::vector<LightBin> bins;
+    std::vector<GLuint> counts;         // lights per cluster this frame
+    std::vector<GLuint> slots;          // kMaxLightsPerCluster indices per cluster
+    std::vector<int> sliceOverflow;     // lights dropped by full clusters, per slice
+
+    void BuildClusterBoxes(float zNear, float zFar, float scaleX, float scaleY);
+    void BinLights(std::vector<ClusterLight>& lights, const float view[16]);
+    void AssignSlice(int slice);
+};
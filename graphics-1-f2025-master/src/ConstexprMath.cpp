@@ -0,0 +1,74 @@
+#include "ConstexprMath.h"
+
+// ------------------------------------------------------------
+// Compile-time checks of ConstexprMath.h: if any of these fail, the
+// build does
+// ------------------------------------------------------------
+namespace
+{
+    using namespace cx;
+
+    constexpr bool NearVec(const Vec3& a, const Vec3& b, float tolerance)
+    {
+        return Near(a.x, b.x, tolerance) && Near(a.y, b.y, tolerance) && Near(a.z, b.z, tolerance);
+    }
+
+    constexpr bool NearMat(const Mat4& a, const Mat4& b, float tolerance)
+    {
+        for (int i = 0; i < 16; ++i)
+            if (!Near(a.m[i], b.m[i], tolerance))
+                return false;
+        return true;
+    }
+
+    // sqrt and trig against known values
+    static_assert(Sqrt(0.0f) == 0.0f && Sqrt(-1.0f) == 0.0f, "Sqrt of <= 0");
+    static_assert(Sqrt(4.0f) == 2.0f && Sqrt(1e6f) == 1000.0f, "Sqrt of squares is exact");
+    static_assert(Sqrt(2.0f) == 1.41421356f, "Sqrt(2) correctly rounded");
+    static_assert(Sqrt(1e-20f) == 1e-10f && Sqrt(1e30f) == 1e15f, "Sqrt over the float range");
+    static_assert(Sin(0.0f) == 0.0f && Cos(0.0f) == 1.0f, "Sin/Cos at 0");
+    static_assert(Near(Sin((float)(kPi / 6)), 0.5f, 1e-7f), "Sin(30 deg)");
+    static_assert(Near(Cos((float)(kPi / 3)), 0.5f, 1e-7f), "Cos(60 deg)");
+    static_assert(Near(Sin(-2.5f), -0.598472144f, 1e-7f), "Sin of a negative angle");
+    static_assert(Near(Cos(100.0f), 0.862318872f, 1e-6f), "Cos after range reduction");
+    static_assert(Near(Tan((float)(kPi / 4)), 1.0f, 1e-7f), "Tan(45 deg)");
+    static_assert(Near(Tan(DegToRad(30.0f)), 0.577350269f, 1e-7f), "Tan(30 deg)");
+    static_assert(Near(Sin(1.0f) * Sin(1.0f) + Cos(1.0f) * Cos(1.0f), 1.0f, 1e-7f), "sin^2 + cos^2");
+
+    // vectors
+    constexpr Vec3 kX = { 1.0f, 0.0f, 0.0f }, kY = { 0.0f, 1.0f, 0.0f }, kZ = { 0.0f, 0.0f, 1.0f };
+    static_assert(NearVec(Cross(kX, kY), kZ, 0.0f) && NearVec(Cross(kY, kZ), kX, 0.0f), "Cross is right-handed");
+    static_assert(Dot(Vec3{ 1.0f, 2.0f, 3.0f }, Vec3{ 4.0f, -5.0f, 6.0f }) == 12.0f, "Dot");
+    static_assert(NearVec(Normalize(Vec3{ 3.0f, 0.0f, 4.0f }), Vec3{ 0.6f, 0.0f, 0.8f }, 1e-7f), "Normalize");
+    static_assert(NearVec(Normalize(Vec3{ 0.0f, 0.0f, 0.0f }), Vec3{ 0.0f, 0.0f, 0.0f }, 0.0f), "Normalize of zero");
+    static_assert(Near(Length(Normalize(Vec3{ -2.0f, 7.0f, 0.5f })), 1.0f, 1e-6f), "unit length");
+
+    // matrices
+    constexpr Mat4 kProjection = Perspective(DegToRad(60.0f), 1.0f, 0.1f, 100.0f);
+    constexpr Mat4 kView = LookAt(Vec3{ 0.0f, 2.0f, 8.0f }, Vec3{ 0.0f, 2.0f, 7.0f }, kY);
+
+    static_assert(NearMat(Mul(Identity(), kProjection), kProjection, 0.0f), "I * P = P");
+    static_assert(NearMat(Mul(kView, Identity()), kView, 0.0f), "V * I = V");
+    static_assert(Near(kProjection.m[5], 1.73205081f, 1e-6f) && kProjection.m[11] == -1.0f, "60 degree projection");
+
+    // the eye lands on the origin and the view direction on -z
+    static_assert(NearVec(Transform(kView, Vec3{ 0.0f, 2.0f, 8.0f }), Vec3{ 0.0f, 0.0f, 0.0f }, 1e-6f), "eye to origin");
+    static_assert(NearVec(Transform(kView, Vec3{ 0.0f, 2.0f, 3.0f }), Vec3{ 0.0f, 0.0f, -5.0f }, 1e-6f), "forward to -z");
+
+    // points on the near and far planes end up at NDC z = -1 and +1
+    constexpr Mat4 kViewProjection = Mul(kProjection, kView);
+    static_assert(Near(Transform(kViewProjection, Vec3{ 0.0f, 2.0f, 7.9f }).z /
+        TransformW(kViewProjection, Vec3{ 0.0f, 2.0f, 7.9f }), -1.0f, 1e-5f), "near plane");
+    static_assert(Near(Transform(kViewProjection, Vec3{ 0.0f, 2.0f, -92.0f }).z /
+        TransformW(kViewProjection, Vec3{ 0.0f, 2.0f, -92.0f }), 1.0f, 1e-5f), "far plane");
+
+    // the top edge of a 60 degree frustum maps to NDC y = 1
+    static_assert(Near(Transform(kViewProjection, Vec3{ 0.0f, 2.0f + 10.0f * Tan(DegToRad(30.0f)), -2.0f }).y /
+        TransformW(kViewProjection, Vec3{ 0.0f, 2.0f, -2.0f }), 1.0f, 1e-5f), "fov edge");
+
+    // an orthographic box lands on the NDC cube corner to corner
+    constexpr Mat4 kOrtho = Orthographic(-4.0f, 2.0f, -1.0f, 3.0f, 1.0f, 11.0f);
+    static_assert(NearVec(Transform(kOrtho, Vec3{ -4.0f, -1.0f, -1.0f }), Vec3{ -1.0f, -1.0f, -1.0f }, 1e-6f), "ortho near corner");
+    static_assert(NearVec(Transform(kOrtho, Vec3{ 2.0f, 3.0f, -11.0f }), Vec3{ 1.0f, 1.0f, 1.0f }, 1e-6f), "ortho far corner");
+    static_assert(TransformW(kOrtho, Vec3{ 5.0f, 6.0f, 7.0f }) == 1.0f, "ortho keeps w");
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+// ------------------------------------------------------------
+// Scalar math that also runs at compile time (C++14 constexpr), so fixed
+// cameras, lights and test fixtures fold into constants:
+//
+//   constexpr cx::Mat4 kProjection = cx::Perspective(cx::DegToRad(60.0f), 1.0f, 0.1f, 100.0f);
+//
+// Sqrt, Sin, Cos and Tan work in double and round once to float: Sqrt
+// equals sqrtf, the trig can be 1 ulp off sinf/cosf/tanf.
+// They iterate, so they are for values the compiler folds; code that runs
+// per frame calls <cmath> or src/SimdMath.h instead, including for
+// Normalize, Length, Perspective and LookAt, which are built on them.
+//
+// Matrices are column-major float[16], like the rest of the renderer.
+// The static_assert checks live in ConstexprMath.cpp.
+// ------------------------------------------------------------
+namespace cx
+{
+    constexpr double kPi = 3.14159265358979323846;
+
+    constexpr float Abs(float v) { return v < 0.0f ? -v : v; }
+    constexpr double Abs(double v) { return v < 0.0 ? -v : v; }
+
+    constexpr bool Near(float a, float b, float tolerance) { return Abs(a - b) <= tolerance; }
+
+    // Same single-precision formula the renderer always used
+    constexpr float DegToRad(float deg) { return deg * 3.14159265f / 180.0f; }
+
+    // Newton's method from above; 0 for x <= 0
+    constexpr double SqrtD(double x)
+    {
+        if (!(x > 0.0))
+            return 0.0;
+        double r = x > 1.0 ? x : 1.0;
+        for (int i = 0; i < 200; ++i)
+        {
+            const double next = 0.5 * (r + x / r);
+            if (next >= r)
+                break;
+            r = next;
+        }
+        return r;
+    }
+
+    constexpr float Sqrt(float x) { return (float)SqrtD(x); }
+
+    // Taylor series on [-pi/4, pi/4]
+    constexpr double SinSeries(double x)
+    {
+        double term = x, sum = x;
+        for (int n = 1; n < 12; ++n)
+        {
+            term *= -x * x / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double CosSeries(double x)
+    {
+        double term = 1.0, sum = 1.0;
+        for (int n = 1; n < 12; ++n)
+        {
+            term *= -x * x / ((2 * n - 1) * (2 * n));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // x = q * pi/2 + r with |r| <= pi/4; fine for the angles cameras and
+    // lights use (|x| up to a few thousand radians)
+    constexpr double SinD(double x)
+    {
+        const double halfPi = kPi * 0.5;
+        const double k = x / halfPi;
+        const long long q = (long long)(k < 0.0 ? k - 0.5 : k + 0.5);
+        const double r = x - (double)q * halfPi;
+        switch (((q % 4) + 4) % 4)
+        {
+        case 0: return SinSeries(r);
+        case 1: return CosSeries(r);
+        case 2: return -SinSeries(r);
+        default: return -CosSeries(r);
+        }
+    }
+
+    constexpr double CosD(double x) { return SinD(x + kPi * 0.5); }
+
+    constexpr float Sin(float x) { return (float)SinD(x); }
+    constexpr float Cos(float x) { return (float)CosD(x); }
+    constexpr float Tan(float x) { return (float)(SinD(x) / CosD(x)); }
+
+    // ------------------------------------------------------------
+    // Vec3: three packed floats (the OBJ loader's and Vertex's layout)
+    // ------------------------------------------------------------
+    struct Vec3
+    {
+        float x, y, z;
+    };
+
+    constexpr Vec3 operator+(const Vec3& a, const Vec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+    constexpr Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    constexpr Vec3 operator*(const Vec3& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+
+    constexpr float Dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+    constexpr Vec3 Cross(const Vec3& a, const Vec3& b)
+    {
+        return {
+            a.y * b.z - a.z * b.y,
+            a.z * b.x - a.x * b.z,
+            a.x * b.y - a.y * b.x
+        };
+    }
+
+    constexpr float Length(const Vec3& v) { return Sqrt(Dot(v, v)); }
+
+    // Zero vector for zero input
+    constexpr Vec3 Normalize(const Vec3& v)
+    {
+        const float len2 = v.x * v.x + v.y * v.y + v.z * v.z;
+        if (len2 <= 0.0f)
+            return { 0.0f, 0.0f, 0.0f };
+        const float invLen = 1.0f / Sqrt(len2);
+        return { v.x * invLen, v.y * invLen, v.z * invLen };
+    }
+
+    // ------------------------------------------------------------
+    // Mat4
+    // ------------------------------------------------------------
+    struct Mat4
+    {
+        float m[16];
+    };
+
+    constexpr Mat4 Identity()
+    {
+        Mat4 r = {};
+        r.m[0] = r.m[5] = r.m[10] = r.m[15] = 1.0f;
+        return r;
+    }
+
+    // a * b
+    constexpr Mat4 Mul(const Mat4& a, const Mat4& b)
+    {
+        Mat4 r = {};
+        for (int c = 0; c < 4; ++c)
+            for (int row = 0; row < 4; ++row)
+                r.m[c * 4 + row] = a.m[0 * 4 + row] * b.m[c * 4 + 0] + a.m[1 * 4 + row] * b.m[c * 4 + 1] +
+                    a.m[2 * 4 + row] * b.m[c * 4 + 2] + a.m[3 * 4 + row] * b.m[c * 4 + 3];
+        return r;
+    }
+
+    // m * (p, w)
+    constexpr Vec3 Transform(const Mat4& m, const Vec3& p, float w = 1.0f)
+    {
+        return {
+            m.m[0] * p.x + m.m[4] * p.y + m.m[8] * p.z + m.m[12] * w,
+            m.m[1] * p.x + m.m[5] * p.y + m.m[9] * p.z + m.m[13] * w,
+            m.m[2] * p.x + m.m[6] * p.y + m.m[10] * p.z + m.m[14] * w
+        };
+    }
+
+    // clip-space w of m * (p, 1)
+    constexpr float TransformW(const Mat4& m, const Vec3& p)
+    {
+        return m.m[3] * p.x + m.m[7] * p.y + m.m[11] * p.z + m.m[15];
+    }
+
+    // OpenGL clip space, right-handed view looking down -z
+    constexpr Mat4 Perspective(float fovYRadians, float aspect, float zNear, float zFar)
+    {
+        const float f = 1.0f / Tan(fovYRadians * 0.5f);
+        Mat4 r = {};
+        r.m[0] = f / aspect;
+        r.m[5] = f;
+        r.m[10] = (zFar + zNear) / (zNear - zFar);
+        r.m[11] = -1.0f;
+        r.m[14] = (2.0f * zFar * zNear) / (zNear - zFar);
+        return r;
+    }
+
+    // OpenGL clip space for the view-space box [left, right] x [bottom, top]
+    // x [-zFar, -zNear]
+    constexpr Mat4 Orthographic(float left, float right, float bottom, float top, float zNear, float zFar)
+    {
+        Mat4 r = {};
+        r.m[0] = 2.0f / (right - left);
+        r.m[5] = 2.0f / (top - bottom);
+        r.m[10] = -2.0f / (zFar - zNear);
+        r.m[12] = -(right + left) / (right - left);
+        r.m[13] = -(top + bottom) / (top - bottom);
+        r.m[14] = -(zFar + zNear) / (zFar - zNear);
+        r.m[15] = 1.0f;
+        return r;
+    }
+
+    constexpr Mat4 LookAt(const Vec3& eye, const Vec3& center, const Vec3& up)
+    {
+        const Vec3 f = Normalize(center - eye);
+        const Vec3 s = Normalize(Cross(f, up));
+        const Vec3 u = Cross(s, f);
+
+        Mat4 r = {};
+        r.m[0] = s.x; r.m[1] = u.x; r.m[2] = -f.x;
+        r.m[4] = s.y; r.m[5] = u.y; r.m[6] = -f.y;
+        r.m[8] = s.z; r.m[9] = u.z; r.m[10] = -f.z;
+        r.m[12] = -Dot(s, eye);
+        r.m[13] = -Dot(u, eye);
+        r.m[14] = Dot(f, eye);
+        r.m[15] = 1.0f;
+        return r;
+    }
+}
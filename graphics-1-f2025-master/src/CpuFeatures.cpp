@@ -0,0 +1,71 @@
+#include "CpuFeatures.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+#if defined(_MSC_VER)
+    // XCR0 bits: SSE + AVX state, and for AVX-512 also opmask + ZMM
+    const unsigned long long kYmmState = 0x6;
+    const unsigned long long kZmmState = 0xE6;
+
+    bool OsSaves(unsigned long long xcr0Mask)
+    {
+        int info[4];
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        return osxsave && avx && (_xgetbv(0) & xcr0Mask) == xcr0Mask;
+    }
+
+    // a leaf 1 feature (ECX bit)
+    bool HasLeaf1(int ecxBit, unsigned long long xcr0Mask)
+    {
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << ecxBit)) != 0 && OsSaves(xcr0Mask);
+    }
+
+    // a leaf 7 feature (EBX bit)
+    bool HasLeaf7(int ebxBit, unsigned long long xcr0Mask)
+    {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7 || !OsSaves(xcr0Mask))
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << ebxBit)) != 0;
+    }
+#endif
+}
+
+bool CpuHasAvx2()
+{
+#if defined(_MSC_VER)
+    static const bool has = HasLeaf7(5, kYmmState);
+#else
+    static const bool has = __builtin_cpu_supports("avx2");
+#endif
+    return has;
+}
+
+bool CpuHasFma()
+{
+#if defined(_MSC_VER)
+    static const bool has = HasLeaf1(12, kYmmState);
+#else
+    static const bool has = __builtin_cpu_supports("fma");
+#endif
+    return has;
+}
+
+bool CpuHasAvx512()
+{
+#if defined(_MSC_VER)
+    static const bool has = HasLeaf7(16, kZmmState);
+#else
+    static const bool has = __builtin_cpu_supports("avx512f");
+#endif
+    return has;
+}
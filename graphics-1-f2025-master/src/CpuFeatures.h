@@ -0,0 +1,25 @@
+#pragma once
+
+// ------------------------------------------------------------
+// Runtime CPU checks for the SIMD kernels, and the attributes that let one
+// translation unit hold AVX2 / AVX-512 functions next to its SSE2 code.
+// Call a CPU_TARGET_* function only after the matching check passed.
+//
+// MSVC accepts these intrinsics anywhere; GCC/Clang need them enabled per
+// function. CPU_TARGET_AVX2 leaves FMA off, so the compiler cannot fuse a
+// multiply and an add and round differently from the SSE path.
+// ------------------------------------------------------------
+#if defined(_MSC_VER)
+#define CPU_TARGET_AVX2
+#define CPU_TARGET_AVX2_FMA
+#define CPU_TARGET_AVX512
+#else
+#define CPU_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#define CPU_TARGET_AVX2_FMA __attribute__((target("avx2,fma,popcnt")))
+#define CPU_TARGET_AVX512 __attribute__((target("avx512f,popcnt")))
+#endif
+
+// Each also checks that the OS saves the registers involved
+bool CpuHasAvx2();
+bool CpuHasFma();
+bool CpuHasAvx512();    // AVX-512F
@@ -0,0 +1,33 @@
+#pragma once
+#include "UniformSchema.h"
+
+// ------------------------------------------------------------
+// Uniforms of the culling compute programs: shaders/cull.comp and
+// shaders/hiz.comp. Per-frame parameters come from CullBlock
+// (GpuCulling.h); these are only what changes between dispatches.
+// ------------------------------------------------------------
+constexpr UniformDecl kCullUniformDecls[] = {
+    { "uPhase",                 GL_INT,        nullptr, kComputeStage },
+    { "uHiZ",                   GL_SAMPLER_2D, nullptr, kComputeStage },
+};
+
+constexpr UniformDecl kHiZUniformDecls[] = {
+    { "uSource",                GL_SAMPLER_2D, nullptr, kComputeStage },
+    { "uSourceLevel",           GL_INT,        nullptr, kComputeStage },
+};
+
+static_assert(SchemaIsValid(kCullUniformDecls), "duplicate uniform or split struct in kCullUniformDecls");
+static_assert(SchemaIsValid(kHiZUniformDecls), "duplicate uniform or split struct in kHiZUniformDecls");
+
+// Handles, checked against the schemas at compile time
+namespace Cull
+{
+    constexpr UniformInt phase = SchemaHandle<UniformInt>(kCullUniformDecls, "uPhase");
+    constexpr UniformInt hiZ = SchemaHandle<UniformInt>(kCullUniformDecls, "uHiZ");
+}
+
+namespace HiZ
+{
+    constexpr UniformInt source = SchemaHandle<UniformInt>(kHiZUniformDecls, "uSource");
+    constexpr UniformInt sourceLevel = SchemaHandle<UniformInt>(kHiZUniformDecls, "uSourceLevel");
+}
@@ -0,0 +1,266 @@
+#include "Deferred.h"
+#include "ClusteredLighting.h"
+#include "DeferredUniforms.h"
+#include "MeshScene.h"
+#include "Frustum.h"
+#include "GLState.h"
+#include "GLStats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    const char* kFullscreenVertexPath = "shaders/fullscreen.vert";
+    const char* kDirectionalFragPath = "shaders/deferred_dir.frag";
+    const char* kVolumeVertexPath = "shaders/light_volume.vert";
+    const char* kStencilFragPath = "shaders/volume_stencil.frag";
+    const char* kLightFragPath = "shaders/deferred_light.frag";
+
+    const int kVolumeRings = 8;
+    const int kVolumeSegments = 16;
+
+    GLuint CreateTarget(GLenum format, int width, int height)
+    {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        return texture;
+    }
+
+    // Unit cone: apex at the origin, opening along +z to a base of radius 1 at z = 1
+    void BuildCone(int segments, std::vector<MeshVertex>& verts, std::vector<GLuint>& idx)
+    {
+        verts.clear();
+        idx.clear();
+        MeshVertex v = {};
+        verts.push_back(v);             // apex
+        v.position[2] = 1.0f;
+        verts.push_back(v);             // center of the base
+        for (int s = 0; s < segments; ++s)
+        {
+            const float phi = 2.0f * 3.14159265f * s / segments;
+            v.position[0] = cosf(phi);
+            v.position[1] = sinf(phi);
+            verts.push_back(v);
+        }
+        for (int s = 0; s < segments; ++s)
+        {
+            const GLuint a = 2 + s, b = 2 + (s + 1) % segments;
+            const GLuint side[6] = { 0, b, a, 1, a, b };
+            idx.insert(idx.end(), side, side + 6);
+        }
+    }
+}
+
+bool DeferredRenderer::Create(int width_, int height_, int maxLights_, std::string& errorOut)
+{
+    width = width_;
+    height = height_;
+    maxLights = maxLights_;
+
+    albedo = CreateTarget(GL_RGBA8, width, height);
+    normal = CreateTarget(GL_RG16_SNORM, width, height);
+    depth = CreateTarget(GL_DEPTH24_STENCIL8, width, height);
+    lightColor = CreateTarget(GL_RGBA8, width, height);
+
+    glGenFramebuffers(1, &gbufferFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, gbufferFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedo, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normal, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+    const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    // the lighting passes test against the scene's depth while sampling it,
+    // so they get a copy to avoid reading and writing one attachment
+    glGenRenderbuffers(1, &lightDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, lightDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+    glGenFramebuffers(1, &lightFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, lightFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lightColor, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, lightDepth);
+    complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete)
+    {
+        errorOut = "deferred framebuffers are incomplete";
+        return false;
+    }
+
+    glGenVertexArrays(1, &emptyVao);
+
+    // the polygons must enclose the true sphere and cone, so they are
+    // pushed out by the distance their faces sag inwards
+    std::vector<MeshVertex> verts;
+    std::vector<GLuint> idx;
+    const float pi = 3.14159265f;
+    const float sphereScale = 1.0f / (cosf(pi / kVolumeRings) * cosf(pi / kVolumeSegments));
+    BuildSuperellipsoid(kVolumeRings, kVolumeSegments, 1.0f, 1.0f, verts, idx);
+    for (MeshVertex& v : verts)
+        for (int k = 0; k < 3; ++k)
+            v.position[k] *= sphereScale;
+    volumes.AddMesh(verts.data(), verts.size(), idx.data(), idx.size());
+
+    BuildCone(kVolumeSegments, verts, idx);
+    for (MeshVertex& v : verts)
+    {
+        v.position[0] /= cosf(pi / kVolumeSegments);
+        v.position[1] /= cosf(pi / kVolumeSegments);
+    }
+    volumes.AddMesh(verts.data(), verts.size(), idx.data(), idx.size());
+    volumes.Upload(maxLights);
+
+    ring.Create(GL_SHADER_STORAGE_BUFFER, maxLights * sizeof(ClusterLight));
+    visible.reserve(maxLights);
+
+    directionalShader.SetUniformSchema(kDeferredUniformDecls);
+    stencilShader.SetUniformSchema(kDeferredUniformDecls);
+    lightShader.SetUniformSchema(kDeferredUniformDecls);
+    return directionalShader.CreateFromFiles(kFullscreenVertexPath, kDirectionalFragPath, errorOut) &&
+        stencilShader.CreateFromFiles(kVolumeVertexPath, kStencilFragPath, errorOut) &&
+        lightShader.CreateFromFiles(kVolumeVertexPath, kLightFragPath, errorOut);
+}
+
+void DeferredRenderer::Destroy()
+{
+    glDeleteFramebuffers(1, &gbufferFbo);
+    glDeleteFramebuffers(1, &lightFbo);
+    GLuint textures[4] = { albedo, normal, depth, lightColor };
+    glDeleteTextures(4, textures);
+    glDeleteRenderbuffers(1, &lightDepth);
+    glDeleteVertexArrays(1, &emptyVao);
+    volumes.Destroy();
+    ring.Destroy();
+    directionalShader.Destroy();
+    stencilShader.Destroy();
+    lightShader.Destroy();
+    gGLState.Invalidate();
+    gbufferFbo = lightFbo = albedo = normal = depth = lightColor = lightDepth = emptyVao = 0;
+}
+
+void DeferredRenderer::PollHotReload()
+{
+    directionalShader.PollHotReload();
+    stencilShader.PollHotReload();
+    lightShader.PollHotReload();
+}
+
+void DeferredRenderer::BeginGeometry()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, gbufferFbo);
+}
+
+void DeferredRenderer::Light(const std::vector<ClusterLight>& lights, const float view[16], const float projection[16])
+{
+    // lights whose range reaches into the frustum
+    const Frustum frustum = ExtractFrustum(view, projection);
+    const size_t count = std::min(lights.size(), (size_t)maxLights);
+    visible.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const ClusterLight& l = lights[i];
+        if (SphereInFrustum(frustum, l.position[0], l.position[1], l.position[2], l.range))
+            visible.push_back((GLuint)i);
+    }
+    gFrameStats.deferredLights += (long long)count;
+    gFrameStats.deferredVolumes += (long long)visible.size();
+
+    ring.BeginFrame();
+    RingBuffer::Allocation lightData = ring.Alloc(std::max<size_t>(count, 1) * sizeof(ClusterLight));
+    if (lightData.ptr && count)
+        memcpy(lightData.ptr, lights.data(), count * sizeof(ClusterLight));
+    ring.Commit();
+
+    // the scene's depth and stencil under the lighting target
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, gbufferFbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, lightFbo);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, lightFbo);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    gGLState.BindTexture(kDeferredAlbedoUnit, GL_TEXTURE_2D, albedo);
+    gGLState.BindTexture(kDeferredNormalUnit, GL_TEXTURE_2D, normal);
+    gGLState.BindTexture(kDeferredDepthUnit, GL_TEXTURE_2D, depth);
+
+    // directional light and unlit surfaces: one full-screen triangle
+    gGLState.SetEnabled(GL_DEPTH_TEST, false);
+    directionalShader.Use();
+    directionalShader.Set(Deferred::albedoMap, (int)kDeferredAlbedoUnit);
+    directionalShader.Set(Deferred::normalMap, (int)kDeferredNormalUnit);
+    directionalShader.Set(Deferred::depthMap, (int)kDeferredDepthUnit);
+    gGLState.BindVertexArray(emptyVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    if (lightData.ptr && !visible.empty())
+    {
+        lightShader.Set(Deferred::albedoMap, (int)kDeferredAlbedoUnit);
+        lightShader.Set(Deferred::normalMap, (int)kDeferredNormalUnit);
+        lightShader.Set(Deferred::depthMap, (int)kDeferredDepthUnit);
+        ring.BindRange(kDeferredLightBinding, lightData);
+        gGLState.BindVertexArray(volumes.GetVAO());
+
+        // volumes are not clipped by the near or far plane, so the camera
+        // may stand inside one
+        gGLState.SetEnabled(GL_STENCIL_TEST, true);
+        gGLState.SetEnabled(GL_DEPTH_CLAMP, true);
+        gGLState.DepthMask(false);
+        glBlendFunc(GL_ONE, GL_ONE);
+        for (GLuint index : visible)
+            DrawVolume(lights[index], index);
+
+        glStencilFunc(GL_ALWAYS, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        gGLState.DepthMask(true);
+        gGLState.SetEnabled(GL_BLEND, false);
+        gGLState.SetEnabled(GL_DEPTH_CLAMP, false);
+        gGLState.SetEnabled(GL_STENCIL_TEST, false);
+    }
+    gGLState.SetEnabled(GL_DEPTH_TEST, true);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, lightFbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DeferredRenderer::DrawVolume(const ClusterLight& light, GLuint index)
+{
+    const MeshRange& mesh = volumes.GetMesh(light.type == kClusterSpotLight ? kConeVolume : kSphereVolume);
+    const void* first = (const void*)(mesh.firstIndex * sizeof(GLuint));
+
+    // stencil: count the volume's faces behind the surface, minus those in
+    // front of it; non-zero where the surface lies inside the volume
+    stencilShader.Use();
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    gGLState.SetEnabled(GL_DEPTH_TEST, true);
+    gGLState.SetEnabled(GL_BLEND, false);
+    glStencilFunc(GL_ALWAYS, 0, 0xFF);
+    glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+    glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+    glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, first, 1,
+        mesh.baseVertex, index);
+
+    // lighting: the first face over a marked pixel shades it and clears the
+    // mark, so every pixel is lit once and the stencil is clean for the next light
+    lightShader.Use();
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    gGLState.SetEnabled(GL_DEPTH_TEST, false);
+    gGLState.SetEnabled(GL_BLEND, true);
+    glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+    glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, first, 1,
+        mesh.baseVertex, index);
+}
+
+void DeferredRenderer::EndFrame()
+{
+    ring.EndFrame();
+}
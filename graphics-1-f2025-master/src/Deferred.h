@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "MeshBatch.h"
+#include "RingBuffer.h"
+#include "Shader.h"
+
+struct ClusterLight;
+
+const unsigned int kDeferredLightBinding = 8;   // shader storage: ClusterLight[]
+
+// G-buffer textures while the lighting passes read them
+enum DeferredTextureUnit : GLuint
+{
+    kDeferredAlbedoUnit = 2,
+    kDeferredNormalUnit = 3,
+    kDeferredDepthUnit = 4,
+};
+
+// ------------------------------------------------------------
+// --deferred: the scene's programs write a G-buffer (shaders/gbuffer.frag)
+// instead of lighting every fragment, and the lights are applied
+// afterwards, once per pixel they reach:
+//
+//   albedo + lit flag   RGBA8
+//   normal              RG16_SNORM, octahedral
+//   depth + stencil     D24S8; positions are rebuilt from it
+//
+// The directional light is one full-screen pass. Point and spot lights
+// outside the frustum are skipped; the rest draw a sphere or cone around
+// their range in two steps: a stencil pass marks the pixels whose surface
+// lies inside the volume, then the lighting pass shades exactly those
+// (with phong.frag's CalcPoint / CalcSpot) and clears the marks again.
+// Light goes into an offscreen target that is blitted to the window.
+// ------------------------------------------------------------
+class DeferredRenderer
+{
+public:
+    DeferredRenderer() : width(0), height(0), maxLights(0), gbufferFbo(0), lightFbo(0), albedo(0),
+        normal(0), depth(0), lightColor(0), lightDepth(0), emptyVao(0) {}
+
+    // Buffers, targets and the three lighting programs
+    bool Create(int width, int height, int maxLights, std::string& errorOut);
+    void Destroy();
+    void PollHotReload();
+
+    // Before the scene is cleared and drawn: binds the G-buffer
+    void BeginGeometry();
+
+    // After the last scene draw: lights the G-buffer into the window.
+    // lights as SetupClusterLights() fills them.
+    void Light(const std::vector<ClusterLight>& lights, const float view[16], const float projection[16]);
+
+    // Call after the frame's last draw that reads the lights.
+    void EndFrame();
+
+private:
+    enum Volume
+    {
+        kSphereVolume = 0,
+        kConeVolume = 1,
+    };
+
+    int width, height, maxLights;
+    GLuint gbufferFbo, lightFbo;
+    GLuint albedo, normal, depth;       // G-buffer textures
+    GLuint lightColor, lightDepth;      // lighting target; depth + stencil copied from the G-buffer
+    GLuint emptyVao;                    // full-screen triangle, vertices from gl_VertexID
+    MeshBatch volumes;                  // unit sphere and cone, aDrawID = light index
+    RingBuffer ring;
+    Shader directionalShader, stencilShader, lightShader;
+    std::vector<GLuint> visible;        // light indices that survived the frustum test
+
+    void DrawVolume(const ClusterLight& light, GLuint index);
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include "UniformSchema.h"
+
+// ------------------------------------------------------------
+// Uniforms of the deferred lighting programs (src/Deferred.h):
+// shaders/deferred_dir.frag, deferred_light.frag and volume_stencil.frag.
+// Camera and lights come from CameraBlock, LightBlock and the light SSBO.
+// ------------------------------------------------------------
+constexpr UniformDecl kDeferredUniformDecls[] = {
+    { "uAlbedoMap",             GL_SAMPLER_2D, nullptr, kFragmentStage },
+    { "uNormalMap",             GL_SAMPLER_2D, nullptr, kFragmentStage },
+    { "uDepthMap",              GL_SAMPLER_2D, nullptr, kFragmentStage },
+};
+
+static_assert(SchemaIsValid(kDeferredUniformDecls), "duplicate uniform or split struct in kDeferredUniformDecls");
+
+// Handles, checked against the schema at compile time
+namespace Deferred
+{
+    constexpr UniformInt albedoMap = SchemaHandle<UniformInt>(kDeferredUniformDecls, "uAlbedoMap");
+    constexpr UniformInt normalMap = SchemaHandle<UniformInt>(kDeferredUniformDecls, "uNormalMap");
+    constexpr UniformInt depthMap = SchemaHandle<UniformInt>(kDeferredUniformDecls, "uDepthMap");
+}
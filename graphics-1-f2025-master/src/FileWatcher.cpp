@@ -0,0 +1,131 @@
+#include "FileWatcher.h"
+#include "Profile.h"
+#include <map>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+namespace
+{
+    struct WatchedFile
+    {
+        unsigned int version = 1;
+        double changeTime = 0.0;
+        long long mtime = 0;
+    };
+
+    std::map<std::string, WatchedFile> gFiles;
+
+    long long ModificationTime(const std::string& path)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            return 0;
+        return (long long)st.st_mtime;
+    }
+
+    void MarkChanged(WatchedFile& file)
+    {
+        file.version++;
+        file.changeTime = ProfileNow();
+    }
+
+#ifdef __linux__
+    int gInotify = -1;
+    std::map<int, std::string> gWatchDirs; // watch descriptor -> directory
+
+    std::string DirectoryOf(const std::string& path)
+    {
+        size_t slash = path.find_last_of('/');
+        return slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+    }
+#else
+    double gLastPoll = 0.0;
+#endif
+}
+
+void WatchFile(const std::string& path)
+{
+    if (gFiles.count(path))
+        return;
+
+    WatchedFile& file = gFiles[path];
+    file.mtime = ModificationTime(path);
+
+#ifdef __linux__
+    if (gInotify < 0)
+        gInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (gInotify < 0)
+        return;
+
+    std::string dir = DirectoryOf(path);
+    for (const auto& w : gWatchDirs)
+        if (w.second == dir)
+            return;
+
+    int wd = inotify_add_watch(gInotify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd >= 0)
+        gWatchDirs[wd] = dir;
+#endif
+}
+
+void PollFileChanges()
+{
+#ifdef __linux__
+    if (gInotify < 0)
+        return;
+
+    alignas(inotify_event) char buffer[4096];
+    for (;;)
+    {
+        ssize_t len = read(gInotify, buffer, sizeof(buffer));
+        if (len <= 0)
+            break;
+
+        for (char* p = buffer; p < buffer + len;)
+        {
+            const inotify_event* ev = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + ev->len;
+
+            auto dir = gWatchDirs.find(ev->wd);
+            if (dir == gWatchDirs.end() || ev->len == 0)
+                continue;
+
+            auto file = gFiles.find(dir->second + "/" + ev->name);
+            if (file != gFiles.end())
+                MarkChanged(file->second);
+        }
+    }
+#else
+    double now = ProfileNow();
+    if (now - gLastPoll < 0.25)
+        return;
+    gLastPoll = now;
+
+    for (auto& f : gFiles)
+    {
+        long long mtime = ModificationTime(f.first);
+        if (mtime != 0 && mtime != f.second.mtime)
+        {
+            f.second.mtime = mtime;
+            MarkChanged(f.second);
+        }
+    }
+#endif
+}
+
+unsigned int GetFileVersion(const std::string& path)
+{
+    auto it = gFiles.find(path);
+    return it == gFiles.end() ? 0 : it->second.version;
+}
+
+double GetFileChangeTime(const std::string& path)
+{
+    auto it = gFiles.find(path);
+    return it == gFiles.end() ? 0.0 : it->second.changeTime;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+
+// Minimal file change notification for hot reloading.
+// Linux uses inotify on the containing directories (editors often save
+// by writing a new file and renaming it over the old one); other
+// platforms fall back to polling modification times a few times a second.
+
+void WatchFile(const std::string& path);
+
+// Cheap, non-blocking; call once per frame.
+void PollFileChanges();
+
+// Incremented every time the file changes. 0 for files that are not watched.
+unsigned int GetFileVersion(const std::string& path);
+
+// ProfileNow() timestamp of the most recent change to the file.
+double GetFileChangeTime(const std::string& path);
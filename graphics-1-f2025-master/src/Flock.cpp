@@ -0,0 +1,84 @@
+#include "Flock.h"
+#include "Bvh.h"
+#include "JobSystem.h"
+#include "NormalMatrix.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // cheap integer hash -> [0, 1)
+    float Hash01(unsigned int x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352dU;
+        x ^= x >> 15;
+        x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return (x & 0xFFFFFF) / 16777216.0f;
+    }
+
+    void FillRange(BirdInstance* out, size_t begin, size_t end, float time)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const unsigned int id = (unsigned int)i * 4u;
+
+            // each bird circles the origin on its own ring, height and speed
+            float radius = 4.0f + 36.0f * Hash01(id);
+            float height = 1.0f + 11.0f * Hash01(id + 1);
+            float speed = (0.2f + 0.6f * Hash01(id + 2)) * (8.0f / radius);
+            float angle = 6.2831853f * Hash01(id + 3) + time * speed;
+            float bob = 0.3f * sinf(time * 2.0f + angle * 5.0f);
+
+            float c = cosf(angle);
+            float s = sinf(angle);
+            const float scale = kBirdScale;
+
+            // column-major T * RotY(-angle) * S: faces along the circle
+            BirdInstance& b = out[i];
+            b.model[0] = c * scale;  b.model[1] = 0.0f;  b.model[2] = s * scale;   b.model[3] = 0.0f;
+            b.model[4] = 0.0f;       b.model[5] = scale; b.model[6] = 0.0f;        b.model[7] = 0.0f;
+            b.model[8] = -s * scale; b.model[9] = 0.0f;  b.model[10] = c * scale;  b.model[11] = 0.0f;
+            b.model[12] = c * radius;
+            b.model[13] = height + bob;
+            b.model[14] = s * radius;
+            b.model[15] = 1.0f;
+
+            b.tint[0] = 0.6f + 0.4f * Hash01(id + 100);
+            b.tint[1] = 0.6f + 0.4f * Hash01(id + 101);
+            b.tint[2] = 0.6f + 0.4f * Hash01(id + 102);
+            b.tint[3] = 1.0f;
+        }
+
+        // rigid + uniform scale, so the 4-wide batch can skip the inverse
+        const size_t stride = sizeof(BirdInstance) / sizeof(float);
+        ComputeNormalMatrices(out[begin].model, stride, out[begin].normalMatrix, stride, end - begin, true);
+    }
+}
+
+void FillFlockInstances(BirdInstance* out, size_t count, float time)
+{
+    ParallelFor(count, 4096, [=](size_t begin, size_t end)
+    {
+        FillRange(out, begin, end, time);
+    });
+}
+
+void BuildFlockScene(const MeshBvh& bird, int flockCount, float time, SceneBvh& scene)
+{
+    std::vector<BirdInstance> flock(flockCount);
+    FillFlockInstances(flock.data(), flock.size(), time);
+
+    std::vector<BvhInstance> instances(1 + flockCount);
+    instances[0].mesh = &bird;
+    static const float kIdentity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    memcpy(instances[0].model, kIdentity, sizeof(kIdentity));
+    for (int i = 0; i < flockCount; ++i)
+    {
+        instances[1 + i].mesh = &bird;
+        memcpy(instances[1 + i].model, flock[i].model, sizeof(flock[i].model));
+    }
+    scene.Build(instances.data(), instances.size());
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+
+class MeshBvh;
+class SceneBvh;
+
+// ------------------------------------------------------------
+// Flock of instanced birds (--birds N), drawn with one
+// glDrawArraysInstanced. Per-instance data goes to an SSBO:
+//
+//   layout(std430, binding = 0) readonly buffer InstanceBlock { BirdInstance instances[]; };
+// ------------------------------------------------------------
+const unsigned int kFlockInstanceBinding = 0; // shader storage binding
+
+// std430: mat4 + vec4, no padding
+struct BirdInstance
+{
+    float model[16];    // rotation + uniform scale + translation only
+    float normalMatrix[12];
+    float tint[4];
+};
+
+static_assert(sizeof(BirdInstance) == 128, "std430 BirdInstance");
+
+// Every bird is the model at this uniform scale
+const float kBirdScale = 0.15f;
+
+// Writes count instances for the given time, split over the job system.
+void FillFlockInstances(BirdInstance* out, size_t count, float time);
+
+// Ray queries on the flock (src/Bvh.h): bird at the origin as instance 0,
+// then flockCount birds as they are at time, all sharing the bird's tree.
+void BuildFlockScene(const MeshBvh& bird, int flockCount, float time, SceneBvh& scene);
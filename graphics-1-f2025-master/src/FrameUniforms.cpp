@@ -0,0 +1,71 @@
+#include "FrameUniforms.h"
+#include "GLState.h"
+#include <cstring>
+
+namespace
+{
+    GLintptr AlignUp(GLintptr value, GLintptr alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool CheckBlockSize(GLuint program, const char* name, size_t expected, std::string& errorOut)
+    {
+        GLuint index = glGetUniformBlockIndex(program, name);
+        if (index == GL_INVALID_INDEX)
+            return true; // program does not use this block
+
+        GLint size = 0;
+        glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+        if ((size_t)size != expected)
+        {
+            errorOut = std::string(name) + " is " + std::to_string(size) + " bytes in GLSL, " +
+                std::to_string(expected) + " in C++";
+            return false;
+        }
+        return true;
+    }
+}
+
+void FrameUniforms::Create()
+{
+    // the second block has to start on the driver's offset alignment
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    lightOffset = AlignUp(sizeof(CameraBlock), alignment);
+    staging.assign(lightOffset + sizeof(LightBlock), 0);
+
+    glGenBuffers(1, &buffer);
+    gGLState.BindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, staging.size(), nullptr, GL_DYNAMIC_DRAW);
+
+    // indexed bindings are context state: every program sees them
+    gGLState.BindBufferRange(GL_UNIFORM_BUFFER, kCameraBlockBinding, buffer, 0, sizeof(CameraBlock));
+    gGLState.BindBufferRange(GL_UNIFORM_BUFFER, kLightBlockBinding, buffer, lightOffset, sizeof(LightBlock));
+}
+
+void FrameUniforms::Update(const CameraBlock& camera, const LightBlock& lights)
+{
+    memcpy(staging.data(), &camera, sizeof(camera));
+    memcpy(staging.data() + lightOffset, &lights, sizeof(lights));
+
+    gGLState.BindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, staging.size(), staging.data());
+}
+
+void FrameUniforms::Destroy()
+{
+    if (buffer)
+    {
+        glDeleteBuffers(1, &buffer);
+        gGLState.Invalidate();
+        buffer = 0;
+    }
+}
+
+bool FrameUniforms::CheckLayout(GLuint program, std::string& errorOut)
+{
+    return CheckBlockSize(program, "CameraBlock", sizeof(CameraBlock), errorOut) &&
+        CheckBlockSize(program, "LightBlock", sizeof(LightBlock), errorOut) &&
+        CheckBlockSize(program, "ObjectBlock", sizeof(ObjectBlock), errorOut);
+}
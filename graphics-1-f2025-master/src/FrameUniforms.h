@@ -0,0 +1,127 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+// ------------------------------------------------------------
+// Per-frame uniform blocks shared by every program that declares them:
+//
+//   layout(std140, binding = 0) uniform CameraBlock { ... };
+//   layout(std140, binding = 1) uniform LightBlock  { ... };
+//   layout(std140, binding = 2) uniform ObjectBlock { ... };  (per draw, from a RingBuffer)
+//
+// The structs below mirror the std140 layout byte for byte (vec3 takes a
+// 16-byte slot, but a following float may fill its last 4 bytes).
+// ------------------------------------------------------------
+enum UniformBlockBinding : GLuint
+{
+    kCameraBlockBinding = 0,
+    kLightBlockBinding = 1,
+    kObjectBlockBinding = 2,
+};
+
+struct CameraBlock
+{
+    float view[16];
+    float projection[16];
+    float viewPos[3];
+    float pad0;
+};
+
+struct Std140DirectionalLight
+{
+    float direction[3]; float pad0;
+    float ambient[3];   float pad1;
+    float diffuse[3];   float pad2;
+    float specular[3];  float pad3;
+};
+
+struct Std140PointLight
+{
+    float position[3]; float pad0;
+    float ambient[3];  float pad1;
+    float diffuse[3];  float pad2;
+    float specular[3];
+    float constant;
+    float linear;
+    float quadratic;
+    float pad3[2];
+};
+
+struct Std140SpotLight
+{
+    float position[3]; float pad0;
+    float direction[3];
+    float cutOff;
+    float outerCutOff; float pad1[3];
+    float ambient[3];  float pad2;
+    float diffuse[3];  float pad3;
+    float specular[3];
+    float constant;
+    float linear;
+    float quadratic;
+    float pad4[2];
+};
+
+struct LightBlock
+{
+    Std140DirectionalLight dirLight;
+    Std140PointLight pointLight;
+    Std140SpotLight spotLight;
+};
+
+struct ObjectBlock
+{
+    float model[16];
+    float baseColor[3];
+    int useTexture;     // GLSL bool: 4 bytes in std140
+    int useLighting;
+    float pad0[3];
+    float normalMatrix[12]; // mat3: three columns padded to vec4 (src/NormalMatrix.h)
+};
+
+// offsets as the GLSL std140 rules place them
+static_assert(offsetof(CameraBlock, projection) == 64, "std140 CameraBlock");
+static_assert(offsetof(CameraBlock, viewPos) == 128, "std140 CameraBlock");
+static_assert(sizeof(CameraBlock) == 144, "std140 CameraBlock");
+
+static_assert(sizeof(Std140DirectionalLight) == 64, "std140 DirectionalLight");
+static_assert(offsetof(Std140PointLight, constant) == 60, "std140 PointLight");
+static_assert(offsetof(Std140PointLight, quadratic) == 68, "std140 PointLight");
+static_assert(sizeof(Std140PointLight) == 80, "std140 PointLight");
+static_assert(offsetof(Std140SpotLight, cutOff) == 28, "std140 SpotLight");
+static_assert(offsetof(Std140SpotLight, outerCutOff) == 32, "std140 SpotLight");
+static_assert(offsetof(Std140SpotLight, ambient) == 48, "std140 SpotLight");
+static_assert(offsetof(Std140SpotLight, constant) == 92, "std140 SpotLight");
+static_assert(sizeof(Std140SpotLight) == 112, "std140 SpotLight");
+
+static_assert(offsetof(LightBlock, pointLight) == 64, "std140 LightBlock");
+static_assert(offsetof(LightBlock, spotLight) == 144, "std140 LightBlock");
+static_assert(sizeof(LightBlock) == 256, "std140 LightBlock");
+
+static_assert(offsetof(ObjectBlock, useTexture) == 76, "std140 ObjectBlock");
+static_assert(offsetof(ObjectBlock, useLighting) == 80, "std140 ObjectBlock");
+static_assert(offsetof(ObjectBlock, normalMatrix) == 96, "std140 ObjectBlock");
+static_assert(sizeof(ObjectBlock) == 144, "std140 ObjectBlock");
+
+// Both blocks live in one buffer, each bound to its binding point with
+// glBindBufferRange, so a frame's data goes up in a single glBufferSubData.
+class FrameUniforms
+{
+public:
+    FrameUniforms() : buffer(0), lightOffset(0) {}
+
+    void Create();
+    void Update(const CameraBlock& camera, const LightBlock& lights);
+    void Destroy();
+
+    // Checks that program's blocks (if it uses them) have the sizes the
+    // C++ structs assume. Call after linking.
+    static bool CheckLayout(GLuint program, std::string& errorOut);
+
+private:
+    GLuint buffer;
+    GLintptr lightOffset;
+    std::vector<unsigned char> staging;
+};
@@ -0,0 +1,55 @@
+#include "Frustum.h"
+#include "SimdMath.h"
+#include <cmath>
+
+void ViewProjection(const float view[16], const float projection[16], float out[16])
+{
+    (simd::Mat4::Load(projection) * simd::Mat4::Load(view)).Store(out);
+}
+
+Frustum ExtractFrustum(const float view[16], const float projection[16])
+{
+    float m[16];
+    ViewProjection(view, projection, m);
+
+    // Gribb/Hartmann: each plane is row 3 +/- row 0..2 of the clip matrix
+    Frustum f;
+    for (int i = 0; i < 6; ++i)
+    {
+        int row = i / 2;
+        float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+        float* p = f.planes[i];
+        for (int k = 0; k < 4; ++k)
+            p[k] = m[k * 4 + 3] + sign * m[k * 4 + row];
+
+        float len = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        for (int k = 0; k < 4; ++k)
+            p[k] /= len;
+    }
+    return f;
+}
+
+bool SphereInFrustum(const Frustum& f, float x, float y, float z, float radius)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        const float* p = f.planes[i];
+        if (p[0] * x + p[1] * y + p[2] * z + p[3] < -radius)
+            return false;
+    }
+    return true;
+}
+
+bool BoxInFrustum(const Frustum& f, const float min[3], const float max[3])
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        const float* p = f.planes[i];
+        const float x = p[0] >= 0.0f ? max[0] : min[0];
+        const float y = p[1] >= 0.0f ? max[1] : min[1];
+        const float z = p[2] >= 0.0f ? max[2] : min[2];
+        if (p[0] * x + p[1] * y + p[2] * z + p[3] < 0.0f)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// Six planes (a, b, c, d) with normals pointing inward and unit length, so
+// a*x + b*y + c*z + d is the signed distance of a point from the plane.
+// Order: left, right, bottom, top, near, far.
+struct Frustum
+{
+    float planes[6][4];
+};
+
+// out = projection * view, all column-major as the render loop builds them
+// (Camera::GetViewMatrix, MakePerspective).
+void ViewProjection(const float view[16], const float projection[16], float out[16]);
+
+Frustum ExtractFrustum(const float view[16], const float projection[16]);
+
+bool SphereInFrustum(const Frustum& f, float x, float y, float z, float radius);
+
+// Tests the corner farthest along each plane's normal
+bool BoxInFrustum(const Frustum& f, const float min[3], const float max[3]);
@@ -0,0 +1,364 @@
+#include "FrustumCull.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+#include <cstring>
+#include <immintrin.h>
+
+// No FMA in the AVX2 kernels: a fused multiply-add rounds differently, and
+// every path must keep the same objects
+
+namespace
+{
+    // Kernels store whole vectors of indices, up to 16 past the last one kept
+    const size_t kSlack = 16;
+    const size_t kCullChunk = 16384;
+
+    struct SphereStreams
+    {
+        const float* x;
+        const float* y;
+        const float* z;
+        const float* r;
+    };
+
+    // Per plane, the arrays holding the corner farthest along its normal
+    struct BoxCorners
+    {
+        const float* axis[6][3];
+    };
+
+    // ------------------------------------------------------------
+    // Compaction tables, built at compile time: for each movemask, the
+    // lanes whose bit is set, packed to the front
+    // ------------------------------------------------------------
+    struct Lanes4
+    {
+        uint32_t lanes[16][4];
+        uint32_t count[16];
+    };
+
+    constexpr Lanes4 MakeLanes4()
+    {
+        Lanes4 t = {};
+        for (int mask = 0; mask < 16; ++mask)
+            for (int lane = 0; lane < 4; ++lane)
+                if (mask & (1 << lane))
+                    t.lanes[mask][t.count[mask]++] = (uint32_t)lane;
+        return t;
+    }
+
+    struct Lanes8
+    {
+        uint64_t lanes[256];    // one byte per lane
+    };
+
+    constexpr Lanes8 MakeLanes8()
+    {
+        Lanes8 t = {};
+        for (int mask = 0; mask < 256; ++mask)
+        {
+            int n = 0;
+            for (int lane = 0; lane < 8; ++lane)
+                if (mask & (1 << lane))
+                    t.lanes[mask] |= (uint64_t)lane << (8 * n++);
+        }
+        return t;
+    }
+
+    alignas(16) constexpr Lanes4 kLanes4 = MakeLanes4();
+    constexpr Lanes8 kLanes8 = MakeLanes8();
+
+    // ------------------------------------------------------------
+    // Scalar: the tails of the SSE and AVX2 kernels, in the same
+    // operation order as the vector code
+    // ------------------------------------------------------------
+    size_t SpheresScalar(const Frustum& f, SphereStreams s, size_t begin, size_t end, uint32_t* out)
+    {
+        size_t n = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            out[n] = (uint32_t)i;
+            n += SphereInFrustum(f, s.x[i], s.y[i], s.z[i], s.r[i]) ? 1 : 0;
+        }
+        return n;
+    }
+
+    size_t BoxesScalar(const Frustum& f, const BoxCorners& b, size_t begin, size_t end, uint32_t* out)
+    {
+        size_t n = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            bool inside = true;
+            for (int k = 0; k < 6 && inside; ++k)
+            {
+                const float* p = f.planes[k];
+                inside = p[0] * b.axis[k][0][i] + p[1] * b.axis[k][1][i] + p[2] * b.axis[k][2][i] + p[3] >= 0.0f;
+            }
+            out[n] = (uint32_t)i;
+            n += inside ? 1 : 0;
+        }
+        return n;
+    }
+
+    // ------------------------------------------------------------
+    // SSE: 4 objects per step
+    // ------------------------------------------------------------
+    size_t SpheresSSE(const Frustum& f, SphereStreams s, size_t begin, size_t end, uint32_t* out)
+    {
+        __m128 p[6][4];
+        for (int k = 0; k < 6; ++k)
+            for (int c = 0; c < 4; ++c)
+                p[k][c] = _mm_set1_ps(f.planes[k][c]);
+
+        size_t n = 0, i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            const __m128 x = _mm_loadu_ps(s.x + i), y = _mm_loadu_ps(s.y + i), z = _mm_loadu_ps(s.z + i);
+            const __m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(s.r + i));
+            __m128 inside = _mm_cmpeq_ps(x, x);
+            for (int k = 0; k < 6; ++k)
+            {
+                __m128 d = _mm_add_ps(_mm_mul_ps(p[k][0], x), _mm_mul_ps(p[k][1], y));
+                d = _mm_add_ps(_mm_add_ps(d, _mm_mul_ps(p[k][2], z)), p[k][3]);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+            }
+            const int mask = _mm_movemask_ps(inside);
+            const __m128i lanes = _mm_load_si128((const __m128i*)kLanes4.lanes[mask]);
+            _mm_storeu_si128((__m128i*)(out + n), _mm_add_epi32(lanes, _mm_set1_epi32((int)i)));
+            n += kLanes4.count[mask];
+        }
+        return n + SpheresScalar(f, s, i, end, out + n);
+    }
+
+    size_t BoxesSSE(const Frustum& f, const BoxCorners& b, size_t begin, size_t end, uint32_t* out)
+    {
+        __m128 p[6][4];
+        for (int k = 0; k < 6; ++k)
+            for (int c = 0; c < 4; ++c)
+                p[k][c] = _mm_set1_ps(f.planes[k][c]);
+
+        const __m128 zero = _mm_setzero_ps();
+        size_t n = 0, i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+            for (int k = 0; k < 6; ++k)
+            {
+                const float* const* a = b.axis[k];
+                __m128 d = _mm_add_ps(_mm_mul_ps(p[k][0], _mm_loadu_ps(a[0] + i)), _mm_mul_ps(p[k][1], _mm_loadu_ps(a[1] + i)));
+                d = _mm_add_ps(_mm_add_ps(d, _mm_mul_ps(p[k][2], _mm_loadu_ps(a[2] + i))), p[k][3]);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(d, zero));
+            }
+            const int mask = _mm_movemask_ps(inside);
+            const __m128i lanes = _mm_load_si128((const __m128i*)kLanes4.lanes[mask]);
+            _mm_storeu_si128((__m128i*)(out + n), _mm_add_epi32(lanes, _mm_set1_epi32((int)i)));
+            n += kLanes4.count[mask];
+        }
+        return n + BoxesScalar(f, b, i, end, out + n);
+    }
+
+    // ------------------------------------------------------------
+    // AVX2: 8 objects per step
+    // ------------------------------------------------------------
+    CPU_TARGET_AVX2 inline size_t Compact8(int mask, size_t base, uint32_t* out)
+    {
+        const __m256i lanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&kLanes8.lanes[mask]));
+        _mm256_storeu_si256((__m256i*)out, _mm256_add_epi32(lanes, _mm256_set1_epi32((int)base)));
+        return (size_t)_mm_popcnt_u32((unsigned)mask);
+    }
+
+    CPU_TARGET_AVX2 size_t SpheresAVX2(const Frustum& f, SphereStreams s, size_t begin, size_t end, uint32_t* out)
+    {
+        __m256 p[6][4];
+        for (int k = 0; k < 6; ++k)
+            for (int c = 0; c < 4; ++c)
+                p[k][c] = _mm256_set1_ps(f.planes[k][c]);
+
+        size_t n = 0, i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            const __m256 x = _mm256_loadu_ps(s.x + i), y = _mm256_loadu_ps(s.y + i), z = _mm256_loadu_ps(s.z + i);
+            const __m256 negR = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(s.r + i));
+            __m256 inside = _mm256_cmp_ps(x, x, _CMP_EQ_OQ);
+            for (int k = 0; k < 6; ++k)
+            {
+                __m256 d = _mm256_add_ps(_mm256_mul_ps(p[k][0], x), _mm256_mul_ps(p[k][1], y));
+                d = _mm256_add_ps(_mm256_add_ps(d, _mm256_mul_ps(p[k][2], z)), p[k][3]);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+            }
+            n += Compact8(_mm256_movemask_ps(inside), i, out + n);
+        }
+        return n + SpheresScalar(f, s, i, end, out + n);
+    }
+
+    CPU_TARGET_AVX2 size_t BoxesAVX2(const Frustum& f, const BoxCorners& b, size_t begin, size_t end, uint32_t* out)
+    {
+        __m256 p[6][4];
+        for (int k = 0; k < 6; ++k)
+            for (int c = 0; c < 4; ++c)
+                p[k][c] = _mm256_set1_ps(f.planes[k][c]);
+
+        const __m256 zero = _mm256_setzero_ps();
+        size_t n = 0, i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+            for (int k = 0; k < 6; ++k)
+            {
+                const float* const* a = b.axis[k];
+                __m256 d = _mm256_add_ps(_mm256_mul_ps(p[k][0], _mm256_loadu_ps(a[0] + i)),
+                    _mm256_mul_ps(p[k][1], _mm256_loadu_ps(a[1] + i)));
+                d = _mm256_add_ps(_mm256_add_ps(d, _mm256_mul_ps(p[k][2], _mm256_loadu_ps(a[2] + i))), p[k][3]);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, zero, _CMP_GE_OQ));
+            }
+            n += Compact8(_mm256_movemask_ps(inside), i, out + n);
+        }
+        return n + BoxesScalar(f, b, i, end, out + n);
+    }
+
+    // ------------------------------------------------------------
+    // AVX-512: 16 objects per step, the tail under a mask, compress-stored
+    // ------------------------------------------------------------
+    CPU_TARGET_AVX512 size_t SpheresAVX512(const Frustum& f, SphereStreams s, size_t begin, size_t end, uint32_t* out)
+    {
+        __m512 p[6][4];
+        for (int k = 0; k < 6; ++k)
+            for (int c = 0; c < 4; ++c)
+                p[k][c] = _mm512_set1_ps(f.planes[k][c]);
+
+        const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        size_t n = 0;
+        for (size_t i = begin; i < end; i += 16)
+        {
+            const __mmask16 live = end - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (end - i)) - 1);
+            const __m512 x = _mm512_maskz_loadu_ps(live, s.x + i), y = _mm512_maskz_loadu_ps(live, s.y + i);
+            const __m512 z = _mm512_maskz_loadu_ps(live, s.z + i);
+            const __m512 negR = _mm512_sub_ps(_mm512_setzero_ps(), _mm512_maskz_loadu_ps(live, s.r + i));
+            __mmask16 inside = live;
+            for (int k = 0; k < 6; ++k)
+            {
+                __m512 d = _mm512_add_ps(_mm512_mul_ps(p[k][0], x), _mm512_mul_ps(p[k][1], y));
+                d = _mm512_add_ps(_mm512_add_ps(d, _mm512_mul_ps(p[k][2], z)), p[k][3]);
+                inside = _mm512_mask_cmp_ps_mask(inside, d, negR, _CMP_GE_OQ);
+            }
+            _mm512_mask_compressstoreu_epi32(out + n, inside, _mm512_add_epi32(lanes, _mm512_set1_epi32((int)i)));
+            n += (size_t)_mm_popcnt_u32(inside);
+        }
+        return n;
+    }
+
+    CPU_TARGET_AVX512 size_t BoxesAVX512(const Frustum& f, const BoxCorners& b, size_t begin, size_t end, uint32_t* out)
+    {
+        __m512 p[6][4];
+        for (int k = 0; k < 6; ++k)
+            for (int c = 0; c < 4; ++c)
+                p[k][c] = _mm512_set1_ps(f.planes[k][c]);
+
+        const __m512 zero = _mm512_setzero_ps();
+        const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        size_t n = 0;
+        for (size_t i = begin; i < end; i += 16)
+        {
+            const __mmask16 live = end - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (end - i)) - 1);
+            __mmask16 inside = live;
+            for (int k = 0; k < 6; ++k)
+            {
+                const float* const* a = b.axis[k];
+                __m512 d = _mm512_add_ps(_mm512_mul_ps(p[k][0], _mm512_maskz_loadu_ps(live, a[0] + i)),
+                    _mm512_mul_ps(p[k][1], _mm512_maskz_loadu_ps(live, a[1] + i)));
+                d = _mm512_add_ps(_mm512_add_ps(d, _mm512_mul_ps(p[k][2], _mm512_maskz_loadu_ps(live, a[2] + i))), p[k][3]);
+                inside = _mm512_mask_cmp_ps_mask(inside, d, zero, _CMP_GE_OQ);
+            }
+            _mm512_mask_compressstoreu_epi32(out + n, inside, _mm512_add_epi32(lanes, _mm512_set1_epi32((int)i)));
+            n += (size_t)_mm_popcnt_u32(inside);
+        }
+        return n;
+    }
+
+    // ------------------------------------------------------------
+    // Runs kernel(begin, end, out) -> kept over [0, count). Large counts go
+    // to the job system in chunks, each into its own part of a scratch
+    // buffer, and are then copied down to their final offsets.
+    // ------------------------------------------------------------
+    template <typename Kernel>
+    size_t CullRange(size_t count, std::vector<uint32_t>& visible, const Kernel& kernel)
+    {
+        if (count < kParallelCullMin || GetJobWorkerCount() == 0)
+        {
+            visible.resize(count + kSlack);
+            visible.resize(kernel(0, count, visible.data()));
+            return visible.size();
+        }
+
+        const size_t chunks = (count + kCullChunk - 1) / kCullChunk;
+        thread_local std::vector<uint32_t> scratch;
+        thread_local std::vector<size_t> kept;
+        scratch.resize(chunks * (kCullChunk + kSlack));
+        kept.resize(chunks + 1);
+
+        uint32_t* scratchData = scratch.data();
+        size_t* keptData = kept.data();
+        ParallelFor(count, kCullChunk, [&](size_t begin, size_t end)
+        {
+            const size_t c = begin / kCullChunk;
+            keptData[c + 1] = kernel(begin, end, scratchData + c * (kCullChunk + kSlack));
+        });
+
+        // kept[c] becomes chunk c's offset in the result
+        keptData[0] = 0;
+        for (size_t c = 0; c < chunks; ++c)
+            keptData[c + 1] += keptData[c];
+
+        visible.resize(keptData[chunks]);
+        uint32_t* visibleData = visible.data();
+        ParallelFor(chunks, 4, [&](size_t begin, size_t end)
+        {
+            for (size_t c = begin; c < end; ++c)
+            {
+                memcpy(visibleData + keptData[c], scratchData + c * (kCullChunk + kSlack),
+                    (keptData[c + 1] - keptData[c]) * sizeof(uint32_t));
+            }
+        });
+        return visible.size();
+    }
+}
+
+size_t CullSpheres(const Frustum& f, const SpheresSoA& spheres, std::vector<uint32_t>& visible)
+{
+    const SphereStreams s = { spheres.center.x.data(), spheres.center.y.data(), spheres.center.z.data(),
+        spheres.radius.data() };
+    const BatchSimdPath path = GetBatchSimdPath();
+    return CullRange(spheres.Size(), visible, [&](size_t begin, size_t end, uint32_t* out)
+    {
+        switch (path)
+        {
+        case kBatchAVX512: return SpheresAVX512(f, s, begin, end, out);
+        case kBatchAVX2: return SpheresAVX2(f, s, begin, end, out);
+        default: return SpheresSSE(f, s, begin, end, out);
+        }
+    });
+}
+
+size_t CullBoxes(const Frustum& f, const BoxesSoA& boxes, std::vector<uint32_t>& visible)
+{
+    BoxCorners b;
+    for (int k = 0; k < 6; ++k)
+    {
+        const PointsSoA& x = f.planes[k][0] >= 0.0f ? boxes.max : boxes.min;
+        const PointsSoA& y = f.planes[k][1] >= 0.0f ? boxes.max : boxes.min;
+        const PointsSoA& z = f.planes[k][2] >= 0.0f ? boxes.max : boxes.min;
+        b.axis[k][0] = x.x.data();
+        b.axis[k][1] = y.y.data();
+        b.axis[k][2] = z.z.data();
+    }
+    const BatchSimdPath path = GetBatchSimdPath();
+    return CullRange(boxes.Size(), visible, [&](size_t begin, size_t end, uint32_t* out)
+    {
+        switch (path)
+        {
+        case kBatchAVX512: return BoxesAVX512(f, b, begin, end, out);
+        case kBatchAVX2: return BoxesAVX2(f, b, begin, end, out);
+        default: return BoxesSSE(f, b, begin, end, out);
+        }
+    });
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "BatchTransform.h"
+#include "Frustum.h"
+#include <cstdint>
+#include <vector>
+
+// ------------------------------------------------------------
+// Frustum culling of many bounds at once. The bounds are the SoA stores
+// of src/BatchTransform.h, so one register holds the same component of 4
+// (SSE), 8 (AVX2) or 16 (AVX-512) objects; the path follows
+// SetBatchSimdPath().
+//
+// The result is compacted: the indices of the objects at least partly
+// inside, in ascending order. Above kParallelCullMin objects the work is
+// split over the job system. Every path keeps exactly the objects the
+// scalar SphereInFrustum/BoxInFrustum keep.
+// ------------------------------------------------------------
+const size_t kParallelCullMin = 1 << 16;
+
+size_t CullSpheres(const Frustum& f, const SpheresSoA& spheres, std::vector<uint32_t>& visible);
+size_t CullBoxes(const Frustum& f, const BoxesSoA& boxes, std::vector<uint32_t>& visible);
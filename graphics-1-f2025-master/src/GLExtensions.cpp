@@ -0,0 +1,41 @@
+#include "GLExtensions.h"
+#include <cstring>
+
+GLExtensions gGLExt;
+
+bool HasGLExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && strcmp(ext, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+void LoadGLExtensions(GLADloadproc load)
+{
+    if (HasGLExtension("GL_KHR_parallel_shader_compile"))
+        gGLExt.MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+    else if (HasGLExtension("GL_ARB_parallel_shader_compile"))
+        gGLExt.MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+
+    gGLExt.parallelShaderCompile = gGLExt.MaxShaderCompilerThreads != nullptr;
+
+    // core in 4.4 (glad loaded it already), otherwise same entry point via the ARB extension
+    gGLExt.BufferStorage = glad_glBufferStorage;
+    if (!gGLExt.BufferStorage && HasGLExtension("GL_ARB_buffer_storage"))
+        gGLExt.BufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+    gGLExt.bufferStorage = gGLExt.BufferStorage != nullptr;
+
+    gGLExt.MultiDrawElementsIndirectCount = glad_glMultiDrawElementsIndirectCount;
+    if (!gGLExt.MultiDrawElementsIndirectCount && HasGLExtension("GL_ARB_indirect_parameters"))
+        gGLExt.MultiDrawElementsIndirectCount = (PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC)load("glMultiDrawElementsIndirectCountARB");
+    gGLExt.indirectParameters = gGLExt.MultiDrawElementsIndirectCount != nullptr;
+
+    // only new query targets, no entry points
+    gGLExt.pipelineStatistics = GLAD_GL_VERSION_4_6 || HasGLExtension("GL_ARB_pipeline_statistics_query");
+}
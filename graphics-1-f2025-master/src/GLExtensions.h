@@ -0,0 +1,35 @@
+#pragma once
+#include <glad/glad.h>
+
+// glad was generated without extensions, so the few optional ones we use
+// are declared and loaded here.
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR           0x91B1
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+struct GLExtensions
+{
+    bool parallelShaderCompile = false;
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreads = nullptr;
+
+    // GL 4.4 / GL_ARB_buffer_storage: immutable, persistently mappable buffers
+    bool bufferStorage = false;
+    PFNGLBUFFERSTORAGEPROC BufferStorage = nullptr;
+
+    // GL 4.6 / GL_ARB_indirect_parameters: draw count read from a GPU buffer
+    bool indirectParameters = false;
+    PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC MultiDrawElementsIndirectCount = nullptr;
+
+    // GL 4.6 / GL_ARB_pipeline_statistics_query: GL_FRAGMENT_SHADER_INVOCATIONS and friends
+    bool pipelineStatistics = false;
+};
+
+extern GLExtensions gGLExt;
+
+// Call once after the context is current and glad is loaded.
+void LoadGLExtensions(GLADloadproc load);
+
+bool HasGLExtension(const char* name);
@@ -0,0 +1,200 @@
+#include "GLState.h"
+#include "GLStats.h"
+
+GLState gGLState;
+
+namespace
+{
+    int BufferTargetIndex(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER:              return 0;
+        case GL_ELEMENT_ARRAY_BUFFER:      return 1;
+        case GL_UNIFORM_BUFFER:            return 2;
+        case GL_SHADER_STORAGE_BUFFER:     return 3;
+        case GL_DRAW_INDIRECT_BUFFER:      return 4;
+        case GL_DISPATCH_INDIRECT_BUFFER:  return 5;
+        case GL_COPY_READ_BUFFER:          return 6;
+        case GL_COPY_WRITE_BUFFER:         return 7;
+        }
+        return -1; // not tracked: always forwarded
+    }
+
+    int TextureTargetIndex(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_TEXTURE_2D:        return 0;
+        case GL_TEXTURE_CUBE_MAP:  return 1;
+        case GL_TEXTURE_2D_ARRAY:  return 2;
+        case GL_TEXTURE_3D:        return 3;
+        }
+        return -1;
+    }
+
+    int CapIndex(GLenum cap)
+    {
+        switch (cap)
+        {
+        case GL_DEPTH_TEST:                return 0;
+        case GL_CULL_FACE:                 return 1;
+        case GL_BLEND:                     return 2;
+        case GL_STENCIL_TEST:              return 3;
+        case GL_SCISSOR_TEST:              return 4;
+        case GL_POLYGON_OFFSET_FILL:       return 5;
+        case GL_DEPTH_CLAMP:               return 6;
+        }
+        return -1;
+    }
+}
+
+void GLState::Invalidate()
+{
+    program = kUnknown;
+    vao = kUnknown;
+    for (GLuint& b : buffers)
+        b = kUnknown;
+    for (int i = 0; i < kIndexedBindings; ++i)
+    {
+        uniformBindings[i] = { kUnknown, 0, 0 };
+        storageBindings[i] = { kUnknown, 0, 0 };
+    }
+    activeUnit = kUnknown;
+    for (auto& unit : textures)
+        for (GLuint& t : unit)
+            t = kUnknown;
+    for (int& c : caps)
+        c = -1;
+    clearColorKnown = false;
+    depthMask = -1;
+}
+
+bool GLState::Filter(bool redundant)
+{
+    if (redundant)
+        gFrameStats.stateFiltered++;
+    else
+        gFrameStats.stateIssued++;
+    return redundant;
+}
+
+GLState::IndexedBinding* GLState::Indexed(GLenum target, GLuint index)
+{
+    if (index >= (GLuint)kIndexedBindings)
+        return nullptr;
+    if (target == GL_UNIFORM_BUFFER)
+        return &uniformBindings[index];
+    if (target == GL_SHADER_STORAGE_BUFFER)
+        return &storageBindings[index];
+    return nullptr;
+}
+
+void GLState::UseProgram(GLuint p)
+{
+    if (Filter(program == p))
+        return;
+    program = p;
+    glUseProgram(p);
+}
+
+void GLState::BindVertexArray(GLuint v)
+{
+    if (Filter(vao == v))
+        return;
+    vao = v;
+    glBindVertexArray(v);
+
+    // the element buffer binding belongs to the VAO
+    buffers[BufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = kUnknown;
+}
+
+void GLState::BindBuffer(GLenum target, GLuint buffer)
+{
+    int t = BufferTargetIndex(target);
+    if (Filter(t >= 0 && buffers[t] == buffer))
+        return;
+    if (t >= 0)
+        buffers[t] = buffer;
+    glBindBuffer(target, buffer);
+}
+
+void GLState::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    IndexedBinding* b = Indexed(target, index);
+    if (Filter(b && b->buffer == buffer && b->offset == offset && b->size == size))
+        return;
+    if (b)
+        *b = { buffer, offset, size };
+    glBindBufferRange(target, index, buffer, offset, size);
+
+    // also replaces the generic binding of target
+    int t = BufferTargetIndex(target);
+    if (t >= 0)
+        buffers[t] = buffer;
+}
+
+void GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    IndexedBinding* b = Indexed(target, index);
+    if (Filter(b && b->buffer == buffer && b->size == -1))
+        return;
+    if (b)
+        *b = { buffer, 0, -1 };
+    glBindBufferBase(target, index, buffer);
+
+    int t = BufferTargetIndex(target);
+    if (t >= 0)
+        buffers[t] = buffer;
+}
+
+void GLState::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    int t = TextureTargetIndex(target);
+    bool tracked = t >= 0 && unit < (GLuint)kTextureUnits;
+    if (Filter(tracked && textures[unit][t] == texture))
+        return;
+
+    if (activeUnit != unit)
+    {
+        activeUnit = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    if (tracked)
+        textures[unit][t] = texture;
+    glBindTexture(target, texture);
+}
+
+void GLState::SetEnabled(GLenum cap, bool enabled)
+{
+    int c = CapIndex(cap);
+    if (Filter(c >= 0 && caps[c] == (enabled ? 1 : 0)))
+        return;
+    if (c >= 0)
+        caps[c] = enabled ? 1 : 0;
+    if (enabled)
+        glEnable(cap);
+    else
+        glDisable(cap);
+}
+
+void GLState::ClearColor(float r, float g, float b, float a)
+{
+    if (Filter(clearColorKnown && clearColor[0] == r && clearColor[1] == g &&
+        clearColor[2] == b && clearColor[3] == a))
+        return;
+    clearColor[0] = r;
+    clearColor[1] = g;
+    clearColor[2] = b;
+    clearColor[3] = a;
+    clearColorKnown = true;
+    glClearColor(r, g, b, a);
+}
+
+void GLState::DepthMask(bool write)
+{
+    if (Filter(depthMask == (write ? 1 : 0)))
+        return;
+    depthMask = write ? 1 : 0;
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <glad/glad.h>
+
+// ------------------------------------------------------------
+// Shadow copy of the GL binding state the renderer touches. Each call is
+// forwarded to GL only if it changes something; both outcomes are counted
+// in gFrameStats (stateIssued / stateFiltered). Uniform values are
+// filtered the same way inside Shader::Set().
+//
+// Code that binds through GL directly (load-time setup) has to leave the
+// bindings as it found them, or call Invalidate() afterwards. Deleting a
+// bound object also needs Invalidate(), since GL may hand its name out again.
+// ------------------------------------------------------------
+class GLState
+{
+public:
+    GLState() { Invalidate(); }
+
+    // forget everything: the next call of each kind always reaches GL
+    void Invalidate();
+
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vao);
+    void BindBuffer(GLenum target, GLuint buffer);
+    void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void BindTexture(GLuint unit, GLenum target, GLuint texture); // sets the active unit as needed
+    void SetEnabled(GLenum cap, bool enabled);
+    void ClearColor(float r, float g, float b, float a);
+    void DepthMask(bool write);
+
+private:
+    static const int kBufferTargets = 8;
+    static const int kIndexedBindings = 16;
+    static const int kTextureUnits = 16;
+    static const int kTextureTargets = 4;
+    static const int kCaps = 7;
+
+    struct IndexedBinding
+    {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;    // -1 for BindBufferBase (whole buffer)
+    };
+
+    static const GLuint kUnknown = 0xFFFFFFFFu;
+
+    GLuint program;
+    GLuint vao;
+    GLuint buffers[kBufferTargets];
+    IndexedBinding uniformBindings[kIndexedBindings];
+    IndexedBinding storageBindings[kIndexedBindings];
+    GLuint activeUnit;
+    GLuint textures[kTextureUnits][kTextureTargets];
+    int caps[kCaps];    // -1 unknown, 0 / 1
+    float clearColor[4];
+    bool clearColorKnown;
+    int depthMask;      // -1 unknown, 0 / 1
+
+    bool Filter(bool redundant);
+    IndexedBinding* Indexed(GLenum target, GLuint index);
+};
+
+extern GLState gGLState;
@@ -0,0 +1,343 @@
+#include "GLStats.h"
+#include "ClusteredLighting.h"
+#include "GLExtensions.h"
+#include "Profile.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+FrameStats gFrameStats;
+
+namespace
+{
+    struct CallCounter
+    {
+        const char* name = nullptr;
+        long long count = 0;
+    };
+
+    std::vector<CallCounter*> gCounters;
+
+    // Hook<decltype(pointer), Tag>::Install(&pointer, name) swaps a glad or
+    // gGLExt function pointer for a wrapper that bumps a counter and forwards
+    // to the real entry point. Tag is a type unique to each pointer.
+    template <typename Fn, typename Tag>
+    struct Hook;
+
+    template <typename R, typename... A, typename Tag>
+    struct Hook<R (APIENTRY*)(A...), Tag>
+    {
+        struct State
+        {
+            R (APIENTRY* original)(A...) = nullptr;
+            CallCounter counter;
+        };
+
+        static State& Get()
+        {
+            static State state;
+            return state;
+        }
+
+        static R APIENTRY Call(A... args)
+        {
+            State& s = Get();
+            s.counter.count++;
+            gFrameStats.glCalls++;
+            return s.original(args...);
+        }
+
+        static void Install(R (APIENTRY** var)(A...), const char* name)
+        {
+            State& s = Get();
+            if (!*var || s.original)
+                return; // not available in this context, or already hooked
+            s.original = *var;
+            s.counter.name = name;
+            *var = &Call;
+            gCounters.push_back(&s.counter);
+        }
+    };
+
+    bool gInstalled = false;
+    int gFrames = 0;
+    double gWindowStart = 0.0;
+    FrameStats gTotals;
+
+    // One row per FrameStats field. Every field is summed over the print
+    // window; rows with a format are printed as averages, grouped by
+    // name, and a group only when one of its fields is nonzero.
+    struct StatRow
+    {
+        const char* group;
+        const char* label;
+        double FrameStats::* field;
+        const char* format;                 // nullptr: only a divisor for other rows
+        double FrameStats::* per = nullptr; // averaged over this field's total; nullptr: over frames
+        double scale = 1.0;                 // average multiplied by this
+    };
+
+    const StatRow kStatRows[] = {
+        { "frame", "CPU ms", &FrameStats::cpuMs, "%.3f" },
+        { "uniforms", "set", &FrameStats::uniformUploads, "%.1f" },
+        { "uniforms", "unchanged", &FrameStats::uniformsSkipped, "%.1f" },
+        { "state calls", "issued", &FrameStats::stateIssued, "%.1f" },
+        { "state calls", "filtered", &FrameStats::stateFiltered, "%.1f" },
+        { "fence", "wait ms", &FrameStats::fenceWaitMs, "%.3f" },
+        { "fence", "stalls", &FrameStats::fenceWaits, "%.2f" },
+        { "scene submit", "ms", &FrameStats::submitMs, "%.3f" },
+        { "culled field", nullptr, &FrameStats::cullSamples, nullptr },
+        { "culled field", "in frustum", &FrameStats::cullInFrustum, "%.0f", &FrameStats::cullSamples },
+        { "culled field", "occlusion-culled", &FrameStats::cullOccluded, "%.0f", &FrameStats::cullSamples },
+        { "culled field", "drawn after the Hi-Z re-test", &FrameStats::cullSecondPhase, "%.0f", &FrameStats::cullSamples },
+        { "CPU occlusion", "raster ms", &FrameStats::occlusionRasterMs, "%.3f" },
+        { "CPU occlusion", "test ms", &FrameStats::occlusionTestMs, "%.3f" },
+        { "CPU occlusion", "tested", &FrameStats::occlusionTested, "%.0f" },
+        { "CPU occlusion", "culled", &FrameStats::occlusionCulled, "%.0f" },
+        { "CPU frustum cull", "ms", &FrameStats::frustumCullMs, "%.3f" },
+        { "CPU frustum cull", "tested", &FrameStats::frustumTested, "%.0f" },
+        { "CPU frustum cull", "visible", &FrameStats::frustumVisible, "%.0f" },
+        { "clustered lights", "lights", &FrameStats::clusterLights, "%.0f" },
+        { "clustered lights", "assign ms", &FrameStats::clusterAssignMs, "%.3f" },
+        { "clustered lights", "per cluster", &FrameStats::clusterRefs, "%.2f", nullptr,
+            1.0 / ClusteredLighting::kClusterCount },
+        { "clustered lights", "fullest cluster", &FrameStats::clusterMostRefs, "%.0f" },
+        { "clustered lights", "dropped", &FrameStats::clusterOverflow, "%.0f" },
+        { "deferred", "lights", &FrameStats::deferredLights, "%.0f" },
+        { "deferred", "volumes drawn", &FrameStats::deferredVolumes, "%.0f" },
+        { "shadow maps", "from cache", &FrameStats::shadowMapsCached, "%.2f" },
+        { "shadow maps", "redrawn", &FrameStats::shadowMapsRedrawn, "%.2f" },
+        { "fragment shader runs per pixel", nullptr, &FrameStats::geometrySamples, nullptr },
+        { "fragment shader runs per pixel", "drawing the scene", &FrameStats::geometryRunsPerPixel, "%.2f",
+            &FrameStats::geometrySamples },
+        { "fragment shader runs per pixel", nullptr, &FrameStats::resolveSamples, nullptr },
+        { "fragment shader runs per pixel", "shading it", &FrameStats::resolveRunsPerPixel, "%.2f",
+            &FrameStats::resolveSamples },
+        { "GL calls", "per frame", &FrameStats::glCalls, "%.1f" },
+    };
+
+    static_assert(sizeof(kStatRows) / sizeof(kStatRows[0]) * sizeof(double) == sizeof(FrameStats),
+        "every FrameStats field needs a row in kStatRows");
+
+    // " | group: label average, label average" for every group in use
+    void PrintStatRows(double frames)
+    {
+        const size_t count = sizeof(kStatRows) / sizeof(kStatRows[0]);
+        size_t begin = 0;
+        while (begin < count)
+        {
+            size_t end = begin + 1;
+            while (end < count && strcmp(kStatRows[end].group, kStatRows[begin].group) == 0)
+                end++;
+
+            bool used = false;
+            for (size_t i = begin; i < end; ++i)
+                used = used || gTotals.*kStatRows[i].field != 0.0;
+
+            if (used)
+            {
+                printf(" | %s:", kStatRows[begin].group);
+                const char* separator = " ";
+                for (size_t i = begin; i < end; ++i)
+                {
+                    const StatRow& row = kStatRows[i];
+                    const double over = row.per ? gTotals.*row.per : frames;
+                    if (!row.format || over == 0.0)
+                        continue;
+                    printf("%s%s ", separator, row.label);
+                    printf(row.format, gTotals.*row.field / over * row.scale);
+                    separator = ", ";
+                }
+            }
+            begin = end;
+        }
+    }
+}
+
+#define COUNT_GL_POINTER(var, name) \
+    do { struct Tag {}; Hook<decltype(var), Tag>::Install(&var, name); } while (0)
+#define COUNT_GL_CALLS(fn) COUNT_GL_POINTER(glad_##fn, #fn)
+#define COUNT_GL_EXT_CALLS(fn) COUNT_GL_POINTER(gGLExt.fn, "gGLExt." #fn)
+
+// Every entry point the render loop can reach belongs here, extensions
+// included; load-time calls (object creation, shader compiles) are left out.
+void InstallGLCallCounters()
+{
+    // uniforms and program state
+    COUNT_GL_CALLS(glGetUniformLocation);
+    COUNT_GL_CALLS(glGetIntegerv);
+    COUNT_GL_CALLS(glGetProgramiv);
+    COUNT_GL_CALLS(glUseProgram);
+    COUNT_GL_CALLS(glUniform1i);
+    COUNT_GL_CALLS(glUniform1f);
+    COUNT_GL_CALLS(glUniform3f);
+    COUNT_GL_CALLS(glUniform4f);
+    COUNT_GL_CALLS(glUniformMatrix3fv);
+    COUNT_GL_CALLS(glUniformMatrix4fv);
+    COUNT_GL_CALLS(glProgramUniform1i);
+    COUNT_GL_CALLS(glProgramUniform1ui);
+    COUNT_GL_CALLS(glProgramUniform1f);
+    COUNT_GL_CALLS(glProgramUniform2f);
+    COUNT_GL_CALLS(glProgramUniform3f);
+    COUNT_GL_CALLS(glProgramUniform4f);
+    COUNT_GL_CALLS(glProgramUniform4fv);
+    COUNT_GL_CALLS(glProgramUniformMatrix3fv);
+    COUNT_GL_CALLS(glProgramUniformMatrix4fv);
+
+    // buffers, textures, vertex arrays
+    COUNT_GL_CALLS(glBindVertexArray);
+    COUNT_GL_CALLS(glBindBuffer);
+    COUNT_GL_CALLS(glBindBufferBase);
+    COUNT_GL_CALLS(glBindBufferRange);
+    COUNT_GL_CALLS(glBufferData);
+    COUNT_GL_CALLS(glBufferSubData);
+    COUNT_GL_CALLS(glBufferStorage);
+    COUNT_GL_CALLS(glMapBufferRange);
+    COUNT_GL_CALLS(glUnmapBuffer);
+    COUNT_GL_CALLS(glFlushMappedBufferRange);
+    COUNT_GL_CALLS(glClearBufferData);
+    COUNT_GL_CALLS(glClearBufferSubData);
+    COUNT_GL_CALLS(glCopyBufferSubData);
+    COUNT_GL_CALLS(glGetBufferSubData);
+    COUNT_GL_CALLS(glActiveTexture);
+    COUNT_GL_CALLS(glBindTexture);
+    COUNT_GL_CALLS(glBindImageTexture);
+    COUNT_GL_CALLS(glTexSubImage2D);
+    COUNT_GL_CALLS(glGenerateMipmap);
+    COUNT_GL_CALLS(glCopyImageSubData);
+    COUNT_GL_CALLS(glBindFramebuffer);
+    COUNT_GL_CALLS(glBlitFramebuffer);
+    COUNT_GL_CALLS(glDrawBuffers);
+    COUNT_GL_CALLS(glClearBufferuiv);
+    COUNT_GL_EXT_CALLS(BufferStorage);
+
+    // fixed-function state
+    COUNT_GL_CALLS(glEnable);
+    COUNT_GL_CALLS(glDisable);
+    COUNT_GL_CALLS(glDepthMask);
+    COUNT_GL_CALLS(glDepthFunc);
+    COUNT_GL_CALLS(glColorMask);
+    COUNT_GL_CALLS(glCullFace);
+    COUNT_GL_CALLS(glBlendFunc);
+    COUNT_GL_CALLS(glStencilFunc);
+    COUNT_GL_CALLS(glStencilOp);
+    COUNT_GL_CALLS(glStencilFuncSeparate);
+    COUNT_GL_CALLS(glStencilOpSeparate);
+    COUNT_GL_CALLS(glPolygonOffset);
+    COUNT_GL_CALLS(glViewport);
+    COUNT_GL_CALLS(glClearColor);
+    COUNT_GL_CALLS(glClear);
+
+    // draws, compute, sync
+    COUNT_GL_CALLS(glDrawArrays);
+    COUNT_GL_CALLS(glDrawArraysInstanced);
+    COUNT_GL_CALLS(glDrawArraysInstancedBaseInstance);
+    COUNT_GL_CALLS(glDrawElements);
+    COUNT_GL_CALLS(glDrawElementsInstanced);
+    COUNT_GL_CALLS(glDrawElementsInstancedBaseVertexBaseInstance);
+    COUNT_GL_CALLS(glDrawElementsIndirect);
+    COUNT_GL_CALLS(glMultiDrawElementsIndirect);
+    COUNT_GL_EXT_CALLS(MultiDrawElementsIndirectCount);
+    COUNT_GL_CALLS(glDispatchCompute);
+    COUNT_GL_CALLS(glMemoryBarrier);
+    COUNT_GL_CALLS(glFenceSync);
+    COUNT_GL_CALLS(glClientWaitSync);
+    COUNT_GL_CALLS(glDeleteSync);
+
+    // queries
+    COUNT_GL_CALLS(glBeginQuery);
+    COUNT_GL_CALLS(glEndQuery);
+    COUNT_GL_CALLS(glGetQueryObjectuiv);
+    COUNT_GL_CALLS(glGetQueryObjectui64v);
+
+    gInstalled = true;
+}
+
+void FragmentCounter::Create(int windowPixels)
+{
+    available = gGLExt.pipelineStatistics;
+    pixels = (double)windowPixels;
+    if (available)
+        glGenQueries(kQueries, queries);
+}
+
+void FragmentCounter::Destroy()
+{
+    if (available)
+        glDeleteQueries(kQueries, queries);
+    available = false;
+    issued = collected = 0;
+}
+
+void FragmentCounter::Begin()
+{
+    // every query still in flight: skip this frame rather than reuse one
+    if (!available || issued - collected == kQueries)
+        return;
+    glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS, queries[issued % kQueries]);
+}
+
+void FragmentCounter::End()
+{
+    if (!available || issued - collected == kQueries)
+        return;
+    glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS);
+    issued++;
+}
+
+void FragmentCounter::Collect(double& runsPerPixel, double& samples)
+{
+    while (collected < issued)
+    {
+        const GLuint query = queries[collected % kQueries];
+        GLuint ready = GL_FALSE;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready)
+            break;
+        GLuint64 runs = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &runs);
+        runsPerPixel += runs / pixels;
+        samples++;
+        collected++;
+    }
+}
+
+void EndFrameStats(double cpuFrameMs)
+{
+    gFrames++;
+    gFrameStats.cpuMs = cpuFrameMs;
+    for (const StatRow& row : kStatRows)
+        gTotals.*row.field += gFrameStats.*row.field;
+    gFrameStats = FrameStats();
+
+    double now = ProfileNow();
+    if (gWindowStart == 0.0)
+        gWindowStart = now;
+    if (now - gWindowStart < 2.0)
+        return;
+
+    const double n = (double)gFrames;
+    printf("Frame stats (%d frames)", gFrames);
+    PrintStatRows(n);
+    if (gInstalled)
+    {
+        printf("\n ");
+
+        std::vector<CallCounter*> sorted = gCounters;
+        std::sort(sorted.begin(), sorted.end(),
+            [](const CallCounter* a, const CallCounter* b) { return a->count > b->count; });
+        for (CallCounter* c : sorted)
+        {
+            if (c->count / n >= 0.05)
+                printf(" %s %.1f", c->name, c->count / n);
+            c->count = 0;
+        }
+    }
+    printf("\n");
+
+    gFrames = 0;
+    gTotals = FrameStats();
+    gWindowStart = now;
+}
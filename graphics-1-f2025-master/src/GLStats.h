@@ -0,0 +1,79 @@
+#pragma once
+
+// Per-frame counters. The uniform/state counters are always maintained;
+// glCalls is only filled in once InstallGLCallCounters() has run. All are
+// doubles so one table in GLStats.cpp can sum and print them: a new field
+// needs a row in kStatRows there too.
+struct FrameStats
+{
+    double cpuMs = 0.0;             // set by EndFrameStats()
+    double glCalls = 0;
+    double uniformUploads = 0;
+    double uniformsSkipped = 0;     // Set() with the value GL already has
+    double stateIssued = 0;         // GLState calls forwarded to GL
+    double stateFiltered = 0;       // GLState calls dropped as redundant
+    double fenceWaits = 0;          // ring buffer frames that had to wait for the GPU
+    double fenceWaitMs = 0.0;
+    double submitMs = 0.0;          // CPU time spent issuing the MeshScene draws
+    double cullSamples = 0;         // GpuCulledField counter readbacks that landed
+    double cullInFrustum = 0;       // summed over those readbacks
+    double cullSecondPhase = 0;     // drawn only after the Hi-Z re-test
+    double cullOccluded = 0;
+    double occlusionRasterMs = 0.0; // SoftwareOcclusion::Render
+    double occlusionTestMs = 0.0;   // box tests against it
+    double occlusionTested = 0;
+    double occlusionCulled = 0;
+    double frustumCullMs = 0.0;     // --cpu-cull, bounds fill and CullBoxes/CullSpheres
+    double frustumTested = 0;
+    double frustumVisible = 0;
+    double clusterAssignMs = 0.0;   // ClusteredLighting::Update
+    double clusterLights = 0;
+    double clusterRefs = 0;         // light indices over all clusters (CPU path)
+    double clusterMostRefs = 0;     // in the fullest cluster
+    double clusterOverflow = 0;     // dropped by clusters already full
+    double deferredLights = 0;      // DeferredRenderer::Light
+    double deferredVolumes = 0;     // light volumes drawn after the frustum test
+    double shadowMapsCached = 0;    // ShadowMaps::Render, static casters reused
+    double shadowMapsRedrawn = 0;   // and drawn again
+    double geometryRunsPerPixel = 0.0; // fragment shader runs while drawing the scene, / window pixels
+    double geometrySamples = 0;     // FragmentCounter results that landed
+    double resolveRunsPerPixel = 0.0;  // same for the visibility buffer's shading pass
+    double resolveSamples = 0;
+};
+
+extern FrameStats gFrameStats;
+
+// Wraps the glad function pointers of the GL entry points the renderer
+// uses so every call is counted. Opt-in (--gl-stats) because each wrapped
+// call costs an extra indirect jump. Call after glad is loaded.
+void InstallGLCallCounters();
+
+// Counts fragment shader runs between Begin() and End() with a
+// GL_FRAGMENT_SHADER_INVOCATIONS query. Results are read a few frames
+// later so the CPU never waits for them. Does nothing without
+// gGLExt.pipelineStatistics.
+class FragmentCounter
+{
+public:
+    void Create(int windowPixels);
+    void Destroy();
+
+    void Begin();
+    void End();
+
+    // Adds the runs per window pixel of every query that has landed
+    void Collect(double& runsPerPixel, double& samples);
+
+private:
+    static const int kQueries = 4;
+    unsigned int queries[kQueries] = {};
+    int issued = 0;     // queries begun so far
+    int collected = 0;  // and read back
+    double pixels = 1.0;
+    bool available = false;
+};
+
+// With --gl-stats, call once at the end of every frame with the CPU time
+// spent building it. Every couple of seconds prints per-frame averages and
+// resets. Without it the caller just clears gFrameStats each frame.
+void EndFrameStats(double cpuFrameMs);
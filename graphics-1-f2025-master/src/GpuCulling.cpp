@@ -0,0 +1,262 @@
+#include "GpuCulling.h"
+#include "MeshScene.h"
+#include "Shader.h"
+#include "GLState.h"
+#include "GLExtensions.h"
+#include "GLStats.h"
+#include "HiZ.h"
+#include "CullUniforms.h"
+#include "NormalMatrix.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    const int kMaxInstances = 65535 * 64; // one dispatch dimension of 64-wide groups
+}
+
+void GpuCulledField::Create(int count)
+{
+    instanceCount = std::min(count, kMaxInstances);
+
+    // three LODs of one sphere: 768, 192 and 48 triangles
+    std::vector<MeshVertex> verts;
+    std::vector<GLuint> idx;
+    const int lodRings[3] = { 16, 8, 4 };
+    for (int lod = 0; lod < 3; ++lod)
+    {
+        BuildSuperellipsoid(lodRings[lod], lodRings[lod] * 3, 1.0f, 1.0f, verts, idx);
+        batch.AddMesh(verts.data(), verts.size(), idx.data(), idx.size());
+    }
+    batch.Upload(instanceCount);
+
+    // square grid on the ground around the origin
+    const int side = (int)ceilf(sqrtf((float)instanceCount));
+    const float spacing = 1.0f;
+    const float scale = 0.3f;
+    std::vector<MeshInstance> instances(instanceCount);
+    bounds.resize(instanceCount * 4);
+    for (int i = 0; i < instanceCount; ++i)
+    {
+        float x = (i % side - 0.5f * (side - 1)) * spacing;
+        float z = (i / side - 0.5f * (side - 1)) * spacing;
+        float y = scale;
+
+        MeshInstance& m = instances[i];
+        memset(m.model, 0, sizeof(m.model));
+        m.model[0] = m.model[5] = m.model[10] = scale;
+        m.model[12] = x;
+        m.model[13] = y;
+        m.model[14] = z;
+        m.model[15] = 1.0f;
+        ComputeNormalMatrix(m.model, m.normalMatrix);
+        m.tint[0] = 0.5f + 0.5f * (float)((i * 37) % 11) / 10.0f;
+        m.tint[1] = 0.5f + 0.5f * (float)((i * 53) % 13) / 12.0f;
+        m.tint[2] = 0.5f + 0.5f * (float)((i * 71) % 7) / 6.0f;
+        m.tint[3] = 1.0f;
+
+        bounds[i * 4 + 0] = x;
+        bounds[i * 4 + 1] = y;
+        bounds[i * 4 + 2] = z;
+        bounds[i * 4 + 3] = scale;
+    }
+
+    glGenBuffers(1, &instanceBuffer);
+    gGLState.BindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(MeshInstance), instances.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &boundsBuffer);
+    gGLState.BindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, bounds.size() * sizeof(float), bounds.data(), GL_STATIC_DRAW);
+
+    // written by the compute pass, read by the draw: never touched by the CPU.
+    // Two lists of instanceCount commands, for the two culling phases.
+    glGenBuffers(1, &commandBuffer);
+    gGLState.BindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * instanceCount * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_COPY);
+
+    // drawCount[2], inFrustum, occluded
+    glGenBuffers(1, &counterBuffer);
+    gGLState.BindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 4 * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &flagBuffer);
+    gGLState.BindBuffer(GL_SHADER_STORAGE_BUFFER, flagBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, instanceCount * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+
+    glGenBuffers(kReadbackLatency, readback);
+    for (int i = 0; i < kReadbackLatency; ++i)
+    {
+        gGLState.BindBuffer(GL_COPY_WRITE_BUFFER, readback[i]);
+        glBufferData(GL_COPY_WRITE_BUFFER, 4 * sizeof(GLuint), nullptr, GL_STREAM_READ);
+    }
+}
+
+void GpuCulledField::Destroy()
+{
+    batch.Destroy();
+    GLuint buffers[5] = { instanceBuffer, boundsBuffer, commandBuffer, counterBuffer, flagBuffer };
+    glDeleteBuffers(5, buffers);
+    glDeleteBuffers(kReadbackLatency, readback);
+    for (int i = 0; i < kReadbackLatency; ++i)
+    {
+        if (readbackFences[i])
+            glDeleteSync(readbackFences[i]);
+        readback[i] = 0;
+        readbackFences[i] = nullptr;
+    }
+    gGLState.Invalidate();
+    instanceBuffer = boundsBuffer = commandBuffer = counterBuffer = flagBuffer = 0;
+}
+
+RingBuffer::Allocation GpuCulledField::WriteParams(RingBuffer& ring, const Frustum& frustum, const float viewProj[16],
+    const float cameraPos[3])
+{
+    CullBlock params = {};
+    memcpy(params.planes, frustum.planes, sizeof(params.planes));
+    params.cameraPos[0] = cameraPos[0];
+    params.cameraPos[1] = cameraPos[1];
+    params.cameraPos[2] = cameraPos[2];
+    params.lodDistance[0] = 8.0f;
+    params.lodDistance[1] = 20.0f;
+    for (int lod = 0; lod < 3; ++lod)
+    {
+        const MeshRange& m = batch.GetMesh(lod);
+        params.lodIndexCount[lod] = m.indexCount;
+        params.lodFirstIndex[lod] = m.firstIndex;
+        params.lodBaseVertex[lod] = m.baseVertex;
+    }
+    params.instanceCount = (GLuint)instanceCount;
+
+    // the pyramid the first phase reads was drawn with last frame's camera
+    memcpy(params.viewProj, viewProj, sizeof(params.viewProj));
+    memcpy(params.prevViewProj, hasPrevViewProj ? prevViewProj : viewProj, sizeof(params.prevViewProj));
+    memcpy(prevViewProj, viewProj, sizeof(prevViewProj));
+    hasPrevViewProj = true;
+
+    RingBuffer::Allocation a = ring.Alloc(sizeof(CullBlock));
+    if (a.ptr)
+        memcpy(a.ptr, &params, sizeof(params));
+    return a;
+}
+
+void GpuCulledField::Cull(Shader& cullShader, RingBuffer& ring, const RingBuffer::Allocation& params,
+    CullPhase phase, GLuint hiz)
+{
+    if (!instanceCount || !params.size)
+        return;
+
+    // the second phase appends to the counters the first one left
+    if (phase != kCullSecondPhase)
+    {
+        const GLuint zero = 0;
+        gGLState.BindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        if (!gGLExt.indirectParameters)
+        {
+            // the draws walk all instanceCount slots: unused ones must be empty draws
+            gGLState.BindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+            glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        }
+    }
+
+    cullShader.Use();
+    cullShader.Set(Cull::phase, (int)phase);
+    cullShader.Set(Cull::hiZ, (int)kHiZTextureUnit);
+    if (phase != kCullFrustumOnly)
+        gGLState.BindTexture(kHiZTextureUnit, GL_TEXTURE_2D, hiz);
+    ring.BindRange(kCullBlockBinding, params);
+    gGLState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kCullBoundsBinding, boundsBuffer);
+    gGLState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kCullCommandBinding, commandBuffer);
+    gGLState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kCullCounterBinding, counterBuffer);
+    gGLState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kCullFlagsBinding, flagBuffer);
+
+    glDispatchCompute((GLuint)(instanceCount + 63) / 64, 1, 1);
+
+    // commands are consumed as indirect draw arguments
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuCulledField::Draw(CullPhase phase)
+{
+    if (!instanceCount)
+        return;
+
+    const int list = phase == kCullSecondPhase ? 1 : 0;
+    const GLintptr commands = (GLintptr)list * instanceCount * sizeof(DrawElementsIndirectCommand);
+
+    gGLState.BindVertexArray(batch.GetVAO());
+    gGLState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kMeshInstanceBinding, instanceBuffer);
+    gGLState.BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+
+    if (gGLExt.indirectParameters)
+    {
+        gGLState.BindBuffer(GL_PARAMETER_BUFFER, counterBuffer);
+        gGLExt.MultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)commands,
+            (GLintptr)(list * sizeof(GLuint)), instanceCount, 0);
+    }
+    else
+    {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)commands, instanceCount, 0);
+    }
+}
+
+void GpuCulledField::CollectStats()
+{
+    if (!instanceCount)
+        return;
+
+    for (int i = 0; i < kReadbackLatency; ++i)
+    {
+        GLsync& fence = readbackFences[i];
+        if (!fence)
+            continue;
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            continue;
+        glDeleteSync(fence);
+        fence = nullptr;
+
+        GLuint counts[4];
+        gGLState.BindBuffer(GL_COPY_READ_BUFFER, readback[i]);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(counts), counts);
+        gFrameStats.cullSamples++;
+        gFrameStats.cullInFrustum += counts[2];
+        gFrameStats.cullSecondPhase += counts[1];
+        gFrameStats.cullOccluded += counts[3];
+    }
+
+    // a slot still in flight means the GPU is far behind: skip this frame's sample
+    int slot = readbackNext;
+    if (readbackFences[slot])
+        return;
+    readbackNext = (readbackNext + 1) % kReadbackLatency;
+
+    gGLState.BindBuffer(GL_COPY_READ_BUFFER, counterBuffer);
+    gGLState.BindBuffer(GL_COPY_WRITE_BUFFER, readback[slot]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, 4 * sizeof(GLuint));
+    readbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void GpuCulledField::Verify(const Frustum& frustum)
+{
+    GLuint counts[4] = {};
+    gGLState.BindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counts), counts);
+
+    int cpuCount = 0;
+    for (int i = 0; i < instanceCount; ++i)
+    {
+        const float* b = &bounds[i * 4];
+        if (SphereInFrustum(frustum, b[0], b[1], b[2], b[3]))
+            cpuCount++;
+    }
+
+    // every instance in the frustum is either drawn by one of the phases or occluded
+    const bool consistent = counts[0] + counts[1] + counts[3] == counts[2];
+    std::cout << "GPU culling check: " << counts[2] << " of " << instanceCount << " in the frustum on the GPU, "
+        << cpuCount << " on the CPU; drawn " << counts[0] << " + " << counts[1] << ", occluded " << counts[3]
+        << " -> " << ((int)counts[2] == cpuCount && consistent ? "OK" : "MISMATCH") << "\n";
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+#include "MeshBatch.h"
+#include "RingBuffer.h"
+#include "Frustum.h"
+
+class Shader;
+
+// std140 parameters of shaders/cull.comp
+struct CullBlock
+{
+    float planes[6][4];
+    float cameraPos[4];
+    float lodDistance[4];           // x: LOD0 -> LOD1, y: LOD1 -> LOD2
+    GLuint lodIndexCount[4];
+    GLuint lodFirstIndex[4];
+    GLint lodBaseVertex[4];
+    GLuint instanceCount;
+    GLuint pad0[3];
+    float viewProj[16];             // Hi-Z test, this frame (second phase)
+    float prevViewProj[16];         // Hi-Z test, last frame's pyramid (first phase)
+};
+
+static_assert(offsetof(CullBlock, cameraPos) == 96, "std140 CullBlock");
+static_assert(offsetof(CullBlock, lodIndexCount) == 128, "std140 CullBlock");
+static_assert(offsetof(CullBlock, instanceCount) == 176, "std140 CullBlock");
+static_assert(offsetof(CullBlock, viewProj) == 192, "std140 CullBlock");
+static_assert(offsetof(CullBlock, prevViewProj) == 256, "std140 CullBlock");
+static_assert(sizeof(CullBlock) == 320, "std140 CullBlock");
+
+const unsigned int kCullBlockBinding = 3;      // uniform block
+const unsigned int kCullBoundsBinding = 1;     // shader storage
+const unsigned int kCullCommandBinding = 2;    // shader storage
+const unsigned int kCullCounterBinding = 3;    // shader storage
+const unsigned int kCullFlagsBinding = 4;      // shader storage
+
+// uPhase of shaders/cull.comp
+enum CullPhase
+{
+    kCullFrustumOnly = 0,   // frustum + LOD, one list
+    kCullFirstPhase = 1,    // + occlusion against last frame's Hi-Z pyramid
+    kCullSecondPhase = 2,   // re-test of what the first phase found occluded
+};
+
+// ------------------------------------------------------------
+// --cull-instances N: a field of N instances with three LODs whose
+// visibility is decided on the GPU. Each frame shaders/cull.comp tests
+// every bounding sphere against the frustum, picks a LOD by distance and
+// appends a DrawElementsIndirectCommand for the survivors; the draw then
+// reads that buffer directly. Nothing is read back to the CPU.
+//
+// With --hiz the field is culled twice per frame around a Hi-Z pyramid
+// build (see HiZ.h and the phases in cull.comp). The counters are copied
+// to a small readback ring and picked up a few frames later, so reporting
+// them never stalls.
+// ------------------------------------------------------------
+class GpuCulledField
+{
+public:
+    GpuCulledField() : instanceBuffer(0), boundsBuffer(0), commandBuffer(0), counterBuffer(0),
+        flagBuffer(0), instanceCount(0), readbackNext(0), hasPrevViewProj(false) {}
+
+    void Create(int count);
+    void Destroy();
+
+    // Writes this frame's CullBlock into ring (before ring.Commit()).
+    // viewProj is also remembered as next frame's prevViewProj.
+    RingBuffer::Allocation WriteParams(RingBuffer& ring, const Frustum& frustum, const float viewProj[16],
+        const float cameraPos[3]);
+
+    // Runs one compute pass, then Draw() with the same phase draws its
+    // survivors with the indirect-draw program (bound by the caller).
+    // The occlusion phases read the pyramid texture hiz.
+    void Cull(Shader& cullShader, RingBuffer& ring, const RingBuffer::Allocation& params,
+        CullPhase phase = kCullFrustumOnly, GLuint hiz = 0);
+    void Draw(CullPhase phase = kCullFrustumOnly);
+
+    // Once per frame after the last Cull: queues a copy of the counters and
+    // adds any copy that has landed to gFrameStats.
+    void CollectStats();
+
+    // Debug only: reads the GPU count back and compares it with the same test
+    // on the CPU. Stalls the pipeline.
+    void Verify(const Frustum& frustum);
+
+    int GetInstanceCount() const { return instanceCount; }
+
+private:
+    static const int kReadbackLatency = 3;
+
+    MeshBatch batch;    // mesh i = LOD i
+    GLuint instanceBuffer, boundsBuffer, commandBuffer, counterBuffer, flagBuffer;
+    int instanceCount;
+    std::vector<float> bounds; // CPU copy for Verify(): x, y, z, radius
+
+    GLuint readback[kReadbackLatency] = {};
+    GLsync readbackFences[kReadbackLatency] = {};
+    int readbackNext;
+    float prevViewProj[16];
+    bool hasPrevViewProj;
+};
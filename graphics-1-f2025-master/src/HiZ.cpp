@@ -0,0 +1,90 @@
+#include "HiZ.h"
+#include "CullUniforms.h"
+#include "Shader.h"
+#include "GLState.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+void HiZPyramid::Create(int width_, int height_)
+{
+    width = width_;
+    height = height_;
+    levels = 1;
+    while ((std::max(width, height) >> levels) > 0)
+        levels++;
+
+    // offscreen scene target; the depth is a texture so it can be read back
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenTextures(1, &depthTexture);
+    gGLState.BindTexture(kHiZTextureUnit, GL_TEXTURE_2D, depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Hi-Z scene framebuffer is incomplete\n";
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // starts out at the far plane everywhere, so the first frame hides nothing
+    glGenTextures(1, &pyramid);
+    gGLState.BindTexture(kHiZTextureUnit, GL_TEXTURE_2D, pyramid);
+    glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    std::vector<float> farDepth((size_t)width * height, 1.0f);
+    for (int level = 0; level < levels; ++level)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, std::max(1, width >> level), std::max(1, height >> level),
+            GL_RED, GL_FLOAT, farDepth.data());
+    }
+}
+
+void HiZPyramid::Destroy()
+{
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    GLuint textures[2] = { depthTexture, pyramid };
+    glDeleteTextures(2, textures);
+    gGLState.Invalidate();
+    fbo = colorBuffer = depthTexture = pyramid = 0;
+}
+
+void HiZPyramid::BeginScene()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+void HiZPyramid::EndScene()
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void HiZPyramid::Build(Shader& hizShader)
+{
+    hizShader.Use();
+    hizShader.Set(HiZ::source, (int)kHiZTextureUnit);
+
+    // level 0 copies the depth buffer, every other level reduces the one above
+    for (int level = 0; level < levels; ++level)
+    {
+        gGLState.BindTexture(kHiZTextureUnit, GL_TEXTURE_2D, level == 0 ? depthTexture : pyramid);
+        hizShader.Set(HiZ::sourceLevel, level == 0 ? 0 : level - 1);
+        glBindImageTexture(0, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        const GLuint w = (GLuint)std::max(1, width >> level);
+        const GLuint h = (GLuint)std::max(1, height >> level);
+        glDispatchCompute((w + 7) / 8, (h + 7) / 8, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+}
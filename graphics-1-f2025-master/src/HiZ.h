@@ -0,0 +1,37 @@
+#pragma once
+#include <glad/glad.h>
+
+class Shader;
+
+const unsigned int kHiZTextureUnit = 1; // unit 0 belongs to the diffuse maps
+
+// ------------------------------------------------------------
+// --hiz: the scene is drawn into an offscreen target whose depth can be
+// sampled, and shaders/hiz.comp reduces that depth into a max-depth
+// pyramid (R32F, level 0 = full resolution, each texel of level n the
+// farthest depth under it in level n - 1). Anything whose nearest depth
+// lies behind the pyramid texel covering its screen rectangle is hidden.
+// ------------------------------------------------------------
+class HiZPyramid
+{
+public:
+    HiZPyramid() : fbo(0), colorBuffer(0), depthTexture(0), pyramid(0), width(0), height(0), levels(0) {}
+
+    void Create(int width, int height);
+    void Destroy();
+
+    // Redirect drawing into the offscreen target, and back (copying the
+    // color to the window) once the frame is done.
+    void BeginScene();
+    void EndScene();
+
+    // Rebuilds the pyramid from the depth drawn so far
+    void Build(Shader& hizShader);
+
+    GLuint GetTexture() const { return pyramid; }
+    int GetLevelCount() const { return levels; }
+
+private:
+    GLuint fbo, colorBuffer, depthTexture, pyramid;
+    int width, height, levels;
+};
@@ -0,0 +1,291 @@
+#include "JobSystem.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+
+// ------------------------------------------------------------
+// Work-stealing pool: every thread owns a deque. The owner pushes
+// and pops at the back (LIFO, cache friendly), idle threads steal
+// from the front of the other deques. Queue 0 belongs to the main
+// thread (and any other thread that is not a worker).
+// ------------------------------------------------------------
+namespace
+{
+    struct WorkerQueue
+    {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    struct JobSystemState
+    {
+        std::vector<std::thread> threads;
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+        std::atomic<int> queued{ 0 };
+        std::atomic<int> sleeping{ 0 };
+        std::atomic<bool> running{ false };
+        std::mutex sleepLock;
+        std::condition_variable wake;
+    } gJobs;
+
+    thread_local int tWorkerIndex = 0;
+
+    void WakeWorkers(int count)
+    {
+        if (gJobs.sleeping.load() == 0)
+            return;
+
+        // taking the lock orders us after a worker that is about to sleep
+        std::lock_guard<std::mutex> guard(gJobs.sleepLock);
+        if (count == 1)
+            gJobs.wake.notify_one();
+        else
+            gJobs.wake.notify_all();
+    }
+
+    void Execute(const Job& job);
+
+    void PushJobs(const Job* jobs, size_t count)
+    {
+        // no workers to hand it to: run inline
+        if (gJobs.threads.empty())
+        {
+            for (size_t i = 0; i < count; ++i)
+                Execute(jobs[i]);
+            return;
+        }
+        if (count == 0)
+            return;
+
+        WorkerQueue& q = *gJobs.queues[tWorkerIndex];
+        {
+            std::lock_guard<std::mutex> guard(q.lock);
+            for (size_t i = 0; i < count; ++i)
+                q.jobs.push_back(jobs[i]);
+        }
+        gJobs.queued.fetch_add((int)count);
+        WakeWorkers((int)count);
+    }
+
+    bool TryGetJob(int index, Job& out)
+    {
+        const int queueCount = (int)gJobs.queues.size();
+
+        // own queue first, newest job
+        {
+            WorkerQueue& q = *gJobs.queues[index];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (!q.jobs.empty())
+            {
+                out = q.jobs.back();
+                q.jobs.pop_back();
+                gJobs.queued.fetch_sub(1);
+                return true;
+            }
+        }
+
+        // steal the oldest job from someone else
+        for (int k = 1; k < queueCount; ++k)
+        {
+            WorkerQueue& q = *gJobs.queues[(index + k) % queueCount];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (!q.jobs.empty())
+            {
+                out = q.jobs.front();
+                q.jobs.pop_front();
+                gJobs.queued.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void FinishJob(JobCounter* counter)
+    {
+        std::vector<Job> ready;
+        {
+            // decrement under the lock so a waiter cannot free the counter
+            // while we are still touching it (see WaitForCounter)
+            std::lock_guard<std::mutex> guard(counter->lock);
+            if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                ready.swap(counter->waiting);
+        }
+        PushJobs(ready.data(), ready.size());
+    }
+
+    void Execute(const Job& job)
+    {
+        job.fn(job.data, job.begin, job.end);
+        if (job.counter)
+            FinishJob(job.counter);
+    }
+
+    void WorkerMain(int index)
+    {
+        tWorkerIndex = index;
+
+        while (gJobs.running.load())
+        {
+            Job job;
+            if (TryGetJob(index, job))
+            {
+                Execute(job);
+                continue;
+            }
+
+            // spin briefly before going to sleep, new work usually arrives in bursts
+            bool found = false;
+            for (int spin = 0; spin < 64 && !found; ++spin)
+            {
+                std::this_thread::yield();
+                found = gJobs.queued.load() > 0;
+            }
+            if (found)
+                continue;
+
+            std::unique_lock<std::mutex> lock(gJobs.sleepLock);
+            gJobs.sleeping.fetch_add(1);
+            gJobs.wake.wait(lock, [] { return gJobs.queued.load() > 0 || !gJobs.running.load(); });
+            gJobs.sleeping.fetch_sub(1);
+        }
+    }
+
+    void CallFunction(void* data, size_t, size_t)
+    {
+        std::unique_ptr<std::function<void()>> fn(static_cast<std::function<void()>*>(data));
+        (*fn)();
+    }
+
+    void CallRange(void* data, size_t begin, size_t end)
+    {
+        (*static_cast<const std::function<void(size_t, size_t)>*>(data))(begin, end);
+    }
+
+    Job MakeFunctionJob(std::function<void()>&& fn, JobCounter* counter)
+    {
+        Job job;
+        job.fn = CallFunction;
+        job.data = new std::function<void()>(std::move(fn));
+        job.counter = counter;
+        return job;
+    }
+}
+
+void InitJobSystem(int workerCount)
+{
+    if (gJobs.running.load())
+        return;
+
+    if (workerCount < 0)
+    {
+        int cores = (int)std::thread::hardware_concurrency();
+        workerCount = cores > 1 ? cores - 1 : 0;
+    }
+
+    gJobs.queues.clear();
+    for (int i = 0; i < workerCount + 1; ++i)
+        gJobs.queues.emplace_back(new WorkerQueue());
+
+    gJobs.running = true;
+    for (int i = 0; i < workerCount; ++i)
+        gJobs.threads.emplace_back(WorkerMain, i + 1);
+}
+
+void ShutdownJobSystem()
+{
+    if (!gJobs.running.load())
+        return;
+
+    gJobs.running = false;
+    {
+        std::lock_guard<std::mutex> guard(gJobs.sleepLock);
+        gJobs.wake.notify_all();
+    }
+    for (std::thread& t : gJobs.threads)
+        t.join();
+
+    gJobs.threads.clear();
+    gJobs.queues.clear();
+    gJobs.queued = 0;
+}
+
+int GetJobWorkerCount()
+{
+    return (int)gJobs.threads.size();
+}
+
+void RunJob(std::function<void()> job, JobCounter* counter)
+{
+    if (counter)
+        counter->pending.fetch_add(1);
+
+    Job j = MakeFunctionJob(std::move(job), counter);
+    PushJobs(&j, 1);
+}
+
+void RunJobAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter)
+{
+    if (counter)
+        counter->pending.fetch_add(1);
+
+    Job j = MakeFunctionJob(std::move(job), counter);
+    {
+        std::lock_guard<std::mutex> guard(dependency.lock);
+        if (dependency.pending.load() != 0)
+        {
+            dependency.waiting.push_back(j);
+            return;
+        }
+    }
+
+    PushJobs(&j, 1);
+}
+
+void WaitForCounter(JobCounter& counter)
+{
+    while (!counter.Done())
+    {
+        Job job;
+        if (!gJobs.threads.empty() && TryGetJob(tWorkerIndex, job))
+            Execute(job);
+        else
+            std::this_thread::yield();
+    }
+
+    // the last FinishJob may still hold the lock; don't return until it lets go
+    std::lock_guard<std::mutex> guard(counter.lock);
+}
+
+void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body)
+{
+    if (count == 0)
+        return;
+    if (grainSize == 0)
+        grainSize = 1;
+
+    const size_t chunkCount = (count + grainSize - 1) / grainSize;
+    if (chunkCount == 1 || gJobs.threads.empty())
+    {
+        body(0, count);
+        return;
+    }
+
+    JobCounter counter;
+    counter.pending = (int)chunkCount;
+
+    std::vector<Job> jobs(chunkCount);
+    for (size_t c = 0; c < chunkCount; ++c)
+    {
+        // pushed in reverse so the owner pops the first chunk and thieves take the tail
+        Job& j = jobs[chunkCount - 1 - c];
+        j.fn = CallRange;
+        j.data = const_cast<std::function<void(size_t, size_t)>*>(&body);
+        j.begin = c * grainSize;
+        j.end = (c + 1) * grainSize < count ? (c + 1) * grainSize : count;
+        j.counter = &counter;
+    }
+    PushJobs(jobs.data(), jobs.size());
+
+    WaitForCounter(counter);
+}
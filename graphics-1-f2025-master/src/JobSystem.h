@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+struct Job
+{
+    void (*fn)(void* data, size_t begin, size_t end) = nullptr;
+    void* data = nullptr;
+    size_t begin = 0;
+    size_t end = 0;
+    struct JobCounter* counter = nullptr;
+};
+
+// Tracks outstanding jobs. Jobs queued with RunJobAfter() are held here
+// until the count drops back to zero.
+struct JobCounter
+{
+    std::atomic<int> pending{ 0 };
+    std::mutex lock;
+    std::vector<Job> waiting;
+
+    bool Done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// Starts the worker threads. -1 = one per core minus the main thread,
+// 0 = no workers (everything runs inline on the caller).
+void InitJobSystem(int workerCount = -1);
+void ShutdownJobSystem();
+int  GetJobWorkerCount();
+
+// Queue a job. counter (optional) is incremented now and decremented when the job finishes.
+void RunJob(std::function<void()> job, JobCounter* counter = nullptr);
+
+// Queue a job that only becomes runnable once dependency reaches zero.
+void RunJobAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter = nullptr);
+
+// Blocks until counter reaches zero. The calling thread runs queued jobs while it waits.
+void WaitForCounter(JobCounter& counter);
+
+// Runs body(begin, end) over [0, count) in chunks of grainSize, spread over the workers.
+// Returns once every chunk has finished.
+void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body);
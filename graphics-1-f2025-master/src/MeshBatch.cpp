@@ -0,0 +1,71 @@
+#include "MeshBatch.h"
+#include "GLState.h"
+
+int MeshBatch::AddMesh(const MeshVertex* v, size_t vertexCount, const GLuint* idx, size_t indexCount)
+{
+    MeshRange range;
+    range.indexCount = (GLuint)indexCount;
+    range.firstIndex = (GLuint)indices.size();
+    range.baseVertex = (GLint)vertices.size();
+
+    vertices.insert(vertices.end(), v, v + vertexCount);
+    indices.insert(indices.end(), idx, idx + indexCount);
+    meshes.push_back(range);
+    return (int)meshes.size() - 1;
+}
+
+void MeshBatch::Upload(size_t maxDraws)
+{
+    std::vector<GLuint> drawIds(maxDraws);
+    for (size_t i = 0; i < maxDraws; ++i)
+        drawIds[i] = (GLuint)i;
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ibo);
+    glGenBuffers(1, &drawIdBuffer);
+
+    gGLState.BindVertexArray(vao);
+
+    gGLState.BindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(MeshVertex), vertices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, uv));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, normal));
+
+    // advances once per instance, so baseInstance picks the element
+    gGLState.BindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+    glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(GLuint), drawIds.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    glVertexAttribDivisor(3, 1);
+
+    gGLState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+    gGLState.BindVertexArray(0);
+}
+
+void MeshBatch::Destroy()
+{
+    GLuint buffers[3] = { vbo, ibo, drawIdBuffer };
+    glDeleteBuffers(3, buffers);
+    glDeleteVertexArrays(1, &vao);
+    gGLState.Invalidate();
+    vao = vbo = ibo = drawIdBuffer = 0;
+}
+
+DrawElementsIndirectCommand MeshBatch::MakeCommand(int mesh, GLuint drawId) const
+{
+    const MeshRange& m = meshes[mesh];
+    DrawElementsIndirectCommand cmd;
+    cmd.count = m.indexCount;
+    cmd.instanceCount = 1;
+    cmd.firstIndex = m.firstIndex;
+    cmd.baseVertex = m.baseVertex;
+    cmd.baseInstance = drawId;
+    return cmd;
+}
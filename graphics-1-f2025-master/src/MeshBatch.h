@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+
+// Same layout as the renderer's Vertex: locations 0/1/2 = position/uv/normal
+struct MeshVertex
+{
+    float position[3];
+    float uv[2];
+    float normal[3];
+};
+
+// Layout fixed by GL for glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand layout");
+
+// Where one mesh lives inside the shared buffers
+struct MeshRange
+{
+    GLuint indexCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+};
+
+// ------------------------------------------------------------
+// Many meshes in one VAO: a shared vertex buffer, a shared 32-bit index
+// buffer, and a per-instance "draw id" attribute (location 3) that reads
+// 0, 1, 2, ... With baseInstance = n a draw sees aDrawID == n, which
+// indexes per-draw data in an SSBO. (gl_DrawID / gl_BaseInstance need
+// GL 4.6; this works on 4.3.)
+// ------------------------------------------------------------
+class MeshBatch
+{
+public:
+    MeshBatch() : vao(0), vbo(0), ibo(0), drawIdBuffer(0) {}
+
+    // CPU side; returns the mesh index
+    int AddMesh(const MeshVertex* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount);
+
+    // Creates the GL buffers. maxDraws bounds the baseInstance values used.
+    void Upload(size_t maxDraws);
+    void Destroy();
+
+    const MeshRange& GetMesh(int mesh) const { return meshes[mesh]; }
+    int GetMeshCount() const { return (int)meshes.size(); }
+    size_t GetVertexCount() const { return vertices.size(); }
+    size_t GetIndexCount() const { return indices.size(); }
+    GLuint GetVAO() const { return vao; }
+
+    // One command drawing mesh once, with aDrawID = drawId
+    DrawElementsIndirectCommand MakeCommand(int mesh, GLuint drawId) const;
+
+private:
+    std::vector<MeshVertex> vertices;
+    std::vector<GLuint> indices;
+    std::vector<MeshRange> meshes;
+
+    GLuint vao, vbo, ibo, drawIdBuffer;
+};
@@ -0,0 +1,201 @@
+#include "MeshScene.h"
+#include "RingBuffer.h"
+#include "GLState.h"
+#include "SoftwareOcclusion.h"
+#include "JobSystem.h"
+#include "NormalMatrix.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    float SignedPow(float v, float e)
+    {
+        return v < 0.0f ? -powf(-v, e) : powf(v, e);
+    }
+}
+
+void BuildSuperellipsoid(int rings, int segments, float e1, float e2,
+    std::vector<MeshVertex>& verts, std::vector<GLuint>& idx)
+{
+    const float pi = 3.14159265f;
+
+    verts.clear();
+    idx.clear();
+    for (int r = 0; r <= rings; ++r)
+    {
+        float theta = -0.5f * pi + pi * r / rings;
+        float ct = cosf(theta), st = sinf(theta);
+        for (int s = 0; s <= segments; ++s)
+        {
+            float phi = 2.0f * pi * s / segments;
+            float cp = cosf(phi), sp = sinf(phi);
+
+            MeshVertex v;
+            v.position[0] = SignedPow(ct, e1) * SignedPow(cp, e2);
+            v.position[1] = SignedPow(st, e1);
+            v.position[2] = SignedPow(ct, e1) * SignedPow(sp, e2);
+
+            float n[3] = {
+                SignedPow(ct, 2.0f - e1) * SignedPow(cp, 2.0f - e2),
+                SignedPow(st, 2.0f - e1),
+                SignedPow(ct, 2.0f - e1) * SignedPow(sp, 2.0f - e2),
+            };
+            float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; ++k)
+                v.normal[k] = len > 0.0f ? n[k] / len : 0.0f;
+
+            v.uv[0] = (float)s / segments;
+            v.uv[1] = (float)r / rings;
+            verts.push_back(v);
+        }
+    }
+
+    const int row = segments + 1;
+    for (int r = 0; r < rings; ++r)
+    {
+        for (int s = 0; s < segments; ++s)
+        {
+            GLuint a = r * row + s, b = a + 1, c = a + row, d = c + 1;
+            GLuint quad[6] = { a, c, b, b, c, d };
+            idx.insert(idx.end(), quad, quad + 6);
+        }
+    }
+}
+
+void MeshScene::Create(int meshCount)
+{
+    drawCount = meshCount;
+
+    std::vector<MeshVertex> verts;
+    std::vector<GLuint> idx;
+    for (int i = 0; i < meshCount; ++i)
+    {
+        // own tessellation and exponents per mesh, so every one is different geometry
+        int rings = 6 + (i * 7) % 13;           // 6..18
+        int segments = 8 + (i * 5) % 17;        // 8..24
+        float e1 = 0.3f + 0.25f * (i % 7);      // 0.3..1.8
+        float e2 = 0.3f + 0.35f * ((i / 7) % 5);
+        BuildSuperellipsoid(rings, segments, e1, e2, verts, idx);
+        batch.AddMesh(verts.data(), verts.size(), idx.data(), idx.size());
+    }
+    batch.Upload(meshCount);
+
+    // static placement: a square grid on the ground behind the bird
+    const int side = (int)ceilf(sqrtf((float)meshCount));
+    const float spacing = 1.2f;
+    const float scale = 0.4f;
+    std::vector<MeshInstance> instances(meshCount);
+    for (int i = 0; i < meshCount; ++i)
+    {
+        MeshInstance& m = instances[i];
+        memset(m.model, 0, sizeof(m.model));
+        m.model[0] = m.model[5] = m.model[10] = scale;
+        m.model[12] = (i % side - 0.5f * (side - 1)) * spacing;
+        m.model[13] = scale;
+        m.model[14] = -4.0f - (i / side) * spacing;
+        m.model[15] = 1.0f;
+
+        ComputeNormalMatrix(m.model, m.normalMatrix);
+
+        m.tint[0] = 0.4f + 0.6f * (float)((i * 37) % 11) / 10.0f;
+        m.tint[1] = 0.4f + 0.6f * (float)((i * 53) % 13) / 12.0f;
+        m.tint[2] = 0.4f + 0.6f * (float)((i * 71) % 7) / 6.0f;
+        m.tint[3] = 1.0f;
+
+        // the superellipsoids fill [-1, 1]^3 before scaling
+        for (int k = 0; k < 3; ++k)
+            bounds.push_back(m.model[12 + k] - scale);
+        for (int k = 0; k < 3; ++k)
+            bounds.push_back(m.model[12 + k] + scale);
+    }
+
+    glGenBuffers(1, &instanceBuffer);
+    gGLState.BindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(MeshInstance), instances.data(), GL_STATIC_DRAW);
+
+    commands.resize(meshCount);
+    visible.assign(meshCount, 1);
+}
+
+int MeshScene::CullOccluded(const SoftwareOcclusion& occlusion)
+{
+    ParallelFor(drawCount, 256, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            visible[i] = occlusion.IsVisible(&bounds[i * 6], &bounds[i * 6 + 3]) ? 1 : 0;
+    });
+
+    int hidden = 0;
+    for (unsigned char v : visible)
+        hidden += v ? 0 : 1;
+    return hidden;
+}
+
+void MeshScene::Destroy()
+{
+    batch.Destroy();
+    if (instanceBuffer)
+        glDeleteBuffers(1, &instanceBuffer);
+    instanceBuffer = 0;
+    gGLState.Invalidate();
+}
+
+void MeshScene::GetBounds(float min[3], float max[3]) const
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        min[k] = 1e30f;
+        max[k] = -1e30f;
+    }
+    for (size_t i = 0; i + 6 <= bounds.size(); i += 6)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            min[k] = std::min(min[k], bounds[i + k]);
+            max[k] = std::max(max[k], bounds[i + 3 + k]);
+        }
+    }
+}
+
+RingBuffer::Allocation MeshScene::WriteCommands(RingBuffer& commandRing, bool allMeshes)
+{
+    // rebuilt every frame, without the meshes CullOccluded() hid
+    commands.clear();
+    for (int i = 0; i < drawCount; ++i)
+    {
+        if (allMeshes || visible[i])
+            commands.push_back(batch.MakeCommand(i, (GLuint)i));
+    }
+    if (commands.empty())
+        return RingBuffer::Allocation();
+
+    RingBuffer::Allocation a = commandRing.Alloc(commands.size() * sizeof(DrawElementsIndirectCommand));
+    if (a.ptr)
+        memcpy(a.ptr, commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand));
+    return a;
+}
+
+void MeshScene::Draw(const RingBuffer& commandRing, const RingBuffer::Allocation& commands, bool multiDraw)
+{
+    if (!commands.size)
+        return;
+
+    gGLState.BindVertexArray(batch.GetVAO());
+    gGLState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kMeshInstanceBinding, instanceBuffer);
+    gGLState.BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandRing.GetID());
+
+    const GLsizei count = (GLsizei)(commands.size / sizeof(DrawElementsIndirectCommand));
+    if (!multiDraw)
+    {
+        // the same commands, one draw call each
+        for (GLsizei i = 0; i < count; ++i)
+        {
+            glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                (void*)(commands.offset + i * sizeof(DrawElementsIndirectCommand)));
+        }
+        return;
+    }
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)commands.offset, count, 0);
+}
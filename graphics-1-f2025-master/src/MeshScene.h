@@ -0,0 +1,66 @@
+#pragma once
+#include "MeshBatch.h"
+#include "RingBuffer.h"
+
+class SoftwareOcclusion;
+
+// std430 per-draw data, indexed by aDrawID in shaders/phong_indirect.vert
+struct MeshInstance
+{
+    float model[16];
+    float normalMatrix[12];     // mat3 in std430: columns padded to vec4
+    float tint[4];
+};
+
+static_assert(sizeof(MeshInstance) == 128, "std430 MeshInstance");
+
+const unsigned int kMeshInstanceBinding = 0; // shader storage binding
+
+// Unit superellipsoid (e1 = e2 = 1 is a sphere), rings x segments quads.
+// Replaces the contents of verts/idx.
+void BuildSuperellipsoid(int rings, int segments, float e1, float e2,
+    std::vector<MeshVertex>& verts, std::vector<GLuint>& idx);
+
+// ------------------------------------------------------------
+// --meshes N: N distinct, procedurally generated meshes on a grid behind
+// the bird, all in one MeshBatch. Every frame builds one indirect command
+// per mesh and submits them with a single glMultiDrawElementsIndirect
+// (or, with --no-mdi, one glDrawElementsIndirect per mesh for comparison).
+// ------------------------------------------------------------
+class MeshScene
+{
+public:
+    MeshScene() : instanceBuffer(0), drawCount(0) {}
+
+    void Create(int meshCount);
+    void Destroy();
+
+    // Tests every mesh's box against the rasterized occluders; the hidden
+    // ones are left out of the following WriteCommands(). Returns how many.
+    int CullOccluded(const SoftwareOcclusion& occlusion);
+
+    // One indirect command per mesh, allocated from the current frame of
+    // commandRing (a GL_DRAW_INDIRECT_BUFFER ring the caller begins, commits
+    // and ends). allMeshes ignores CullOccluded(), for shadow casters.
+    // Empty if nothing is left to draw or the frame is full.
+    RingBuffer::Allocation WriteCommands(RingBuffer& commandRing, bool allMeshes);
+
+    // Expects the indirect-draw program to be bound and commandRing
+    // committed; commands come from WriteCommands() this frame. Without
+    // multiDraw each one goes out as its own glDrawElementsIndirect.
+    void Draw(const RingBuffer& commandRing, const RingBuffer::Allocation& commands, bool multiDraw);
+
+    // World-space box around every mesh
+    void GetBounds(float min[3], float max[3]) const;
+
+    int GetDrawCount() const { return drawCount; }
+    size_t GetTriangleCount() const { return batch.GetIndexCount() / 3; }
+
+private:
+    MeshBatch batch;
+    GLuint instanceBuffer;
+    int drawCount;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<float> bounds;          // world-space box per mesh: min xyz, max xyz
+    std::vector<unsigned char> visible; // from the last CullOccluded()
+};
@@ -0,0 +1,134 @@
+#include "NormalMatrix.h"
+#include <cmath>
+#include <immintrin.h>
+
+namespace
+{
+    // (a.yzx * b.zxy - a.zxy * b.yzx); w ends up 0 for w = 0 inputs
+    inline __m128 Cross(__m128 a, __m128 b)
+    {
+        const __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+        const __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+        const __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+        return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+    }
+
+    inline float Dot3(__m128 a, __m128 b)
+    {
+        const __m128 m = _mm_mul_ps(a, b);
+        return _mm_cvtss_f32(m) + _mm_cvtss_f32(_mm_shuffle_ps(m, m, 1)) + _mm_cvtss_f32(_mm_shuffle_ps(m, m, 2));
+    }
+
+    // SoA: component k of column c for 4 matrices
+    struct Columns4
+    {
+        __m128 c[3][3];
+    };
+
+    // column col of 4 matrices, transposed so lane i belongs to matrix i
+    inline Columns4 Load4(const float* models, size_t stride)
+    {
+        Columns4 m;
+        for (int col = 0; col < 3; ++col)
+        {
+            __m128 r0 = _mm_loadu_ps(models + col * 4);
+            __m128 r1 = _mm_loadu_ps(models + stride + col * 4);
+            __m128 r2 = _mm_loadu_ps(models + 2 * stride + col * 4);
+            __m128 r3 = _mm_loadu_ps(models + 3 * stride + col * 4);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            m.c[col][0] = r0;
+            m.c[col][1] = r1;
+            m.c[col][2] = r2;
+        }
+        return m;
+    }
+
+    inline void Store4(const Columns4& n, float* out, size_t stride)
+    {
+        for (int col = 0; col < 3; ++col)
+        {
+            __m128 r0 = n.c[col][0], r1 = n.c[col][1], r2 = n.c[col][2], r3 = _mm_setzero_ps();
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(out + col * 4, r0);
+            _mm_storeu_ps(out + stride + col * 4, r1);
+            _mm_storeu_ps(out + 2 * stride + col * 4, r2);
+            _mm_storeu_ps(out + 3 * stride + col * 4, r3);
+        }
+    }
+
+    inline void Cross4(const __m128 a[3], const __m128 b[3], __m128 out[3])
+    {
+        out[0] = _mm_sub_ps(_mm_mul_ps(a[1], b[2]), _mm_mul_ps(a[2], b[1]));
+        out[1] = _mm_sub_ps(_mm_mul_ps(a[2], b[0]), _mm_mul_ps(a[0], b[2]));
+        out[2] = _mm_sub_ps(_mm_mul_ps(a[0], b[1]), _mm_mul_ps(a[1], b[0]));
+    }
+
+    inline __m128 Dot4(const __m128 a[3], const __m128 b[3])
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])), _mm_mul_ps(a[2], b[2]));
+    }
+}
+
+void ComputeNormalMatrix(const float model[16], float out[12])
+{
+    // w of the first three columns is 0 for any affine model matrix
+    const __m128 c0 = _mm_loadu_ps(model);
+    const __m128 c1 = _mm_loadu_ps(model + 4);
+    const __m128 c2 = _mm_loadu_ps(model + 8);
+
+    // orthogonal columns of equal length: the 3x3 / s^2
+    const float s0 = Dot3(c0, c0), s1 = Dot3(c1, c1), s2 = Dot3(c2, c2);
+    const float tolerance = 1e-5f * s0;
+    if (fabsf(s1 - s0) <= tolerance && fabsf(s2 - s0) <= tolerance &&
+        fabsf(Dot3(c0, c1)) <= tolerance && fabsf(Dot3(c1, c2)) <= tolerance && fabsf(Dot3(c2, c0)) <= tolerance &&
+        s0 > 0.0f)
+    {
+        const __m128 inv = _mm_set1_ps(1.0f / s0);
+        _mm_storeu_ps(out, _mm_mul_ps(c0, inv));
+        _mm_storeu_ps(out + 4, _mm_mul_ps(c1, inv));
+        _mm_storeu_ps(out + 8, _mm_mul_ps(c2, inv));
+        out[3] = out[7] = out[11] = 0.0f;
+        return;
+    }
+
+    const __m128 n0 = Cross(c1, c2);
+    const __m128 n1 = Cross(c2, c0);
+    const __m128 n2 = Cross(c0, c1);
+    const float det = Dot3(c0, n0);
+    const __m128 inv = _mm_set1_ps(det != 0.0f ? 1.0f / det : 0.0f);
+    _mm_storeu_ps(out, _mm_mul_ps(n0, inv));
+    _mm_storeu_ps(out + 4, _mm_mul_ps(n1, inv));
+    _mm_storeu_ps(out + 8, _mm_mul_ps(n2, inv));
+    out[3] = out[7] = out[11] = 0.0f;
+}
+
+void ComputeNormalMatrices(const float* models, size_t modelStride, float* out, size_t outStride,
+    size_t count, bool uniformScale)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const Columns4 m = Load4(models + i * modelStride, modelStride);
+        Columns4 n;
+        __m128 inv;
+        if (uniformScale)
+        {
+            n = m;
+            inv = _mm_div_ps(_mm_set1_ps(1.0f), Dot4(m.c[0], m.c[0]));
+        }
+        else
+        {
+            Cross4(m.c[1], m.c[2], n.c[0]);
+            Cross4(m.c[2], m.c[0], n.c[1]);
+            Cross4(m.c[0], m.c[1], n.c[2]);
+            inv = _mm_div_ps(_mm_set1_ps(1.0f), Dot4(m.c[0], n.c[0]));
+        }
+        for (int col = 0; col < 3; ++col)
+            for (int k = 0; k < 3; ++k)
+                n.c[col][k] = _mm_mul_ps(n.c[col][k], inv);
+        Store4(n, out + i * outStride, outStride);
+    }
+
+    for (; i < count; ++i)
+        ComputeNormalMatrix(models + i * modelStride, out + i * outStride);
+}
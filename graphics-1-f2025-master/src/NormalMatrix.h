@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+
+// ------------------------------------------------------------
+// Normal matrices, computed on the CPU once per object instead of
+// mat3(transpose(inverse(model))) for every vertex. Written as a GLSL mat3
+// in std140 / std430: three columns, each padded to a vec4 (12 floats).
+//
+// The inverse transpose of the upper 3x3 with columns c0, c1, c2 is
+//
+//   [c1 x c2, c2 x c0, c0 x c1] / det,   det = c0 . (c1 x c2)
+//
+// For rotation + uniform scale s it reduces to the 3x3 itself / s^2.
+// ------------------------------------------------------------
+
+// Picks the rotation + uniform-scale shortcut when the columns allow it.
+void ComputeNormalMatrix(const float model[16], float out[12]);
+
+// count matrices at once, 4 per SSE step: models and out advance by their
+// stride in floats. uniformScale promises every model is rotation +
+// uniform scale (+ translation), skipping the general inverse.
+void ComputeNormalMatrices(const float* models, size_t modelStride, float* out, size_t outStride,
+    size_t count, bool uniformScale);
@@ -0,0 +1,212 @@
+#include "ObjLoader.h"
+#include "JobSystem.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+using namespace std;
+using Vec3 = cx::Vec3;
+
+// ------------------------------------------------------------
+// Very small OBJ loader for v/vt/vn/f (triangles)
+// The file is split into line-aligned chunks that are parsed on the
+// job system, then stitched back together in file order (indices in
+// "f" lines are absolute, so order is all that matters).
+// ------------------------------------------------------------
+static void ParseOBJChunk(const string& text, size_t begin, size_t end, ObjData& out)
+{
+    istringstream chunk(text.substr(begin, end - begin));
+
+    string line;
+    while (getline(chunk, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        istringstream iss(line);
+        string type;
+        iss >> type;
+
+        if (type == "v")
+        {
+            Vec3 p;
+            iss >> p.x >> p.y >> p.z;
+            out.positions.push_back(p);
+        }
+        else if (type == "vt")
+        {
+            Vec2 t;
+            iss >> t.x >> t.y;
+            out.tcoords.push_back(t);
+        }
+        else if (type == "vn")
+        {
+            Vec3 n;
+            iss >> n.x >> n.y >> n.z;
+            out.normals.push_back(n);
+        }
+        else if (type == "f")
+        {
+            Face f = {};
+
+            for (int i = 0; i < 3; ++i)
+            {
+                string token;
+                iss >> token; // e.g. "2/1/1"
+                if (token.empty())
+                    break;
+
+                size_t s1 = token.find('/');
+                size_t s2 = token.find('/', s1 + 1);
+
+                int vi = 0;
+                int vti = 0;
+                int vni = 0;
+
+                if (s1 == string::npos)
+                {
+                    // Only vertex index present
+                    vi = stoi(token);
+                }
+                else
+                {
+                    string vStr = token.substr(0, s1);
+                    string vtStr;
+                    string vnStr;
+
+                    if (s2 == string::npos)
+                    {
+                        // "v/vt"
+                        vtStr = token.substr(s1 + 1);
+                    }
+                    else
+                    {
+                        // "v/vt/vn"
+                        vtStr = token.substr(s1 + 1, s2 - (s1 + 1));
+                        vnStr = token.substr(s2 + 1);
+                    }
+
+                    if (!vStr.empty())  vi = stoi(vStr);
+                    if (!vtStr.empty()) vti = stoi(vtStr);
+                    if (!vnStr.empty()) vni = stoi(vnStr);
+                }
+
+                f.v[i] = vi;
+                f.vt[i] = vti;
+                f.vn[i] = vni;
+            }
+
+            out.faces.push_back(f);
+        }
+    }
+}
+
+bool LoadOBJ(const string& path, ObjData& out)
+{
+    ifstream file(path);
+    if (!file.is_open())
+    {
+        cerr << "Failed to open OBJ file: " << path << "\n";
+        return false;
+    }
+
+    string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    const size_t chunkBytes = 256 * 1024;
+    vector<size_t> starts(1, 0);
+    while (starts.back() + chunkBytes < text.size())
+    {
+        size_t nl = text.find('\n', starts.back() + chunkBytes);
+        if (nl == string::npos)
+            break;
+        starts.push_back(nl + 1);
+    }
+
+    vector<ObjData> parts(starts.size());
+    ParallelFor(starts.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t c = begin; c < end; ++c)
+        {
+            size_t chunkEnd = c + 1 < starts.size() ? starts[c + 1] : text.size();
+            ParseOBJChunk(text, starts[c], chunkEnd, parts[c]);
+        }
+    });
+
+    out.positions.clear();
+    out.tcoords.clear();
+    out.normals.clear();
+    out.faces.clear();
+
+    for (const ObjData& part : parts)
+    {
+        out.positions.insert(out.positions.end(), part.positions.begin(), part.positions.end());
+        out.tcoords.insert(out.tcoords.end(), part.tcoords.begin(), part.tcoords.end());
+        out.normals.insert(out.normals.end(), part.normals.begin(), part.normals.end());
+        out.faces.insert(out.faces.end(), part.faces.begin(), part.faces.end());
+    }
+
+    cout << "Loaded OBJ: " << path << "\n";
+    cout << "  positions: " << out.positions.size() << "\n";
+    cout << "  tcoords:   " << out.tcoords.size() << "\n";
+    cout << "  normals:   " << out.normals.size() << "\n";
+    cout << "  faces:     " << out.faces.size() << "\n";
+
+    return true;
+}
+
+// ------------------------------------------------------------
+// Convert OBJ data (indexed) to flat OpenGL vertices
+// (includes a scale factor to make the Bird bigger)
+// ------------------------------------------------------------
+vector<Vertex> BuildVerticesFromObj(const ObjData& obj)
+{
+    vector<Vertex> verts(obj.faces.size() * 3);
+
+    const float scale = 2.5f;   // <--- tweak this if Bird is too small/big
+
+    // every face writes its own 3 vertices, so chunks can run on any worker
+    ParallelFor(obj.faces.size(), 2048, [&](size_t begin, size_t end)
+    {
+        for (size_t fi = begin; fi < end; ++fi)
+        {
+            const Face& f = obj.faces[fi];
+            for (int i = 0; i < 3; ++i)
+            {
+                int vi = f.v[i] - 1; // OBJ indices start at 1
+                int vti = f.vt[i] - 1;
+                int vni = f.vn[i] - 1;
+
+                Vertex v = {};
+
+                if (vi >= 0 && vi < (int)obj.positions.size())
+                {
+                    Vec3 p = obj.positions[vi];
+                    p.x *= scale;
+                    p.y *= scale;
+                    p.z *= scale;
+                    v.position = p;
+                }
+                else
+                {
+                    v.position = { 0.f, 0.f, 0.f };
+                }
+
+                if (vti >= 0 && vti < (int)obj.tcoords.size())
+                    v.uv = obj.tcoords[vti];
+                else
+                    v.uv = { 0.f, 0.f };
+
+                if (vni >= 0 && vni < (int)obj.normals.size())
+                    v.normal = obj.normals[vni];
+                else
+                    v.normal = { 0.f, 0.f, 1.f };
+
+                verts[fi * 3 + i] = v;
+            }
+        }
+    });
+
+    cout << "Built " << verts.size() << " vertices from OBJ.\n";
+    return verts;
+}
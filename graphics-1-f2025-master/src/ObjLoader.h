@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "ConstexprMath.h"
+
+// ------------------------------------------------------------
+// Simple math/OBJ data structures (from Assignment 3)
+// ------------------------------------------------------------
+
+struct Vec2
+{
+    float x, y;
+};
+
+struct Face
+{
+    int v[3];   // position indices
+    int vt[3];  // texcoord indices
+    int vn[3];  // normal indices
+};
+
+struct ObjData
+{
+    std::vector<cx::Vec3> positions; // "v"  lines
+    std::vector<Vec2> tcoords;       // "vt" lines
+    std::vector<cx::Vec3> normals;   // "vn" lines
+    std::vector<Face> faces;         // "f"  lines
+};
+
+struct Vertex
+{
+    cx::Vec3 position;
+    Vec2 uv;
+    cx::Vec3 normal;
+};
+
+// Very small OBJ loader for v/vt/vn/f (triangles), parsed on the job
+// system. No GL, so the benchmarks can load the model too.
+bool LoadOBJ(const std::string& path, ObjData& out);
+
+// Flat vertices, three per face, with the bird's scale applied
+std::vector<Vertex> BuildVerticesFromObj(const ObjData& obj);
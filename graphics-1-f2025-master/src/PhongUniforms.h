@@ -0,0 +1,34 @@
+#pragma once
+#include "UniformSchema.h"
+
+// ------------------------------------------------------------
+// Uniforms of shaders/phong.vert + phong.frag. The index of each entry is
+// its location; struct members follow the GLSL struct's member order.
+// Camera, lights and per-draw data come from the blocks in FrameUniforms.h;
+// the shadow maps' matrices from ShadowBlock (src/ShadowMaps.h).
+// ------------------------------------------------------------
+constexpr UniformDecl kPhongUniformDecls[] = {
+    { "uDiffuseMap",            GL_SAMPLER_2D, nullptr, kFragmentStage },
+    { "uDirShadowMap",          GL_SAMPLER_2D_SHADOW, nullptr, kFragmentStage },
+    { "uSpotShadowMap",         GL_SAMPLER_2D_SHADOW, nullptr, kFragmentStage },
+};
+
+static_assert(SchemaIsValid(kPhongUniformDecls), "duplicate uniform or split struct in kPhongUniformDecls");
+
+// Variant key bits of phong.frag, phong_clustered.frag and gbuffer.frag
+// (src/ShaderVariants.h)
+enum PhongFeature : unsigned
+{
+    kPhongTexture = 1,          // HAS_TEXTURE: uUseTexture as a constant
+    kPhongLighting = 2,         // HAS_LIGHTING: uUseLighting as a constant
+    kPhongStaticLights = 4,     // STATIC_DIR_LIGHT / STATIC_SPOT_LIGHT: LightBlock values compiled in
+    kPhongShadows = 8,          // HAS_SHADOWS: dirLight and spotLight through ShadowMaps (phong.frag only)
+};
+
+// Handles, checked against the schema at compile time
+namespace Phong
+{
+    constexpr UniformInt diffuseMap = SchemaHandle<UniformInt>(kPhongUniformDecls, "uDiffuseMap");
+    constexpr UniformInt dirShadowMap = SchemaHandle<UniformInt>(kPhongUniformDecls, "uDirShadowMap");
+    constexpr UniformInt spotShadowMap = SchemaHandle<UniformInt>(kPhongUniformDecls, "uSpotShadowMap");
+}
@@ -0,0 +1,127 @@
+#include "Profile.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Span
+    {
+        std::string name;
+        std::vector<std::string> deps;
+        double start;
+        double end;
+        int thread;
+    };
+
+    std::mutex gSpanLock;
+    std::vector<Span> gSpans;
+    std::atomic<int> gNextThread{ 0 };
+    thread_local int tThreadIndex = -1;
+
+    int ThreadIndex()
+    {
+        if (tThreadIndex < 0)
+            tThreadIndex = gNextThread.fetch_add(1);
+        return tThreadIndex;
+    }
+
+    const Span* FindSpan(const std::string& name)
+    {
+        for (const Span& s : gSpans)
+            if (s.name == name)
+                return &s;
+        return nullptr;
+    }
+}
+
+double ProfileNow()
+{
+    using namespace std::chrono;
+    static const steady_clock::time_point origin = steady_clock::now();
+    return duration<double>(steady_clock::now() - origin).count();
+}
+
+void RecordSpan(const char* name, double start, double end, std::initializer_list<const char*> deps)
+{
+    Span s;
+    s.name = name;
+    for (const char* d : deps)
+        s.deps.push_back(d);
+    s.start = start;
+    s.end = end;
+    s.thread = ThreadIndex();
+
+    std::lock_guard<std::mutex> guard(gSpanLock);
+    gSpans.push_back(s);
+}
+
+ScopedSpan::ScopedSpan(const char* name_, std::initializer_list<const char*> deps_)
+    : name(name_), depCount(0), start(ProfileNow())
+{
+    for (const char* d : deps_)
+        if (depCount < 4)
+            deps[depCount++] = d;
+}
+
+ScopedSpan::~ScopedSpan()
+{
+    double end = ProfileNow();
+    Span s;
+    s.name = name;
+    for (int i = 0; i < depCount; ++i)
+        s.deps.push_back(deps[i]);
+    s.start = start;
+    s.end = end;
+    s.thread = ThreadIndex();
+
+    std::lock_guard<std::mutex> guard(gSpanLock);
+    gSpans.push_back(s);
+}
+
+void PrintStartupReport(const char* lastSpan)
+{
+    std::lock_guard<std::mutex> guard(gSpanLock);
+
+    std::vector<Span> sorted = gSpans;
+    std::sort(sorted.begin(), sorted.end(),
+        [](const Span& a, const Span& b) { return a.start < b.start; });
+
+    printf("Startup timeline (ms):\n");
+    for (const Span& s : sorted)
+    {
+        printf("  [T%d] %-22s %8.2f -> %8.2f  (%7.2f)\n",
+            s.thread, s.name.c_str(), s.start * 1e3, s.end * 1e3, (s.end - s.start) * 1e3);
+    }
+
+    // Walk back from the last span, always following the dependency that
+    // finished latest: that is the one that actually held things up.
+    std::vector<const Span*> path;
+    const Span* cur = FindSpan(lastSpan);
+    while (cur)
+    {
+        path.push_back(cur);
+        const Span* next = nullptr;
+        for (const std::string& d : cur->deps)
+        {
+            const Span* dep = FindSpan(d);
+            if (dep && (!next || dep->end > next->end))
+                next = dep;
+        }
+        cur = next;
+    }
+
+    if (path.empty())
+        return;
+
+    printf("Critical path:");
+    for (size_t i = path.size(); i-- > 0;)
+        printf(" %s (%.2f ms)%s", path[i]->name.c_str(),
+            (path[i]->end - path[i]->start) * 1e3, i ? " ->" : "\n");
+    printf("Time to first frame: %.2f ms\n", path[0]->end * 1e3);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <initializer_list>
+
+// Seconds since the first call (program start, in practice).
+double ProfileNow();
+
+// Records a named span of work. deps names the spans that had to finish
+// before this one could start; they are used to walk the critical path.
+void RecordSpan(const char* name, double start, double end,
+    std::initializer_list<const char*> deps = {});
+
+class ScopedSpan
+{
+public:
+    ScopedSpan(const char* name, std::initializer_list<const char*> deps = {});
+    ~ScopedSpan();
+
+private:
+    const char* name;
+    const char* deps[4];
+    int depCount;
+    double start;
+};
+
+// Prints every recorded span plus the critical path that ends at lastSpan.
+void PrintStartupReport(const char* lastSpan);
@@ -0,0 +1,165 @@
+#include "RingBuffer.h"
+#include "GLExtensions.h"
+#include "GLStats.h"
+#include "GLState.h"
+#include "Profile.h"
+#include <iostream>
+
+namespace
+{
+    size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    size_t OffsetAlignment(GLenum target)
+    {
+        GLint alignment = 256;
+        if (target == GL_UNIFORM_BUFFER)
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        else if (target == GL_SHADER_STORAGE_BUFFER)
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        return alignment > 0 ? (size_t)alignment : 256;
+    }
+}
+
+bool RingBuffer::Create(GLenum target_, size_t bytesPerFrame, int framesInFlight)
+{
+    target = target_;
+    alignment = OffsetAlignment(target);
+    regionSize = AlignUp(bytesPerFrame, alignment);
+    frames = framesInFlight < 1 ? 1 : (framesInFlight > kMaxFrames ? kMaxFrames : framesInFlight);
+    frame = frames - 1; // the first BeginFrame() moves to region 0
+    head = 0;
+
+    const GLsizeiptr total = (GLsizeiptr)(regionSize * frames);
+    glGenBuffers(1, &buffer);
+    gGLState.BindBuffer(target, buffer);
+
+    persistent = gGLExt.bufferStorage;
+    if (persistent)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        gGLExt.BufferStorage(target, total, nullptr, flags);
+        mapped = (unsigned char*)glMapBufferRange(target, 0, total, flags);
+        if (!mapped)
+        {
+            std::cerr << "RingBuffer: persistent map failed, falling back to per-frame maps\n";
+            glDeleteBuffers(1, &buffer);
+            gGLState.Invalidate();
+            glGenBuffers(1, &buffer);
+            gGLState.BindBuffer(target, buffer);
+            persistent = false;
+        }
+    }
+    if (!persistent)
+        glBufferData(target, total, nullptr, GL_STREAM_DRAW);
+
+    return buffer != 0;
+}
+
+void RingBuffer::Destroy()
+{
+    for (GLsync& f : fences)
+    {
+        if (f)
+            glDeleteSync(f);
+        f = nullptr;
+    }
+    if (buffer)
+    {
+        if (mapped)
+        {
+            gGLState.BindBuffer(target, buffer);
+            glUnmapBuffer(target);
+        }
+        glDeleteBuffers(1, &buffer);
+        gGLState.Invalidate();
+    }
+    buffer = 0;
+    mapped = nullptr;
+}
+
+void RingBuffer::BeginFrame()
+{
+    frame = (frame + 1) % frames;
+    head = 0;
+
+    GLsync& fence = fences[frame];
+    if (fence)
+    {
+        // normally signaled long ago: check without flushing or blocking first
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            double start = ProfileNow();
+            do
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+            while (status == GL_TIMEOUT_EXPIRED);
+            gFrameStats.fenceWaits++;
+            gFrameStats.fenceWaitMs += (ProfileNow() - start) * 1e3;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    if (!persistent)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+            GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
+        gGLState.BindBuffer(target, buffer);
+        mapped = (unsigned char*)glMapBufferRange(target, frame * regionSize, regionSize, flags);
+    }
+}
+
+RingBuffer::Allocation RingBuffer::Alloc(size_t bytes)
+{
+    Allocation a;
+    size_t start = AlignUp(head, alignment);
+    if (!mapped)
+        return a;
+    if (start + bytes > regionSize)
+    {
+        if (!overflowLogged)
+        {
+            std::cerr << "RingBuffer: a frame needs more than " << regionSize
+                << " bytes; draws that do not fit are skipped\n";
+            overflowLogged = true;
+        }
+        return a;
+    }
+
+    head = start + bytes;
+    a.offset = (GLintptr)(frame * regionSize + start);
+    a.size = (GLsizeiptr)bytes;
+    // the persistent mapping covers the whole buffer, a per-frame map only this region
+    a.ptr = mapped + (persistent ? a.offset : (GLintptr)start);
+    return a;
+}
+
+void RingBuffer::Commit()
+{
+    if (persistent || !mapped)
+        return; // coherent mapping: writes are visible to the next draw
+
+    gGLState.BindBuffer(target, buffer);
+    if (head)
+        glFlushMappedBufferRange(target, 0, head);
+    glUnmapBuffer(target);
+    mapped = nullptr;
+}
+
+void RingBuffer::EndFrame()
+{
+    Commit();
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool RingBuffer::BindRange(GLuint index, const Allocation& a) const
+{
+    // a zero-sized range is GL_INVALID_VALUE
+    if (!a.size)
+        return false;
+    gGLState.BindBufferRange(target, index, buffer, a.offset, a.size);
+    return true;
+}
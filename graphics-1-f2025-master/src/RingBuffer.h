@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <glad/glad.h>
+
+// ------------------------------------------------------------
+// Streaming buffer for data rewritten every frame (per-draw uniforms etc.).
+//
+// One buffer split into framesInFlight regions. Each frame bump-allocates
+// from the next region; a fence placed at EndFrame() guards the region
+// until the GPU is done with it, so the CPU only ever waits when it gets
+// more than framesInFlight frames ahead.
+//
+// With GL 4.4 / ARB_buffer_storage the buffer stays persistently mapped.
+// Otherwise each frame maps its region with GL_MAP_UNSYNCHRONIZED_BIT
+// (the fences do the synchronization) and unmaps it in Commit().
+// ------------------------------------------------------------
+class RingBuffer
+{
+public:
+    struct Allocation
+    {
+        void* ptr = nullptr;    // write here before Commit()
+        GLintptr offset = 0;    // for glBindBufferRange
+        GLsizeiptr size = 0;
+    };
+
+    RingBuffer() : buffer(0), target(0), regionSize(0), alignment(1), frames(0), frame(0),
+        head(0), mapped(nullptr), persistent(false), overflowLogged(false) {}
+
+    // target is what the ranges get bound as (GL_UNIFORM_BUFFER, ...).
+    bool Create(GLenum target, size_t bytesPerFrame, int framesInFlight = 3);
+    void Destroy();
+
+    // Waits (if it must) for the GPU to release the next region and makes it current.
+    void BeginFrame();
+
+    // Bump allocation, aligned for glBindBufferRange on the buffer's target.
+    // Once the frame's region is full it returns an empty Allocation (size 0,
+    // ptr == nullptr) and logs the first time; skip the draws that needed it.
+    Allocation Alloc(size_t bytes);
+
+    // Writes are done; call before the first draw that reads them.
+    void Commit();
+
+    // Call after the frame's last draw that reads from the buffer.
+    void EndFrame();
+
+    // Binds nothing and returns false for an empty Allocation
+    bool BindRange(GLuint index, const Allocation& a) const;
+
+    GLuint GetID() const { return buffer; }
+    bool IsPersistent() const { return persistent; }
+
+private:
+    static const int kMaxFrames = 4;
+
+    GLuint buffer;
+    GLenum target;
+    size_t regionSize;
+    size_t alignment;
+    int frames;
+    int frame;          // current region
+    size_t head;        // bytes used in the current region
+    unsigned char* mapped;
+    bool persistent;
+    bool overflowLogged;
+    GLsync fences[kMaxFrames] = {};
+};
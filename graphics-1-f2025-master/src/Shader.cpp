@@ -1,13 +1,182 @@
 #include "Shader.h"
-#include "Shader.h"
+#include "GLExtensions.h"
+#include "FileWatcher.h"
+#include "Profile.h"
+#include "GLStats.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include <vector>
 #include <iostream>
 
-bool Shader::CompileShader(GLuint shader, const char* src, std::string& errorOut)
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// ------------------------------------------------------------
+// Program binary cache
+// ------------------------------------------------------------
+namespace
+{
+    std::string gCacheDir = "shader_cache";
+
+    const unsigned int kCacheVersion = 1;
+
+    struct BinaryCacheHeader
+    {
+        char magic[4];              // "SPBC"
+        unsigned int version;
+        unsigned long long key;     // must match the file name
+        unsigned int format;        // from glGetProgramBinary
+        unsigned int length;
+        unsigned long long checksum;
+    };
+
+    // FNV-1a, 64 bit
+    unsigned long long HashBytes(const void* data, size_t size, unsigned long long h = 14695981039346656037ull)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    unsigned long long HashString(const char* s, unsigned long long h)
+    {
+        // include the terminator so "ab"+"c" and "a"+"bc" differ
+        return HashBytes(s ? s : "", (s ? strlen(s) : 0) + 1, h);
+    }
+
+    std::string CachePath(unsigned long long key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", key);
+        return gCacheDir + "/" + name;
+    }
+
+    bool ReadTextFile(const std::string& path, std::string& out)
+    {
+        std::ifstream file(path);
+        if (!file.is_open())
+            return false;
+        std::stringstream ss;
+        ss << file.rdbuf();
+        out = ss.str();
+        return true;
+    }
+
+    void MakeCacheDir()
+    {
+#ifdef _WIN32
+        _mkdir(gCacheDir.c_str());
+#else
+        mkdir(gCacheDir.c_str(), 0755);
+#endif
+    }
+}
+
+void Shader::SetBinaryCacheDir(const std::string& dir)
 {
-    glShaderSource(shader, 1, &src, nullptr);
-    glCompileShader(shader);
+    gCacheDir = dir;
+}
+
+bool Shader::LoadCachedBinary(Build& build)
+{
+    const std::string path = CachePath(build.cacheKey);
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        return false;
+    const std::streamoff fileSize = in.tellg();
+    in.seekg(0);
+
+    const char* reason = nullptr;
+    BinaryCacheHeader header = {};
+    std::vector<char> data;
 
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || memcmp(header.magic, "SPBC", 4) != 0 || header.version != kCacheVersion)
+        reason = "bad header";
+    else if (header.key != build.cacheKey)
+        reason = "key mismatch";
+    else if (fileSize < 0 || (unsigned long long)fileSize - sizeof(header) != header.length)
+        reason = "length does not match the file";
+    else
+    {
+        data.resize(header.length);
+        in.read(data.data(), header.length);
+        if (!in || HashBytes(data.data(), data.size()) != header.checksum)
+            reason = "truncated or corrupt";
+    }
+
+    if (!reason)
+    {
+        GLuint prog = glCreateProgram();
+        glProgramBinary(prog, header.format, data.data(), (GLsizei)data.size());
+
+        // the driver rejects binaries from another driver build or GPU
+        GLint success = 0;
+        glGetProgramiv(prog, GL_LINK_STATUS, &success);
+        if (success)
+        {
+            build.program = prog;
+            return true;
+        }
+        glDeleteProgram(prog);
+        reason = "rejected by driver";
+    }
+
+    in.close();
+    std::remove(path.c_str());
+    std::cout << "Shader cache: discarded " << path << " (" << reason << "), recompiling\n";
+    return false;
+}
+
+void Shader::SaveCachedBinary(const Build& build)
+{
+    GLint length = 0;
+    glGetProgramiv(build.program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> data(length);
+    GLenum format = 0;
+    glGetProgramBinary(build.program, length, nullptr, &format, data.data());
+
+    BinaryCacheHeader header = {};
+    memcpy(header.magic, "SPBC", 4);
+    header.version = kCacheVersion;
+    header.key = build.cacheKey;
+    header.format = format;
+    header.length = (unsigned int)length;
+    header.checksum = HashBytes(data.data(), data.size());
+
+    // write to a temp file first so a crash never leaves a half-written entry
+    MakeCacheDir();
+    const std::string path = CachePath(build.cacheKey);
+    const std::string tmpPath = path + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(data.data(), data.size());
+    out.close();
+    if (!out)
+    {
+        std::remove(tmpPath.c_str());
+        return;
+    }
+    std::remove(path.c_str());
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+        std::remove(tmpPath.c_str());
+}
+
+bool Shader::CheckShader(GLuint shader, std::string& errorOut)
+{
     GLint success = 0;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if (!success)
@@ -22,48 +191,529 @@ bool Shader::CompileShader(GLuint shader, const char* src, std::string& errorOut
     return true;
 }
 
+void Shader::StartBuild(Build& build, const char* vertexSrc, const char* fragmentSrc)
+{
+    build = Build();
+
+    // let the driver use as many compiler threads as it likes
+    static bool threadsSet = false;
+    if (gGLExt.parallelShaderCompile && !threadsSet)
+    {
+        gGLExt.MaxShaderCompilerThreads(0xFFFFFFFFu);
+        threadsSet = true;
+    }
+
+    GLint binaryFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+    if (!gCacheDir.empty() && binaryFormats > 0)
+    {
+        // a driver update changes these strings and so invalidates the cache
+        unsigned long long key = HashString(vertexSrc, 14695981039346656037ull);
+        key = HashString(fragmentSrc ? fragmentSrc : "", key);
+        key = HashString((const char*)glGetString(GL_VENDOR), key);
+        key = HashString((const char*)glGetString(GL_RENDERER), key);
+        key = HashString((const char*)glGetString(GL_VERSION), key);
+        build.cacheKey = key;
+
+        if (LoadCachedBinary(build))
+        {
+            build.fromCache = true;
+            return;
+        }
+    }
+
+    // no fragment source: vertexSrc is a compute shader
+    build.vs = glCreateShader(fragmentSrc ? GL_VERTEX_SHADER : GL_COMPUTE_SHADER);
+    glShaderSource(build.vs, 1, &vertexSrc, nullptr);
+    glCompileShader(build.vs);
+
+    if (fragmentSrc)
+    {
+        build.fs = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(build.fs, 1, &fragmentSrc, nullptr);
+        glCompileShader(build.fs);
+    }
+
+    // linking a program whose shaders failed just fails the link;
+    // FinishBuild reports the compile log in that case
+    build.program = glCreateProgram();
+    if (build.cacheKey)
+        glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(build.program, build.vs);
+    if (build.fs)
+        glAttachShader(build.program, build.fs);
+    glLinkProgram(build.program);
+}
+
+bool Shader::BuildReady(const Build& build)
+{
+    if (!gGLExt.parallelShaderCompile || !build.program || build.fromCache)
+        return true;
+
+    GLint done = 0;
+    glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &done);
+    return done != 0;
+}
+
+bool Shader::FinishBuild(Build& build, std::string& errorOut)
+{
+    // already linked by glProgramBinary
+    if (build.fromCache)
+        return true;
+
+    bool ok = CheckShader(build.vs, errorOut) && (!build.fs || CheckShader(build.fs, errorOut));
+    if (ok)
+    {
+        GLint success = 0;
+        glGetProgramiv(build.program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            GLint logLen = 0;
+            glGetProgramiv(build.program, GL_INFO_LOG_LENGTH, &logLen);
+            std::vector<char> logBuf(logLen ? logLen : 1);
+            glGetProgramInfoLog(build.program, logLen, nullptr, logBuf.data());
+            errorOut = std::string(logBuf.data());
+            ok = false;
+        }
+    }
+
+    // shaders can be deleted after linking
+    glDetachShader(build.program, build.vs);
+    glDeleteShader(build.vs);
+    if (build.fs)
+    {
+        glDetachShader(build.program, build.fs);
+        glDeleteShader(build.fs);
+    }
+    build.vs = build.fs = 0;
+
+    if (!ok)
+    {
+        glDeleteProgram(build.program);
+        build.program = 0;
+    }
+    else if (build.cacheKey)
+    {
+        SaveCachedBinary(build);
+    }
+    return ok;
+}
+
+// ------------------------------------------------------------
+// Uniform reflection and shadowed uploads
+// ------------------------------------------------------------
+namespace
+{
+    const char* GLSLTypeName(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_FLOAT:          return "float";
+        case GL_FLOAT_VEC2:     return "vec2";
+        case GL_FLOAT_VEC3:     return "vec3";
+        case GL_FLOAT_VEC4:     return "vec4";
+        case GL_FLOAT_MAT3:     return "mat3";
+        case GL_FLOAT_MAT4:     return "mat4";
+        case GL_INT:            return "int";
+        case GL_UNSIGNED_INT:   return "uint";
+        case GL_BOOL:           return "bool";
+        case GL_SAMPLER_2D:     return "sampler2D";
+        case GL_SAMPLER_2D_SHADOW: return "sampler2DShadow";
+        case GL_SAMPLER_CUBE:   return "samplerCube";
+        case GL_SAMPLER_3D:     return "sampler3D";
+        case GL_SAMPLER_2D_ARRAY: return "sampler2DArray";
+        case GL_UNSIGNED_INT_SAMPLER_2D: return "usampler2D";
+        }
+        return "float";
+    }
+}
+
+void Shader::SetUniformSchema(const UniformDecl* decls, int count)
+{
+    schema = decls;
+    schemaCount = count;
+
+    // slot i == schema entry i == location i, so SchemaHandle() indices line up
+    slots.clear();
+    slotLookup.clear();
+    for (int i = 0; i < count; ++i)
+    {
+        UniformSlot slot;
+        slot.name = decls[i].name;
+        slot.type = decls[i].type;
+        BindSlot(slot);
+        slots.push_back(slot);
+        slotLookup[slot.name] = i;
+    }
+}
+
+std::string Shader::PrepareSource(const char* src, UniformStage stage) const
+{
+    std::string text = src;
+    if (!defines.empty())
+    {
+        size_t eol = text.find('\n', text.find("#version"));
+        text.insert(eol == std::string::npos ? text.size() : eol + 1, defines);
+    }
+    if (!schema)
+        return text;
+
+    // one declaration per plain uniform, one per struct variable
+    std::string decls;
+    for (int i = 0; i < schemaCount; ++i)
+    {
+        const UniformDecl& d = schema[i];
+        if (!(d.stages & stage))
+            continue;
+
+        std::string name = d.name;
+        if (d.structType)
+        {
+            name = name.substr(0, StructPrefixLength(d.name));
+            if (i > 0 && schema[i - 1].structType && SamePrefix(schema[i - 1].name, d.name))
+                continue; // later member of a struct already declared
+        }
+
+        decls += "layout(location = " + std::to_string(i) + ") uniform " +
+            (d.structType ? d.structType : GLSLTypeName(d.type)) + " " + name + ";\n";
+    }
+
+    const std::string marker = "#pragma uniforms";
+    size_t at = text.find(marker);
+    if (at != std::string::npos)
+    {
+        text.replace(at, marker.size(), decls);
+    }
+    else
+    {
+        // no marker: right after the #version line
+        size_t eol = text.find('\n', text.find("#version"));
+        text.insert(eol == std::string::npos ? text.size() : eol + 1, decls);
+    }
+    return text;
+}
+
+bool Shader::ValidateSchema(GLuint program, std::string& errorOut) const
+{
+    for (int i = 0; i < schemaCount; ++i)
+    {
+        const char* name = schema[i].name;
+        GLint location = glGetUniformLocation(program, name);
+        if (location < 0)
+            continue; // declared but unused by the shader code: optimized out
+
+        GLuint index = GL_INVALID_INDEX;
+        GLint type = 0;
+        glGetUniformIndices(program, 1, &name, &index);
+        if (index != GL_INVALID_INDEX)
+            glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_TYPE, &type);
+
+        if (location != i || (GLenum)type != schema[i].type)
+        {
+            std::ostringstream msg;
+            msg << "Uniform schema mismatch for '" << name << "': expected location " << i
+                << " type 0x" << std::hex << schema[i].type << ", program has location "
+                << std::dec << location << " type 0x" << std::hex << type;
+            errorOut = msg.str();
+            return false;
+        }
+    }
+    return true;
+}
+
+void Shader::ReflectUniforms()
+{
+    activeUniforms.clear();
+    if (ID)
+    {
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        std::vector<char> name(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; ++i)
+        {
+            ActiveUniform u;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), nullptr, &u.size, &u.type, name.data());
+            u.location = glGetUniformLocation(ID, name.data());
+            if (u.location < 0)
+                continue; // lives in a uniform block
+
+            std::string key = name.data();
+            activeUniforms[key] = u;
+
+            // arrays are reported as "name[0]"; allow plain "name" too
+            size_t bracket = key.find("[0]");
+            if (bracket != std::string::npos && bracket + 3 == key.size())
+                activeUniforms[key.substr(0, bracket)] = u;
+        }
+    }
+
+    // new program, new locations; and it holds none of our shadowed values
+    for (UniformSlot& slot : slots)
+        BindSlot(slot);
+}
+
+void Shader::BindSlot(UniformSlot& slot)
+{
+    slot.location = -1;
+    slot.known = false;
+
+    auto it = activeUniforms.find(slot.name);
+    if (it == activeUniforms.end())
+        return; // not declared, or optimized out; Set() becomes a no-op
+
+    if (!HandleAccepts(slot.type, it->second.type) && slot.type != it->second.type)
+    {
+        std::cerr << "Shader: uniform '" << slot.name << "' has GL type 0x" << std::hex
+            << it->second.type << ", handle expects 0x" << slot.type << std::dec << "\n";
+        return;
+    }
+    slot.location = it->second.location;
+}
+
+int Shader::ResolveUniform(const char* name, GLenum type)
+{
+    auto it = slotLookup.find(name);
+    if (it != slotLookup.end())
+        return it->second;
+
+    UniformSlot slot;
+    slot.name = name;
+    slot.type = type;
+    BindSlot(slot);
+    if (slot.location < 0 && ID)
+        std::cout << "Shader: uniform '" << name << "' is not active in program " << ID << "\n";
+
+    slots.push_back(slot);
+    slotLookup[name] = (int)slots.size() - 1;
+    return (int)slots.size() - 1;
+}
+
+bool Shader::Unchanged(UniformSlot& slot, const void* value, size_t bytes)
+{
+    if (slot.location < 0)
+        return true;
+
+    if (slot.known && memcmp(slot.value, value, bytes) == 0)
+    {
+        gFrameStats.uniformsSkipped++;
+        return true;
+    }
+
+    memcpy(slot.value, value, bytes);
+    slot.known = true;
+    gFrameStats.uniformUploads++;
+    return false;
+}
+
+void Shader::Set(UniformInt u, int value)
+{
+    if (u.slot < 0)
+        return;
+    UniformSlot& slot = slots[u.slot];
+    if (!Unchanged(slot, &value, sizeof(value)))
+        glProgramUniform1i(ID, slot.location, value);
+}
+
+void Shader::Set(UniformFloat u, float value)
+{
+    if (u.slot < 0)
+        return;
+    UniformSlot& slot = slots[u.slot];
+    if (!Unchanged(slot, &value, sizeof(value)))
+        glProgramUniform1f(ID, slot.location, value);
+}
+
+void Shader::Set(UniformVec3 u, float x, float y, float z)
+{
+    if (u.slot < 0)
+        return;
+    const float v[3] = { x, y, z };
+    UniformSlot& slot = slots[u.slot];
+    if (!Unchanged(slot, v, sizeof(v)))
+        glProgramUniform3f(ID, slot.location, x, y, z);
+}
+
+void Shader::Set(UniformMat4 u, const float* m)
+{
+    if (u.slot < 0)
+        return;
+    UniformSlot& slot = slots[u.slot];
+    if (!Unchanged(slot, m, 16 * sizeof(float)))
+        glProgramUniformMatrix4fv(ID, slot.location, 1, GL_FALSE, m);
+}
+
 bool Shader::CreateFromSource(const char* vertexSrc, const char* fragmentSrc, std::string& errorOut)
 {
-    GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-    if (!CompileShader(vs, vertexSrc, errorOut))
+    BeginCreateFromSource(vertexSrc, fragmentSrc);
+    return FinishCreate(errorOut);
+}
+
+void Shader::BeginCreateFromSource(const char* vertexSrc, const char* fragmentSrc)
+{
+    std::string vs = PrepareSource(vertexSrc, kVertexStage);
+    std::string fs = PrepareSource(fragmentSrc, kFragmentStage);
+    StartBuild(pending, vs.c_str(), fs.c_str());
+}
+
+bool Shader::IsReady() const
+{
+    return BuildReady(pending);
+}
+
+bool Shader::FinishCreate(std::string& errorOut)
+{
+    bool ok = FinishBuild(pending, errorOut);
+    if (ok && !ValidateSchema(pending.program, errorOut))
     {
-        glDeleteShader(vs);
+        glDeleteProgram(pending.program);
+        pending.program = 0;
+        ok = false;
+    }
+    ID = pending.program;
+    fromCache = pending.fromCache;
+    pending = Build();
+    ReflectUniforms();
+    return ok;
+}
+
+bool Shader::BeginCreateFromFiles(const std::string& vertexFile, const std::string& fragmentFile, std::string& errorOut)
+{
+    std::string vertexSrc, fragmentSrc;
+    if (!ReadTextFile(vertexFile, vertexSrc))
+    {
+        errorOut = "Could not read " + vertexFile;
+        return false;
+    }
+    if (!ReadTextFile(fragmentFile, fragmentSrc))
+    {
+        errorOut = "Could not read " + fragmentFile;
         return false;
     }
 
-    GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    if (!CompileShader(fs, fragmentSrc, errorOut))
+    vertexPath = vertexFile;
+    fragmentPath = fragmentFile;
+    WatchFile(vertexPath);
+    WatchFile(fragmentPath);
+    vertexVersion = GetFileVersion(vertexPath);
+    fragmentVersion = GetFileVersion(fragmentPath);
+
+    BeginCreateFromSource(vertexSrc.c_str(), fragmentSrc.c_str());
+    return true;
+}
+
+bool Shader::CreateFromFiles(const std::string& vertexFile, const std::string& fragmentFile, std::string& errorOut)
+{
+    if (!BeginCreateFromFiles(vertexFile, fragmentFile, errorOut))
+        return false;
+    return FinishCreate(errorOut);
+}
+
+bool Shader::CreateComputeFromFile(const std::string& computeFile, std::string& errorOut)
+{
+    std::string computeSrc;
+    if (!ReadTextFile(computeFile, computeSrc))
     {
-        glDeleteShader(vs);
-        glDeleteShader(fs);
+        errorOut = "Could not read " + computeFile;
         return false;
     }
 
-    ID = glCreateProgram();
-    glAttachShader(ID, vs);
-    glAttachShader(ID, fs);
-    glLinkProgram(ID);
+    vertexPath = computeFile;
+    fragmentPath.clear();
+    WatchFile(vertexPath);
+    vertexVersion = GetFileVersion(vertexPath);
+    fragmentVersion = 0;
 
-    GLint success = 0;
-    glGetProgramiv(ID, GL_LINK_STATUS, &success);
-    if (!success)
+    StartBuild(pending, PrepareSource(computeSrc.c_str(), kComputeStage).c_str(), nullptr);
+    return FinishCreate(errorOut);
+}
+
+bool Shader::PollHotReload()
+{
+    if (vertexPath.empty())
+        return false;
+
+    PollFileChanges();
+
+    const bool compute = fragmentPath.empty();
+    const std::string files = compute ? vertexPath : vertexPath + " / " + fragmentPath;
+
+    if (!reload.program)
     {
-        GLint logLen = 0;
-        glGetProgramiv(ID, GL_INFO_LOG_LENGTH, &logLen);
-        std::vector<char> logBuf(logLen ? logLen : 1);
-        glGetProgramInfoLog(ID, logLen, nullptr, logBuf.data());
-        errorOut = std::string(logBuf.data());
-        glDeleteShader(vs);
-        glDeleteShader(fs);
-        glDeleteProgram(ID);
-        ID = 0;
+        unsigned int vv = GetFileVersion(vertexPath);
+        unsigned int fv = compute ? 0 : GetFileVersion(fragmentPath);
+        if (vv == vertexVersion && fv == fragmentVersion)
+            return false;
+
+        std::string vertexSrc, fragmentSrc;
+        if (!ReadTextFile(vertexPath, vertexSrc) || (!compute && !ReadTextFile(fragmentPath, fragmentSrc)))
+            return false; // mid-save; the next change event retries
+
+        vertexVersion = vv;
+        fragmentVersion = fv;
+        reloadStart = compute ? GetFileChangeTime(vertexPath)
+            : std::max(GetFileChangeTime(vertexPath), GetFileChangeTime(fragmentPath));
+        reloadFrames = 0;
+        if (compute)
+            StartBuild(reload, PrepareSource(vertexSrc.c_str(), kComputeStage).c_str(), nullptr);
+        else
+            StartBuild(reload, PrepareSource(vertexSrc.c_str(), kVertexStage).c_str(),
+                PrepareSource(fragmentSrc.c_str(), kFragmentStage).c_str());
+    }
+
+    // keep rendering with the old program until the driver is done
+    if (!BuildReady(reload))
+    {
+        reloadFrames++;
         return false;
     }
 
-    // shaders can be deleted after linking
-    glDetachShader(ID, vs);
-    glDetachShader(ID, fs);
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    std::string err;
+    bool ok = FinishBuild(reload, err);
+    if (ok && !ValidateSchema(reload.program, err))
+    {
+        glDeleteProgram(reload.program);
+        ok = false;
+    }
+    double ms = (ProfileNow() - reloadStart) * 1e3;
+
+    if (!ok)
+    {
+        std::cerr << "Hot reload of " << files << " failed, keeping the previous program:\n" << err << "\n";
+        reload = Build();
+        return false;
+    }
+
+    // the old program may still be bound, and GL can hand its name to the new one
+    glDeleteProgram(ID);
+    ID = reload.program;
+    fromCache = reload.fromCache;
+    reload = Build();
+    gGLState.Invalidate();
+    ReflectUniforms();
+
+    std::cout << "Hot reload: " << files << " swapped in "
+        << ms << " ms after the change (" << reloadFrames << " frames drawn meanwhile"
+        << (gGLExt.parallelShaderCompile ? "" : "; compiled in place, without parallel compile") << ")\n";
     return true;
-}
\ No newline at end of file
+}
+
+void Shader::Destroy()
+{
+    // a rebuild may still be in flight
+    if (reload.vs)
+        glDeleteShader(reload.vs);
+    if (reload.fs)
+        glDeleteShader(reload.fs);
+    if (reload.program)
+        glDeleteProgram(reload.program);
+    reload = Build();
+
+    if (ID)
+    {
+        glDeleteProgram(ID);
+        ID = 0;
+    }
+}
@@ -1,19 +1,130 @@
 #pragma once
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <glad/glad.h>
+#include "UniformSchema.h"
+#include "GLState.h"
 
 class Shader
 {
 public:
-    Shader() : ID(0) {}
+    Shader() : ID(0), fromCache(false), schema(nullptr), schemaCount(0),
+        vertexVersion(0), fragmentVersion(0), reloadStart(0.0), reloadFrames(0) {}
     // build shader from source strings
     bool CreateFromSource(const char* vertexSrc, const char* fragmentSrc, std::string& errorOut);
-    void Use() const { glUseProgram(ID); }
+
+    // Same as CreateFromSource, split in two so the driver can compile while
+    // we do other work: Begin issues compile + link without reading any
+    // status back, Finish collects the result (blocking if still busy).
+    void BeginCreateFromSource(const char* vertexSrc, const char* fragmentSrc);
+    bool IsReady() const;   // never blocks; always true without parallel compile
+    bool FinishCreate(std::string& errorOut);
+
+    // Load both stages from files. The files are watched for PollHotReload().
+    // Begin fails only if a file cannot be read.
+    bool BeginCreateFromFiles(const std::string& vertexFile, const std::string& fragmentFile, std::string& errorOut);
+    bool CreateFromFiles(const std::string& vertexFile, const std::string& fragmentFile, std::string& errorOut);
+
+    // Compute program from one file, also watched for PollHotReload().
+    bool CreateComputeFromFile(const std::string& computeFile, std::string& errorOut);
+
+    // Call once per frame. When a source file changes the program is rebuilt
+    // in the background while the old one keeps rendering; the new program
+    // replaces it only once it has linked. Returns true on the swap frame.
+    // Without parallel compile the rebuild blocks this call instead (one
+    // hitch); a failed one still keeps the old program.
+    bool PollHotReload();
+
+    // Linked programs are saved with glGetProgramBinary under this directory,
+    // keyed by source hash + driver strings, and reloaded on the next run.
+    // An empty path disables the cache.
+    static void SetBinaryCacheDir(const std::string& dir);
+    bool LoadedFromCache() const { return fromCache; }
+
+    // Declares the program's uniforms up front (see UniformSchema.h). Call
+    // before creating the program; handles made with SchemaHandle() on the
+    // same array are then valid for this shader.
+    template <size_t N>
+    void SetUniformSchema(const UniformDecl (&decls)[N]) { SetUniformSchema(decls, (int)N); }
+    void SetUniformSchema(const UniformDecl* decls, int count);
+
+    // Lines inserted after #version in every stage ("#define HAS_TEXTURE true\n"),
+    // for compile-time variants of one source (see ShaderVariants.h). Call
+    // before creating the program; hot reloads keep them.
+    void SetDefines(const std::string& lines) { defines = lines; }
+
+    UniformInt   GetUniformInt(const char* name)   { return UniformInt{ ResolveUniform(name, GL_INT) }; }
+    UniformFloat GetUniformFloat(const char* name) { return UniformFloat{ ResolveUniform(name, GL_FLOAT) }; }
+    UniformVec3  GetUniformVec3(const char* name)  { return UniformVec3{ ResolveUniform(name, GL_FLOAT_VEC3) }; }
+    UniformMat4  GetUniformMat4(const char* name)  { return UniformMat4{ ResolveUniform(name, GL_FLOAT_MAT4) }; }
+
+    // Uploads go through glProgramUniform*, so the program need not be bound.
+    void Set(UniformInt u, int value);
+    void Set(UniformFloat u, float value);
+    void Set(UniformVec3 u, float x, float y, float z);
+    void Set(UniformMat4 u, const float* m); // 16 floats, as the render loop builds them
+
+    void Use() const { gGLState.UseProgram(ID); }
     GLuint GetID() const { return ID; }
-    void Destroy() { if (ID) { glDeleteProgram(ID); ID = 0; } }
+    void Destroy();
 
 private:
+    // one compile + link in flight
+    struct Build
+    {
+        GLuint program = 0;
+        GLuint vs = 0;
+        GLuint fs = 0;
+        unsigned long long cacheKey = 0;
+        bool fromCache = false;
+    };
+
+    // Active uniform as reported by glGetActiveUniform after linking
+    struct ActiveUniform
+    {
+        GLint location;
+        GLenum type;
+        GLint size;
+    };
+
+    // What a handle points at; value shadows what the program holds
+    struct UniformSlot
+    {
+        std::string name;
+        GLenum type = 0;
+        GLint location = -1;
+        bool known = false;  // value[] matches the program
+        float value[16];
+    };
+
     GLuint ID;
-    bool CompileShader(GLuint shader, const char* src, std::string& errorOut);
-};
+    bool fromCache;
+    std::unordered_map<std::string, ActiveUniform> activeUniforms;
+    std::unordered_map<std::string, int> slotLookup;
+    std::vector<UniformSlot> slots;
+    const UniformDecl* schema;
+    int schemaCount;
+    std::string defines;
+    Build pending;  // between BeginCreate* and FinishCreate
+    Build reload;   // background rebuild after a file change
+
+    std::string vertexPath, fragmentPath;  // compute programs: vertexPath only
+    unsigned int vertexVersion, fragmentVersion;
+    double reloadStart;
+    int reloadFrames;
 
+    std::string PrepareSource(const char* src, UniformStage stage) const;
+    bool ValidateSchema(GLuint program, std::string& errorOut) const;
+    void ReflectUniforms();
+    int ResolveUniform(const char* name, GLenum type);
+    void BindSlot(UniformSlot& slot);
+    bool Unchanged(UniformSlot& slot, const void* value, size_t bytes);
+
+    static void StartBuild(Build& build, const char* vertexSrc, const char* fragmentSrc);
+    static bool BuildReady(const Build& build);
+    static bool FinishBuild(Build& build, std::string& errorOut);
+    static bool CheckShader(GLuint shader, std::string& errorOut);
+    static bool LoadCachedBinary(Build& build);
+    static void SaveCachedBinary(const Build& build);
+};
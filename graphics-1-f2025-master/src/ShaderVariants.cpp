@@ -0,0 +1,74 @@
+#include "ShaderVariants.h"
+#include "Profile.h"
+#include <iostream>
+
+void ShaderVariants::Create(const std::string& vertexFile, const std::string& fragmentFile, const UniformDecl* decls,
+    int declCount, const std::vector<ShaderFeature>& features_)
+{
+    vertexPath = vertexFile;
+    fragmentPath = fragmentFile;
+    schema = decls;
+    schemaCount = declCount;
+    features = features_;
+}
+
+void ShaderVariants::Destroy()
+{
+    for (auto& it : variants)
+        it.second.shader.Destroy();
+    variants.clear();
+}
+
+void ShaderVariants::PollHotReload()
+{
+    for (auto& it : variants)
+        if (it.second.state == kReady)
+            it.second.shader.PollHotReload();
+}
+
+std::string ShaderVariants::DefinesFor(unsigned key) const
+{
+    std::string lines;
+    for (const ShaderFeature& f : features)
+        lines += (key & f.bit) ? f.onDefines : f.offDefines;
+    return lines;
+}
+
+ShaderVariants::Variant& ShaderVariants::Issue(unsigned key)
+{
+    auto it = variants.find(key);
+    if (it != variants.end())
+        return it->second;
+
+    Variant& v = variants[key];
+    v.shader.SetUniformSchema(schema, schemaCount);
+    v.shader.SetDefines(DefinesFor(key));
+    std::string err;
+    if (!v.shader.BeginCreateFromFiles(vertexPath, fragmentPath, err))
+    {
+        std::cerr << "Shader variant " << key << " of " << fragmentPath << ": " << err << "\n";
+        v.state = kFailed;
+    }
+    return v;
+}
+
+void ShaderVariants::Precompile(const std::vector<unsigned>& keys)
+{
+    for (unsigned key : keys)
+        Issue(key);
+}
+
+Shader* ShaderVariants::Get(unsigned key)
+{
+    Variant& v = Issue(key);
+    if (v.state == kIssued)
+    {
+        const double start = ProfileNow();
+        std::string err;
+        v.state = v.shader.FinishCreate(err) ? kReady : kFailed;
+        blockingMs += (ProfileNow() - start) * 1e3;
+        if (v.state == kFailed)
+            std::cerr << "Shader variant " << key << " of " << fragmentPath << " failed:\n" << err << "\n";
+    }
+    return v.state == kReady ? &v.shader : nullptr;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include "Shader.h"
+
+// One switch of a ShaderVariants family: the lines a variant gets after
+// #version depending on whether its key has the bit.
+struct ShaderFeature
+{
+    unsigned bit;
+    std::string onDefines;      // "#define HAS_TEXTURE true\n"
+    std::string offDefines;     // "#define HAS_TEXTURE false\n", or empty
+};
+
+// ------------------------------------------------------------
+// Compile-time variants of one vertex + fragment file pair. A variant is
+// keyed by the feature bits it was built with; each bit turns into
+// #defines (see ShaderFeature) that let the compiler drop the branches a
+// uniform would otherwise decide per fragment.
+//
+// Variants are built on first Get(), or ahead of time with Precompile(),
+// which only issues the compiles so the driver can work on them in the
+// background. Every variant goes through Shader, so each one also lands
+// in the program binary cache under its own source hash and hot reloads
+// with the files.
+// ------------------------------------------------------------
+class ShaderVariants
+{
+public:
+    template <size_t N>
+    void Create(const std::string& vertexFile, const std::string& fragmentFile, const UniformDecl (&decls)[N],
+        const std::vector<ShaderFeature>& features)
+    {
+        Create(vertexFile, fragmentFile, decls, (int)N, features);
+    }
+    void Create(const std::string& vertexFile, const std::string& fragmentFile, const UniformDecl* decls,
+        int declCount, const std::vector<ShaderFeature>& features);
+    void Destroy();
+    void PollHotReload();
+
+    // Issues the compiles of these variants without waiting for them
+    void Precompile(const std::vector<unsigned>& keys);
+
+    // The variant for key, finished (and if need be compiled) on first use.
+    // nullptr if it failed to build; the error is printed once.
+    Shader* Get(unsigned key);
+
+    // The #define lines variant key is built with
+    std::string DefinesFor(unsigned key) const;
+
+    int GetVariantCount() const { return (int)variants.size(); }
+    double GetBlockingMs() const { return blockingMs; }    // spent waiting in Get()
+
+private:
+    enum State
+    {
+        kIssued,
+        kReady,
+        kFailed,
+    };
+
+    struct Variant
+    {
+        Shader shader;
+        State state = kIssued;
+    };
+
+    std::string vertexPath, fragmentPath;
+    const UniformDecl* schema = nullptr;
+    int schemaCount = 0;
+    std::vector<ShaderFeature> features;
+    std::map<unsigned, Variant> variants;
+    double blockingMs = 0.0;
+
+    Variant& Issue(unsigned key);
+};
@@ -0,0 +1,280 @@
+#include "ShadowMaps.h"
+#include "ClusteredLighting.h"
+#include "ConstexprMath.h"
+#include "GLState.h"
+#include "GLStats.h"
+#include "ShadowUniforms.h"
+#include "SimdMath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    const char* kCasterVertexPaths[ShadowMaps::kCasterCount] = {
+        "shaders/shadow.vert",
+        "shaders/shadow_instanced.vert",
+        "shaders/shadow_indirect.vert",
+    };
+    const char* kCasterFragPath = "shaders/shadow.frag";
+
+    // the cone's edge must not land on the map's border
+    const float kSpotMarginRadians = cx::DegToRad(2.0f);
+
+    simd::Vec3 ToVec3(const float v[3])
+    {
+        return simd::Vec3(v[0], v[1], v[2]);
+    }
+
+    // LookAt needs an up vector that is not along the view
+    simd::Vec3 UpFor(const simd::Vec3& dir)
+    {
+        return fabsf(dir.Y()) > 0.99f ? simd::Vec3(0.0f, 0.0f, 1.0f) : simd::Vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    // clip space [-1, 1] to texture space [0, 1], depth included
+    void ToTextureSpace(const float clip[16], float out[16])
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            for (int r = 0; r < 3; ++r)
+                out[c * 4 + r] = 0.5f * clip[c * 4 + r] + 0.5f * clip[c * 4 + 3];
+            out[c * 4 + 3] = clip[c * 4 + 3];
+        }
+    }
+}
+
+bool ShadowMaps::Create(int dirSize_, int spotSize_, int windowWidth_, int windowHeight_, std::string& errorOut)
+{
+    dirSize = dirSize_;
+    spotSize = spotSize_;
+    windowWidth = windowWidth_;
+    windowHeight = windowHeight_;
+
+    CreateMap(maps[kDirLight], dirSize);
+    CreateMap(maps[kSpotLight], spotSize);
+    bool complete = true;
+    for (const Map& map : maps)
+    {
+        const GLuint fbos[2] = { map.cachedFbo, map.liveFbo };
+        for (GLuint fbo : fbos)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete)
+    {
+        errorOut = "shadow map framebuffers are incomplete";
+        return false;
+    }
+
+    glGenBuffers(1, &buffer);
+    gGLState.BindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(ShadowBlock), nullptr, GL_DYNAMIC_DRAW);
+
+    for (int c = 0; c < kCasterCount; ++c)
+    {
+        casterShaders[c].SetUniformSchema(kShadowUniformDecls);
+        if (!casterShaders[c].CreateFromFiles(kCasterVertexPaths[c], kCasterFragPath, errorOut))
+            return false;
+    }
+    return true;
+}
+
+void ShadowMaps::CreateMap(Map& map, int size)
+{
+    map.size = size;
+    GLuint* textures[2] = { &map.cached, &map.live };
+    GLuint* fbos[2] = { &map.cachedFbo, &map.liveFbo };
+    for (int i = 0; i < 2; ++i)
+    {
+        // compared on lookup, linear filtering does 2x2 PCF; outside the map is lit
+        const float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        glGenTextures(1, textures[i]);
+        glBindTexture(GL_TEXTURE_2D, *textures[i]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, size, size);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+        glGenFramebuffers(1, fbos[i]);
+        glBindFramebuffer(GL_FRAMEBUFFER, *fbos[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, *textures[i], 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    gGLState.Invalidate();  // texture bindings changed behind its back
+    map.sampled = map.cached;
+    map.cachedVersion = 0;
+}
+
+void ShadowMaps::Destroy()
+{
+    for (Map& map : maps)
+    {
+        const GLuint textures[2] = { map.cached, map.live };
+        const GLuint fbos[2] = { map.cachedFbo, map.liveFbo };
+        glDeleteTextures(2, textures);
+        glDeleteFramebuffers(2, fbos);
+        map = Map();
+    }
+    glDeleteBuffers(1, &buffer);
+    for (Shader& shader : casterShaders)
+        shader.Destroy();
+    gGLState.Invalidate();
+    buffer = 0;
+}
+
+void ShadowMaps::PollHotReload()
+{
+    // the cached maps hold depth from the old caster program
+    for (Shader& shader : casterShaders)
+    {
+        if (shader.PollHotReload())
+            InvalidateStatic();
+    }
+}
+
+void ShadowMaps::SetSceneBounds(const float min[3], const float max[3])
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        sceneMin[k] = min[k];
+        sceneMax[k] = max[k];
+    }
+}
+
+// Looks along the light at the scene box; the box's corners in light view
+// space give the orthographic volume
+void ShadowMaps::DirMatrix(const Std140DirectionalLight& light, float out[16], float& texelSize) const
+{
+    const simd::Vec3 center = (ToVec3(sceneMin) + ToVec3(sceneMax)) * 0.5f;
+    const simd::Vec3 dir = simd::Normalize(ToVec3(light.direction));
+    const simd::Mat4 view = simd::LookAt(center - dir, center, UpFor(dir));
+
+    simd::Vec3 vmin(1e30f, 1e30f, 1e30f), vmax(-1e30f, -1e30f, -1e30f);
+    for (int i = 0; i < 8; ++i)
+    {
+        const simd::Vec3 corner((i & 1) ? sceneMax[0] : sceneMin[0], (i & 2) ? sceneMax[1] : sceneMin[1],
+            (i & 4) ? sceneMax[2] : sceneMin[2]);
+        const simd::Vec3 p = simd::TransformPoint(view, corner);
+        vmin = simd::Min(vmin, p);
+        vmax = simd::Max(vmax, p);
+    }
+
+    // no square roots or trig in it, so cx's is as fast as any
+    const cx::Mat4 projection = cx::Orthographic(vmin.X(), vmax.X(), vmin.Y(), vmax.Y(), -vmax.Z(), -vmin.Z());
+    (simd::Mat4::Load(projection.m) * view).Store(out);
+    texelSize = std::max(vmax.X() - vmin.X(), vmax.Y() - vmin.Y()) / dirSize;
+}
+
+// From the light along its direction, wide enough for the outer cone and
+// as deep as its range or the farthest corner of the scene box
+void ShadowMaps::SpotMatrix(const Std140SpotLight& light, float out[16], float& texelSize) const
+{
+    const simd::Vec3 eye = ToVec3(light.position);
+    const simd::Vec3 dir = simd::Normalize(ToVec3(light.direction));
+    const simd::Mat4 view = simd::LookAt(eye, eye + dir, UpFor(dir));
+
+    const float brightest = std::max(light.diffuse[0], std::max(light.diffuse[1], light.diffuse[2]));
+    float zFar = ClusteredLighting::LightRange(light.constant, light.linear, light.quadratic, brightest);
+    float farthest = 0.0f;
+    for (int i = 0; i < 8; ++i)
+    {
+        const simd::Vec3 corner((i & 1) ? sceneMax[0] : sceneMin[0], (i & 2) ? sceneMax[1] : sceneMin[1],
+            (i & 4) ? sceneMax[2] : sceneMin[2]);
+        farthest = std::max(farthest, simd::Length(corner - eye));
+    }
+    zFar = std::max(0.2f, std::min(zFar, farthest));
+
+    const float fovY = 2.0f * acosf(light.outerCutOff) + kSpotMarginRadians;
+    (simd::Perspective(fovY, 1.0f, 0.1f, zFar) * view).Store(out);
+    texelSize = 2.0f * tanf(fovY * 0.5f) / spotSize;
+}
+
+void ShadowMaps::Render(const LightBlock& lights, const std::function<void()>& drawStatic,
+    const std::function<void()>& drawDynamic)
+{
+    DirMatrix(lights.dirLight, maps[kDirLight].matrix, block.dirTexelSize);
+    SpotMatrix(lights.spotLight, maps[kSpotLight].matrix, block.spotTexelSize);
+
+    // slope-scaled bias against acne; receivers add a normal offset
+    gGLState.SetEnabled(GL_DEPTH_TEST, true);
+    gGLState.SetEnabled(GL_POLYGON_OFFSET_FILL, true);
+    glPolygonOffset(2.0f, 4.0f);
+
+    bool redrawn = false;
+    for (Map& map : maps)
+    {
+        // the static casters only when the light or they moved
+        if (map.cachedVersion == staticVersion && memcmp(map.matrix, map.cachedMatrix, sizeof(map.matrix)) == 0)
+        {
+            gFrameStats.shadowMapsCached++;
+        }
+        else
+        {
+            DrawInto(map.cachedFbo, map.size, map.matrix, drawStatic, true);
+            memcpy(map.cachedMatrix, map.matrix, sizeof(map.matrix));
+            map.cachedVersion = staticVersion;
+            gFrameStats.shadowMapsRedrawn++;
+            redrawn = true;
+        }
+
+        // the moving ones on top of a copy, every frame
+        map.sampled = map.cached;
+        if (drawDynamic)
+        {
+            glCopyImageSubData(map.cached, GL_TEXTURE_2D, 0, 0, 0, 0, map.live, GL_TEXTURE_2D, 0, 0, 0, 0,
+                map.size, map.size, 1);
+            DrawInto(map.liveFbo, map.size, map.matrix, drawDynamic, false);
+            map.sampled = map.live;
+        }
+    }
+
+    gGLState.SetEnabled(GL_POLYGON_OFFSET_FILL, false);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowWidth, windowHeight);
+
+    // ShadowBlock only changes with the cached maps
+    if (redrawn)
+    {
+        ToTextureSpace(maps[kDirLight].matrix, block.dirMatrix);
+        ToTextureSpace(maps[kSpotLight].matrix, block.spotMatrix);
+        gGLState.BindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+    }
+}
+
+void ShadowMaps::DrawInto(GLuint fbo, int size, const float matrix[16], const std::function<void()>& draw, bool clear)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, size, size);
+    gGLState.DepthMask(true);   // both the clear and the casters write depth
+    if (clear)
+        glClear(GL_DEPTH_BUFFER_BIT);
+    drawingMatrix = matrix;
+    if (draw)
+        draw();
+    drawingMatrix = nullptr;
+}
+
+void ShadowMaps::UseCasterProgram(Caster caster)
+{
+    Shader& shader = casterShaders[caster];
+    shader.Use();
+    if (drawingMatrix)
+        shader.Set(ShadowCaster::lightMatrix, drawingMatrix);
+}
+
+void ShadowMaps::Bind()
+{
+    gGLState.BindBufferBase(GL_UNIFORM_BUFFER, kShadowBlockBinding, buffer);
+    gGLState.BindTexture(kDirShadowUnit, GL_TEXTURE_2D, maps[kDirLight].sampled);
+    gGLState.BindTexture(kSpotShadowUnit, GL_TEXTURE_2D, maps[kSpotLight].sampled);
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <glad/glad.h>
+#include "FrameUniforms.h"
+#include "Shader.h"
+
+const unsigned int kShadowBlockBinding = 4;     // uniform block: ShadowBlock
+
+// The maps while phong.frag samples them (unit 5 is the visibility buffer's)
+enum ShadowTextureUnit : GLuint
+{
+    kDirShadowUnit = 6,
+    kSpotShadowUnit = 7,
+};
+
+// What phong.frag reads as
+//   layout(std140, binding = 4) uniform ShadowBlock { ... };
+// Matrices take world space to the map's [0, 1] texture coordinates and
+// depth. texelSize is the world size of one texel: for the directional
+// map directly, for the spot map per unit of distance from the light.
+struct ShadowBlock
+{
+    float dirMatrix[16];
+    float spotMatrix[16];
+    float dirTexelSize;
+    float spotTexelSize;
+    float pad0[2];
+};
+
+static_assert(sizeof(ShadowBlock) == 144, "std140 ShadowBlock");
+
+// ------------------------------------------------------------
+// --shadows: depth maps for LightBlock's dirLight (orthographic, over the
+// scene bounds) and spotLight (perspective, over its outer cone and range).
+//
+// Each light keeps two maps. The cached map holds only the static casters
+// and is redrawn when the light's matrix or the static geometry changes
+// (InvalidateStatic()); every other frame it is reused as is. The dynamic
+// casters are composited on top each frame: the cached depth is copied to
+// the live map and they are drawn into it. Without dynamic casters the
+// cached map is sampled directly.
+// ------------------------------------------------------------
+class ShadowMaps
+{
+public:
+    // Depth-only programs, one per way the casters get their model matrix
+    enum Caster
+    {
+        kObjectCaster = 0,      // ObjectBlock (shaders/shadow.vert)
+        kInstancedCaster = 1,   // the flock's instance SSBO (shadow_instanced.vert)
+        kIndirectCaster = 2,    // MeshScene's per-draw SSBO (shadow_indirect.vert)
+        kCasterCount = 3,
+    };
+
+    ShadowMaps() : windowWidth(0), windowHeight(0), dirSize(0), spotSize(0), buffer(0), staticVersion(1) {}
+
+    // dirSize / spotSize square maps; the window size is restored after Render()
+    bool Create(int dirSize, int spotSize, int windowWidth, int windowHeight, std::string& errorOut);
+    void Destroy();
+    void PollHotReload();
+
+    // The box the directional map covers: every caster and receiver
+    void SetSceneBounds(const float min[3], const float max[3]);
+
+    // A static caster moved: both cached maps are redrawn by the next Render()
+    void InvalidateStatic() { ++staticVersion; }
+
+    // Brings both maps up to date with lights. drawStatic only runs for a
+    // cached map that has to be redrawn, drawDynamic (if set) every frame;
+    // both issue their draws after UseCasterProgram(). Leaves the window's
+    // framebuffer bound.
+    void Render(const LightBlock& lights, const std::function<void()>& drawStatic,
+        const std::function<void()>& drawDynamic);
+
+    // Binds the caster's program, set up for the map being drawn
+    void UseCasterProgram(Caster caster);
+
+    // ShadowBlock and the maps, for the programs built with HAS_SHADOWS
+    void Bind();
+
+private:
+    enum Light
+    {
+        kDirLight = 0,
+        kSpotLight = 1,
+        kLightCount = 2,
+    };
+
+    struct Map
+    {
+        int size = 0;
+        GLuint cached = 0, live = 0;            // depth textures
+        GLuint cachedFbo = 0, liveFbo = 0;
+        GLuint sampled = 0;                     // what Bind() hands out this frame
+        float matrix[16] = {};                  // light view-projection
+        float cachedMatrix[16] = {};            // the one the cached map was drawn with
+        unsigned cachedVersion = 0;             // staticVersion it was drawn with; 0: never
+    };
+
+    int windowWidth, windowHeight;
+    int dirSize, spotSize;
+    float sceneMin[3] = { -1.0f, -1.0f, -1.0f }, sceneMax[3] = { 1.0f, 1.0f, 1.0f };
+    Map maps[kLightCount];
+    const float* drawingMatrix = nullptr;       // for UseCasterProgram()
+    GLuint buffer;
+    ShadowBlock block = {};
+    unsigned staticVersion;
+    Shader casterShaders[kCasterCount];
+
+    void CreateMap(Map& map, int size);
+    void DirMatrix(const Std140DirectionalLight& light, float out[16], float& texelSize) const;
+    void SpotMatrix(const Std140SpotLight& light, float out[16], float& texelSize) const;
+    void DrawInto(GLuint fbo, int size, const float matrix[16], const std::function<void()>& draw, bool clear);
+};
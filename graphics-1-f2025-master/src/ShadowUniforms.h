@@ -0,0 +1,19 @@
+#pragma once
+#include "UniformSchema.h"
+
+// ------------------------------------------------------------
+// Uniforms of the shadow map caster programs (src/ShadowMaps.h):
+// shaders/shadow.vert and shadow_instanced.vert. The model matrix comes
+// from ObjectBlock or the flock's instance SSBO.
+// ------------------------------------------------------------
+constexpr UniformDecl kShadowUniformDecls[] = {
+    { "uLightMatrix",           GL_FLOAT_MAT4, nullptr, kVertexStage },
+};
+
+static_assert(SchemaIsValid(kShadowUniformDecls), "duplicate uniform or split struct in kShadowUniformDecls");
+
+// Handles, checked against the schema at compile time
+namespace ShadowCaster
+{
+    constexpr UniformMat4 lightMatrix = SchemaHandle<UniformMat4>(kShadowUniformDecls, "uLightMatrix");
+}
@@ -0,0 +1,209 @@
+#include "SimdMath.h"
+
+namespace simd
+{
+    const char* BackendName()
+    {
+#if SIMD_MATH_AVX2
+        return "AVX2";
+#elif SIMD_MATH_SSE4
+        return "SSE4.1";
+#elif SIMD_MATH_SSE
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+
+    namespace
+    {
+        // 2x2 matrices as (m00, m01, m10, m11)
+
+        // a * b
+        inline Float4 Mat2Mul(Float4 a, Float4 b)
+        {
+            return F4Add(F4Mul(a, F4Shuffle<0, 3, 0, 3>(b, b)),
+                F4Mul(F4Shuffle<1, 0, 3, 2>(a, a), F4Shuffle<2, 1, 2, 1>(b, b)));
+        }
+
+        // adj(a) * b
+        inline Float4 Mat2AdjMul(Float4 a, Float4 b)
+        {
+            return F4Sub(F4Mul(F4Shuffle<3, 3, 0, 0>(a, a), b),
+                F4Mul(F4Shuffle<1, 1, 2, 2>(a, a), F4Shuffle<2, 3, 0, 1>(b, b)));
+        }
+
+        // a * adj(b)
+        inline Float4 Mat2MulAdj(Float4 a, Float4 b)
+        {
+            return F4Sub(F4Mul(a, F4Shuffle<3, 0, 3, 0>(b, b)),
+                F4Mul(F4Shuffle<1, 0, 3, 2>(a, a), F4Shuffle<2, 1, 2, 1>(b, b)));
+        }
+    }
+
+    // Block inverse over the four 2x2 corners A B / C D. Written for rows,
+    // it works on columns unchanged: inverse(transpose(M)) = transpose(inverse(M)).
+    Mat4 Inverse(const Mat4& m)
+    {
+        const Float4 a = F4Shuffle<0, 1, 0, 1>(m.col[0], m.col[1]);
+        const Float4 b = F4Shuffle<2, 3, 2, 3>(m.col[0], m.col[1]);
+        const Float4 c = F4Shuffle<0, 1, 0, 1>(m.col[2], m.col[3]);
+        const Float4 d = F4Shuffle<2, 3, 2, 3>(m.col[2], m.col[3]);
+
+        // (|A|, |B|, |C|, |D|)
+        const Float4 detSub = F4Sub(
+            F4Mul(F4Shuffle<0, 2, 0, 2>(m.col[0], m.col[2]), F4Shuffle<1, 3, 1, 3>(m.col[1], m.col[3])),
+            F4Mul(F4Shuffle<1, 3, 1, 3>(m.col[0], m.col[2]), F4Shuffle<0, 2, 0, 2>(m.col[1], m.col[3])));
+        const Float4 detA = F4SplatLane<0>(detSub);
+        const Float4 detB = F4SplatLane<1>(detSub);
+        const Float4 detC = F4SplatLane<2>(detSub);
+        const Float4 detD = F4SplatLane<3>(detSub);
+
+        const Float4 dc = Mat2AdjMul(d, c);
+        const Float4 ab = Mat2AdjMul(a, b);
+        Float4 x = F4Sub(F4Mul(detD, a), Mat2Mul(b, dc));
+        Float4 w = F4Sub(F4Mul(detA, d), Mat2Mul(c, ab));
+        Float4 y = F4Sub(F4Mul(detB, c), Mat2MulAdj(d, ab));
+        Float4 z = F4Sub(F4Mul(detC, b), Mat2MulAdj(a, dc));
+
+        // |M| = |A||D| + |B||C| - tr(adj(A) B adj(D) C)
+        Float4 tr = F4Mul(ab, F4Shuffle<0, 2, 1, 3>(dc, dc));
+        tr = F4Add(tr, F4Shuffle<2, 3, 0, 1>(tr, tr));
+        tr = F4Add(tr, F4Shuffle<1, 0, 3, 2>(tr, tr));
+        const Float4 det = F4Sub(F4Add(F4Mul(detA, detD), F4Mul(detB, detC)), tr);
+
+        const Float4 scale = F4Div(F4Set(1.0f, -1.0f, -1.0f, 1.0f), det);
+        x = F4Mul(x, scale);
+        y = F4Mul(y, scale);
+        z = F4Mul(z, scale);
+        w = F4Mul(w, scale);
+
+        // adjugate the blocks and put them back in place
+        Mat4 r;
+        r.col[0] = F4Shuffle<3, 1, 3, 1>(x, y);
+        r.col[1] = F4Shuffle<2, 0, 2, 0>(x, y);
+        r.col[2] = F4Shuffle<3, 1, 3, 1>(z, w);
+        r.col[3] = F4Shuffle<2, 0, 2, 0>(z, w);
+        return r;
+    }
+
+    // The 3x3 inverse has rows c1 x c2, c2 x c0, c0 x c1 over the determinant
+    Mat4 InverseAffine(const Mat4& m)
+    {
+        const Vec3 c0(m.col[0]), c1(m.col[1]), c2(m.col[2]);
+        const Vec3 r0 = Cross(c1, c2);
+        const Float4 inv = F4Splat(1.0f / Dot(c0, r0));
+
+        Mat4 r;
+        r.col[0] = F4Mul(r0.v, inv);
+        r.col[1] = F4Mul(Cross(c2, c0).v, inv);
+        r.col[2] = F4Mul(Cross(c0, c1).v, inv);
+        r.col[3] = F4Zero();
+        F4Transpose(r.col[0], r.col[1], r.col[2], r.col[3]);
+
+        const Vec3 t = TransformVector(r, Vec3(m.col[3]));
+        r.col[3] = F4Sub(F4Set(0.0f, 0.0f, 0.0f, 1.0f), t.v);
+        return r;
+    }
+
+    Mat4 InverseRigid(const Mat4& m)
+    {
+        Mat4 r = m;
+        r.col[3] = F4Zero();
+        F4Transpose(r.col[0], r.col[1], r.col[2], r.col[3]);
+
+        const Vec3 t = TransformVector(r, Vec3(m.col[3]));
+        r.col[3] = F4Sub(F4Set(0.0f, 0.0f, 0.0f, 1.0f), t.v);
+        return r;
+    }
+
+    Mat4 Translation(const Vec3& t)
+    {
+        Mat4 m = Mat4::Identity();
+        m.col[3] = F4Add(t.v, m.col[3]);
+        return m;
+    }
+
+    Mat4 Scale(const Vec3& s)
+    {
+        Mat4 m;
+        m.col[0] = F4Mul(s.v, F4Set(1.0f, 0.0f, 0.0f, 0.0f));
+        m.col[1] = F4Mul(s.v, F4Set(0.0f, 1.0f, 0.0f, 0.0f));
+        m.col[2] = F4Mul(s.v, F4Set(0.0f, 0.0f, 1.0f, 0.0f));
+        m.col[3] = F4Set(0.0f, 0.0f, 0.0f, 1.0f);
+        return m;
+    }
+
+    Mat4 Perspective(float fovYRadians, float aspect, float zNear, float zFar)
+    {
+        const float f = 1.0f / tanf(fovYRadians * 0.5f);
+        Mat4 m;
+        m.col[0] = F4Set(f / aspect, 0.0f, 0.0f, 0.0f);
+        m.col[1] = F4Set(0.0f, f, 0.0f, 0.0f);
+        m.col[2] = F4Set(0.0f, 0.0f, (zFar + zNear) / (zNear - zFar), -1.0f);
+        m.col[3] = F4Set(0.0f, 0.0f, (2.0f * zFar * zNear) / (zNear - zFar), 0.0f);
+        return m;
+    }
+
+    Mat4 LookAt(const Vec3& eye, const Vec3& center, const Vec3& up)
+    {
+        const Vec3 f = Normalize(center - eye);
+        const Vec3 s = Normalize(Cross(f, up));
+        const Vec3 u = Cross(s, f);
+
+        // rows s, u, -f with the eye moved to the origin, transposed
+        Mat4 m;
+        m.col[0] = F4Set(s.X(), s.Y(), s.Z(), -Dot(s, eye));
+        m.col[1] = F4Set(u.X(), u.Y(), u.Z(), -Dot(u, eye));
+        m.col[2] = F4Set(-f.X(), -f.Y(), -f.Z(), Dot(f, eye));
+        m.col[3] = F4Set(0.0f, 0.0f, 0.0f, 1.0f);
+        return Transpose(m);
+    }
+
+    Quat AxisAngle(const Vec3& axis, float angle)
+    {
+        const float s = sinf(angle * 0.5f);
+        return Quat(F4Add(F4Mul(axis.v, F4Splat(s)), F4Set(0.0f, 0.0f, 0.0f, cosf(angle * 0.5f))));
+    }
+
+    Mat4 ToMat4(const Quat& q)
+    {
+        const float x = q.X(), y = q.Y(), z = q.Z(), w = q.W();
+        const float xx = x * x, yy = y * y, zz = z * z;
+        const float xy = x * y, xz = x * z, yz = y * z;
+        const float wx = w * x, wy = w * y, wz = w * z;
+
+        Mat4 m;
+        m.col[0] = F4Set(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f);
+        m.col[1] = F4Set(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f);
+        m.col[2] = F4Set(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f);
+        m.col[3] = F4Set(0.0f, 0.0f, 0.0f, 1.0f);
+        return m;
+    }
+
+    Quat Nlerp(const Quat& a, const Quat& b, float t)
+    {
+        // the shorter way round
+        const Float4 to = F4Dot4(a.v, b.v) < 0.0f ? F4Sub(F4Zero(), b.v) : b.v;
+        return Normalize(Quat(F4Add(a.v, F4Mul(F4Sub(to, a.v), F4Splat(t)))));
+    }
+
+    Quat Slerp(const Quat& a, const Quat& b, float t)
+    {
+        float cosTheta = F4Dot4(a.v, b.v);
+        Float4 to = b.v;
+        if (cosTheta < 0.0f)
+        {
+            cosTheta = -cosTheta;
+            to = F4Sub(F4Zero(), to);
+        }
+        if (cosTheta > 0.9995f)
+            return Nlerp(a, Quat(to), t);   // sin(theta) too small to divide by
+
+        const float theta = acosf(cosTheta);
+        const float invSin = 1.0f / sinf(theta);
+        const float wa = sinf((1.0f - t) * theta) * invSin;
+        const float wb = sinf(t * theta) * invSin;
+        return Quat(F4Add(F4Mul(a.v, F4Splat(wa)), F4Mul(to, F4Splat(wb))));
+    }
+}
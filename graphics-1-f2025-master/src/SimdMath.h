@@ -0,0 +1,395 @@
+#pragma once
+#include <cmath>
+
+// ------------------------------------------------------------
+// Vec3 / Vec4 / Mat4 / Quat on 4-wide SIMD registers. The instruction set
+// is picked at compile time from what the compiler targets:
+//
+//   SIMD_MATH_AVX2   AVX2 (-mavx2, /arch:AVX2): Mat4 products 8 floats at a time
+//   SIMD_MATH_SSE4   SSE4.1 (-msse4.1): 3-component dot products with dpps
+//   SIMD_MATH_SSE    SSE2, the x86-64 baseline
+//   SIMD_MATH_SCALAR plain floats; also forced with -DSIMD_MATH_FORCE_SCALAR
+//
+// Matrices are column-major like the rest of the renderer (col[3] is the
+// translation), so Load/Store take the float[16] arrays the uniform blocks
+// use. Vec3 keeps w = 0 in its register.
+//
+// Dot products add x, y, z (, w) left to right and the SIMD code fuses
+// nothing, so every backend matches the scalar code it replaced to the
+// bit, as long as the compiler does not contract that scalar code into
+// FMAs (-mfma / -march=native); then the last bits may differ.
+// ------------------------------------------------------------
+#if defined(SIMD_MATH_FORCE_SCALAR)
+#define SIMD_MATH_LEVEL 0
+#elif defined(__AVX2__)
+#define SIMD_MATH_LEVEL 3
+#elif defined(__SSE4_1__)
+#define SIMD_MATH_LEVEL 2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_MATH_LEVEL 1
+#else
+#define SIMD_MATH_LEVEL 0
+#endif
+
+#define SIMD_MATH_SCALAR (SIMD_MATH_LEVEL == 0)
+#define SIMD_MATH_SSE (SIMD_MATH_LEVEL >= 1)
+#define SIMD_MATH_SSE4 (SIMD_MATH_LEVEL >= 2)
+#define SIMD_MATH_AVX2 (SIMD_MATH_LEVEL >= 3)
+
+#if SIMD_MATH_SSE
+#include <immintrin.h>
+#endif
+
+namespace simd
+{
+    // "AVX2", "SSE4.1", "SSE2" or "scalar"
+    const char* BackendName();
+
+    // ------------------------------------------------------------
+    // Float4: the register type and the handful of operations the types
+    // below are written in
+    // ------------------------------------------------------------
+#if SIMD_MATH_SSE
+    typedef __m128 Float4;
+
+    inline Float4 F4Set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+    inline Float4 F4Splat(float s) { return _mm_set1_ps(s); }
+    inline Float4 F4Zero() { return _mm_setzero_ps(); }
+    inline Float4 F4Load(const float* p) { return _mm_loadu_ps(p); }
+    inline void F4Store(float* p, Float4 v) { _mm_storeu_ps(p, v); }
+    inline Float4 F4Add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+    inline Float4 F4Sub(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+    inline Float4 F4Mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+    inline Float4 F4Div(Float4 a, Float4 b) { return _mm_div_ps(a, b); }
+    inline Float4 F4Min(Float4 a, Float4 b) { return _mm_min_ps(a, b); }
+    inline Float4 F4Max(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+    inline float F4X(Float4 v) { return _mm_cvtss_f32(v); }
+
+    // (a[i0], a[i1], b[i2], b[i3]), as _mm_shuffle_ps
+    template <int i0, int i1, int i2, int i3>
+    inline Float4 F4Shuffle(Float4 a, Float4 b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(i3, i2, i1, i0)); }
+
+    inline void F4Transpose(Float4& a, Float4& b, Float4& c, Float4& d) { _MM_TRANSPOSE4_PS(a, b, c, d); }
+
+    inline float F4Dot3(Float4 a, Float4 b)
+    {
+#if SIMD_MATH_SSE4
+        // dpps adds (x + y) + (z + w), with w masked to 0 here
+        return _mm_cvtss_f32(_mm_dp_ps(a, b, 0x71));
+#else
+        const __m128 m = _mm_mul_ps(a, b);
+        __m128 s = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+        s = _mm_add_ss(s, _mm_movehl_ps(m, m));
+        return _mm_cvtss_f32(s);
+#endif
+    }
+
+    // not dpps: it would add (x + y) + (z + w)
+    inline float F4Dot4(Float4 a, Float4 b)
+    {
+        const __m128 m = _mm_mul_ps(a, b);
+        __m128 s = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+        s = _mm_add_ss(s, _mm_movehl_ps(m, m));
+        s = _mm_add_ss(s, _mm_shuffle_ps(m, m, _MM_SHUFFLE(3, 3, 3, 3)));
+        return _mm_cvtss_f32(s);
+    }
+#else
+    struct Float4
+    {
+        float v[4];
+    };
+
+    inline Float4 F4Set(float x, float y, float z, float w) { return { { x, y, z, w } }; }
+    inline Float4 F4Splat(float s) { return { { s, s, s, s } }; }
+    inline Float4 F4Zero() { return { { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+    inline Float4 F4Load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+    inline void F4Store(float* p, Float4 v) { p[0] = v.v[0]; p[1] = v.v[1]; p[2] = v.v[2]; p[3] = v.v[3]; }
+
+#define SIMD_MATH_LANEWISE(name, expr)                                                      \
+    inline Float4 name(Float4 a, Float4 b)                                                  \
+    {                                                                                       \
+        Float4 r;                                                                           \
+        for (int i = 0; i < 4; ++i)                                                         \
+            r.v[i] = expr;                                                                  \
+        return r;                                                                           \
+    }
+    SIMD_MATH_LANEWISE(F4Add, a.v[i] + b.v[i])
+    SIMD_MATH_LANEWISE(F4Sub, a.v[i] - b.v[i])
+    SIMD_MATH_LANEWISE(F4Mul, a.v[i] * b.v[i])
+    SIMD_MATH_LANEWISE(F4Div, a.v[i] / b.v[i])
+    SIMD_MATH_LANEWISE(F4Min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+    SIMD_MATH_LANEWISE(F4Max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+#undef SIMD_MATH_LANEWISE
+
+    inline float F4X(Float4 v) { return v.v[0]; }
+
+    template <int i0, int i1, int i2, int i3>
+    inline Float4 F4Shuffle(Float4 a, Float4 b) { return { { a.v[i0], a.v[i1], b.v[i2], b.v[i3] } }; }
+
+    inline void F4Transpose(Float4& a, Float4& b, Float4& c, Float4& d)
+    {
+        Float4 r[4] = { a, b, c, d };
+        a = { { r[0].v[0], r[1].v[0], r[2].v[0], r[3].v[0] } };
+        b = { { r[0].v[1], r[1].v[1], r[2].v[1], r[3].v[1] } };
+        c = { { r[0].v[2], r[1].v[2], r[2].v[2], r[3].v[2] } };
+        d = { { r[0].v[3], r[1].v[3], r[2].v[3], r[3].v[3] } };
+    }
+
+    inline float F4Dot3(Float4 a, Float4 b) { return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]; }
+    inline float F4Dot4(Float4 a, Float4 b) { return F4Dot3(a, b) + a.v[3] * b.v[3]; }
+#endif
+
+    // lane i in all four lanes
+    template <int i>
+    inline Float4 F4SplatLane(Float4 v) { return F4Shuffle<i, i, i, i>(v, v); }
+
+    template <int i>
+    inline float F4Lane(Float4 v) { return F4X(F4SplatLane<i>(v)); }
+
+    // (x, y, z, 0)
+    inline Float4 F4ZeroW(Float4 v) { return F4Shuffle<0, 1, 0, 2>(v, F4Shuffle<2, 2, 0, 0>(v, F4Zero())); }
+
+    // ------------------------------------------------------------
+    // Vec3 / Vec4
+    // ------------------------------------------------------------
+    struct Vec3
+    {
+        Float4 v;
+
+        Vec3() : v(F4Zero()) {}
+        Vec3(float x, float y, float z) : v(F4Set(x, y, z, 0.0f)) {}
+        explicit Vec3(Float4 v_) : v(v_) {}
+
+        static Vec3 Load(const float p[3]) { return Vec3(p[0], p[1], p[2]); }
+        void Store(float p[3]) const
+        {
+            p[0] = X();
+            p[1] = Y();
+            p[2] = Z();
+        }
+
+        float X() const { return F4X(v); }
+        float Y() const { return F4Lane<1>(v); }
+        float Z() const { return F4Lane<2>(v); }
+    };
+
+    struct Vec4
+    {
+        Float4 v;
+
+        Vec4() : v(F4Zero()) {}
+        Vec4(float x, float y, float z, float w) : v(F4Set(x, y, z, w)) {}
+        Vec4(const Vec3& xyz, float w) : v(F4Set(xyz.X(), xyz.Y(), xyz.Z(), w)) {}
+        explicit Vec4(Float4 v_) : v(v_) {}
+
+        static Vec4 Load(const float p[4]) { return Vec4(F4Load(p)); }
+        void Store(float p[4]) const { F4Store(p, v); }
+
+        float X() const { return F4X(v); }
+        float Y() const { return F4Lane<1>(v); }
+        float Z() const { return F4Lane<2>(v); }
+        float W() const { return F4Lane<3>(v); }
+        Vec3 XYZ() const { return Vec3(F4ZeroW(v)); }
+    };
+
+    inline Vec3 operator+(const Vec3& a, const Vec3& b) { return Vec3(F4Add(a.v, b.v)); }
+    inline Vec3 operator-(const Vec3& a, const Vec3& b) { return Vec3(F4Sub(a.v, b.v)); }
+    inline Vec3 operator*(const Vec3& a, const Vec3& b) { return Vec3(F4Mul(a.v, b.v)); }
+    inline Vec3 operator*(const Vec3& a, float s) { return Vec3(F4Mul(a.v, F4Splat(s))); }
+    inline Vec3 operator-(const Vec3& a) { return Vec3(F4Sub(F4Zero(), a.v)); }
+    inline Vec3 Min(const Vec3& a, const Vec3& b) { return Vec3(F4Min(a.v, b.v)); }
+    inline Vec3 Max(const Vec3& a, const Vec3& b) { return Vec3(F4Max(a.v, b.v)); }
+
+    inline float Dot(const Vec3& a, const Vec3& b) { return F4Dot3(a.v, b.v); }
+
+    inline Vec3 Cross(const Vec3& a, const Vec3& b)
+    {
+        // a.yzx * b.zxy - a.zxy * b.yzx
+        const Float4 aYZX = F4Shuffle<1, 2, 0, 3>(a.v, a.v);
+        const Float4 bZXY = F4Shuffle<2, 0, 1, 3>(b.v, b.v);
+        const Float4 aZXY = F4Shuffle<2, 0, 1, 3>(a.v, a.v);
+        const Float4 bYZX = F4Shuffle<1, 2, 0, 3>(b.v, b.v);
+        return Vec3(F4Sub(F4Mul(aYZX, bZXY), F4Mul(aZXY, bYZX)));
+    }
+
+    inline float Length(const Vec3& v) { return sqrtf(Dot(v, v)); }
+
+    // Zero vector for zero input
+    inline Vec3 Normalize(const Vec3& v)
+    {
+        const float len2 = Dot(v, v);
+        if (len2 <= 0.0f)
+            return Vec3();
+        return v * (1.0f / sqrtf(len2));
+    }
+
+    inline Vec4 operator+(const Vec4& a, const Vec4& b) { return Vec4(F4Add(a.v, b.v)); }
+    inline Vec4 operator-(const Vec4& a, const Vec4& b) { return Vec4(F4Sub(a.v, b.v)); }
+    inline Vec4 operator*(const Vec4& a, const Vec4& b) { return Vec4(F4Mul(a.v, b.v)); }
+    inline Vec4 operator*(const Vec4& a, float s) { return Vec4(F4Mul(a.v, F4Splat(s))); }
+    inline float Dot(const Vec4& a, const Vec4& b) { return F4Dot4(a.v, b.v); }
+
+    // ------------------------------------------------------------
+    // Mat4, column-major
+    // ------------------------------------------------------------
+    struct Mat4
+    {
+        Float4 col[4];
+
+        static Mat4 Identity()
+        {
+            Mat4 m;
+            m.col[0] = F4Set(1.0f, 0.0f, 0.0f, 0.0f);
+            m.col[1] = F4Set(0.0f, 1.0f, 0.0f, 0.0f);
+            m.col[2] = F4Set(0.0f, 0.0f, 1.0f, 0.0f);
+            m.col[3] = F4Set(0.0f, 0.0f, 0.0f, 1.0f);
+            return m;
+        }
+
+        static Mat4 Load(const float m[16])
+        {
+            Mat4 r;
+            for (int c = 0; c < 4; ++c)
+                r.col[c] = F4Load(m + c * 4);
+            return r;
+        }
+
+        void Store(float m[16]) const
+        {
+            for (int c = 0; c < 4; ++c)
+                F4Store(m + c * 4, col[c]);
+        }
+    };
+
+    // sum of a's columns weighted by v's lanes, added in lane order
+    inline Float4 MulColumns(const Mat4& a, Float4 v)
+    {
+        Float4 r = F4Mul(a.col[0], F4SplatLane<0>(v));
+        r = F4Add(r, F4Mul(a.col[1], F4SplatLane<1>(v)));
+        r = F4Add(r, F4Mul(a.col[2], F4SplatLane<2>(v)));
+        return F4Add(r, F4Mul(a.col[3], F4SplatLane<3>(v)));
+    }
+
+    inline Mat4 operator*(const Mat4& a, const Mat4& b)
+    {
+        Mat4 r;
+#if SIMD_MATH_AVX2
+        // two result columns per 8-wide register
+        const __m256 a0 = _mm256_insertf128_ps(_mm256_castps128_ps256(a.col[0]), a.col[0], 1);
+        const __m256 a1 = _mm256_insertf128_ps(_mm256_castps128_ps256(a.col[1]), a.col[1], 1);
+        const __m256 a2 = _mm256_insertf128_ps(_mm256_castps128_ps256(a.col[2]), a.col[2], 1);
+        const __m256 a3 = _mm256_insertf128_ps(_mm256_castps128_ps256(a.col[3]), a.col[3], 1);
+        for (int c = 0; c < 4; c += 2)
+        {
+            const __m256 bc = _mm256_insertf128_ps(_mm256_castps128_ps256(b.col[c]), b.col[c + 1], 1);
+            __m256 s = _mm256_mul_ps(a0, _mm256_permute_ps(bc, 0x00));
+            s = _mm256_add_ps(s, _mm256_mul_ps(a1, _mm256_permute_ps(bc, 0x55)));
+            s = _mm256_add_ps(s, _mm256_mul_ps(a2, _mm256_permute_ps(bc, 0xAA)));
+            s = _mm256_add_ps(s, _mm256_mul_ps(a3, _mm256_permute_ps(bc, 0xFF)));
+            r.col[c] = _mm256_castps256_ps128(s);
+            r.col[c + 1] = _mm256_extractf128_ps(s, 1);
+        }
+#else
+        for (int c = 0; c < 4; ++c)
+            r.col[c] = MulColumns(a, b.col[c]);
+#endif
+        return r;
+    }
+
+    inline Vec4 operator*(const Mat4& m, const Vec4& v) { return Vec4(MulColumns(m, v.v)); }
+
+    // w = 1 / w = 0 without the divide: for affine matrices
+    inline Vec3 TransformPoint(const Mat4& m, const Vec3& p)
+    {
+        Float4 r = F4Mul(m.col[0], F4SplatLane<0>(p.v));
+        r = F4Add(r, F4Mul(m.col[1], F4SplatLane<1>(p.v)));
+        r = F4Add(r, F4Mul(m.col[2], F4SplatLane<2>(p.v)));
+        return Vec3(F4ZeroW(F4Add(r, m.col[3])));
+    }
+
+    inline Vec3 TransformVector(const Mat4& m, const Vec3& v)
+    {
+        Float4 r = F4Mul(m.col[0], F4SplatLane<0>(v.v));
+        r = F4Add(r, F4Mul(m.col[1], F4SplatLane<1>(v.v)));
+        r = F4Add(r, F4Mul(m.col[2], F4SplatLane<2>(v.v)));
+        return Vec3(F4ZeroW(r));
+    }
+
+    inline Mat4 Transpose(const Mat4& m)
+    {
+        Mat4 r = m;
+        F4Transpose(r.col[0], r.col[1], r.col[2], r.col[3]);
+        return r;
+    }
+
+    // a * b when both have (0, 0, 0, 1) as their last row
+    inline Mat4 MulAffine(const Mat4& a, const Mat4& b)
+    {
+        Mat4 r;
+        for (int c = 0; c < 4; ++c)
+        {
+            Float4 s = F4Mul(a.col[0], F4SplatLane<0>(b.col[c]));
+            s = F4Add(s, F4Mul(a.col[1], F4SplatLane<1>(b.col[c])));
+            r.col[c] = F4Add(s, F4Mul(a.col[2], F4SplatLane<2>(b.col[c])));
+        }
+        r.col[3] = F4Add(r.col[3], a.col[3]);
+        return r;
+    }
+
+    Mat4 Inverse(const Mat4& m);            // general; singular input gives inf/nan
+    Mat4 InverseAffine(const Mat4& m);      // last row (0, 0, 0, 1)
+    Mat4 InverseRigid(const Mat4& m);       // rotation + translation only
+
+    Mat4 Translation(const Vec3& t);
+    Mat4 Scale(const Vec3& s);
+
+    // OpenGL clip space (z in [-w, w]), right-handed view looking down -z
+    Mat4 Perspective(float fovYRadians, float aspect, float zNear, float zFar);
+    Mat4 LookAt(const Vec3& eye, const Vec3& center, const Vec3& up);
+
+    // ------------------------------------------------------------
+    // Quat: (x, y, z) vector part, w scalar part
+    // ------------------------------------------------------------
+    struct Quat
+    {
+        Float4 v;
+
+        Quat() : v(F4Set(0.0f, 0.0f, 0.0f, 1.0f)) {}
+        Quat(float x, float y, float z, float w) : v(F4Set(x, y, z, w)) {}
+        explicit Quat(Float4 v_) : v(v_) {}
+
+        float X() const { return F4X(v); }
+        float Y() const { return F4Lane<1>(v); }
+        float Z() const { return F4Lane<2>(v); }
+        float W() const { return F4Lane<3>(v); }
+    };
+
+    // rotation by angle (radians) around a unit axis
+    Quat AxisAngle(const Vec3& axis, float angle);
+
+    // a * b rotates by b first, then a
+    inline Quat operator*(const Quat& a, const Quat& b)
+    {
+        Float4 r = F4Mul(F4SplatLane<3>(a.v), b.v);
+        r = F4Add(r, F4Mul(F4Mul(F4SplatLane<0>(a.v), F4Shuffle<3, 2, 1, 0>(b.v, b.v)), F4Set(1.0f, -1.0f, 1.0f, -1.0f)));
+        r = F4Add(r, F4Mul(F4Mul(F4SplatLane<1>(a.v), F4Shuffle<2, 3, 0, 1>(b.v, b.v)), F4Set(1.0f, 1.0f, -1.0f, -1.0f)));
+        return Quat(F4Add(r, F4Mul(F4Mul(F4SplatLane<2>(a.v), F4Shuffle<1, 0, 3, 2>(b.v, b.v)),
+            F4Set(-1.0f, 1.0f, 1.0f, -1.0f))));
+    }
+
+    inline Quat Conjugate(const Quat& q) { return Quat(F4Mul(q.v, F4Set(-1.0f, -1.0f, -1.0f, 1.0f))); }
+
+    inline Quat Normalize(const Quat& q) { return Quat(F4Mul(q.v, F4Splat(1.0f / sqrtf(F4Dot4(q.v, q.v))))); }
+
+    // v + w t + q.xyz x t, t = 2 q.xyz x v
+    inline Vec3 Rotate(const Quat& q, const Vec3& v)
+    {
+        const Vec3 u(F4ZeroW(q.v));
+        const Vec3 t = Cross(u, v) * 2.0f;
+        return v + t * F4Lane<3>(q.v) + Cross(u, t);
+    }
+
+    Mat4 ToMat4(const Quat& q);             // unit q
+    Quat Nlerp(const Quat& a, const Quat& b, float t);
+    Quat Slerp(const Quat& a, const Quat& b, float t);
+}
@@ -0,0 +1,353 @@
+#include "SoftwareOcclusion.h"
+#include "CpuFeatures.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+
+namespace
+{
+    const int kTile = SoftwareOcclusion::kTileSize;
+
+    // One triangle into one tile: tile-local rows y0..y1, columns x0..x1,
+    // x0 a multiple of the vector width. (ox, oy) = tile origin in pixels,
+    // tile = its first pixel in a buffer of the given row stride.
+    void RasterTriangleSSE(float* tile, int stride, int ox, int oy, const float (*edge)[3], const float* plane,
+        int x0, int y0, int x1, int y1)
+    {
+        const __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 a0 = _mm_set1_ps(edge[0][0]);
+        const __m128 a1 = _mm_set1_ps(edge[1][0]);
+        const __m128 a2 = _mm_set1_ps(edge[2][0]);
+        const __m128 az = _mm_set1_ps(plane[0]);
+
+        for (int y = y0; y <= y1; ++y)
+        {
+            const float fy = (float)(oy + y) + 0.5f;
+            const __m128 r0 = _mm_set1_ps(edge[0][1] * fy + edge[0][2]);
+            const __m128 r1 = _mm_set1_ps(edge[1][1] * fy + edge[1][2]);
+            const __m128 r2 = _mm_set1_ps(edge[2][1] * fy + edge[2][2]);
+            const __m128 rz = _mm_set1_ps(plane[1] * fy + plane[2]);
+            float* row = tile + y * stride;
+
+            for (int x = x0; x <= x1; x += 4)
+            {
+                const __m128 fx = _mm_add_ps(_mm_set1_ps((float)(ox + x)), lane);
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, fx), r0), zero);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, fx), r1), zero));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, fx), r2), zero));
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+
+                const __m128 z = _mm_add_ps(_mm_mul_ps(az, fx), rz);
+                const __m128 cur = _mm_loadu_ps(row + x);
+                const __m128 nearer = _mm_min_ps(cur, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, cur)));
+            }
+        }
+    }
+
+    CPU_TARGET_AVX2
+    void RasterTriangleAVX2(float* tile, int stride, int ox, int oy, const float (*edge)[3], const float* plane,
+        int x0, int y0, int x1, int y1)
+    {
+        const __m256 lane = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 a0 = _mm256_set1_ps(edge[0][0]);
+        const __m256 a1 = _mm256_set1_ps(edge[1][0]);
+        const __m256 a2 = _mm256_set1_ps(edge[2][0]);
+        const __m256 az = _mm256_set1_ps(plane[0]);
+
+        for (int y = y0; y <= y1; ++y)
+        {
+            const float fy = (float)(oy + y) + 0.5f;
+            const __m256 r0 = _mm256_set1_ps(edge[0][1] * fy + edge[0][2]);
+            const __m256 r1 = _mm256_set1_ps(edge[1][1] * fy + edge[1][2]);
+            const __m256 r2 = _mm256_set1_ps(edge[2][1] * fy + edge[2][2]);
+            const __m256 rz = _mm256_set1_ps(plane[1] * fy + plane[2]);
+            float* row = tile + y * stride;
+
+            for (int x = x0; x <= x1; x += 8)
+            {
+                const __m256 fx = _mm256_add_ps(_mm256_set1_ps((float)(ox + x)), lane);
+                __m256 inside = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a0, fx), r0), zero, _CMP_GE_OQ);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a1, fx), r1), zero, _CMP_GE_OQ));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a2, fx), r2), zero, _CMP_GE_OQ));
+                if (_mm256_movemask_ps(inside) == 0)
+                    continue;
+
+                const __m256 z = _mm256_add_ps(_mm256_mul_ps(az, fx), rz);
+                const __m256 cur = _mm256_loadu_ps(row + x);
+                _mm256_storeu_ps(row + x, _mm256_blendv_ps(cur, _mm256_min_ps(cur, z), inside));
+            }
+        }
+    }
+
+    // clip = m * (x, y, z, 1), column-major
+    inline __m128 TransformPoint(const __m128 cols[4], float x, float y, float z)
+    {
+        __m128 r = _mm_add_ps(_mm_mul_ps(cols[0], _mm_set1_ps(x)), cols[3]);
+        r = _mm_add_ps(r, _mm_mul_ps(cols[1], _mm_set1_ps(y)));
+        return _mm_add_ps(r, _mm_mul_ps(cols[2], _mm_set1_ps(z)));
+    }
+}
+
+void SoftwareOcclusion::Create(int width_, int height_, SimdPath path)
+{
+    tilesX = (width_ + kTile - 1) / kTile;
+    tilesY = (height_ + kTile - 1) / kTile;
+    width = tilesX * kTile;
+    height = tilesY * kTile;
+
+    const bool avx2 = CpuHasAvx2();
+    if (path == kSimdAuto)
+        simd = avx2 ? kSimdAVX2 : kSimdSSE;
+    else
+        simd = (path == kSimdAVX2 && !avx2) ? kSimdSSE : path;
+
+    bins.assign(tilesX * tilesY, std::vector<int>());
+    raster.assign((size_t)(width + 2) * (height + 2), 0.0f);
+    depth.assign((size_t)width * height, 1.0f);
+    tileMax.assign(tilesX * tilesY, 1.0f);
+}
+
+void SoftwareOcclusion::AddOccluder(const void* vertices, size_t stride, size_t vertexCount, const float model[16])
+{
+    const unsigned char* bytes = (const unsigned char*)vertices;
+    for (size_t i = 0; i + 2 < vertexCount; i += 3)
+    {
+        for (size_t k = 0; k < 3; ++k)
+        {
+            const float* p = (const float*)(bytes + (i + k) * stride);
+            for (int r = 0; r < 3; ++r)
+                occluders.push_back(model[r] * p[0] + model[4 + r] * p[1] + model[8 + r] * p[2] + model[12 + r]);
+        }
+    }
+}
+
+int SoftwareOcclusion::Render(const float view[16], const float projection[16])
+{
+    ViewProjection(view, projection, viewProj);
+    SetupTriangles();
+
+    // every tile writes only its own pixels; the filter reads across tiles,
+    // so it waits for the whole raster pass
+    const int tileCount = tilesX * tilesY;
+    ParallelFor(tileCount, 1, [this](size_t begin, size_t end)
+    {
+        for (size_t t = begin; t < end; ++t)
+            RasterizeTile((int)t);
+    });
+    ParallelFor(tileCount, 1, [this](size_t begin, size_t end)
+    {
+        for (size_t t = begin; t < end; ++t)
+            FilterTile((int)t);
+    });
+    return (int)triangles.size();
+}
+
+void SoftwareOcclusion::SetupTriangles()
+{
+    triangles.clear();
+    for (std::vector<int>& bin : bins)
+        bin.clear();
+
+    __m128 cols[4];
+    for (int c = 0; c < 4; ++c)
+        cols[c] = _mm_loadu_ps(viewProj + c * 4);
+
+    const size_t triangleCount = occluders.size() / 9;
+    for (size_t i = 0; i < triangleCount; ++i)
+    {
+        const float* v = &occluders[i * 9];
+        float sx[3], sy[3], sz[3];
+        bool clipped = false;
+        for (int k = 0; k < 3; ++k)
+        {
+            float clip[4];
+            _mm_storeu_ps(clip, TransformPoint(cols, v[k * 3 + 0], v[k * 3 + 1], v[k * 3 + 2]));
+
+            // crossing the near plane: dropping an occluder only hides less
+            if (clip[3] <= 1e-6f || clip[2] < -clip[3])
+            {
+                clipped = true;
+                break;
+            }
+            const float invW = 1.0f / clip[3];
+            sx[k] = (clip[0] * invW * 0.5f + 0.5f) * width;
+            sy[k] = (clip[1] * invW * 0.5f + 0.5f) * height;
+            sz[k] = clip[2] * invW * 0.5f + 0.5f;
+        }
+        if (clipped)
+            continue;
+
+        // pixels whose center may be inside
+        Triangle t;
+        t.minX = std::max(0, (int)floorf(std::min(sx[0], std::min(sx[1], sx[2]))));
+        t.minY = std::max(0, (int)floorf(std::min(sy[0], std::min(sy[1], sy[2]))));
+        t.maxX = std::min(width - 1, (int)floorf(std::max(sx[0], std::max(sx[1], sx[2]))));
+        t.maxY = std::min(height - 1, (int)floorf(std::max(sy[0], std::max(sy[1], sy[2]))));
+        if (t.minX > t.maxX || t.minY > t.maxY)
+            continue;
+
+        // edge k runs from vertex k to k + 1; flip so the inside is positive
+        // whatever the winding (occluders are drawn two-sided)
+        float area = 0.0f;
+        for (int k = 0; k < 3; ++k)
+        {
+            const int j = (k + 1) % 3;
+            t.edge[k][0] = sy[k] - sy[j];
+            t.edge[k][1] = sx[j] - sx[k];
+            t.edge[k][2] = sx[k] * sy[j] - sy[k] * sx[j];
+        }
+        area = t.edge[0][0] * sx[2] + t.edge[0][1] * sy[2] + t.edge[0][2];
+        if (fabsf(area) < 1e-6f)
+            continue;
+
+        // z = (E12 * z0 + E20 * z1 + E01 * z2) / area
+        const float invArea = 1.0f / area;
+        for (int c = 0; c < 3; ++c)
+            t.depth[c] = (t.edge[1][c] * sz[0] + t.edge[2][c] * sz[1] + t.edge[0][c] * sz[2]) * invArea;
+
+        const float sign = area > 0.0f ? 1.0f : -1.0f;
+        for (int k = 0; k < 3; ++k)
+            for (int c = 0; c < 3; ++c)
+                t.edge[k][c] *= sign;
+
+        const int index = (int)triangles.size();
+        triangles.push_back(t);
+        for (int ty = t.minY / kTile; ty <= t.maxY / kTile; ++ty)
+            for (int tx = t.minX / kTile; tx <= t.maxX / kTile; ++tx)
+                bins[ty * tilesX + tx].push_back(index);
+    }
+}
+
+void SoftwareOcclusion::RasterizeTile(int tileIndex)
+{
+    const int ox = (tileIndex % tilesX) * kTile;
+    const int oy = (tileIndex / tilesX) * kTile;
+    const int stride = width + 2;
+    float* tile = &raster[(size_t)(oy + 1) * stride + ox + 1];
+    for (int y = 0; y < kTile; ++y)
+        std::fill(tile + y * stride, tile + y * stride + kTile, 1.0f);
+
+    const int lanes = simd == kSimdAVX2 ? 8 : 4;
+    for (int index : bins[tileIndex])
+    {
+        const Triangle& t = triangles[index];
+        const int x0 = (std::max(t.minX, ox) - ox) & ~(lanes - 1);
+        const int y0 = std::max(t.minY, oy) - oy;
+        const int x1 = std::min(t.maxX, ox + kTile - 1) - ox;
+        const int y1 = std::min(t.maxY, oy + kTile - 1) - oy;
+        if (simd == kSimdAVX2)
+            RasterTriangleAVX2(tile, stride, ox, oy, t.edge, t.depth, x0, y0, x1, y1);
+        else
+            RasterTriangleSSE(tile, stride, ox, oy, t.edge, t.depth, x0, y0, x1, y1);
+    }
+}
+
+void SoftwareOcclusion::FilterTile(int tileIndex)
+{
+    const int ox = (tileIndex % tilesX) * kTile;
+    const int oy = (tileIndex / tilesX) * kTile;
+    const int stride = width + 2;
+
+    // the border of the raster buffer is 0: the screen edge erodes nothing
+    __m128 farthest = _mm_setzero_ps();
+    for (int y = 0; y < kTile; ++y)
+    {
+        const float* above = &raster[(size_t)(oy + y) * stride + ox];
+        float* out = &depth[(size_t)(oy + y) * width + ox];
+        for (int x = 0; x < kTile; x += 4)
+        {
+            __m128 m = _mm_setzero_ps();
+            for (int r = 0; r < 3; ++r)
+            {
+                const float* p = above + r * stride + x;
+                m = _mm_max_ps(m, _mm_max_ps(_mm_loadu_ps(p), _mm_max_ps(_mm_loadu_ps(p + 1), _mm_loadu_ps(p + 2))));
+            }
+            _mm_storeu_ps(out + x, m);
+            farthest = _mm_max_ps(farthest, m);
+        }
+    }
+
+    float lanesMax[4];
+    _mm_storeu_ps(lanesMax, farthest);
+    tileMax[tileIndex] = std::max(std::max(lanesMax[0], lanesMax[1]), std::max(lanesMax[2], lanesMax[3]));
+}
+
+bool SoftwareOcclusion::IsVisible(const float boxMin[3], const float boxMax[3]) const
+{
+    __m128 cols[4];
+    for (int c = 0; c < 4; ++c)
+        cols[c] = _mm_loadu_ps(viewProj + c * 4);
+
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, nearest = 1.0f;
+    for (int i = 0; i < 8; ++i)
+    {
+        float clip[4];
+        _mm_storeu_ps(clip, TransformPoint(cols, (i & 1) ? boxMax[0] : boxMin[0],
+            (i & 2) ? boxMax[1] : boxMin[1], (i & 4) ? boxMax[2] : boxMin[2]));
+        if (clip[3] <= 1e-6f || clip[2] < -clip[3])
+            return true;
+
+        const float invW = 1.0f / clip[3];
+        const float x = (clip[0] * invW * 0.5f + 0.5f) * width;
+        const float y = (clip[1] * invW * 0.5f + 0.5f) * height;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearest = std::min(nearest, clip[2] * invW * 0.5f + 0.5f);
+    }
+
+    // every pixel the rectangle touches
+    const int x0 = std::max(0, (int)floorf(minX));
+    const int y0 = std::max(0, (int)floorf(minY));
+    const int x1 = std::min(width - 1, (int)floorf(maxX));
+    const int y1 = std::min(height - 1, (int)floorf(maxY));
+    if (x0 > x1 || y0 > y1)
+        return true; // off screen: for the frustum test to decide
+
+    for (int ty = y0 / kTile; ty <= y1 / kTile; ++ty)
+    {
+        for (int tx = x0 / kTile; tx <= x1 / kTile; ++tx)
+        {
+            const int tile = ty * tilesX + tx;
+            if (nearest > tileMax[tile])
+                continue; // behind everything in this tile
+
+            const int ox = tx * kTile, oy = ty * kTile;
+            if (TileVisible(tile, std::max(x0, ox), std::max(y0, oy),
+                    std::min(x1, ox + kTile - 1), std::min(y1, oy + kTile - 1), nearest))
+                return true;
+        }
+    }
+    return false;
+}
+
+bool SoftwareOcclusion::TileVisible(int tileIndex, int x0, int y0, int x1, int y1, float nearest) const
+{
+    const int ox = (tileIndex % tilesX) * kTile;
+    const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 lo = _mm_set1_ps((float)x0);
+    const __m128 hi = _mm_set1_ps((float)x1);
+    const __m128 z = _mm_set1_ps(nearest);
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        const float* row = &depth[(size_t)y * width];
+        for (int x = ox + ((x0 - ox) & ~3); x <= x1; x += 4)
+        {
+            const __m128 fx = _mm_add_ps(_mm_set1_ps((float)x), lane);
+            const __m128 inRange = _mm_and_ps(_mm_cmpge_ps(fx, lo), _mm_cmple_ps(fx, hi));
+            const __m128 open = _mm_cmpge_ps(_mm_loadu_ps(row + x), z);
+            if (_mm_movemask_ps(_mm_and_ps(inRange, open)))
+                return true;
+        }
+    }
+    return false;
+}
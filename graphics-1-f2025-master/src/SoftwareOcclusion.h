@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// ------------------------------------------------------------
+// CPU occlusion culling, no GPU readback: a few occluder meshes are
+// rasterized depth-only into a small buffer, and object AABBs are tested
+// against it before their draws are issued.
+//
+// The buffer is split into 32x32 tiles. Triangles are set up once per
+// frame and binned to the tiles they touch, then the tiles are rasterized
+// in parallel on the job system, 4 (SSE) or 8 (AVX2) pixels at a time,
+// sampling at pixel centers so meshes have no cracks. A 3x3 max filter
+// then keeps a pixel's depth only where all its neighbours are covered
+// too: occluders shrink by a pixel, so a box peeking past a silhouette is
+// not hidden by a partly covered pixel. Every tile also keeps the
+// farthest depth it holds, and boxes behind that skip its pixels.
+// ------------------------------------------------------------
+class SoftwareOcclusion
+{
+public:
+    enum SimdPath
+    {
+        kSimdAuto,  // AVX2 when the CPU has it
+        kSimdSSE,
+        kSimdAVX2,
+    };
+
+    SoftwareOcclusion() : width(0), height(0), tilesX(0), tilesY(0), simd(kSimdSSE) {}
+
+    // Sizes round up to whole tiles
+    void Create(int width, int height, SimdPath path = kSimdAuto);
+
+    // Non-indexed triangle list; position = first three floats of each
+    // stride-byte vertex. Occluders are static: baked to world space here.
+    void AddOccluder(const void* vertices, size_t stride, size_t vertexCount, const float model[16]);
+
+    // Same column-major matrices the render loop builds. Returns the
+    // number of triangles that reached the rasterizer.
+    int Render(const float view[16], const float projection[16]);
+
+    // Whether any part of the box may be visible (after Render). Boxes that
+    // are off screen or cross the near plane count as visible.
+    bool IsVisible(const float boxMin[3], const float boxMax[3]) const;
+
+    size_t GetOccluderTriangleCount() const { return occluders.size() / 9; }
+    SimdPath GetSimdPath() const { return simd; }
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+
+    static const int kTileSize = 32;
+
+private:
+    // screen-space triangle, edge functions >= 0 inside
+    struct Triangle
+    {
+        float edge[3][3];   // A, B, C per edge, at pixel centers
+        float depth[3];     // z = depth[0] * x + depth[1] * y + depth[2]
+        int minX, minY, maxX, maxY;
+    };
+
+    int width, height, tilesX, tilesY;
+    SimdPath simd;
+    float viewProj[16];
+    std::vector<float> occluders;               // world-space xyz, 9 floats per triangle
+    std::vector<Triangle> triangles;            // this frame's set-up triangles
+    std::vector<std::vector<int>> bins;         // triangle indices per tile
+    std::vector<float> raster;                  // as rasterized, 1 pixel border of 0
+    std::vector<float> depth;                   // after the 3x3 max filter, row-major
+    std::vector<float> tileMax;                 // farthest depth in each tile
+
+    void SetupTriangles();
+    void RasterizeTile(int tile);
+    void FilterTile(int tile);
+    bool TileVisible(int tile, int x0, int y0, int x1, int y1, float nearest) const;
+};
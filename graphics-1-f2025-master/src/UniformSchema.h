@@ -0,0 +1,118 @@
+#pragma once
+#include <cstddef>
+#include <glad/glad.h>
+
+// Typed uniform handles. Resolve once by name with Shader::GetUniform*(),
+// then Set() them every frame: no string lookups, and values equal to what
+// the program already holds are not re-uploaded. Handles survive hot reloads.
+struct UniformInt   { int slot = -1; };   // int, bool and sampler uniforms
+struct UniformFloat { int slot = -1; };
+struct UniformVec3  { int slot = -1; };
+struct UniformMat4  { int slot = -1; };
+
+// ------------------------------------------------------------
+// Compile-time uniform schema
+//
+// A program's uniforms are listed in a constexpr UniformDecl array. The
+// array index is the uniform's location: Shader injects matching
+// "layout(location = N) uniform ..." declarations into the sources (at a
+// "#pragma uniforms" line) and checks them against reflection after
+// linking. SchemaHandle() turns a name into a handle at compile time, so
+// per-frame uploads index straight into the slot table.
+// ------------------------------------------------------------
+enum UniformStage : unsigned
+{
+    kVertexStage = 1,
+    kFragmentStage = 2,
+    kComputeStage = 4,
+};
+
+struct UniformDecl
+{
+    const char* name;        // GL name, "uModel" or "dirLight.direction"
+    GLenum type;             // GL_FLOAT_VEC3, GL_BOOL, GL_SAMPLER_2D, ...
+    const char* structType;  // GLSL struct for "var.member" names, else nullptr
+    unsigned stages;         // UniformStage bits
+};
+
+constexpr bool ConstStrEqual(const char* a, const char* b)
+{
+    while (*a && *a == *b)
+    {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+// Length of the "var" part of "var.member" (whole length if no dot).
+constexpr size_t StructPrefixLength(const char* name)
+{
+    size_t n = 0;
+    while (name[n] && name[n] != '.')
+        ++n;
+    return n;
+}
+
+constexpr bool SamePrefix(const char* a, const char* b)
+{
+    const size_t n = StructPrefixLength(a);
+    if (n != StructPrefixLength(b))
+        return false;
+    for (size_t i = 0; i < n; ++i)
+        if (a[i] != b[i])
+            return false;
+    return true;
+}
+
+// Whether a handle of handleType may point at a uniform declared as glslType.
+constexpr bool HandleAccepts(GLenum handleType, GLenum glslType)
+{
+    return handleType == glslType ||
+        (handleType == GL_INT &&
+            (glslType == GL_BOOL || glslType == GL_SAMPLER_2D || glslType == GL_SAMPLER_2D_SHADOW ||
+             glslType == GL_SAMPLER_CUBE || glslType == GL_SAMPLER_3D || glslType == GL_SAMPLER_2D_ARRAY ||
+             glslType == GL_UNSIGNED_INT_SAMPLER_2D));
+}
+
+template <typename Handle> struct HandleType;
+template <> struct HandleType<UniformInt>   { static constexpr GLenum value = GL_INT; };
+template <> struct HandleType<UniformFloat> { static constexpr GLenum value = GL_FLOAT; };
+template <> struct HandleType<UniformVec3>  { static constexpr GLenum value = GL_FLOAT_VEC3; };
+template <> struct HandleType<UniformMat4>  { static constexpr GLenum value = GL_FLOAT_MAT4; };
+
+// Fails to compile (throw in a constant expression) if the name is missing
+// or the handle type does not fit the declaration.
+template <typename Handle, size_t N>
+constexpr Handle SchemaHandle(const UniformDecl (&decls)[N], const char* name)
+{
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (ConstStrEqual(decls[i].name, name))
+        {
+            if (!HandleAccepts(HandleType<Handle>::value, decls[i].type))
+                throw "uniform type does not match the handle type";
+            return Handle{ (int)i };
+        }
+    }
+    throw "uniform is not in the schema";
+}
+
+// Names are unique and members of one struct variable are adjacent
+// (a struct uniform occupies consecutive locations).
+template <size_t N>
+constexpr bool SchemaIsValid(const UniformDecl (&decls)[N])
+{
+    for (size_t i = 0; i < N; ++i)
+    {
+        for (size_t j = i + 1; j < N; ++j)
+        {
+            if (ConstStrEqual(decls[i].name, decls[j].name))
+                return false;
+            if (decls[i].structType && SamePrefix(decls[i].name, decls[j].name) &&
+                !SamePrefix(decls[i].name, decls[j - 1].name))
+                return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,146 @@
+#include "VisibilityBuffer.h"
+#include "VisibilityUniforms.h"
+#include "Flock.h"
+#include "GLState.h"
+
+namespace
+{
+    const char* kIdVertexPath = "shaders/visibility.vert";
+    const char* kIdFragPath = "shaders/visibility.frag";
+    const char* kFullscreenVertexPath = "shaders/fullscreen.vert";
+    const char* kResolveFragPath = "shaders/visibility_resolve.frag";
+
+    const GLsizeiptr kVertexBytes = 8 * sizeof(float);  // position, uv, normal
+}
+
+bool VisibilityBuffer::Create(int width_, int height_, const std::vector<VisibilityMesh>& sceneMeshes,
+    std::string& errorOut)
+{
+    width = width_;
+    height = height_;
+
+    glGenTextures(1, &ids);
+    glBindTexture(GL_TEXTURE_2D, ids);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ids, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete)
+    {
+        errorOut = "visibility framebuffer is incomplete";
+        return false;
+    }
+
+    // ID ranges and vertex offsets, then every mesh's vertices copied back to back
+    meshes.clear();
+    instanceCounts.clear();
+    GLuint firstVertex = 0, firstID = 0;
+    for (const VisibilityMesh& m : sceneMeshes)
+    {
+        VisibilityMeshData d;
+        d.firstVertex = firstVertex;
+        d.triangleCount = (GLuint)m.vertexCount / 3;
+        d.firstInstance = m.firstInstance;
+        d.firstID = firstID;
+        for (int k = 0; k < 3; ++k)
+            d.baseColor[k] = m.baseColor[k];
+        d.flags = (m.useTexture ? kVisibilityTextured : 0) | (m.useLighting ? kVisibilityLit : 0);
+        meshes.push_back(d);
+        instanceCounts.push_back((GLsizei)m.instanceCount);
+
+        firstVertex += (GLuint)m.vertexCount;
+        firstID += d.triangleCount * m.instanceCount;
+    }
+
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, firstVertex * kVertexBytes, nullptr, GL_STATIC_DRAW);
+    for (size_t i = 0; i < sceneMeshes.size(); ++i)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, sceneMeshes[i].vbo);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, meshes[i].firstVertex * kVertexBytes,
+            sceneMeshes[i].vertexCount * kVertexBytes);
+    }
+
+    glGenBuffers(1, &meshBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, meshBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, meshes.size() * sizeof(VisibilityMeshData), meshes.data(), GL_STATIC_DRAW);
+
+    glGenVertexArrays(1, &emptyVao);
+
+    idShader.SetUniformSchema(kVisibilityUniformDecls);
+    resolveShader.SetUniformSchema(kVisibilityUniformDecls);
+    return idShader.CreateFromFiles(kIdVertexPath, kIdFragPath, errorOut) &&
+        resolveShader.CreateFromFiles(kFullscreenVertexPath, kResolveFragPath, errorOut);
+}
+
+void VisibilityBuffer::Destroy()
+{
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &ids);
+    glDeleteRenderbuffers(1, &depth);
+    GLuint buffers[2] = { vertexBuffer, meshBuffer };
+    glDeleteBuffers(2, buffers);
+    glDeleteVertexArrays(1, &emptyVao);
+    idShader.Destroy();
+    resolveShader.Destroy();
+    gGLState.Invalidate();
+    fbo = ids = depth = vertexBuffer = meshBuffer = emptyVao = 0;
+}
+
+void VisibilityBuffer::PollHotReload()
+{
+    idShader.PollHotReload();
+    resolveShader.PollHotReload();
+}
+
+void VisibilityBuffer::Draw(const RingBuffer& instanceRing, const RingBuffer::Allocation& instances)
+{
+    const GLuint noID = 0;
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glClearBufferuiv(GL_COLOR, 0, &noID);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    // the ring was full: the resolve pass sees an empty buffer
+    if (!instanceRing.BindRange(kFlockInstanceBinding, instances))
+        return;
+    gGLState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kVisibilityVertexBinding, vertexBuffer);
+    gGLState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kVisibilityMeshBinding, meshBuffer);
+
+    idShader.Use();
+    gGLState.BindVertexArray(emptyVao);
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        const VisibilityMeshData& m = meshes[i];
+        idShader.Set(Visibility::mesh, (int)i);
+        glDrawArraysInstanced(GL_TRIANGLES, (GLint)m.firstVertex, (GLsizei)m.triangleCount * 3, instanceCounts[i]);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void VisibilityBuffer::Resolve(GLuint diffuseTexture)
+{
+    gGLState.BindTexture(kVisibilityUnit, GL_TEXTURE_2D, ids);
+    gGLState.BindTexture(0, GL_TEXTURE_2D, diffuseTexture);
+
+    // background pixels discard and keep the window's clear colour
+    gGLState.SetEnabled(GL_DEPTH_TEST, false);
+    resolveShader.Use();
+    resolveShader.Set(Visibility::meshCount, (int)meshes.size());
+    resolveShader.Set(Visibility::visibilityMap, (int)kVisibilityUnit);
+    resolveShader.Set(Visibility::diffuseMap, 0);
+    gGLState.BindVertexArray(emptyVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    gGLState.SetEnabled(GL_DEPTH_TEST, true);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "RingBuffer.h"
+#include "Shader.h"
+
+const unsigned int kVisibilityVertexBinding = 9;   // shader storage: every mesh's Vertex array
+const unsigned int kVisibilityMeshBinding = 10;    // shader storage: VisibilityMeshData[]
+const GLuint kVisibilityUnit = 5;                  // ID texture while the shading pass reads it
+
+// One mesh of the scene: a non-indexed triangle list with main.cpp's
+// Vertex layout, drawn instanceCount times with the instances starting
+// at firstInstance in the BirdInstance array handed to Draw().
+struct VisibilityMesh
+{
+    GLuint vbo;
+    GLsizei vertexCount;
+    GLuint firstInstance;
+    GLuint instanceCount;
+    float baseColor[3];     // as ObjectBlock
+    bool useTexture;
+    bool useLighting;
+};
+
+// std430 element of the mesh table in shaders/visibility*.
+struct VisibilityMeshData
+{
+    GLuint firstVertex, triangleCount, firstInstance, firstID;
+    float baseColor[3];
+    GLuint flags;           // kVisibilityTextured | kVisibilityLit
+};
+
+static_assert(sizeof(VisibilityMeshData) == 32, "std430 VisibilityMeshData");
+
+const GLuint kVisibilityTextured = 1;
+const GLuint kVisibilityLit = 2;
+
+// ------------------------------------------------------------
+// --visibility: the scene is rasterized once into a 32-bit ID target and
+// shaded afterwards, exactly once per pixel. Every triangle of every
+// instance owns one ID,
+//
+//   id = mesh.firstID + instance * mesh.triangleCount + gl_PrimitiveID + 1
+//
+// (0 = nothing drawn). The shading pass is one full-screen triangle: it
+// decodes the ID, fetches the triangle's three vertices and the instance
+// transform, intersects the pixel's view ray with the triangle for the
+// barycentrics (perspective-correct, and again one pixel over in x and y
+// for the texture gradients) and lights the result with phong.frag's
+// functions. Overdraw then only costs the ID writes.
+// ------------------------------------------------------------
+class VisibilityBuffer
+{
+public:
+    VisibilityBuffer() : width(0), height(0), fbo(0), ids(0), depth(0), vertexBuffer(0),
+        meshBuffer(0), emptyVao(0) {}
+
+    // Copies the meshes' vertices into one storage buffer
+    bool Create(int width, int height, const std::vector<VisibilityMesh>& meshes, std::string& errorOut);
+    void Destroy();
+    void PollHotReload();
+
+    // Rasterizes the IDs; instances as the meshes' firstInstance expects them.
+    void Draw(const RingBuffer& instanceRing, const RingBuffer::Allocation& instances);
+
+    // Shades every covered pixel into the window; diffuseTexture for the
+    // textured meshes.
+    void Resolve(GLuint diffuseTexture);
+
+private:
+    int width, height;
+    GLuint fbo, ids, depth;
+    GLuint vertexBuffer, meshBuffer;
+    GLuint emptyVao;                    // vertices are fetched from the storage buffer
+    std::vector<VisibilityMeshData> meshes;
+    std::vector<GLsizei> instanceCounts;
+    Shader idShader, resolveShader;
+};
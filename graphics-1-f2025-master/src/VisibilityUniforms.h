@@ -0,0 +1,25 @@
+#pragma once
+#include "UniformSchema.h"
+
+// ------------------------------------------------------------
+// Uniforms of the visibility buffer programs (src/VisibilityBuffer.h):
+// shaders/visibility.vert/.frag and visibility_resolve.frag.
+// Camera and lights come from CameraBlock and LightBlock.
+// ------------------------------------------------------------
+constexpr UniformDecl kVisibilityUniformDecls[] = {
+    { "uMesh",                  GL_INT,                       nullptr, kVertexStage | kFragmentStage },
+    { "uMeshCount",             GL_INT,                       nullptr, kFragmentStage },
+    { "uVisibilityMap",         GL_UNSIGNED_INT_SAMPLER_2D,   nullptr, kFragmentStage },
+    { "uDiffuseMap",            GL_SAMPLER_2D,                nullptr, kFragmentStage },
+};
+
+static_assert(SchemaIsValid(kVisibilityUniformDecls), "duplicate uniform or split struct in kVisibilityUniformDecls");
+
+// Handles, checked against the schema at compile time
+namespace Visibility
+{
+    constexpr UniformInt mesh = SchemaHandle<UniformInt>(kVisibilityUniformDecls, "uMesh");
+    constexpr UniformInt meshCount = SchemaHandle<UniformInt>(kVisibilityUniformDecls, "uMeshCount");
+    constexpr UniformInt visibilityMap = SchemaHandle<UniformInt>(kVisibilityUniformDecls, "uVisibilityMap");
+    constexpr UniformInt diffuseMap = SchemaHandle<UniformInt>(kVisibilityUniformDecls, "uDiffuseMap");
+}
@@ -2,6 +2,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "Window.h"
+#include "GLExtensions.h"
 #include <cassert>
 struct App
 {
@@ -27,6 +28,7 @@ void CreateWindow(int width, int height, const char* title)
 
     // Load OpenGL extensions
     assert(gladLoadGLLoader((GLADloadproc)glfwGetProcAddress));
+    LoadGLExtensions((GLADloadproc)glfwGetProcAddress);
 }
 
 bool WindowShouldClose()
@@ -2,13 +2,46 @@
 #include <GLFW/glfw3.h>
 #include "Window.h"
 #include "Shader.h"
+#include "PhongUniforms.h"
+#include "FrameUniforms.h"
+#include "RingBuffer.h"
+#include "GLState.h"
+#include "Flock.h"
+#include "MeshScene.h"
+#include "GpuCulling.h"
+#include "HiZ.h"
+#include "CullUniforms.h"
+#include "Frustum.h"
+#include "SoftwareOcclusion.h"
+#include "ClusteredLighting.h"
+#include "Deferred.h"
+#include "VisibilityBuffer.h"
+#include "NormalMatrix.h"
+#include "SimdMath.h"
+#include "ConstexprMath.h"
+#include "BatchTransform.h"
+#include "FrustumCull.h"
+#include "Bvh.h"
+#include "ShadowMaps.h"
+#include "ShaderVariants.h"
+#include "JobSystem.h"
+#include "Profile.h"
+#include "GLStats.h"
+#include "GLExtensions.h"
+#include "Bench.h"
+#include "ObjLoader.h"
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <string>
+#include <iterator>
 #include <cmath>    // for sin, cos, tan, sqrt
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
 
 using namespace std;
 
@@ -19,286 +52,62 @@ using namespace std;
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 800;
 
-// ------------------------------------------------------------
-// Simple math/OBJ data structures (from Assignment 3)
-// ------------------------------------------------------------
-
-struct Vec2
-{
-    float x, y;
-};
-
-struct Vec3
-{
-    float x, y, z;
-};
-
-struct Face
-{
-    int v[3];   // position indices
-    int vt[3];  // texcoord indices
-    int vn[3];  // normal indices
-};
-
-struct ObjData
-{
-    vector<Vec3> positions; // "v"  lines
-    vector<Vec2> tcoords;   // "vt" lines
-    vector<Vec3> normals;   // "vn" lines
-    vector<Face> faces;     // "f"  lines
-};
-
-struct Vertex
-{
-    Vec3 position;
-    Vec2 uv;
-    Vec3 normal;
-};
+// packed, with constexpr operators (src/ConstexprMath.h)
+using Vec3 = cx::Vec3;
 
 // ------------------------------------------------------------
-// Tiny vector math helpers (no GLM)
+// Tiny vector math helpers (no GLM): Vec3's +, -, *, Dot and Cross come
+// with it from src/ConstexprMath.h. cx::Normalize and cx::Length iterate
+// for their square root, so they are for constants; code that runs every
+// frame uses these, on the SIMD types (src/SimdMath.h).
 // ------------------------------------------------------------
+using cx::DegToRad;
 
-Vec3 operator+(const Vec3& a, const Vec3& b)
+simd::Vec3 ToSimd(const Vec3& v)
 {
-    return { a.x + b.x, a.y + b.y, a.z + b.z };
+    return simd::Vec3(v.x, v.y, v.z);
 }
 
-Vec3 operator-(const Vec3& a, const Vec3& b)
+Vec3 FromSimd(const simd::Vec3& v)
 {
-    return { a.x - b.x, a.y - b.y, a.z - b.z };
+    return { v.X(), v.Y(), v.Z() };
 }
 
-Vec3 operator*(const Vec3& a, float s)
+// Unit vector along v; zero for zero input
+Vec3 Direction(const Vec3& v)
 {
-    return { a.x * s, a.y * s, a.z * s };
+    return FromSimd(simd::Normalize(ToSimd(v)));
 }
 
-float Dot(const Vec3& a, const Vec3& b)
+float Magnitude(const Vec3& v)
 {
-    return a.x * b.x + a.y * b.y + a.z * b.z;
-}
-
-Vec3 Cross(const Vec3& a, const Vec3& b)
-{
-    return {
-        a.y * b.z - a.z * b.y,
-        a.z * b.x - a.x * b.z,
-        a.x * b.y - a.y * b.x
-    };
-}
-
-Vec3 Normalize(const Vec3& v)
-{
-    float len2 = v.x * v.x + v.y * v.y + v.z * v.z;
-    if (len2 <= 0.0f) return { 0.0f, 0.0f, 0.0f };
-    float invLen = 1.0f / sqrtf(len2);
-    return { v.x * invLen, v.y * invLen, v.z * invLen };
-}
-
-float DegToRad(float deg)
-{
-    return deg * 3.14159265f / 180.0f;
-}
-
-// ------------------------------------------------------------
-// Very small OBJ loader for v/vt/vn/f (triangles) - unchanged
-// ------------------------------------------------------------
-bool LoadOBJ(const string& path, ObjData& out)
-{
-    ifstream file(path);
-    if (!file.is_open())
-    {
-        cerr << "Failed to open OBJ file: " << path << "\n";
-        return false;
-    }
-
-    out.positions.clear();
-    out.tcoords.clear();
-    out.normals.clear();
-    out.faces.clear();
-
-    string line;
-    while (getline(file, line))
-    {
-        if (line.empty() || line[0] == '#')
-            continue;
-
-        istringstream iss(line);
-        string type;
-        iss >> type;
-
-        if (type == "v")
-        {
-            Vec3 p;
-            iss >> p.x >> p.y >> p.z;
-            out.positions.push_back(p);
-        }
-        else if (type == "vt")
-        {
-            Vec2 t;
-            iss >> t.x >> t.y;
-            out.tcoords.push_back(t);
-        }
-        else if (type == "vn")
-        {
-            Vec3 n;
-            iss >> n.x >> n.y >> n.z;
-            out.normals.push_back(n);
-        }
-        else if (type == "f")
-        {
-            Face f = {};
-
-            for (int i = 0; i < 3; ++i)
-            {
-                string token;
-                iss >> token; // e.g. "2/1/1"
-                if (token.empty())
-                    break;
-
-                size_t s1 = token.find('/');
-                size_t s2 = token.find('/', s1 + 1);
-
-                int vi = 0;
-                int vti = 0;
-                int vni = 0;
-
-                if (s1 == string::npos)
-                {
-                    // Only vertex index present
-                    vi = stoi(token);
-                }
-                else
-                {
-                    string vStr = token.substr(0, s1);
-                    string vtStr;
-                    string vnStr;
-
-                    if (s2 == string::npos)
-                    {
-                        // "v/vt"
-                        vtStr = token.substr(s1 + 1);
-                    }
-                    else
-                    {
-                        // "v/vt/vn"
-                        vtStr = token.substr(s1 + 1, s2 - (s1 + 1));
-                        vnStr = token.substr(s2 + 1);
-                    }
-
-                    if (!vStr.empty())  vi = stoi(vStr);
-                    if (!vtStr.empty()) vti = stoi(vtStr);
-                    if (!vnStr.empty()) vni = stoi(vnStr);
-                }
-
-                f.v[i] = vi;
-                f.vt[i] = vti;
-                f.vn[i] = vni;
-            }
-
-            out.faces.push_back(f);
-        }
-    }
-
-    cout << "Loaded OBJ: " << path << "\n";
-    cout << "  positions: " << out.positions.size() << "\n";
-    cout << "  tcoords:   " << out.tcoords.size() << "\n";
-    cout << "  normals:   " << out.normals.size() << "\n";
-    cout << "  faces:     " << out.faces.size() << "\n";
-
-    return true;
+    return simd::Length(ToSimd(v));
 }
 
 // ------------------------------------------------------------
-// Convert OBJ data (indexed) to flat OpenGL vertices
-// (includes a scale factor to make the Bird bigger)
+// Simple 4x4 matrix helpers (column-major float[16], uploaded with GL_FALSE).
+// The constexpr ones let a fixed camera be built at compile time; see the
+// projection in the render loop. MakeLookAt runs every frame.
 // ------------------------------------------------------------
-vector<Vertex> BuildVerticesFromObj(const ObjData& obj)
+constexpr void CopyMatrix(const cx::Mat4& from, float m[16])
 {
-    vector<Vertex> verts;
-    verts.reserve(obj.faces.size() * 3);
-
-    const float scale = 2.5f;   // <--- tweak this if Bird is too small/big
-
-    for (const Face& f : obj.faces)
-    {
-        for (int i = 0; i < 3; ++i)
-        {
-            int vi = f.v[i] - 1; // OBJ indices start at 1
-            int vti = f.vt[i] - 1;
-            int vni = f.vn[i] - 1;
-
-            Vertex v = {};
-
-            if (vi >= 0 && vi < (int)obj.positions.size())
-            {
-                Vec3 p = obj.positions[vi];
-                p.x *= scale;
-                p.y *= scale;
-                p.z *= scale;
-                v.position = p;
-            }
-            else
-            {
-                v.position = { 0.f, 0.f, 0.f };
-            }
-
-            if (vti >= 0 && vti < (int)obj.tcoords.size())
-                v.uv = obj.tcoords[vti];
-            else
-                v.uv = { 0.f, 0.f };
-
-            if (vni >= 0 && vni < (int)obj.normals.size())
-                v.normal = obj.normals[vni];
-            else
-                v.normal = { 0.f, 0.f, 1.f };
-
-            verts.push_back(v);
-        }
-    }
-
-    cout << "Built " << verts.size() << " vertices from OBJ.\n";
-    return verts;
+    for (int i = 0; i < 16; ++i)
+        m[i] = from.m[i];
 }
 
-// ------------------------------------------------------------
-// Simple 4x4 matrix helpers (row-major, we upload with GL_FALSE)
-// ------------------------------------------------------------
-void MakeIdentity(float m[16])
+constexpr void MakeIdentity(float m[16])
 {
-    for (int i = 0; i < 16; ++i) m[i] = 0.0f;
-    m[0] = m[5] = m[10] = m[15] = 1.0f;
+    CopyMatrix(cx::Identity(), m);
 }
 
-void MakePerspective(float fovDeg, float aspect, float zNear, float zFar, float m[16])
+constexpr void MakePerspective(float fovDeg, float aspect, float zNear, float zFar, float m[16])
 {
-    float fovRad = DegToRad(fovDeg);
-    float f = 1.0f / tanf(fovRad * 0.5f);
-
-    for (int i = 0; i < 16; ++i) m[i] = 0.0f;
-
-    m[0] = f / aspect;
-    m[5] = f;
-    m[10] = (zFar + zNear) / (zNear - zFar);
-    m[11] = -1.0f;
-    m[14] = (2.0f * zFar * zNear) / (zNear - zFar);
+    CopyMatrix(cx::Perspective(DegToRad(fovDeg), aspect, zNear, zFar), m);
 }
 
 void MakeLookAt(const Vec3& eye, const Vec3& center, const Vec3& up, float m[16])
 {
-    Vec3 f = Normalize(center - eye);
-    Vec3 s = Normalize(Cross(f, up));
-    Vec3 u = Cross(s, f);
-
-    // Row-major
-    m[0] = s.x; m[1] = u.x; m[2] = -f.x; m[3] = 0.0f;
-    m[4] = s.y; m[5] = u.y; m[6] = -f.y; m[7] = 0.0f;
-    m[8] = s.z; m[9] = u.z; m[10] = -f.z; m[11] = 0.0f;
-    m[12] = -Dot(s, eye);
-    m[13] = -Dot(u, eye);
-    m[14] = Dot(f, eye);
-    m[15] = 1.0f;
+    simd::LookAt(ToSimd(eye), ToSimd(center), ToSimd(up)).Store(m);
 }
 
 // ------------------------------------------------------------
@@ -318,12 +127,12 @@ struct Camera
         front.x = cosf(DegToRad(yaw)) * cosf(DegToRad(pitch));
         front.y = sinf(DegToRad(pitch));
         front.z = sinf(DegToRad(yaw)) * cosf(DegToRad(pitch));
-        return Normalize(front);
+        return Direction(front);
     }
 
     Vec3 GetRight() const
     {
-        return Normalize(Cross(GetForward(), { 0.0f, 1.0f, 0.0f }));
+        return Direction(Cross(GetForward(), { 0.0f, 1.0f, 0.0f }));
     }
 
     void GetViewMatrix(float out[16]) const
@@ -367,32 +176,46 @@ void UpdateCameraFromInput(Camera& cam, float dt, GLFWwindow* window)
 
 // ------------------------------------------------------------
 // Procedural checkerboard texture (safe fallback, no extra libs)
+// Pixels are generated on the CPU (any thread), the upload needs the
+// GL context and stays on the main thread.
 // ------------------------------------------------------------
-GLuint CreateCheckerTexture()
+struct ImageData
+{
+    int width = 0;
+    int height = 0;
+    vector<unsigned char> pixels; // RGB8
+};
+
+ImageData BuildCheckerImage()
 {
-    const int W = 64;
-    const int H = 64;
-    vector<unsigned char> data(W * H * 3);
+    ImageData img;
+    img.width = 64;
+    img.height = 64;
+    img.pixels.resize(img.width * img.height * 3);
 
-    for (int y = 0; y < H; ++y)
+    for (int y = 0; y < img.height; ++y)
     {
-        for (int x = 0; x < W; ++x)
+        for (int x = 0; x < img.width; ++x)
         {
-            int idx = (y * W + x) * 3;
+            int idx = (y * img.width + x) * 3;
             int check = ((x / 8) + (y / 8)) % 2;
             unsigned char v = check ? 230 : 50;
-            data[idx + 0] = v;
-            data[idx + 1] = v;
-            data[idx + 2] = v;
+            img.pixels[idx + 0] = v;
+            img.pixels[idx + 1] = v;
+            img.pixels[idx + 2] = v;
         }
     }
+    return img;
+}
 
+GLuint CreateTextureFromImage(const ImageData& img)
+{
     GLuint tex = 0;
     glGenTextures(1, &tex);
     glBindTexture(GL_TEXTURE_2D, tex);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, W, H, 0,
-        GL_RGB, GL_UNSIGNED_BYTE, data.data());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, img.width, img.height, 0,
+        GL_RGB, GL_UNSIGNED_BYTE, img.pixels.data());
     glGenerateMipmap(GL_TEXTURE_2D);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -412,197 +235,431 @@ GLuint CreateCheckerTexture()
         void LoadImageFromFile(Image* img, const char* filename);
         void LoadTexture(Texture* tex, const Image& img);
 
-    you could replace CreateCheckerTexture() with a loader that reads
-    "TEXTURE.jpg" and uploads it. I'm leaving the checkerboard here
+    you could replace BuildCheckerImage() with a loader that reads
+    "TEXTURE.jpg" into an ImageData. I'm leaving the checkerboard here
     to guarantee this file compiles and runs on your current setup.
 */
 
 // ------------------------------------------------------------
-// Phong vertex & fragment shaders (inline)
+// Phong vertex & fragment shaders live in shaders/ next to Bird.obj,
+// so they can be edited while the program runs (see PollHotReload)
 // ------------------------------------------------------------
-static const char* phongVertexSrc = R"(
-#version 430 core
+static const char* phongVertexPath = "shaders/phong.vert";
+static const char* phongFragPath = "shaders/phong.frag";
+static const char* phongInstancedVertexPath = "shaders/phong_instanced.vert";
+static const char* phongIndirectVertexPath = "shaders/phong_indirect.vert";
+static const char* cullComputePath = "shaders/cull.comp";
+static const char* hizComputePath = "shaders/hiz.comp";
+static const char* phongClusteredFragPath = "shaders/phong_clustered.frag";
+static const char* clustersComputePath = "shaders/clusters.comp";
+static const char* gbufferFragPath = "shaders/gbuffer.frag";
 
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoord;
-layout (location = 2) in vec3 aNormal;
-
-out vec2 vTexCoord;
-out vec3 vNormal;
-out vec3 vFragPos;
+// ------------------------------------------------------------
+// Lighting setup (visually distinct), written into the std140 LightBlock
+// ------------------------------------------------------------
+void SetVec3(float v[3], float x, float y, float z)
+{
+    v[0] = x; v[1] = y; v[2] = z;
+}
 
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProjection;
+void SetupLights(LightBlock& lights, float time)
+{
+    // Directional light towards (-1, -1, -1) - soft white "sun"
+    Std140DirectionalLight& dir = lights.dirLight;
+    SetVec3(dir.direction, -1.0f, -1.0f, -1.0f);
+    SetVec3(dir.ambient, 0.15f, 0.15f, 0.15f);
+    SetVec3(dir.diffuse, 0.4f, 0.4f, 0.4f);
+    SetVec3(dir.specular, 0.5f, 0.5f, 0.5f);
+
+    // Point light animated in a circle (radius 10, height 5) - BRIGHT RED
+    float radius = 10.0f;
+    float speed = 1.0f;
+    float lx = cosf(time * speed) * radius;
+    float lz = sinf(time * speed) * radius;
+    float ly = 5.0f;
+
+    Std140PointLight& point = lights.pointLight;
+    SetVec3(point.position, lx, ly, lz);
+    SetVec3(point.ambient, 0.02f, 0.0f, 0.0f);
+    SetVec3(point.diffuse, 1.0f, 0.2f, 0.2f);     // RED – easy to see moving
+    SetVec3(point.specular, 1.0f, 0.2f, 0.2f);
+    point.constant = 1.0f;
+    point.linear = 0.09f;
+    point.quadratic = 0.032f;
+
+    // Spotlight 5 units above Bird, pointing downward - WARM YELLOW CONE
+    Std140SpotLight& spot = lights.spotLight;
+    SetVec3(spot.position, 0.0f, 5.0f, 0.0f);
+    SetVec3(spot.direction, 0.0f, -1.0f, 0.0f);
+    SetVec3(spot.ambient, 0.0f, 0.0f, 0.0f);
+    SetVec3(spot.diffuse, 1.0f, 1.0f, 0.7f);      // warm yellowish
+    SetVec3(spot.specular, 1.0f, 1.0f, 0.9f);
+    constexpr float kCutOff = cx::Cos(DegToRad(10.0f)), kOuterCutOff = cx::Cos(DegToRad(14.0f));
+    spot.cutOff = kCutOff;
+    spot.outerCutOff = kOuterCutOff;
+    spot.constant = 1.0f;
+    spot.linear = 0.09f;
+    spot.quadratic = 0.032f;
+}
 
-void main()
+// ------------------------------------------------------------
+// --lights N: the point and spot light above, then N small coloured lights
+// drifting over the ground, every fourth one a spot pointing down. Ranges
+// come from each light's own attenuation.
+// ------------------------------------------------------------
+void SetClusterLight(ClusterLight& out, const float position[3], const float direction[3], float type,
+    const float ambient[3], const float diffuse[3], const float specular[3],
+    float cutOff, float outerCutOff, float constant, float linear, float quadratic)
 {
-    vec4 worldPos = uModel * vec4(aPos, 1.0);
-    vFragPos = worldPos.xyz;
+    memset(&out, 0, sizeof(out));
+    float brightest = 0.0f;
+    for (int k = 0; k < 3; ++k)
+    {
+        out.position[k] = position[k];
+        out.direction[k] = direction[k];
+        out.ambient[k] = ambient[k];
+        out.diffuse[k] = diffuse[k];
+        out.specular[k] = specular[k];
+        brightest = max(brightest, max(ambient[k], max(diffuse[k], specular[k])));
+    }
+    out.type = type;
+    out.cutOff = cutOff;
+    out.outerCutOff = outerCutOff;
+    out.constant = constant;
+    out.linear = linear;
+    out.quadratic = quadratic;
+    out.range = ClusteredLighting::LightRange(constant, linear, quadratic, brightest);
+}
 
-    vNormal = mat3(transpose(inverse(uModel))) * aNormal;
-    vTexCoord = aTexCoord;
+void SetupClusterLights(vector<ClusterLight>& out, const LightBlock& lights, int extra, float time)
+{
+    out.resize(2 + extra);
 
-    gl_Position = uProjection * uView * worldPos;
-}
-)";
+    const Std140PointLight& point = lights.pointLight;
+    const float down[3] = { 0.0f, -1.0f, 0.0f };
+    SetClusterLight(out[0], point.position, down, kClusterPointLight, point.ambient, point.diffuse,
+        point.specular, 0.0f, 0.0f, point.constant, point.linear, point.quadratic);
 
-static const char* phongFragSrc = R"(
-#version 430 core
+    const Std140SpotLight& spot = lights.spotLight;
+    SetClusterLight(out[1], spot.position, spot.direction, kClusterSpotLight, spot.ambient, spot.diffuse,
+        spot.specular, spot.cutOff, spot.outerCutOff, spot.constant, spot.linear, spot.quadratic);
 
-in vec2 vTexCoord;
-in vec3 vNormal;
-in vec3 vFragPos;
-out vec4 FragColor;
+    const float none[3] = { 0.0f, 0.0f, 0.0f };
+    constexpr float kSpotCutOff = cx::Cos(DegToRad(20.0f)), kSpotOuterCutOff = cx::Cos(DegToRad(30.0f));
+    for (int i = 0; i < extra; ++i)
+    {
+        // sunflower spiral over a disc of radius 45, each light circling its spot
+        float angle = i * 2.39996f;
+        float radius = 3.0f + 42.0f * sqrtf((i + 0.5f) / extra);
+        float phase = time * (0.5f + 0.1f * (i % 7)) + i;
+        float position[3] = {
+            cosf(angle) * radius + 1.5f * cosf(phase),
+            0.6f + 0.4f * sinf(phase * 1.3f),
+            sinf(angle) * radius + 1.5f * sinf(phase) };
+
+        // hue around the colour wheel
+        float hue = fmodf(i * 0.618034f, 1.0f) * 6.0f;
+        float color[3] = {
+            min(1.0f, max(0.0f, fabsf(hue - 3.0f) - 1.0f)),
+            min(1.0f, max(0.0f, 2.0f - fabsf(hue - 2.0f))),
+            min(1.0f, max(0.0f, 2.0f - fabsf(hue - 4.0f))) };
+        float diffuse[3] = { 2.0f * color[0], 2.0f * color[1], 2.0f * color[2] };
+        float specular[3] = { 0.5f * color[0], 0.5f * color[1], 0.5f * color[2] };
+
+        if (i % 4 == 3)
+        {
+            position[1] = 3.0f;
+            SetClusterLight(out[2 + i], position, down, kClusterSpotLight, none, diffuse, specular,
+                kSpotCutOff, kSpotOuterCutOff, 1.0f, 0.2f, 2.0f);
+        }
+        else
+        {
+            SetClusterLight(out[2 + i], position, down, kClusterPointLight, none, diffuse, specular,
+                0.0f, 0.0f, 1.0f, 0.5f, 20.0f);
+        }
+    }
+}
 
-// Material / control
-uniform sampler2D uDiffuseMap;
-uniform vec3  uBaseColor;
-uniform bool  uUseTexture;
-uniform bool  uUseLighting;
-uniform vec3  uViewPos;
+// Copies one draw's ObjectBlock into the ring (a single write to mapped
+// memory), with the normal matrix filled in from its model matrix
+RingBuffer::Allocation PushObject(RingBuffer& ring, const ObjectBlock& object)
+{
+    RingBuffer::Allocation a = ring.Alloc(sizeof(ObjectBlock));
+    if (a.ptr)
+    {
+        ObjectBlock block = object;
+        ComputeNormalMatrix(block.model, block.normalMatrix);
+        memcpy(a.ptr, &block, sizeof(ObjectBlock));
+    }
+    return a;
+}
 
-// Directional light
-struct DirectionalLight
+// ------------------------------------------------------------
+// Phong variants (src/ShaderVariants.h): the flags a draw's ObjectBlock
+// carries become the variant key, so each draw gets a program without
+// the branches it never takes
+// ------------------------------------------------------------
+string GLSLFloat(float v)
 {
-    vec3 direction;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
+    char text[32];
+    snprintf(text, sizeof(text), "%#.9g", v); // always with a decimal point
+    return text;
+}
 
-// Point light
-struct PointLight
+string GLSLVec3(const float v[3])
 {
-    vec3 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float constant;
-    float linear;
-    float quadratic;
-};
+    return "vec3(" + GLSLFloat(v[0]) + ", " + GLSLFloat(v[1]) + ", " + GLSLFloat(v[2]) + ")";
+}
 
-// Spotlight
-struct SpotLight
+// The switches of phong.frag, phong_clustered.frag and gbuffer.frag. The
+// sun and the spot light never move, so their current values can be
+// compiled in.
+vector<ShaderFeature> PhongFeatures(const LightBlock& lights)
 {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float constant;
-    float linear;
-    float quadratic;
-};
+    const Std140DirectionalLight& d = lights.dirLight;
+    const Std140SpotLight& s = lights.spotLight;
+    const string dirLight = "DirectionalLight(" + GLSLVec3(d.direction) + ", " + GLSLVec3(d.ambient) + ", " +
+        GLSLVec3(d.diffuse) + ", " + GLSLVec3(d.specular) + ")";
+    const string spotLight = "SpotLight(" + GLSLVec3(s.position) + ", " + GLSLVec3(s.direction) + ", " +
+        GLSLFloat(s.cutOff) + ", " + GLSLFloat(s.outerCutOff) + ", " + GLSLVec3(s.ambient) + ", " +
+        GLSLVec3(s.diffuse) + ", " + GLSLVec3(s.specular) + ", " + GLSLFloat(s.constant) + ", " +
+        GLSLFloat(s.linear) + ", " + GLSLFloat(s.quadratic) + ")";
 
-uniform DirectionalLight dirLight;
-uniform PointLight       pointLight;
-uniform SpotLight        spotLight;
+    return {
+        { kPhongTexture, "#define HAS_TEXTURE true\n", "#define HAS_TEXTURE false\n" },
+        { kPhongLighting, "#define HAS_LIGHTING true\n", "#define HAS_LIGHTING false\n" },
+        { kPhongStaticLights, "#define STATIC_DIR_LIGHT " + dirLight + "\n#define STATIC_SPOT_LIGHT " + spotLight + "\n", "" },
+        { kPhongShadows, "#define HAS_SHADOWS\n", "" },
+    };
+}
 
-vec3 GetBaseColor()
+unsigned PhongVariantKey(const ObjectBlock& object, bool staticLights)
 {
-    if (uUseTexture)
-    {
-        return texture(uDiffuseMap, vTexCoord).rgb;
-    }
-    else
-    {
-        return uBaseColor;
-    }
+    return (object.useTexture ? kPhongTexture : 0u) | (object.useLighting ? kPhongLighting : 0u) |
+        (staticLights ? kPhongStaticLights : 0u);
 }
 
-vec3 CalcDirectional(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 color)
+// The texture units phong.frag samples: the diffuse map and, in programs
+// built with HAS_SHADOWS, the shadow maps (elsewhere those are optimized out)
+void SetPhongSamplers(Shader& shader)
 {
-    vec3 lightDir = normalize(-light.direction);
-    float diff = max(dot(normal, lightDir), 0.0);
+    shader.Set(Phong::diffuseMap, 0);
+    shader.Set(Phong::dirShadowMap, (int)kDirShadowUnit);
+    shader.Set(Phong::spotShadowMap, (int)kSpotShadowUnit);
+}
 
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+// The variant for key, or the uber shader (--uber-shader, or the variant failed)
+Shader& SelectPhong(ShaderVariants& variants, Shader& uber, unsigned key, bool useVariants)
+{
+    Shader* variant = useVariants ? variants.Get(key) : nullptr;
+    return variant ? *variant : uber;
+}
 
-    vec3 ambient  = light.ambient  * color;
-    vec3 diffuse  = light.diffuse  * diff * color;
-    vec3 specular = light.specular * spec;
-    return ambient + diffuse + specular;
+string PhongVariantName(unsigned key)
+{
+    string name = (key & kPhongTexture) ? "textured" : "untextured";
+    name += (key & kPhongLighting) ? ", lit" : ", unlit";
+    if (key & kPhongStaticLights)
+        name += ", static lights folded";
+    if (key & kPhongShadows)
+        name += ", shadowed";
+    return name;
 }
 
-vec3 CalcPoint(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 color)
+// ------------------------------------------------------------
+// --variant-bench: each Phong variant against the uber shader given the
+// same ObjectBlock flags. The ground plane is stretched over the whole
+// window and drawn without depth testing, so every pass shades every pixel
+// and the difference is the fragment work the variant compiled away.
+// ------------------------------------------------------------
+void BenchPhongVariants(ShaderVariants& variants, Shader& uber, FrameUniforms& frameUniforms,
+    RingBuffer& objectRing, GLuint texture, GLuint groundVAO)
 {
-    vec3 lightDir = normalize(light.position - fragPos);
-    float diff = max(dot(normal, lightDir), 0.0);
+    const int kPasses = 20;
+
+    // the plane's x and z onto clip-space x and y, seen from just above
+    CameraBlock camera = {};
+    MakeIdentity(camera.view);
+    MakeIdentity(camera.projection);
+    SetVec3(camera.viewPos, 0.0f, 0.0f, 2.0f);
+    LightBlock lights;
+    SetupLights(lights, 0.0f);
+    frameUniforms.Update(camera, lights);
+
+    ObjectBlock object = {};
+    object.model[0] = 1.0f / 50.0f;
+    object.model[6] = 1.0f;
+    object.model[9] = 1.0f / 50.0f;
+    object.model[15] = 1.0f;
+    SetVec3(object.baseColor, 0.5f, 0.5f, 0.5f);
+
+    gGLState.SetEnabled(GL_DEPTH_TEST, false);
+    gGLState.BindVertexArray(groundVAO);
+    gGLState.BindTexture(0, GL_TEXTURE_2D, texture);
+
+    auto timePasses = [&](Shader& shader, const RingBuffer::Allocation& data)
+    {
+        shader.Use();
+        shader.Set(Phong::diffuseMap, 0);
+        objectRing.BindRange(kObjectBlockBinding, data);
+        glDrawArrays(GL_TRIANGLES, 0, 6);   // warm-up
+        glFinish();
+        double start = ProfileNow();
+        for (int i = 0; i < kPasses; ++i)
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        glFinish();
+        return (ProfileNow() - start) * 1e3 / kPasses;
+    };
 
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+    cout << "Phong variants, ms per full-window pass (" << kPasses << " passes each):\n";
+    const unsigned keys[] = { 0, kPhongTexture, kPhongLighting, kPhongTexture | kPhongLighting,
+        kPhongLighting | kPhongStaticLights, kPhongTexture | kPhongLighting | kPhongStaticLights };
+    for (unsigned key : keys)
+    {
+        Shader* variant = variants.Get(key);
+        if (!variant)
+            continue;
 
-    float distance    = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant +
-                               light.linear * distance +
-                               light.quadratic * distance * distance);
+        object.useTexture = (key & kPhongTexture) ? GL_TRUE : GL_FALSE;
+        object.useLighting = (key & kPhongLighting) ? GL_TRUE : GL_FALSE;
+        objectRing.BeginFrame();
+        RingBuffer::Allocation data = PushObject(objectRing, object);
+        objectRing.Commit();
 
-    vec3 ambient  = light.ambient  * color;
-    vec3 diffuse  = light.diffuse  * diff * color;
-    vec3 specular = light.specular * spec;
+        const double uberMs = timePasses(uber, data);
+        const double variantMs = timePasses(*variant, data);
+        objectRing.EndFrame();
 
-    ambient  *= attenuation;
-    diffuse  *= attenuation;
-    specular *= attenuation;
+        printf("  %-42s uber %7.3f  variant %7.3f  (%+.0f%%)\n", PhongVariantName(key).c_str(),
+            uberMs, variantMs, (variantMs / uberMs - 1.0) * 100.0);
+    }
 
-    return ambient + diffuse + specular;
+    gGLState.SetEnabled(GL_DEPTH_TEST, true);
 }
 
-vec3 CalcSpot(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 color)
+// --vertex-bench: phong.vert with the normal matrix from ObjectBlock
+// against the old per-vertex inverse(uModel), rasterizer off so only the
+// vertex stage is timed. The mesh is drawn as instances so no vertex
+// results are reused between copies.
+void BenchVertexCost(const char* fragmentPath, FrameUniforms& frameUniforms, RingBuffer& objectRing,
+    GLuint vao, GLsizei vertexCount)
 {
-    vec3 lightDir = normalize(light.position - fragPos);
-    float diff = max(dot(normal, lightDir), 0.0);
+    const int kPasses = 10;
+    const GLsizei kCopies = 64;
 
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-
-    float distance    = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant +
-                               light.linear * distance +
-                               light.quadratic * distance * distance);
-
-    float theta   = dot(lightDir, normalize(-light.direction));
-    float epsilon = light.cutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    Shader shaders[2];
+    const char* names[2] = { "uNormalMatrix (CPU)", "inverse(uModel) per vertex" };
+    for (int i = 0; i < 2; ++i)
+    {
+        string err;
+        shaders[i].SetUniformSchema(kPhongUniformDecls);
+        shaders[i].SetDefines(i == 1 ? "#define NORMAL_MATRIX_FROM_MODEL\n" : "");
+        if (!shaders[i].CreateFromFiles(phongVertexPath, fragmentPath, err))
+        {
+            cerr << "Vertex bench shader failed:\n" << err << "\n";
+            return;
+        }
+    }
 
-    vec3 ambient  = light.ambient  * color;
-    vec3 diffuse  = light.diffuse  * diff * color;
-    vec3 specular = light.specular * spec;
+    CameraBlock camera = {};
+    MakeIdentity(camera.view);
+    MakeIdentity(camera.projection);
+    LightBlock lights;
+    SetupLights(lights, 0.0f);
+    frameUniforms.Update(camera, lights);
+
+    // non-uniform scale, so the general inverse is what both sides compute
+    ObjectBlock object = {};
+    MakeIdentity(object.model);
+    object.model[0] = 0.5f;
+    object.model[5] = 2.0f;
+    objectRing.BeginFrame();
+    RingBuffer::Allocation data = PushObject(objectRing, object);
+    objectRing.Commit();
+    objectRing.BindRange(kObjectBlockBinding, data);
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    gGLState.BindVertexArray(vao);
+    double ms[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        shaders[i].Use();
+        glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount, kCopies);   // warm-up
+        glFinish();
+        double start = ProfileNow();
+        for (int pass = 0; pass < kPasses; ++pass)
+            glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount, kCopies);
+        glFinish();
+        ms[i] = (ProfileNow() - start) * 1e3 / kPasses;
+    }
+    glDisable(GL_RASTERIZER_DISCARD);
+    objectRing.EndFrame();
+
+    const double vertices = (double)vertexCount * kCopies;
+    cout << "Vertex stage, " << vertices / 1e6 << " M vertices per pass (" << kPasses << " passes):\n";
+    for (int i = 0; i < 2; ++i)
+        printf("  %-28s %8.3f ms  %6.2f ns/vertex\n", names[i], ms[i], ms[i] * 1e6 / vertices);
+    printf("  CPU normal matrix: %+.0f%%\n", (ms[0] / ms[1] - 1.0) * 100.0);
+
+    for (Shader& shader : shaders)
+        shader.Destroy();
+    gGLState.Invalidate();
+}
 
-    ambient  *= attenuation * intensity;
-    diffuse  *= attenuation * intensity;
-    specular *= attenuation * intensity;
+// ------------------------------------------------------------
+// Ray queries (src/Bvh.h): picking and line of sight
+// ------------------------------------------------------------
 
-    return ambient + diffuse + specular;
+// World-space ray from eye through window pixel (x, y), for a view along
+// forward with the given projection
+BvhRay PixelRay(const Vec3& eye, const Vec3& forward, const float projection[16], double x, double y)
+{
+    const Vec3 right = Direction(Cross(forward, { 0.0f, 1.0f, 0.0f }));
+    const Vec3 up = Cross(right, forward);
+    const float ndcX = (float)(2.0 * x / WINDOW_WIDTH - 1.0);
+    const float ndcY = (float)(1.0 - 2.0 * y / WINDOW_HEIGHT);
+    const Vec3 dir = forward + right * (ndcX / projection[0]) + up * (ndcY / projection[5]);
+    return { { eye.x, eye.y, eye.z }, { dir.x, dir.y, dir.z }, 1e30f };
 }
 
-void main()
+// Left click: what is under the cursor, and whether the spot light sees it
+void PickUnderCursor(GLFWwindow* window, const Camera& camera, const float projection[16],
+    const MeshBvh& bird, int flockCount, float time, const LightBlock& lights)
 {
-    vec3 color = GetBaseColor();
-
-    // Unlit option – used for ground plane
-    if (!uUseLighting)
+    double x = 0.0, y = 0.0;
+    glfwGetCursorPos(window, &x, &y);
+    SceneBvh scene;
+    BuildFlockScene(bird, flockCount, time, scene);
+
+    const BvhRay ray = PixelRay(camera.position, camera.GetForward(), projection, x, y);
+    BvhHit hit;
+    if (!scene.Intersect(ray, hit))
     {
-        FragColor = vec4(color, 1.0);
+        cout << "Pick (" << x << ", " << y << "): nothing\n";
         return;
     }
 
-    vec3 norm    = normalize(vNormal);
-    vec3 viewDir = normalize(uViewPos - vFragPos);
-
-    vec3 result = vec3(0.0);
-
-    result += CalcDirectional(dirLight, norm, viewDir, color);
-    result += CalcPoint(pointLight, norm, vFragPos, viewDir, color);
-    result += CalcSpot(spotLight, norm, vFragPos, viewDir, color);
+    // shadow ray from the hit point to the light, both ends pulled in a little
+    const float* light = lights.spotLight.position;
+    BvhRay toLight;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float p = ray.origin[k] + ray.dir[k] * hit.t;
+        toLight.dir[k] = light[k] - p;
+        toLight.origin[k] = p + toLight.dir[k] * 1e-4f;
+    }
+    toLight.tMax = 1.0f - 2e-4f;
+    const bool lit = !scene.Occluded(toLight);
 
-    FragColor = vec4(result, 1.0);
+    const Vec3 dir = { ray.dir[0], ray.dir[1], ray.dir[2] };
+    cout << "Pick (" << x << ", " << y << "): ";
+    if (hit.instance == 0)
+        cout << "bird";
+    else
+        cout << "flock bird " << hit.instance - 1;
+    cout << ", triangle " << hit.triangle << " at distance " << hit.t * Magnitude(dir) << ", "
+        << (lit ? "in view of" : "hidden from") << " the spot light\n";
 }
-)";
 
 // ------------------------------------------------------------
 // Ground plane VAO/VBO
@@ -648,34 +705,329 @@ void CreateGroundPlane()
 // ------------------------------------------------------------
 // Main
 // ------------------------------------------------------------
-int main()
+int main(int argc, char** argv)
 {
+    ProfileNow(); // starts the startup clock
+
+    bool serialStartup = false;
+    bool glStats = false;
+    int flockCount = 0;
+    int meshCount = 0;
+    bool multiDraw = true;
+    int cullCount = 0;
+    bool cullVerify = false;
+    bool hizCulling = false;
+    bool cpuOcclusion = false;
+    bool cpuCull = false;
+    bool clustered = false;
+    int extraLights = 0;
+    bool clusterCompute = false;
+    bool deferred = false;
+    bool visibility = false;
+    bool useVariants = true;
+    bool staticLights = false;
+    bool variantBench = false;
+    bool vertexBench = false;
+    bool shadows = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (string(argv[i]) == "--bench")
+            return RunBenchmarks(i + 1 < argc ? argv[i + 1] : "all");
+        if (string(argv[i]) == "--serial-startup")
+            serialStartup = true;
+        if (string(argv[i]) == "--gl-stats")
+            glStats = true;
+        if (string(argv[i]) == "--no-shader-cache")
+            Shader::SetBinaryCacheDir("");
+        if (string(argv[i]) == "--birds" && i + 1 < argc)
+            flockCount = max(0, atoi(argv[++i]));
+        if (string(argv[i]) == "--meshes" && i + 1 < argc)
+            meshCount = max(0, atoi(argv[++i]));
+        if (string(argv[i]) == "--no-mdi")
+            multiDraw = false;
+        if (string(argv[i]) == "--cull-instances" && i + 1 < argc)
+            cullCount = max(0, atoi(argv[++i]));
+        if (string(argv[i]) == "--cull-verify")
+            cullVerify = true;
+        if (string(argv[i]) == "--hiz")
+            hizCulling = true;
+        if (string(argv[i]) == "--cpu-occlusion")
+            cpuOcclusion = true;
+        if (string(argv[i]) == "--cpu-cull")
+            cpuCull = true;
+        if (string(argv[i]) == "--lights" && i + 1 < argc)
+        {
+            clustered = true;
+            extraLights = max(0, atoi(argv[++i]));
+        }
+        if (string(argv[i]) == "--cluster-compute")
+            clusterCompute = true;
+        if (string(argv[i]) == "--deferred")
+            deferred = true;
+        if (string(argv[i]) == "--visibility")
+            visibility = true;
+        if (string(argv[i]) == "--uber-shader")
+            useVariants = false;
+        if (string(argv[i]) == "--static-lights")
+            staticLights = true;
+        if (string(argv[i]) == "--variant-bench")
+            variantBench = true;
+        if (string(argv[i]) == "--vertex-bench")
+            vertexBench = true;
+        if (string(argv[i]) == "--shadows")
+            shadows = true;
+    }
+
+    // --visibility covers the ground, the bird and the flock
+    if (visibility && (meshCount > 0 || cullCount > 0 || clustered || deferred))
+    {
+        cout << "--visibility draws the ground, bird and flock only; --meshes, --cull-instances,"
+            " --lights and --deferred are ignored\n";
+        meshCount = cullCount = extraLights = 0;
+        clustered = deferred = hizCulling = false;
+    }
+
+    // --deferred lights the same list from a G-buffer instead of the clusters
+    if (deferred)
+        clustered = false;
+    if (visibility && cpuCull)
+    {
+        cout << "--cpu-cull culls the forward draws, ignored with --visibility\n";
+        cpuCull = false;
+    }
+    if (deferred && hizCulling)
+    {
+        cout << "--hiz draws into its own framebuffer, ignored with --deferred\n";
+        hizCulling = false;
+    }
+    if (shadows && (clustered || deferred || visibility))
+    {
+        cout << "--shadows is sampled by phong.frag only, ignored with --lights, --deferred and --visibility\n";
+        shadows = false;
+    }
+
     cout << "Program starting...\n";
 
-    // Create window/context using class-provided helper
-    CreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Graphics Final Project - Lighting");
+    // Worker threads for loading and per-frame CPU work.
+    // --serial-startup runs every job inline, to compare startup times.
+    InitJobSystem(serialStartup ? 0 : -1);
 
     // --------------------------------------------------------
-    // Load custom OBJ ("Bird.obj")
+    // Startup graph. CPU work needs no GL context, so it is kicked
+    // off before the window even exists; GL work stays on this thread.
+    //
+    //   LoadOBJ -> BuildVertices ------------------------+
+    //   CheckerImage -------------------------+          |
+    //   CreateWindow -> IssueShader -> CreateGround -> UploadTexture
+    //                       |                       -> UploadMesh -> FinishShader
+    //                       +-- (driver compiles in the background) --^
     // --------------------------------------------------------
     ObjData obj;
-    if (!LoadOBJ("Bird.obj", obj))
+    bool objLoaded = false;
+    vector<Vertex> vertices;
+    ImageData birdImage;
+    JobCounter objJob, meshJob, imageJob;
+
+    RunJob([&]
+    {
+        ScopedSpan span("LoadOBJ");
+        objLoaded = LoadOBJ("Bird.obj", obj);
+    }, &objJob);
+
+    // Convert OBJ to flat vertex array once parsing is done
+    RunJobAfter(objJob, [&]
+    {
+        ScopedSpan span("BuildVertices", { "LoadOBJ" });
+        if (objLoaded)
+            vertices = BuildVerticesFromObj(obj);
+    }, &meshJob);
+
+    // Bird texture (checkerboard for now)
+    RunJob([&]
+    {
+        ScopedSpan span("CheckerImage");
+        birdImage = BuildCheckerImage();
+    }, &imageJob);
+
+    // Create window/context using class-provided helper
+    {
+        ScopedSpan span("CreateWindow");
+        CreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Graphics Final Project - Lighting");
+    }
+
+    // Count every GL call the render loop makes (reported with the frame stats)
+    if (glStats)
+        InstallGLCallCounters();
+
+    // --shadows: made before the Phong programs, which only get
+    // HAS_SHADOWS if the maps exist
+    ShadowMaps shadowMaps;
+    string shadowErr;
+    if (shadows && !shadowMaps.Create(2048, 1024, WINDOW_WIDTH, WINDOW_HEIGHT, shadowErr))
+    {
+        cerr << "Shadow map error, drawing without shadows:\n" << shadowErr << "\n";
+        shadowMaps.Destroy();
+        shadows = false;
+    }
+    if (shadows)
+    {
+        cout << "Shadow maps: 2048^2 sun, 1024^2 spot; the bird" << (meshCount > 0 ? " and the mesh scene" : "")
+            << " cached until a light moves" << (flockCount > 0 ? ", the flock drawn over them each frame" : "") << "\n";
+    }
+    const string shadowDefines = shadows ? "#define HAS_SHADOWS\n" : "";
+
+    // --------------------------------------------------------
+    // Create Phong shader. Only issued here; with parallel shader
+    // compile the driver works on it while we upload everything else.
+    // --------------------------------------------------------
+    // --lights N swaps the fragment stage of every lit program; --deferred
+    // writes the G-buffer from it instead
+    const char* fragPath = deferred ? gbufferFragPath : clustered ? phongClusteredFragPath : phongFragPath;
+    Shader phongShader;
+    phongShader.SetUniformSchema(kPhongUniformDecls);
+    phongShader.SetDefines(shadowDefines);
+    bool shaderOk = false;
+    string err;
+    {
+        ScopedSpan span("IssueShader", { "CreateWindow" });
+        shaderOk = phongShader.BeginCreateFromFiles(phongVertexPath, fragPath, err);
+    }
+
+    // Instanced variant for --birds N, sharing phong.frag
+    Shader flockShader;
+    if (flockCount > 0)
+    {
+        flockShader.SetUniformSchema(kPhongUniformDecls);
+        flockShader.SetDefines(shadowDefines);
+        if (!flockShader.BeginCreateFromFiles(phongInstancedVertexPath, fragPath, err))
+            flockCount = 0;
+    }
+
+    // Multi-draw-indirect variant for --meshes N and --cull-instances N
+    Shader meshShader;
+    if (meshCount > 0 || cullCount > 0)
+    {
+        meshShader.SetUniformSchema(kPhongUniformDecls);
+        meshShader.SetDefines(shadowDefines);
+        if (!meshShader.BeginCreateFromFiles(phongIndirectVertexPath, fragPath, err))
+            meshCount = cullCount = 0;
+    }
+
+    // Compile-time variants of the same programs, one per ObjectBlock flag
+    // combination the scene draws with. The uber shaders above stay as the
+    // fallback (--uber-shader) and for the layout checks.
+    ShaderVariants phongVariants, flockVariants, meshVariants;
+    {
+        LightBlock initialLights;
+        SetupLights(initialLights, 0.0f);
+        const vector<ShaderFeature> features = PhongFeatures(initialLights);
+        phongVariants.Create(phongVertexPath, fragPath, kPhongUniformDecls, features);
+        flockVariants.Create(phongInstancedVertexPath, fragPath, kPhongUniformDecls, features);
+        meshVariants.Create(phongIndirectVertexPath, fragPath, kPhongUniformDecls, features);
+    }
+    const unsigned featureBits = (staticLights ? kPhongStaticLights : 0u) | (shadows ? kPhongShadows : 0u);
+    const unsigned groundKey = (extraLights > 0 || shadows ? kPhongLighting : 0u) | featureBits;
+    const unsigned birdKey = kPhongTexture | kPhongLighting | featureBits;
+    const unsigned meshKey = kPhongLighting | featureBits;
+    if (useVariants)
+    {
+        ScopedSpan span("IssueVariants", { "IssueShader" });
+        phongVariants.Precompile({ groundKey, birdKey });
+        if (flockCount > 0)
+            flockVariants.Precompile({ birdKey });
+        if (meshCount > 0 || cullCount > 0)
+            meshVariants.Precompile({ meshKey });
+    }
+
+    if (!shaderOk)
+    {
+        cerr << "Phong shader error:\n" << err << "\n"
+            << "Make sure the shaders folder is next to the .exe.\n";
+        cout << "Press Enter to exit...\n";
+        cin.get();
+        ShutdownJobSystem();
+        DestroyWindow();
+        return -1;
+    }
+
+    FrameUniforms frameUniforms;
+    RingBuffer objectRing;
+    RingBuffer flockRing;
+    RingBuffer commandRing;
+    MeshScene meshScene;
+    GpuCulledField cullField;
+    HiZPyramid hiz;
+    ClusteredLighting clusteredLighting;
+    {
+        ScopedSpan span("CreateGround", { "IssueShader" });
+
+        // Ground plane
+        CreateGroundPlane();
+
+        // Camera / light uniform blocks, and the per-draw stream
+        frameUniforms.Create();
+        objectRing.Create(GL_UNIFORM_BUFFER, 64 * 1024);
+        cout << "Per-draw ring buffer: " << (objectRing.IsPersistent()
+            ? "persistently mapped (buffer storage)" : "unsynchronized map per frame") << "\n";
+
+        // flock instances are rewritten every frame, so they stream too;
+        // --visibility puts the ground and the bird in front of them.
+        // --cpu-cull with --shadows uploads the birds in view and, for the
+        // shadow casters, all of them (plus room to align the second range).
+        if (visibility)
+            flockRing.Create(GL_SHADER_STORAGE_BUFFER, (2 + flockCount) * sizeof(BirdInstance));
+        else if (flockCount > 0 && cpuCull && shadows)
+            flockRing.Create(GL_SHADER_STORAGE_BUFFER, 2 * flockCount * sizeof(BirdInstance) + 256);
+        else if (flockCount > 0)
+            flockRing.Create(GL_SHADER_STORAGE_BUFFER, flockCount * sizeof(BirdInstance));
+
+        // distinct meshes in shared buffers, one indirect command each per frame
+        if (meshCount > 0)
+        {
+            meshScene.Create(meshCount);
+            // --shadows draws every mesh into the maps too (plus room to align the second range)
+            const size_t commandBytes = meshCount * sizeof(DrawElementsIndirectCommand);
+            commandRing.Create(GL_DRAW_INDIRECT_BUFFER, shadows ? 2 * commandBytes + 256 : commandBytes);
+        }
+
+        // instance field culled on the GPU; buffers stay GPU-side
+        if (cullCount > 0)
+            cullField.Create(cullCount);
+        if (cullCount > 0 && hizCulling)
+            hiz.Create(WINDOW_WIDTH, WINDOW_HEIGHT);
+
+        // light array and per-cluster lists, streamed every frame
+        if (clustered)
+            clusteredLighting.Create(2 + extraLights, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+        // Enable depth testing
+        gGLState.SetEnabled(GL_DEPTH_TEST, true);
+    }
+
+    WaitForCounter(imageJob);
+    GLuint birdTexture = 0;
+    {
+        ScopedSpan span("UploadTexture", { "CheckerImage", "CreateGround" });
+        birdTexture = CreateTextureFromImage(birdImage);
+    }
+
+    WaitForCounter(meshJob);
+    if (!objLoaded)
     {
         cerr << "ERROR: Could not load Bird.obj. "
             << "Make sure it is in the same folder as the .exe.\n";
         cout << "Press Enter to exit...\n";
         cin.get();
+        ShutdownJobSystem();
         DestroyWindow();
         return -1;
     }
-
-    // Convert OBJ to flat vertex array
-    vector<Vertex> vertices = BuildVerticesFromObj(obj);
     if (vertices.empty())
     {
         cerr << "ERROR: OBJ has no vertices after conversion.\n";
         cout << "Press Enter to exit...\n";
         cin.get();
+        ShutdownJobSystem();
         DestroyWindow();
         return -1;
     }
@@ -684,202 +1036,689 @@ int main()
     // Create VAO/VBO for Bird mesh
     // --------------------------------------------------------
     GLuint birdVAO = 0, birdVBO = 0;
-    glGenVertexArrays(1, &birdVAO);
-    glGenBuffers(1, &birdVBO);
-
-    glBindVertexArray(birdVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, birdVBO);
-    glBufferData(GL_ARRAY_BUFFER,
-        vertices.size() * sizeof(Vertex),
-        vertices.data(),
-        GL_STATIC_DRAW);
-
-    // position: location 0
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-        sizeof(Vertex),
-        (void*)offsetof(Vertex, position));
-
-    // texcoord: location 1
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE,
-        sizeof(Vertex),
-        (void*)offsetof(Vertex, uv));
-
-    // normal: location 2
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE,
-        sizeof(Vertex),
-        (void*)offsetof(Vertex, normal));
+    {
+        ScopedSpan span("UploadMesh", { "BuildVertices", "UploadTexture" });
 
-    glBindVertexArray(0);
+        glGenVertexArrays(1, &birdVAO);
+        glGenBuffers(1, &birdVBO);
 
-    // Ground plane
-    CreateGroundPlane();
+        glBindVertexArray(birdVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, birdVBO);
+        glBufferData(GL_ARRAY_BUFFER,
+            vertices.size() * sizeof(Vertex),
+            vertices.data(),
+            GL_STATIC_DRAW);
+
+        // position: location 0
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+            sizeof(Vertex),
+            (void*)offsetof(Vertex, position));
+
+        // texcoord: location 1
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE,
+            sizeof(Vertex),
+            (void*)offsetof(Vertex, uv));
+
+        // normal: location 2
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE,
+            sizeof(Vertex),
+            (void*)offsetof(Vertex, normal));
 
-    // Enable depth testing
-    glEnable(GL_DEPTH_TEST);
+        glBindVertexArray(0);
+    }
 
-    // --------------------------------------------------------
-    // Create Phong shader
-    // --------------------------------------------------------
-    Shader phongShader;
-    string err;
-    if (!phongShader.CreateFromSource(phongVertexSrc, phongFragSrc, err))
+    {
+        ScopedSpan span("FinishShader", { "IssueShader", "UploadMesh" });
+        shaderOk = phongShader.FinishCreate(err) &&
+            FrameUniforms::CheckLayout(phongShader.GetID(), err);
+    }
+    cout << "Phong shader: " << (phongShader.LoadedFromCache() ? "loaded from binary cache" : "compiled") << "\n";
+    if (!shaderOk)
     {
         cerr << "Phong shader error:\n" << err << "\n";
         cout << "Press Enter to exit...\n";
         cin.get();
+        ShutdownJobSystem();
         DestroyWindow();
         return -1;
     }
 
-    // --------------------------------------------------------
-    // Create Bird texture (checkerboard for now)
-    // --------------------------------------------------------
-    GLuint birdTexture = CreateCheckerTexture();
+    if (flockCount > 0)
+    {
+        if (flockShader.FinishCreate(err) && FrameUniforms::CheckLayout(flockShader.GetID(), err))
+        {
+            cout << "Flock: " << flockCount << " instanced birds\n";
+        }
+        else
+        {
+            cerr << "Instanced Phong shader error, drawing no flock:\n" << err << "\n";
+            flockCount = 0;
+        }
+    }
+
+    if (meshCount > 0 || cullCount > 0)
+    {
+        if (!meshShader.FinishCreate(err) || !FrameUniforms::CheckLayout(meshShader.GetID(), err))
+        {
+            cerr << "Indirect Phong shader error, drawing no mesh scene or culled field:\n" << err << "\n";
+            meshCount = cullCount = 0;
+        }
+    }
+    if (meshCount > 0)
+    {
+        cout << "Mesh scene: " << meshCount << " distinct meshes, " << meshScene.GetTriangleCount()
+            << " triangles, " << (multiDraw ? "one glMultiDrawElementsIndirect" : "one draw per mesh") << "\n";
+    }
+
+    // --cpu-occlusion: the bird hides the scene meshes behind it, decided on the CPU
+    SoftwareOcclusion occlusion;
+    cpuOcclusion = cpuOcclusion && meshCount > 0;
+    if (cpuOcclusion)
+    {
+        float identity[16];
+        MakeIdentity(identity);
+        occlusion.Create(256, 256);
+        occlusion.AddOccluder(vertices.data(), sizeof(Vertex), vertices.size(), identity);
+        cout << "CPU occlusion: " << occlusion.GetWidth() << "x" << occlusion.GetHeight() << " depth, "
+            << occlusion.GetOccluderTriangleCount() << " occluder triangles, "
+            << (occlusion.GetSimdPath() == SoftwareOcclusion::kSimdAVX2 ? "AVX2" : "SSE") << "\n";
+    }
+
+    // --cpu-cull: the ground and the bird as boxes (0 and 1), the flock as
+    // spheres, tested against the view frustum before they are drawn
+    BoxesSoA sceneBounds;
+    SpheresSoA flockBounds;
+    vector<BirdInstance> flockScratch;
+    vector<uint32_t> visibleIds;
+    if (cpuCull)
+    {
+        sceneBounds.Resize(2);
+        const float groundMin[3] = { -50.0f, 0.0f, -50.0f }, groundMax[3] = { 50.0f, 0.0f, 50.0f };
+        float birdMin[3] = { 1e30f, 1e30f, 1e30f }, birdMax[3] = { -1e30f, -1e30f, -1e30f };
+        float birdRadius = 0.0f;
+        for (const Vec3& p : obj.positions)
+        {
+            const float v[3] = { p.x, p.y, p.z };
+            for (int k = 0; k < 3; ++k)
+            {
+                birdMin[k] = min(birdMin[k], v[k]);
+                birdMax[k] = max(birdMax[k], v[k]);
+            }
+            birdRadius = max(birdRadius, Magnitude(p));
+        }
+        PointsSoA* corners[2] = { &sceneBounds.min, &sceneBounds.max };
+        const float* values[2][2] = { { groundMin, birdMin }, { groundMax, birdMax } };
+        for (int c = 0; c < 2; ++c)
+        {
+            for (int i = 0; i < 2; ++i)
+            {
+                corners[c]->x[i] = values[c][i][0];
+                corners[c]->y[i] = values[c][i][1];
+                corners[c]->z[i] = values[c][i][2];
+            }
+        }
+
+        // birds are drawn around their origin at kBirdScale
+        flockScratch.resize(flockCount);
+        flockBounds.Resize(flockCount);
+        fill(flockBounds.radius.begin(), flockBounds.radius.end(), birdRadius * kBirdScale);
+        cout << "CPU frustum culling: ground, bird and " << flockCount << " flock birds, "
+            << BatchSimdPathName(GetBatchSimdPath()) << "\n";
+    }
+
+    Shader cullShader, hizShader;
+    if (cullCount > 0)
+    {
+        cullShader.SetUniformSchema(kCullUniformDecls);
+        if (!cullShader.CreateComputeFromFile(cullComputePath, err))
+        {
+            cerr << "Culling compute shader error, drawing no culled field:\n" << err << "\n";
+            cullCount = 0;
+        }
+        else
+        {
+            cout << "GPU-culled field: " << cullField.GetInstanceCount() << " instances, 3 LODs, "
+                << (gGLExt.indirectParameters ? "draw count read from the GPU" : "empty commands up to the full count") << "\n";
+        }
+    }
+    if (cullCount > 0 && hizCulling)
+    {
+        hizShader.SetUniformSchema(kHiZUniformDecls);
+        if (!hizShader.CreateComputeFromFile(hizComputePath, err))
+        {
+            cerr << "Hi-Z compute shader error, culling by frustum only:\n" << err << "\n";
+            hiz.Destroy();
+            hizCulling = false;
+        }
+        else
+        {
+            cout << "Hi-Z occlusion culling: " << hiz.GetLevelCount() << " pyramid levels, two phases\n";
+        }
+    }
+
+    Shader clusterShader;
+    if (clustered && clusterCompute)
+    {
+        if (!clusterShader.CreateComputeFromFile(clustersComputePath, err))
+        {
+            cerr << "Cluster compute shader error, assigning lights on the CPU:\n" << err << "\n";
+            clusterCompute = false;
+        }
+    }
+    if (clustered)
+    {
+        cout << "Clustered lighting: " << 2 + extraLights << " point/spot lights, "
+            << ClusteredLighting::kClustersX << "x" << ClusteredLighting::kClustersY << "x"
+            << ClusteredLighting::kClustersZ << " clusters, assigned "
+            << (clusterCompute ? "by a compute shader" : "on the CPU") << "\n";
+    }
+
+    DeferredRenderer deferredRenderer;
+    if (deferred && !deferredRenderer.Create(WINDOW_WIDTH, WINDOW_HEIGHT, 2 + extraLights, err))
+    {
+        cerr << "Deferred renderer error, lighting forward instead:\n" << err << "\n";
+        deferredRenderer.Destroy();
+        deferred = false;
+    }
+    if (deferred)
+        cout << "Deferred lighting: " << 2 + extraLights << " point/spot lights as stencil-tested volumes\n";
+
+    // instance 0 is the ground, 1 the bird, the flock follows
+    VisibilityBuffer visibilityBuffer;
+    if (visibility)
+    {
+        vector<VisibilityMesh> visibilityMeshes = {
+            { gGroundVBO, 6, 0, 1, { 0.5f, 0.5f, 0.5f }, false, false },
+            { birdVBO, (GLsizei)vertices.size(), 1, 1 + (GLuint)flockCount, { 1.0f, 1.0f, 1.0f }, true, true },
+        };
+        if (!visibilityBuffer.Create(WINDOW_WIDTH, WINDOW_HEIGHT, visibilityMeshes, err))
+        {
+            cerr << "Visibility buffer error, drawing forward instead:\n" << err << "\n";
+            visibilityBuffer.Destroy();
+            visibility = false;
+        }
+        else
+        {
+            cout << "Visibility buffer: triangle + instance IDs in R32UI, one shading pass\n";
+        }
+    }
+
+    // --gl-stats: fragment shader runs per pixel, forward or not
+    FragmentCounter geometryCounter, resolveCounter;
+    if (glStats)
+    {
+        geometryCounter.Create(WINDOW_WIDTH * WINDOW_HEIGHT);
+        resolveCounter.Create(WINDOW_WIDTH * WINDOW_HEIGHT);
+    }
+
+    // setup above bound things behind the state cache's back
+    gGLState.Invalidate();
+
+    if (variantBench)
+        BenchPhongVariants(phongVariants, phongShader, frameUniforms, objectRing, birdTexture, gGroundVAO);
+    if (vertexBench)
+        BenchVertexCost(fragPath, frameUniforms, objectRing, birdVAO, (GLsizei)vertices.size());
+
+    // picking: the bird's triangles, instanced for the flock when clicked
+    MeshBvh birdBvh;
+    if (!vertices.empty())
+    {
+        double bvhStart = ProfileNow();
+        birdBvh.Build(&vertices[0].position, sizeof(Vertex), nullptr, vertices.size() / 3);
+        cout << "Bird BVH: " << birdBvh.GetTriangleCount() << " triangles, " << birdBvh.GetNodeCount()
+            << " nodes, built in " << (ProfileNow() - bvhStart) * 1e3 << " ms\n";
+    }
+
+    // the sun's map spans the ground, up to the top of the bird, the
+    // flock (bird origins at most 12.3 up, Flock.cpp) and the mesh scene
+    if (shadows)
+    {
+        float birdMin[3], birdMax[3];
+        birdBvh.GetBounds(birdMin, birdMax);
+        float top = max(birdMax[1], 0.0f);
+        if (flockCount > 0)
+            top = max(top, 12.3f + birdMax[1] * kBirdScale);
+        float sceneMin[3] = { -50.0f, 0.0f, -50.0f }, sceneMax[3] = { 50.0f, top, 50.0f };
+        if (meshCount > 0)
+        {
+            float meshMin[3], meshMax[3];
+            meshScene.GetBounds(meshMin, meshMax);
+            for (int k = 0; k < 3; ++k)
+            {
+                sceneMin[k] = min(sceneMin[k], meshMin[k]);
+                sceneMax[k] = max(sceneMax[k], meshMax[k]);
+            }
+        }
+        shadowMaps.SetSceneBounds(sceneMin, sceneMax);
+    }
+    if (useVariants)
+    {
+        cout << "Phong variants: " << phongVariants.GetVariantCount() + flockVariants.GetVariantCount() +
+            meshVariants.GetVariantCount() << " programs keyed by texture / lighting"
+            << (staticLights ? " / static lights" : "") << (shadows ? " / shadows" : "") << "\n";
+    }
 
     GLFWwindow* window = glfwGetCurrentContext();
     Camera camera;
+    vector<ClusterLight> clusterLights;
 
     float lastTime = (float)glfwGetTime();
+    bool firstFrame = true;
+    bool mouseWasDown = false;
 
     cout << "Controls:\n";
     cout << "  WASD = move\n";
     cout << "  SPACE / LeftCtrl = up/down\n";
     cout << "  Arrow keys = look around\n";
+    cout << "  Left click = pick the bird under the cursor\n";
 
     // --------------------------------------------------------
     // Render loop
     // --------------------------------------------------------
     while (!WindowShouldClose())
     {
+        double frameStart = ProfileNow();
         float currentTime = (float)glfwGetTime();
         float dt = currentTime - lastTime;
         lastTime = currentTime;
 
         UpdateCameraFromInput(camera, dt, window);
 
-        glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
+        // Picks up edits to shaders/phong.*; the old program keeps drawing until the new one links
+        phongShader.PollHotReload();
+        flockShader.PollHotReload();
+        meshShader.PollHotReload();
+        phongVariants.PollHotReload();
+        flockVariants.PollHotReload();
+        meshVariants.PollHotReload();
+        cullShader.PollHotReload();
+        hizShader.PollHotReload();
+        clusterShader.PollHotReload();
+        if (deferred)
+            deferredRenderer.PollHotReload();
+        if (visibility)
+            visibilityBuffer.PollHotReload();
+        if (shadows)
+            shadowMaps.PollHotReload();
+
+        // with Hi-Z the frame is drawn offscreen so its depth can be read
+        if (hizCulling)
+            hiz.BeginScene();
+        if (deferred)
+            deferredRenderer.BeginGeometry();
+
+        gGLState.ClearColor(0.1f, 0.1f, 0.15f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        phongShader.Use();
+        // ----------------------------------------------------
+        // Camera + lights: one buffer upload for the frame
+        // ----------------------------------------------------
+        // the projection never changes: folded to constants at compile time
+        constexpr cx::Mat4 kProjection = cx::Perspective(DegToRad(60.0f),
+            (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f);
+        CameraBlock cameraData;
+        camera.GetViewMatrix(cameraData.view);
+        CopyMatrix(kProjection, cameraData.projection);
+        SetVec3(cameraData.viewPos, camera.position.x, camera.position.y, camera.position.z); // for specular
+        const Frustum frustum = ExtractFrustum(cameraData.view, cameraData.projection);
+
+        LightBlock lights;
+        SetupLights(lights, currentTime);
+        frameUniforms.Update(cameraData, lights);
+
+        const bool mouseDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+        if (mouseDown && !mouseWasDown && birdBvh.GetTriangleCount() > 0)
+            PickUnderCursor(window, camera, cameraData.projection, birdBvh, flockCount, currentTime, lights);
+        mouseWasDown = mouseDown;
+
+        if (clustered || deferred)
+            SetupClusterLights(clusterLights, lights, extraLights, currentTime);
+        if (clustered)
+        {
+            clusteredLighting.Update(clusterLights, cameraData.view, cameraData.projection,
+                clusterCompute ? &clusterShader : nullptr);
+        }
 
-        GLint prog = 0;
-        glGetIntegerv(GL_CURRENT_PROGRAM, &prog);
+        // ----------------------------------------------------
+        // Per-draw data, streamed into this frame's ring region
+        // ----------------------------------------------------
+        objectRing.BeginFrame();
+
+        // ground: flat grey, no lighting
+        ObjectBlock ground;
+        MakeIdentity(ground.model);
+        SetVec3(ground.baseColor, 0.5f, 0.5f, 0.5f);
+        ground.useTexture = GL_FALSE;
+        ground.useLighting = extraLights > 0 || shadows;  // lit only to show the extra lights or shadows
+        RingBuffer::Allocation groundData = PushObject(objectRing, ground);
+
+        // Bird: textured, lit, at origin
+        ObjectBlock bird;
+        MakeIdentity(bird.model);
+        SetVec3(bird.baseColor, 1.0f, 1.0f, 1.0f); // multiplied with texture
+        bird.useTexture = GL_TRUE;
+        bird.useLighting = GL_TRUE;
+        RingBuffer::Allocation birdData = PushObject(objectRing, bird);
+
+        bool drawGround = true, drawBird = true;
+        int flockDrawCount = flockCount;
+        if (cpuCull)
+        {
+            const double cullStart = ProfileNow();
+            CullBoxes(frustum, sceneBounds, visibleIds);
+            drawGround = !visibleIds.empty() && visibleIds.front() == 0;
+            drawBird = !visibleIds.empty() && visibleIds.back() == 1;
+            gFrameStats.frustumCullMs += (ProfileNow() - cullStart) * 1e3;
+            gFrameStats.frustumTested += 2;
+            gFrameStats.frustumVisible += (long long)visibleIds.size();
+        }
+
+        // flock: same material, transforms + tints per instance, filled in parallel
+        RingBuffer::Allocation flockData, flockInstances, flockCasters, visibilityInstances;
+        if (visibility)
+        {
+            flockRing.BeginFrame();
+            visibilityInstances = flockRing.Alloc((2 + flockCount) * sizeof(BirdInstance));
+            if (visibilityInstances.ptr)
+            {
+                BirdInstance* inst = (BirdInstance*)visibilityInstances.ptr;
+                for (int k = 0; k < 2; ++k)
+                {
+                    MakeIdentity(inst[k].model);
+                    ComputeNormalMatrix(inst[k].model, inst[k].normalMatrix);
+                    inst[k].tint[0] = inst[k].tint[1] = inst[k].tint[2] = inst[k].tint[3] = 1.0f;
+                }
+                FillFlockInstances(inst + 2, flockCount, currentTime);
+            }
+            flockRing.Commit();
+        }
+        else if (flockCount > 0)
+        {
+            flockData = PushObject(objectRing, bird);
+
+            flockRing.BeginFrame();
+            if (cpuCull)
+            {
+                // fill every bird, then upload only those in view
+                FillFlockInstances(flockScratch.data(), flockCount, currentTime);
+                const double cullStart = ProfileNow();
+                for (int i = 0; i < flockCount; ++i)
+                {
+                    flockBounds.center.x[i] = flockScratch[i].model[12];
+                    flockBounds.center.y[i] = flockScratch[i].model[13];
+                    flockBounds.center.z[i] = flockScratch[i].model[14];
+                }
+                flockDrawCount = (int)CullSpheres(frustum, flockBounds, visibleIds);
+                gFrameStats.frustumCullMs += (ProfileNow() - cullStart) * 1e3;
+                gFrameStats.frustumTested += flockCount;
+                gFrameStats.frustumVisible += flockDrawCount;
+
+                flockInstances = flockRing.Alloc(flockDrawCount * sizeof(BirdInstance));
+                if (flockInstances.ptr)
+                {
+                    BirdInstance* dst = (BirdInstance*)flockInstances.ptr;
+                    ParallelFor(flockDrawCount, 4096, [&](size_t begin, size_t end)
+                    {
+                        for (size_t i = begin; i < end; ++i)
+                            dst[i] = flockScratch[visibleIds[i]];
+                    });
+                }
+
+                // birds out of view still cast shadows into it
+                if (shadows)
+                {
+                    flockCasters = flockRing.Alloc(flockCount * sizeof(BirdInstance));
+                    if (flockCasters.ptr)
+                        memcpy(flockCasters.ptr, flockScratch.data(), flockCount * sizeof(BirdInstance));
+                }
+            }
+            else
+            {
+                flockInstances = flockRing.Alloc(flockCount * sizeof(BirdInstance));
+                if (flockInstances.ptr)
+                    FillFlockInstances((BirdInstance*)flockInstances.ptr, flockCount, currentTime);
+                flockCasters = flockInstances;
+            }
+            flockRing.Commit();
+        }
+
+        // mesh scene: untextured, lit, tinted per draw; the commands for
+        // the shadow casters and the camera share one commandRing frame
+        RingBuffer::Allocation sceneData, sceneCommands, casterCommands;
+        if (meshCount > 0)
+        {
+            ObjectBlock scene = bird;
+            scene.useTexture = GL_FALSE;
+            sceneData = PushObject(objectRing, scene);
+
+            if (cpuOcclusion)
+            {
+                double rasterStart = ProfileNow();
+                occlusion.Render(cameraData.view, cameraData.projection);
+                double testStart = ProfileNow();
+                int hidden = meshScene.CullOccluded(occlusion);
+                gFrameStats.occlusionRasterMs += (testStart - rasterStart) * 1e3;
+                gFrameStats.occlusionTestMs += (ProfileNow() - testStart) * 1e3;
+                gFrameStats.occlusionTested += meshCount;
+                gFrameStats.occlusionCulled += hidden;
+            }
+
+            commandRing.BeginFrame();
+            if (shadows)
+                casterCommands = meshScene.WriteCommands(commandRing, true);
+            sceneCommands = meshScene.WriteCommands(commandRing, false);
+            commandRing.Commit();
+        }
+
+        // culled field: same material; the compute pass's parameters share the ring
+        RingBuffer::Allocation fieldData, cullParams;
+        if (cullCount > 0)
+        {
+            ObjectBlock field = bird;
+            field.useTexture = GL_FALSE;
+            fieldData = PushObject(objectRing, field);
+
+            float viewProj[16];
+            ViewProjection(cameraData.view, cameraData.projection, viewProj);
+            cullParams = cullField.WriteParams(objectRing, frustum, viewProj, cameraData.viewPos);
+        }
+
+        objectRing.Commit();
 
         // ----------------------------------------------------
-        // Matrices
+        // --shadows: the bird and the mesh scene into the cached maps when
+        // they are stale, the whole flock over them every frame (also with
+        // --cpu-cull)
         // ----------------------------------------------------
-        float view[16];
-        float projection[16];
-        float groundModel[16];
-        float birdModel[16];
-
-        camera.GetViewMatrix(view);
-        MakePerspective(60.0f,
-            (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT,
-            0.1f, 100.0f, projection);
-        MakeIdentity(groundModel);
-        MakeIdentity(birdModel); // Bird at origin
-
-        glUniformMatrix4fv(glGetUniformLocation(prog, "uView"),
-            1, GL_FALSE, view);
-        glUniformMatrix4fv(glGetUniformLocation(prog, "uProjection"),
-            1, GL_FALSE, projection);
+        if (shadows)
+        {
+            function<void()> drawFlock;
+            if (flockCasters.size)
+            {
+                drawFlock = [&]
+                {
+                    shadowMaps.UseCasterProgram(ShadowMaps::kInstancedCaster);
+                    flockRing.BindRange(kFlockInstanceBinding, flockCasters);
+                    gGLState.BindVertexArray(birdVAO);
+                    glDrawArraysInstanced(GL_TRIANGLES, 0, (GLsizei)vertices.size(), flockCount);
+                };
+            }
+            shadowMaps.Render(lights, [&]
+            {
+                shadowMaps.UseCasterProgram(ShadowMaps::kObjectCaster);
+                if (objectRing.BindRange(kObjectBlockBinding, birdData))
+                {
+                    gGLState.BindVertexArray(birdVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+                }
+                if (casterCommands.size)
+                {
+                    shadowMaps.UseCasterProgram(ShadowMaps::kIndirectCaster);
+                    meshScene.Draw(commandRing, casterCommands, multiDraw);
+                }
+            }, drawFlock);
+            shadowMaps.Bind();
 
+            // Render() leaves the window's framebuffer bound
+            if (hizCulling)
+                hiz.BeginScene();
+        }
+
+        // Bind texture sampler to unit 0 (the light assignment may have used another program)
+        Shader& groundShader = SelectPhong(phongVariants, phongShader, groundKey, useVariants);
+        groundShader.Use();
+        SetPhongSamplers(groundShader);
+
+        // ----------------------------------------------------
+        // --visibility: IDs first, then every pixel shaded once
         // ----------------------------------------------------
-        // Lighting setup (visually distinct)
-// ----------------------------------------------------
-        // Directional light towards (-1, -1, -1) - soft white "sun"
-        glUniform3f(glGetUniformLocation(prog, "dirLight.direction"),
-            -1.0f, -1.0f, -1.0f);
-        glUniform3f(glGetUniformLocation(prog, "dirLight.ambient"),
-            0.15f, 0.15f, 0.15f);
-        glUniform3f(glGetUniformLocation(prog, "dirLight.diffuse"),
-            0.4f, 0.4f, 0.4f);
-        glUniform3f(glGetUniformLocation(prog, "dirLight.specular"),
-            0.5f, 0.5f, 0.5f);
-
-        // Point light animated in a circle (radius 10, height 5) - BRIGHT RED
-        float radius = 10.0f;
-        float speed = 1.0f;
-        float lx = cosf(currentTime * speed) * radius;
-        float lz = sinf(currentTime * speed) * radius;
-        float ly = 5.0f;
-
-        glUniform3f(glGetUniformLocation(prog, "pointLight.position"),
-            lx, ly, lz);
-        glUniform3f(glGetUniformLocation(prog, "pointLight.ambient"),
-            0.02f, 0.0f, 0.0f);
-        glUniform3f(glGetUniformLocation(prog, "pointLight.diffuse"),
-            1.0f, 0.2f, 0.2f);     // RED – easy to see moving
-        glUniform3f(glGetUniformLocation(prog, "pointLight.specular"),
-            1.0f, 0.2f, 0.2f);
-        glUniform1f(glGetUniformLocation(prog, "pointLight.constant"), 1.0f);
-        glUniform1f(glGetUniformLocation(prog, "pointLight.linear"), 0.09f);
-        glUniform1f(glGetUniformLocation(prog, "pointLight.quadratic"), 0.032f);
-
-        // Spotlight 5 units above Bird, pointing downward - WARM YELLOW CONE
-        glUniform3f(glGetUniformLocation(prog, "spotLight.position"),
-            0.0f, 5.0f, 0.0f);
-        glUniform3f(glGetUniformLocation(prog, "spotLight.direction"),
-            0.0f, -1.0f, 0.0f);
-        glUniform3f(glGetUniformLocation(prog, "spotLight.ambient"),
-            0.0f, 0.0f, 0.0f);
-        glUniform3f(glGetUniformLocation(prog, "spotLight.diffuse"),
-            1.0f, 1.0f, 0.7f);     // warm yellowish
-        glUniform3f(glGetUniformLocation(prog, "spotLight.specular"),
-            1.0f, 1.0f, 0.9f);
-
-        float innerCut = cosf(DegToRad(10.0f));
-        float outerCut = cosf(DegToRad(14.0f));
-        glUniform1f(glGetUniformLocation(prog, "spotLight.cutOff"), innerCut);
-        glUniform1f(glGetUniformLocation(prog, "spotLight.outerCutOff"), outerCut);
-        glUniform1f(glGetUniformLocation(prog, "spotLight.constant"), 1.0f);
-        glUniform1f(glGetUniformLocation(prog, "spotLight.linear"), 0.09f);
-        glUniform1f(glGetUniformLocation(prog, "spotLight.quadratic"), 0.032f);
-
-        // Camera position for specular
-        glUniform3f(glGetUniformLocation(prog, "uViewPos"),
-            camera.position.x, camera.position.y, camera.position.z);
-
-        // Bind texture sampler to unit 0
-        glUniform1i(glGetUniformLocation(prog, "uDiffuseMap"), 0);
+        if (visibility)
+        {
+            geometryCounter.Begin();
+            visibilityBuffer.Draw(flockRing, visibilityInstances);
+            geometryCounter.End();
+
+            resolveCounter.Begin();
+            visibilityBuffer.Resolve(birdTexture);
+            resolveCounter.End();
+            flockRing.EndFrame();
+        }
+        else
+        {
+            geometryCounter.Begin();
+
+            // ------------------------------------------------
+            // Draw ground
+            // ------------------------------------------------
+            if (drawGround && objectRing.BindRange(kObjectBlockBinding, groundData))
+            {
+                gGLState.BindVertexArray(gGroundVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            }
+
+            // ------------------------------------------------
+            // Draw Bird mesh
+            // ------------------------------------------------
+            if (drawBird && birdData.size)
+            {
+                Shader& birdShader = SelectPhong(phongVariants, phongShader, birdKey, useVariants);
+                birdShader.Use();
+                SetPhongSamplers(birdShader);
+                objectRing.BindRange(kObjectBlockBinding, birdData);
+
+                gGLState.BindTexture(0, GL_TEXTURE_2D, birdTexture);
+
+                gGLState.BindVertexArray(birdVAO);
+                glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+            }
+
+            // ------------------------------------------------
+            // Draw the flock: one instanced draw, same mesh and texture
+            // ------------------------------------------------
+            if (flockCount > 0)
+            {
+                // nothing in view (--cpu-cull) or a ring was full
+                if (flockData.size && flockInstances.size)
+                {
+                    Shader& shader = SelectPhong(flockVariants, flockShader, birdKey, useVariants);
+                    shader.Use();
+                    SetPhongSamplers(shader);
+                    objectRing.BindRange(kObjectBlockBinding, flockData);
+                    flockRing.BindRange(kFlockInstanceBinding, flockInstances);
+
+                    glDrawArraysInstanced(GL_TRIANGLES, 0, (GLsizei)vertices.size(), flockDrawCount);
+                }
+                flockRing.EndFrame();
+            }
+
+            geometryCounter.End();
+        }
 
         // ----------------------------------------------------
-        // Draw ground (flat grey, no lighting)
-// ----------------------------------------------------
-        glUniformMatrix4fv(glGetUniformLocation(prog, "uModel"),
-            1, GL_FALSE, groundModel);
-        glUniform1i(glGetUniformLocation(prog, "uUseTexture"), GL_FALSE);
-        glUniform1i(glGetUniformLocation(prog, "uUseLighting"), GL_FALSE);
-        glUniform3f(glGetUniformLocation(prog, "uBaseColor"),
-            0.5f, 0.5f, 0.5f); // grey
-
-        glBindVertexArray(gGroundVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
+        // Draw the mesh scene, timing just the submission
+        // ----------------------------------------------------
+        if (meshCount > 0 && sceneData.size && sceneCommands.size)
+        {
+            double submitStart = ProfileNow();
+            Shader& shader = SelectPhong(meshVariants, meshShader, meshKey, useVariants);
+            shader.Use();
+            SetPhongSamplers(shader);
+            objectRing.BindRange(kObjectBlockBinding, sceneData);
+            meshScene.Draw(commandRing, sceneCommands, multiDraw);
+            gFrameStats.submitMs += (ProfileNow() - submitStart) * 1e3;
+        }
+        if (meshCount > 0)
+            commandRing.EndFrame();
 
         // ----------------------------------------------------
-        // Draw Bird mesh (textured, lit)
-// ----------------------------------------------------
-        glUniformMatrix4fv(glGetUniformLocation(prog, "uModel"),
-            1, GL_FALSE, birdModel);
-        glUniform1i(glGetUniformLocation(prog, "uUseTexture"), GL_TRUE);
-        glUniform1i(glGetUniformLocation(prog, "uUseLighting"), GL_TRUE);
-        glUniform3f(glGetUniformLocation(prog, "uBaseColor"),
-            1.0f, 1.0f, 1.0f); // multiplied with texture
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, birdTexture);
+        // Cull the field on the GPU, then draw what survived
+        // ----------------------------------------------------
+        if (cullCount > 0 && fieldData.size && cullParams.size)
+        {
+            // --hiz: draw what was visible last frame, build the pyramid
+            // from that depth, then catch what it missed
+            CullPhase phase = hizCulling ? kCullFirstPhase : kCullFrustumOnly;
+            cullField.Cull(cullShader, objectRing, cullParams, phase, hiz.GetTexture());
+
+            Shader& shader = SelectPhong(meshVariants, meshShader, meshKey, useVariants);
+            shader.Use();
+            SetPhongSamplers(shader);
+            objectRing.BindRange(kObjectBlockBinding, fieldData);
+            cullField.Draw(phase);
+
+            if (hizCulling)
+            {
+                hiz.Build(hizShader);
+                cullField.Cull(cullShader, objectRing, cullParams, kCullSecondPhase, hiz.GetTexture());
 
-        glBindVertexArray(birdVAO);
-        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
-        glBindVertexArray(0);
+                shader.Use();
+                cullField.Draw(kCullSecondPhase);
+            }
+
+            if (cullVerify && firstFrame)
+                cullField.Verify(frustum);
+            cullField.CollectStats();
+        }
+
+        // --deferred: the scene is in the G-buffer, light it into the window
+        if (deferred)
+            deferredRenderer.Light(clusterLights, cameraData.view, cameraData.projection);
+
+        // the GPU owns this region until the frame's fence passes
+        objectRing.EndFrame();
+        if (clustered)
+            clusteredLighting.EndFrame();
+        if (deferred)
+            deferredRenderer.EndFrame();
+
+        if (hizCulling)
+            hiz.EndScene();
+
+        double cpuFrameMs = (ProfileNow() - frameStart) * 1e3;
 
         // Finish frame
         Loop();
+
+        if (firstFrame)
+        {
+            RecordSpan("FirstFrame", frameStart, ProfileNow(), { "FinishShader" });
+            PrintStartupReport("FirstFrame");
+            firstFrame = false;
+        }
+        // --gl-stats: averages every couple of seconds
+        if (glStats)
+        {
+            geometryCounter.Collect(gFrameStats.geometryRunsPerPixel, gFrameStats.geometrySamples);
+            resolveCounter.Collect(gFrameStats.resolveRunsPerPixel, gFrameStats.resolveSamples);
+            EndFrameStats(cpuFrameMs);
+        }
+        else
+        {
+            gFrameStats = FrameStats();
+        }
     }
 
     // Cleanup
@@ -888,8 +1727,30 @@ int main()
     glDeleteBuffers(1, &gGroundVBO);
     glDeleteVertexArrays(1, &gGroundVAO);
     glDeleteTextures(1, &birdTexture);
+    frameUniforms.Destroy();
+    objectRing.Destroy();
+    flockRing.Destroy();
+    commandRing.Destroy();
+    meshScene.Destroy();
+    cullField.Destroy();
+    hiz.Destroy();
+    clusteredLighting.Destroy();
+    deferredRenderer.Destroy();
+    shadowMaps.Destroy();
+    visibilityBuffer.Destroy();
+    geometryCounter.Destroy();
+    resolveCounter.Destroy();
 
     phongShader.Destroy();
+    flockShader.Destroy();
+    meshShader.Destroy();
+    phongVariants.Destroy();
+    flockVariants.Destroy();
+    meshVariants.Destroy();
+    cullShader.Destroy();
+    hizShader.Destroy();
+    clusterShader.Destroy();
+    ShutdownJobSystem();
     DestroyWindow();
 
     cout << "Program finished. Press Enter to exit...\n";